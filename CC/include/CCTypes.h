@@ -24,4 +24,16 @@ typedef float PointCoordinateType;
 //! Type of a single scalar field value
 typedef float ScalarType;
 
+//! Type of a point index (and of a number of points)
+/** 32 bits by default (i.e. up to ~4.29 billion points per cloud). Define
+	CC_CORE_LIB_USES_64_BITS_INDEXES (see the COMPILE_CC_CORE_LIB_WITH_64_BITS_INDEXES
+	CMake option) to handle bigger clouds. All the libraries and plugins linked
+	with CC_CORE_LIB must be compiled with the same setting.
+**/
+#ifdef CC_CORE_LIB_USES_64_BITS_INDEXES
+typedef unsigned long long PointIndexType;
+#else
+typedef unsigned PointIndexType;
+#endif
+
 #endif //CC_TYPES_HEADER
@@ -50,29 +50,29 @@ public:
 		virtual ~ChunkedPointCloud();
 
 		//**** inherited form GenericCloud ****//
-		inline virtual unsigned size() const { return m_points->currentSize(); }
+		inline virtual PointIndexType size() const { return m_points->currentSize(); }
 		virtual void forEach(genericPointAction& action);
 		virtual void getBoundingBox(CCVector3& bbMin, CCVector3& bbMax);
 		virtual void placeIteratorAtBegining();
 		virtual const CCVector3* getNextPoint();
 		virtual bool enableScalarField();
 		virtual bool isScalarFieldEnabled() const;
-		virtual void setPointScalarValue(unsigned pointIndex, ScalarType value);
-		virtual ScalarType getPointScalarValue(unsigned pointIndex) const;
+		virtual void setPointScalarValue(PointIndexType pointIndex, ScalarType value);
+		virtual ScalarType getPointScalarValue(PointIndexType pointIndex) const;
 
 		//**** inherited form GenericIndexedCloud ****//
-		inline virtual const CCVector3* getPoint(unsigned index)  { return point(index); }
-		inline virtual void getPoint(unsigned index, CCVector3& P) const { P = *point(index); }
+		inline virtual const CCVector3* getPoint(PointIndexType index)  { return point(index); }
+		inline virtual void getPoint(PointIndexType index, CCVector3& P) const { P = *point(index); }
 
 		//**** inherited form GenericIndexedCloudPersist ****//
-		inline virtual const CCVector3* getPointPersistentPtr(unsigned index) { return point(index); }
+		inline virtual const CCVector3* getPointPersistentPtr(PointIndexType index) { return point(index); }
 
 		//**** other methods ****//
 
 		//! Const version of getPoint
-		inline virtual const CCVector3* getPoint(unsigned index) const { return point(index); }
+		inline virtual const CCVector3* getPoint(PointIndexType index) const { return point(index); }
 		//! Const version of getPointPersistentPtr
-		inline virtual const CCVector3* getPointPersistentPtr(unsigned index) const { return point(index); }
+		inline virtual const CCVector3* getPointPersistentPtr(PointIndexType index) const { return point(index); }
 
 		//! Applies a rigid transformation to the cloud, for the scaled scale
 		/** WARNING: THIS METHOD IS NOT COMPATIBLE WITH PARALLEL STRATEGIES
@@ -88,7 +88,7 @@ public:
 			\param newNumberOfPoints the new number of points
 			\return true if the method succeeds, false otherwise
 		**/
-		virtual bool resize(unsigned newNumberOfPoints);
+		virtual bool resize(PointIndexType newNumberOfPoints);
 
 		//! Reserves memory for the point database
 		/** This method tries to reserve some memory to store points
@@ -98,7 +98,7 @@ public:
 			\param newNumberOfPoints the new number of points
 			\return true if the method succeeds, false otherwise
 		**/
-		virtual bool reserve(unsigned newNumberOfPoints);
+		virtual bool reserve(PointIndexType newNumberOfPoints);
 
 		//! Clears the cloud database
 		/** Equivalent to resize(0).
@@ -210,26 +210,26 @@ public:
 		virtual void deleteAllScalarFields();
 
 		//! Returns cloud capacity (i.e. reserved size)
-		inline virtual unsigned capacity() const { return m_points->capacity(); }
+		inline virtual PointIndexType capacity() const { return m_points->capacity(); }
 
 protected:
 
 		//! Swaps two points (and their associated scalar values!)
-		virtual void swapPoints(unsigned firstIndex, unsigned secondIndex);
+		virtual void swapPoints(PointIndexType firstIndex, PointIndexType secondIndex);
 
 		//! Returns non const access to a given point
 		/** WARNING: index must be valid
 			\param index point index
 			\return pointer on point stored data
 		**/
-		inline virtual CCVector3* point(unsigned index) { assert(index < size()); return reinterpret_cast<CCVector3*>(m_points->getValue(index)); }
+		inline virtual CCVector3* point(PointIndexType index) { assert(index < size()); return reinterpret_cast<CCVector3*>(m_points->getValue(index)); }
 
 		//! Returns const access to a given point
 		/** WARNING: index must be valid
 			\param index point index
 			\return pointer on point stored data
 		**/
-		inline virtual const CCVector3* point(unsigned index) const { assert(index < size()); return reinterpret_cast<CCVector3*>(m_points->getValue(index)); }
+		inline virtual const CCVector3* point(PointIndexType index) const { assert(index < size()); return reinterpret_cast<CCVector3*>(m_points->getValue(index)); }
 
 		//! 3D Points database
 		GenericChunkedArray<3,PointCoordinateType>* m_points;
@@ -238,7 +238,7 @@ protected:
 		bool m_validBB;
 
 		//! 'Iterator' on the points db
-		unsigned m_currentPointIndex;
+		PointIndexType m_currentPointIndex;
 
 		//! Associated scalar fields
 		std::vector<ScalarField*> m_scalarFields;
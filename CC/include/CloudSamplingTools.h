@@ -30,6 +30,7 @@ class GenericProgressCallback;
 class GenericIndexedCloud;
 class GenericIndexedCloudPersist;
 class GenericIndexedMesh;
+class NeighbourhoodCache;
 class ReferenceCloud;
 class ReferenceCloudPersist;
 class SimpleCloud;
@@ -147,17 +148,25 @@ public:
 	//! Resamples a point cloud (process based on inter point distance)
 	/** The cloud is resampled so that there is no point nearer than a given distance to other points
 		It works by picking a reference point, removing all points which are to close to this point, and repeating these two steps until the result is reached
+		In parallel mode, the points are swept cell by cell (with cells larger than the biggest
+		distance). The cells are split in 8 'colors' so that two cells of the same color never
+		share a neighbour cell: the cells of a given color are processed concurrently, and the
+		colors one after the other. The selection is not the same as the one of the sequential
+		sweep, but it gives the same guarantee and it doesn't depend on the number of threads.
 		\param cloud the point cloud to resample
 		\param minDistance the distance under which a point in the resulting cloud cannot have any neighbour
+		\param modParams parameters of the (optional) modulation of the distance by the active scalar field
 		\param octree associated octree if available
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\param multiThread whether to use the parallel algorithm or the sequential one
 		\return a reference cloud corresponding to the resampling 'selection'
 	**/
 	static ReferenceCloud* resampleCloudSpatially(	GenericIndexedCloudPersist* cloud,
 													PointCoordinateType minDistance,
 													const SFModulationParams& modParams,
 													DgmOctree* octree = 0,
-													GenericProgressCallback* progressCb = 0);
+													GenericProgressCallback* progressCb = 0,
+													bool multiThread = false);
 
 	//! Statistical Outliers Removal (SOR) filter
 	/** This filter removes points based on their mean distance to their distance (by comparing it to the average distance of all points to their neighbors).
@@ -167,13 +176,15 @@ public:
 		\param nSigma number of sigmas under which the points should be kept
 		\param octree associated octree if available
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\param cache precomputed neighbourhoods (optional - only used if it holds at least 'knn' neighbours per point)
 		\return a reference cloud corresponding to the filtered cloud
 	**/
 	static ReferenceCloud* sorFilter(	GenericIndexedCloudPersist* cloud,
 										int knn = 6,
 										double nSigma = 1.0,
 										DgmOctree* octree = 0,
-										GenericProgressCallback* progressCb = 0);
+										GenericProgressCallback* progressCb = 0,
+										const NeighbourhoodCache* cache = 0);
 
 	//! Noise filter based on the distance to the approximate local surface
 	/** This filter removes points based on their distance relatively to the best fit plane computed on their neighbors.
@@ -187,6 +198,7 @@ public:
 		\param absoluteError absolute error (if useAbsoluteError is true)
 		\param octree associated octree if available
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\param cache precomputed neighbourhoods (optional - the neighbourhoods it can't provide are extracted on the fly - note that exactly 'knn' neighbours are read from it while the on the fly extraction may return more)
 		\return a reference cloud corresponding to the filtered cloud
 	**/
 	static ReferenceCloud* noiseFilter(	GenericIndexedCloudPersist* cloud,
@@ -198,7 +210,8 @@ public:
 										bool useAbsoluteError = true,
 										double absoluteError = 0.0,
 										DgmOctree* octree = 0,
-										GenericProgressCallback* progressCb = 0);
+										GenericProgressCallback* progressCb = 0,
+										const NeighbourhoodCache* cache = 0);
 
 protected:
 
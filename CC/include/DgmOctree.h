@@ -25,6 +25,7 @@
 #include "CCConst.h"
 #include "CCPlatform.h"
 #include "GenericProgressCallback.h"
+#include "GenericIndexedCloudPersist.h"
 
 //system
 #include <vector>
@@ -97,11 +98,14 @@ public:
 	//! Invalid cell code
 	static const OctreeCellCodeType INVALID_CELL_CODE = (~(OctreeCellCodeType)0);
 
+	//! Invalid point index (see DgmOctree::removePoints and DgmOctree::buildFromSubset)
+	static const PointIndexType INVALID_POINT_INDEX = (~static_cast<PointIndexType>(0));
+
 	//! Octree cell codes container
 	typedef std::vector<OctreeCellCodeType> cellCodesContainer;
 
 	//! Octree cell indexes container
-	typedef std::vector<unsigned> cellIndexesContainer;
+	typedef std::vector<PointIndexType> cellIndexesContainer;
 
 	//! Structure used during nearest neighbour search
 	/** Association between a point, its index and its square distance to the query point.
@@ -112,7 +116,7 @@ public:
 		//! Point
 		const CCVector3* point;
 		//! Point index
-		unsigned pointIndex;
+		PointIndexType pointIndex;
 		//! Point associated distance value
 		double squareDistd;
 
@@ -125,7 +129,7 @@ public:
 		}
 
 		//! Constructor with point and its index
-		PointDescriptor(const CCVector3* P, unsigned index)
+		PointDescriptor(const CCVector3* P, PointIndexType index)
 			: point(P)
 			, pointIndex(index)
 			, squareDistd(-1.0)
@@ -133,7 +137,7 @@ public:
 		}
 
 		//! Constructor with point, its index and square distance
-		PointDescriptor(const CCVector3* P, unsigned index, double d2)
+		PointDescriptor(const CCVector3* P, PointIndexType index, double d2)
 			: point(P)
 			, pointIndex(index)
 			, squareDistd(d2)
@@ -250,7 +254,7 @@ public:
 		/** This field is only used by the "unique nearest neighbour" search algorithm
 			(see DgmOctree::findTheNearestNeighborStartingFromCell).
 		**/
-		unsigned theNearestPointIndex;
+		PointIndexType theNearestPointIndex;
 
 		//! Default constructor
 		NearestNeighboursSearchStruct()
@@ -308,6 +312,28 @@ public:
 		{}
 	};
 
+	//! Output of the batched neighbourhood queries (compressed sparse rows)
+	/** The neighbours of the i-th query point are stored in 'indexes' and
+		'squareDists' between offsets[i] (included) and offsets[i+1] (excluded).
+		See DgmOctree::findNeighborsInASphereBatch and DgmOctree::findNearestNeighborsBatch.
+	**/
+	struct NeighboursBatch
+	{
+		//! Row offsets (size = number of queries + 1)
+		std::vector<PointIndexType> offsets;
+		//! Neighbours indexes (in the associated cloud)
+		std::vector<PointIndexType> indexes;
+		//! Neighbours square distances to their query point
+		std::vector<PointCoordinateType> squareDists;
+
+		//! Returns the number of query points
+		inline unsigned size() const { return offsets.empty() ? 0 : static_cast<unsigned>(offsets.size()-1); }
+		//! Returns the number of neighbours of a given query point
+		inline unsigned count(unsigned queryIndex) const { return static_cast<unsigned>(offsets[queryIndex+1]-offsets[queryIndex]); }
+		//! Clears the structure
+		inline void clear() { offsets.clear(); indexes.clear(); squareDists.clear(); }
+	};
+
 	//! Association between an index and the code of an octree cell
 	/** Index could be the index of a point, in which case the code
 		would correspond to the octree cell where the point lies.
@@ -315,7 +341,7 @@ public:
 	struct IndexAndCode
 	{
 		//! index
-		unsigned theIndex;
+		PointIndexType theIndex;
 		//! cell code
 		OctreeCellCodeType theCode;
 
@@ -327,7 +353,7 @@ public:
 		}
 
 		//! Constructor from an index and a code
-		IndexAndCode(unsigned index, OctreeCellCodeType code)
+		IndexAndCode(PointIndexType index, OctreeCellCodeType code)
 			: theIndex(index)
 			, theCode(code)
 		{
@@ -340,6 +366,14 @@ public:
 		{
 		}
 
+		//! Copy operator
+		IndexAndCode& operator = (const IndexAndCode& ic)
+		{
+			theIndex = ic.theIndex;
+			theCode = ic.theCode;
+			return *this;
+		}
+
 		//! Code-based comparison operator
 		/** \param a first IndexAndCode structure
 			\param b second IndexAndCode structure
@@ -375,7 +409,7 @@ public:
 		//! Truncated cell code
 		OctreeCellCodeType truncatedCode;
 		//! Cell index in octree structure (see m_thePointsAndTheirCellCodes)
-		unsigned index;
+		PointIndexType index;
 		//! Set of points lying inside this cell
 		ReferenceCloud* points;
 
@@ -420,7 +454,7 @@ public:
 	//! Builds the structure
 	/** Octree 3D limits are determined automatically.
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
-		\return the number of points projected in the octree
+		\return the number of points projected in the octree (capped to INT_MAX, see getNumberOfProjectedPoints)
 	**/
 	int build(GenericProgressCallback* progressCb = 0);
 
@@ -433,7 +467,7 @@ public:
 		\param pointsMinFilter the lower limits for the projected points along X, Y and Z (is specified)
 		\param pointsMaxFilter the upper limits for the projected points along X, Y and Z (is specified)
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
-		\return the number of points projected in the octree
+		\return the number of points projected in the octree (capped to INT_MAX, see getNumberOfProjectedPoints)
 	**/
 	int build(	const CCVector3& octreeMin,
 				const CCVector3& octreeMax,
@@ -441,12 +475,22 @@ public:
 				const CCVector3* pointsMaxFilter = 0,
 				GenericProgressCallback* progressCb = 0);
 
+	//! Sets whether the structure should be built in parallel or not
+	/** If false, the cell codes are computed in a single loop then sorted
+		with std::sort (former build path - mainly for benchmarking).
+		Enabled by default.
+	**/
+	inline void setParallelBuild(bool state) { m_parallelBuild = state; }
+
+	//! Returns whether the structure is built in parallel (see setParallelBuild)
+	inline bool parallelBuild() const { return m_parallelBuild; }
+
 	/**** GETTERS ****/
 
 	//! Returns the number of points projected into the octree
 	/** \return the number of projected points
 	**/
-	inline unsigned getNumberOfProjectedPoints() const { return m_numberOfProjectedPoints; }
+	inline PointIndexType getNumberOfProjectedPoints() const { return m_numberOfProjectedPoints; }
 
 	//! Returns the lower boundaries of the octree
 	/** \return the lower coordinates along X,Y and Z
@@ -465,6 +509,12 @@ public:
 	**/
 	void getBoundingBox(CCVector3& bbMin, CCVector3& bbMax) const;
 
+	//! Returns the bounding box of the points projected in the octree
+	/**	\param bbMin lower bounding-box limits (Xmin,Ymin,Zmin)
+		\param bbMax higher bounding-box limits (Xmax,Ymax,Zmax)
+	**/
+	inline void getPointsBoundingBox(CCVector3& bbMin, CCVector3& bbMax) const { bbMin = m_pointsMin; bbMax = m_pointsMax; }
+
 	//! Returns the lowest cell positions in the octree along all dimensions and for a given level of subdivision
 	/** For example, at a level	n, the octree length is 2^n cells along each
 		dimension. The lowest cell position along each dimension will be expressed
@@ -637,6 +687,55 @@ public:
 											NeighboursSet& neighbours,
 											unsigned char level) const;
 
+	//! Batched form of the spherical neighbourhood search
+	/** Query points are grouped by octree cell (at the given level) so that the
+		candidate points of each cell are gathered only once. The distances are
+		then computed on packed coordinates (vectorized when SSE2 is available).
+		Use findBestLevelForAGivenNeighbourhoodSizeExtraction to get the right
+		value for 'level'. Thread-safe (can be called concurrently).
+		\param queryPoints query points
+		\param count number of query points
+		\param radius sphere radius
+		\param level subdivision level at which to apply the extraction process
+		\param[out] batch neighbours of each query point (see NeighboursBatch)
+		\param sortValues whether to sort each set of neighbours by increasing distance
+		\return false if not enough memory
+	**/
+	bool findNeighborsInASphereBatch(	const CCVector3* queryPoints,
+										unsigned count,
+										PointCoordinateType radius,
+										unsigned char level,
+										NeighboursBatch& batch,
+										bool sortValues = false) const;
+
+	//! Batched form of the nearest neighbours search
+	/** Same principle as findNeighborsInASphereBatch. Contrarily to
+		findNearestNeighborsStartingFromCell, exactly min(k,number of points)
+		neighbours are returned for each query point, sorted by increasing distance.
+		Thread-safe (can be called concurrently).
+		\param queryPoints query points
+		\param count number of query points
+		\param k number of neighbours to find
+		\param level subdivision level at which to start the search (see findBestLevelForAGivenPopulationPerCell)
+		\param[out] batch neighbours of each query point (see NeighboursBatch)
+		\return false if not enough memory
+	**/
+	bool findNearestNeighborsBatch(	const CCVector3* queryPoints,
+									unsigned count,
+									unsigned k,
+									unsigned char level,
+									NeighboursBatch& batch) const;
+
+	//! Converts the neighbours of one query of a batch to a standard neighbours set
+	/** \param batch batch of neighbours (see findNeighborsInASphereBatch and findNearestNeighborsBatch)
+		\param queryIndex query point index
+		\param[out] neighbours neighbours set (resized to the number of neighbours)
+		\return the number of neighbours
+	**/
+	unsigned getBatchNeighbours(const NeighboursBatch& batch,
+								unsigned queryIndex,
+								NeighboursSet& neighbours) const;
+
 	//! Input/output parameters structure for getPointsInCylindricalNeighbourhood
 	struct CylindricalNeighbourhood
 	{
@@ -871,7 +970,7 @@ public:
 	unsigned char findBestLevelForAGivenCellNumber(unsigned indicativeNumberOfCells) const;
 
 	//! Returns the ith cell code
-	inline const OctreeCellCodeType& getCellCode(unsigned index) const { return m_thePointsAndTheirCellCodes[index].theCode; }
+	inline const OctreeCellCodeType& getCellCode(PointIndexType index) const { return m_thePointsAndTheirCellCodes[index].theCode; }
 
 	//! Returns the list of codes corresponding to the octree cells for a given level of subdivision
 	/** Only the non empty cells are represented in the octree structure.
@@ -926,7 +1025,7 @@ public:
 	void diff(unsigned char octreeLevel, const cellsContainer &codesA, const cellsContainer &codesB, int &diffA, int &diffB, int &cellsA, int &cellsB) const;
 
 	//! Returns the number of cells for a given level of subdivision
-	inline const unsigned& getCellNumber(unsigned char level) const
+	inline const PointIndexType& getCellNumber(unsigned char level) const
 	{
 		assert(level <= MAX_OCTREE_LEVEL);
 		return m_cellCount[level];
@@ -1005,7 +1104,9 @@ public:
 		number of points, avoiding great loss of performances. The only limitation is when the
 		level of subdivision is deepest level. In this case no more splitting is possible.
 
-		Parallel processing is based on QtConcurrent::map system.
+		Parallel processing relies on a work stealing scheduler: cells are distributed
+		between the threads by batches of similar population, and idle threads steal
+		cells from the busiest ones (dense cells don't stall the whole process).
 
 		\param startingLevel the initial level of subdivision
 		\param func the function to apply
@@ -1030,7 +1131,9 @@ public:
 	/** The function to apply should be of the form DgmOctree::octreeCellFunc. In this case
 		the octree cells are scanned one by one at the same level of subdivision.
 
-		Parallel processing is based on QtConcurrent::map system.
+		Parallel processing relies on a work stealing scheduler: cells are distributed
+		between the threads by batches of similar population, and idle threads steal
+		cells from the busiest ones (dense cells don't stall the whole process).
 
 		\param level the level of subdivision
 		\param func the function to apply
@@ -1062,6 +1165,104 @@ public:
 	//! Returns whether multi-threading (parallel) computation is supported or not
 	static bool MultiThreadSupport();
 
+	/**** ORDERED POINTS ****/
+
+	//! Sets whether the octree should keep a copy of the points coordinates, sorted by cell code
+	/** With this copy, the points of neighbouring cells are contiguous in memory and
+		neighbourhood extraction doesn't need to query the associated cloud anymore (at
+		the cost of 3 more coordinates per point). If the octree is already built, the
+		copy is computed (or released) immediately. Otherwise it will be computed at
+		build time.
+		\warning the copy must be released (see releaseOrderedPoints) as soon as the
+		associated cloud points are modified.
+		\param state whether to keep the ordered copy or not
+		\return false if there's not enough memory (in which case the copy is disabled)
+	**/
+	bool setKeepOrderedPoints(bool state);
+
+	//! Returns whether the octree keeps an ordered copy of the points coordinates
+	inline bool keepOrderedPoints() const { return m_keepOrderedPoints; }
+
+	//! Releases the ordered copy of the points coordinates (see setKeepOrderedPoints)
+	/** Should be called each time the associated cloud points are modified.
+		The copy will not be computed again until the next call to setKeepOrderedPoints
+		or to build.
+	**/
+	void releaseOrderedPoints();
+
+	//! Returns whether the ordered copy of the points coordinates is available
+	inline bool hasOrderedPoints() const { return !m_orderedPoints.empty(); }
+
+	//! Returns the memory used by the ordered copy of the points coordinates (in bytes)
+	inline size_t getOrderedPointsMemory() const { return m_orderedPoints.capacity() * sizeof(CCVector3); }
+
+	/**** CELL INDEX LOOKUP TABLES ****/
+
+	//! Sets whether cells should be looked up through per-level tables instead of a binary search
+	/** The table of a given level maps the (truncated) cell codes to the index of the
+		first point of each cell. It is built the first time a cell of this level is
+		looked up (and shared by all threads). Low levels use a dense table (one entry
+		per potential cell), the others an open-addressing hash table. Levels with too
+		many cells (or with almost one point per cell) keep the binary search.
+		Enabled by default.
+	**/
+	void setUseCellIndexTables(bool state);
+
+	//! Returns whether cells are looked up through per-level tables (see setUseCellIndexTables)
+	inline bool useCellIndexTables() const { return m_useCellIndexTables; }
+
+	//! Releases the cell index lookup tables (they will be built again on demand)
+	void releaseCellIndexTables();
+
+	/**** INCREMENTAL UPDATE ****/
+
+	//! Updates the octree after some points have been removed from the associated cloud
+	/** The remaining points keep their cell codes and their order: no projection
+		nor sort is required. The remaining points must have kept their relative
+		order in the cloud (as ChunkedPointCloud::resize after a compaction does).
+		\param newIndexes for each point of the cloud BEFORE the removal, its new index (or INVALID_POINT_INDEX if it has been removed)
+		\return false if an error occurred (in which case the octree should be rebuilt)
+	**/
+	virtual bool removePoints(const std::vector<PointIndexType>& newIndexes);
+
+	//! Updates the octree after some points have been appended to the associated cloud
+	/** Only the new points are projected and sorted. The resulting (sorted) run
+		is then merged with the existing cells. The octree bounding-box is unchanged.
+		\param firstIndex index of the first new point in the associated cloud (all the points after it are new)
+		\return false if some new points lie outside of the octree bounding-box or if there's not enough memory (in which case the octree should be rebuilt)
+	**/
+	virtual bool insertPoints(PointIndexType firstIndex);
+
+	//! Builds the octree of a subset of the points of another octree
+	/** The octree bounding-box and the cell codes are those of the source octree,
+		so that the subset directly reuses its ordering (no projection nor sort).
+		Typically used for the clouds resulting from a segmentation.
+		\param source octree of the original cloud
+		\param newIndexes for each point of the original cloud, its index in this octree's associated cloud (or INVALID_POINT_INDEX if it is not part of it)
+		\return the number of points in the octree (or -1 if an error occurred)
+	**/
+	virtual int buildFromSubset(const DgmOctree& source, const std::vector<PointIndexType>& newIndexes);
+
+	//! Restores a previously computed octree structure (typically loaded from a file)
+	/** The points are neither projected nor sorted: the per-level tables are deduced
+		from the structure in a single pass. The structure is checked first (point
+		indexes, codes order and, on a regular sample of the points, the cell codes
+		themselves).
+		\param cells sorted cell codes (swapped with the octree structure in case of success)
+		\param octreeMin lower limits of the octree bounding-box
+		\param octreeMax higher limits of the octree bounding-box
+		\param pointsMin lower limits of the projected points bounding-box
+		\param pointsMax higher limits of the projected points bounding-box
+		\param fillIndexes min and max occupied cells positions at the deepest level of subdivision (min xyz then max xyz)
+		\return false if the structure doesn't match the associated cloud (in which case the octree is cleared)
+	**/
+	virtual bool restoreStructure(	cellsContainer& cells,
+									const CCVector3& octreeMin,
+									const CCVector3& octreeMax,
+									const CCVector3& pointsMin,
+									const CCVector3& pointsMax,
+									const int fillIndexes[6]);
+
 protected:
 
 	/*******************************/
@@ -1072,9 +1273,9 @@ protected:
 	struct octreeTopDownScanStruct
 	{
 		//! Cell position inside subdivision level
-		unsigned pos;
+		PointIndexType pos;
 		//! Number of points in cell
-		unsigned elements;
+		PointIndexType elements;
 		//! Subdivision level
 		unsigned char level;
 	};
@@ -1090,7 +1291,7 @@ protected:
 	GenericIndexedCloudPersist* m_theAssociatedCloud;
 
 	//! Number of points projected in the octree
-	unsigned m_numberOfProjectedPoints;
+	PointIndexType m_numberOfProjectedPoints;
 
 	//! Min coordinates of the octree bounding-box
 	CCVector3 m_dimMin;
@@ -1107,20 +1308,39 @@ protected:
 	//! Min and max occupied cells indexes, for all dimensions and every subdivision level
 	int m_fillIndexes[(MAX_OCTREE_LEVEL+1)*6];
 	//! Number of cells per level of subdivision
-	unsigned m_cellCount[MAX_OCTREE_LEVEL+1];
+	PointIndexType m_cellCount[MAX_OCTREE_LEVEL+1];
 	//! Max cell population per level of subdivision
-	unsigned m_maxCellPopulation[MAX_OCTREE_LEVEL+1];
+	PointIndexType m_maxCellPopulation[MAX_OCTREE_LEVEL+1];
 	//! Average cell population per level of subdivision
 	double m_averageCellPopulation[MAX_OCTREE_LEVEL+1];
 	//! Std. dev. of cell population per level of subdivision
 	double m_stdDevCellPopulation[MAX_OCTREE_LEVEL+1];
 
+	//! Whether the structure is built in parallel or not
+	bool m_parallelBuild;
+
+	//! Copy of the points coordinates (same order as m_thePointsAndTheirCellCodes)
+	std::vector<CCVector3> m_orderedPoints;
+	//! Whether the ordered copy of the points coordinates should be kept or not
+	bool m_keepOrderedPoints;
+
+	//! Cell index lookup table (for a given level of subdivision)
+	struct CellIndexTable;
+	//! Cell index lookup tables, per level of subdivision
+	struct CellIndexTables;
+	//! Cell index lookup tables (built on demand - possibly by concurrent threads)
+	CellIndexTables* m_cellIndexTables;
+	//! Whether cells should be looked up through the per-level tables or not
+	bool m_useCellIndexTables;
+
 	/******************************/
 	/**         METHODS          **/
 	/******************************/
 
 	//! Generic method to build the octree structure
-	/** \param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+	/** Cell codes are computed by chunks of points (in parallel if multi-threading
+		is supported) and then sorted with a radix sort.
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
 		\return the number of points projected in the octree
 	**/
 	int genericBuild(GenericProgressCallback* progressCb = 0);
@@ -1134,6 +1354,35 @@ protected:
 	//! Updates the tables containing the number of octree cells for each level of subdivision
 	void updateCellCountTable();
 
+	//! Computes the ordered copy of the points coordinates (see setKeepOrderedPoints)
+	bool computeOrderedPoints();
+
+	//! Deduces the 'fill indexes' of all levels from the deepest one
+	void updateFillIndexesFromDeepestLevel();
+
+	//! Shrinks the points bounding-box (and the fill indexes) to the associated cloud bounding-box
+	/** Used after the removal of some points.
+	**/
+	void shrinkPointsBoundingBox();
+
+	//! Updates the tables after an incremental update of the octree
+	void finishIncrementalUpdate();
+
+	//! Returns the cell index lookup table of a given level (built on first request)
+	/** \param bitDec binary shift corresponding to the level of subdivision (see GET_BIT_SHIFT)
+		\return the lookup table or 0 if it's not available (disabled, too many cells or not enough memory)
+	**/
+	const CellIndexTable* getCellIndexTable(unsigned char bitDec) const;
+
+	//! Returns the point corresponding to an element of the octree structure
+	/** Uses the ordered copy of the points coordinates if available.
+	**/
+	inline const CCVector3* getPointAt(cellsContainer::const_iterator p) const
+	{
+		return m_orderedPoints.empty()	? m_theAssociatedCloud->getPointPersistentPtr(p->theIndex)
+										: &m_orderedPoints[p - m_thePointsAndTheirCellCodes.begin()];
+	}
+
 	//! Computes statistics about cells for a given level of subdivision
 	/** This method requires some computation, therefore it shouldn't be
 		called too often.
@@ -1169,7 +1418,8 @@ protected:
 #endif
 
 	//! Returns the index of a given cell represented by its code
-	/** The index is found thanks to a binary search. The index of an existing cell
+	/** The index is found thanks to the lookup table of the corresponding level
+		(see setUseCellIndexTables) or a binary search. The index of an existing cell
 		is between 0 and the number of points projected in the octree minus 1. If
 		the cell code cannot be found in the octree structure, then the method returns
 		an index equal to the number of projected points (m_numberOfProjectedPoints).
@@ -1177,7 +1427,7 @@ protected:
 		\param bitDec binary shift corresponding to the level of subdivision (see GET_BIT_SHIFT)
 		\return the index of the cell (or 'm_numberOfProjectedPoints' if none found)
 	**/
-	unsigned getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned char bitDec) const;
+	PointIndexType getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned char bitDec) const;
 
 	//! Returns the index of a given cell represented by its code
 	/** Same algorithm as the other "getCellIndex" method, but in an optimized form.
@@ -1188,7 +1438,7 @@ protected:
 		\param end last index of the sub-list in which to perform the binary search
 		\return the index of the cell (or 'm_numberOfProjectedPoints' if none found)
 	**/
-	unsigned getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned char bitDec, unsigned begin, unsigned end) const;
+	PointIndexType getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned char bitDec, PointIndexType begin, PointIndexType end) const;
 };
 
 }
@@ -34,6 +34,9 @@ class GenericIndexedCloudPersist;
 class ReferenceCloud;
 class ChunkedPointCloud;
 class GenericProgressCallback;
+class GenericPointStream;
+class GenericDistanceOutput;
+class MeshDistanceGrid;
 struct OctreeAndMeshIntersection;
 
 //! Several entity-to-entity distances computation algorithms (cloud-cloud, cloud-mesh, point-triangle, etc.)
@@ -51,12 +54,11 @@ public: //distance to clouds or meshes
 
 		//! Maximum search distance (true distance won't be computed if greater)
 		/** Set to -1 to deactivate (default).
-			\warning Not compatible with closest point set determination (see CPSet)
 		**/
 		ScalarType maxSearchDist;
 
 		//! Whether to use multi-thread or single thread mode
-		/** If maxSearchDist > 0, single thread mode will be forced.
+		/** Compatible with maxSearchDist > 0 (capped distances).
 		**/
 		bool multiThread;
 
@@ -88,9 +90,27 @@ public: //distance to clouds or meshes
 		**/
 		bool reuseExistingLocalModels;
 
+		//! Whether to precompute the local models on a regular grid (see LocalModelGrid)
+		/** For local models only (i.e. ignored if localModel = NO_MODEL).
+			One model is computed (in parallel) for each non empty cell of the reference
+			octree at level localModelGridLevel. Each compared point then simply uses the
+			model associated to its nearest neighbour. Much faster than computing a model
+			for each point, and independent of the processing order (contrarily to
+			reuseExistingLocalModels, which is ignored in this case).
+		**/
+		bool useLocalModelGrid;
+
+		//! Level of subdivision of the grid of local models
+		/** For local models only, and if useLocalModelGrid is true.
+			If set to 0 (default), the level is deduced from the neighbourhood size.
+		**/
+		unsigned char localModelGridLevel;
+
 		//! Container of (references to) points to store the "Closest Point Set"
 		/** The Closest Point Set corresponds to (the reference to) each compared point's closest neighbour.
-			\warning Not compatible with max search distance (see maxSearchDist)
+			If a max search distance is defined (see maxSearchDist), compared points without any neighbour
+			below this distance are associated to DgmOctree::INVALID_POINT_INDEX ("no match"): in this case
+			the references must be checked (with ReferenceCloud::getPointGlobalIndex) before being used.
 		**/
 		ReferenceCloud* CPSet;
 
@@ -100,6 +120,18 @@ public: //distance to clouds or meshes
 		**/
 		bool resetFormerDistances;
 
+		//! Whether to keep the input reference octree as is (if possible)
+		/** By default, both octrees are (re)built on a common bounding-box for each comparison.
+			If this option is set and an already built reference octree is passed to
+			computeCloud2CloudDistance, only the compared octree is (re)built in the same
+			frame, provided that the reference octree bounding-box contains the points to
+			compare (otherwise a temporary reference octree is built, and the input one is
+			left untouched). Allows comparing several clouds to the same reference (even
+			concurrently) while computing its octree only once.
+			\warning All the reference points must be projected in the reference octree.
+		**/
+		bool reuseReferenceOctree;
+
 		//! Default constructor/initialization
 		Cloud2CloudDistanceComputationParams()
 			: octreeLevel(0)
@@ -110,8 +142,11 @@ public: //distance to clouds or meshes
 			, kNNForLocalModel(0)
 			, radiusForLocalModel(0)
 			, reuseExistingLocalModels(false)
+			, useLocalModelGrid(false)
+			, localModelGridLevel(0)
 			, CPSet(0)
 			, resetFormerDistances(true)
+			, reuseReferenceOctree(false)
 		{}
 	};
 
@@ -123,8 +158,6 @@ public: //distance to clouds or meshes
 		NAN_VALUE but one can avoid this by definining the Cloud2CloudDistanceComputationParams::resetFormerDistances
 		parameters to false. But even in this case, only values above Cloud2CloudDistanceComputationParams::maxSearchDist
 		will remain untouched.
-		\warning Max search distance (Cloud2CloudDistanceComputationParams::maxSearchDist > 0) is not compatible with the
-		determination of the Closest Point Set (Cloud2CloudDistanceComputationParams::CPSet)
 		\param comparedCloud the compared cloud (the distances will be computed on these points)
 		\param referenceCloud the reference cloud (the distances will be computed relatively to these points)
 		\param params distance computation parameters
@@ -140,6 +173,54 @@ public: //distance to clouds or meshes
 											DgmOctree* compOctree = 0,
 											DgmOctree* refOctree = 0);
 
+	//! Computes the "nearest neighbour distance" between two point clouds tile by tile (bounded memory)
+	/** The compared cloud is split in spatial tiles. Each tile is compared (see computeCloud2CloudDistance)
+		to the reference points lying in the tile bounding-box enlarged by the max search distance, so that
+		the octrees and the temporary structures are only built for one tile at a time. The tiles are sized so
+		that the memory required to process each of them stays below 'maxTileMemory' (as far as the point
+		density allows it). The distances are directly written in the compared cloud 'enabled' scalar field
+		(and the results are the same as with computeCloud2CloudDistance). The points of both clouds are sorted by
+		cell once and for all, which requires one additional index per point (outside of the tiles budget).
+		\warning Cloud2CloudDistanceComputationParams::maxSearchDist must be defined (> 0) and local models are not supported.
+		\param comparedCloud the compared cloud (the distances will be computed on these points)
+		\param referenceCloud the reference cloud (the distances will be computed relatively to these points)
+		\param params distance computation parameters
+		\param maxTileMemory max memory (in bytes) used to process a single tile
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return 0 if ok, a negative value otherwise
+	**/
+	static int computeCloud2CloudDistanceTiled(	GenericIndexedCloudPersist* comparedCloud,
+												GenericIndexedCloudPersist* referenceCloud,
+												Cloud2CloudDistanceComputationParams& params,
+												size_t maxTileMemory,
+												GenericProgressCallback* progressCb = 0);
+
+	//! Computes the "nearest neighbour distance" between two point streams tile by tile (out-of-core)
+	/** Out-of-core version of computeCloud2CloudDistanceTiled: the clouds are never loaded in memory, so that
+		they can be larger than the available memory. The streams are read several times: the points are first
+		sorted by tile in temporary files, then the tiles are loaded and processed one after the other, and the
+		distances are finally sent to the output in the compared stream order. The temporary files require about
+		24 bytes per compared point and 12 bytes per reference point (times the number of tiles it overlaps)
+		of disk space.
+		\warning Cloud2CloudDistanceComputationParams::maxSearchDist must be defined (> 0). Local models and
+		the Closest Point Set are not supported.
+		\param comparedStream the compared points (the distances will be computed on these points)
+		\param referenceStream the reference points (the distances will be computed relatively to these points)
+		\param output receives the distances (one per compared point, in the same order)
+		\param params distance computation parameters
+		\param maxTileMemory max memory (in bytes) used to process a single tile
+		\param tempFilesPrefix prefix (path and base name) of the temporary files
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return 0 if ok, -1 if not enough memory, -2 if the input is invalid or the process has been cancelled, -3 on read/write error
+	**/
+	static int computeCloud2CloudDistanceOutOfCore(	GenericPointStream* comparedStream,
+													GenericPointStream* referenceStream,
+													GenericDistanceOutput* output,
+													Cloud2CloudDistanceComputationParams& params,
+													size_t maxTileMemory,
+													const char* tempFilesPrefix,
+													GenericProgressCallback* progressCb = 0);
+
 	//! Cloud-to-mes distances computation parameters
 	struct Cloud2MeshDistanceComputationParams
 	{
@@ -166,12 +247,30 @@ public: //distance to clouds or meshes
 		//! Whether triangle normals should be computed in the 'direct' order (true) or 'indirect' (false)
 		bool flipNormals;
 
-		//! Whether to use multi-thread or single thread mode (if maxSearchDist > 0, single thread mode is forced)
+		//! Whether to use multi-thread or single thread mode (compatible with maxSearchDist > 0)
+		/** Ignored if useDistanceMap is true.
+		**/
 		bool multiThread;
 
+		//! Whether to use a Bounding Volume Hierarchy over the mesh triangles instead of the octree grid
+		/** The mesh is not projected in the octree grid (octreeLevel is ignored): memory consumption
+			only depends on the number of triangles and performances don't depend on their size.
+			Compatible with signed distances, maxSearchDist > 0 and the Closest Point Set.
+			If true, useDistanceMap is ignored.
+		**/
+		bool useBVH;
+
+		//! Precomputed distance grid (optional)
+		/** If set, the distances are read from this grid (see MeshDistanceGrid) instead of being computed
+			from scratch: they are interpolated in the grid, except close to the mesh (see MeshDistanceGrid::getExactBandWidth)
+			and beyond the grid band where they are computed exactly with the grid hierarchy (useBVH is implied).
+			The grid must have been built on the same mesh. All distances are exact if a Closest Point Set is requested.
+		**/
+		const MeshDistanceGrid* distanceGrid;
+
 		//! Cloud to store the Closest Point Set
 		/** The cloud should be initialized but empty on input. It will have the same size as the compared cloud on output.
-			\warning Not compatible with maxSearchDist > 0.
+			If maxSearchDist > 0, the points without any triangle below this distance get NaN coordinates ('no match').
 		**/
 		ChunkedPointCloud* CPSet;
 
@@ -183,6 +282,8 @@ public: //distance to clouds or meshes
 			, signedDistances(false)
 			, flipNormals(false)
 			, multiThread(true)
+			, useBVH(false)
+			, distanceGrid(0)
 			, CPSet(0)
 		{}
 	};
@@ -195,7 +296,7 @@ public: //distance to clouds or meshes
 		\param mesh the reference mesh (the distances will be computed relatively to its triangles)
 		\param params parameters
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
-		\param cloudOctree the pre-computed octree of the compared cloud (warning: its bounding box should be equal to the union of both point cloud and mesh bbs and it should be cubical - it is automatically computed if 0)
+		\param cloudOctree the pre-computed octree of the compared cloud (warning: its bounding box should be equal to the union of both point cloud and mesh bbs and it should be cubical - it is automatically computed if 0 - ignored if params.useBVH is true)
 		\return 0 if ok, a negative value otherwise
 	**/
 	static int computeCloud2MeshDistance(	GenericIndexedCloudPersist* pointCloud,
@@ -249,6 +350,70 @@ public: //distance to simple entities (triangles, planes, etc.)
 	**/
 	static ScalarType computePoint2PlaneDistance(const CCVector3* P, const PointCoordinateType* planeEquation);
 
+	//! Computes the distances between a set of points and a triangle
+	/** Batched version of computePoint2TriangleDistance (same conventions).
+		The points are given as separate arrays of coordinates (one per dimension).
+		SIMD instructions are used if the CPU supports them (see GetSIMDInstructionSet).
+		Whatever the instruction set, the results are exactly the same. They may only
+		differ from the ones of computePoint2TriangleDistance by a rounding error.
+		WARNING: if not signed, the returned distances are SQUARED!
+		\param x points X coordinates
+		\param y points Y coordinates
+		\param z points Z coordinates
+		\param count number of points
+		\param theTriangle a 3D triangle
+		\param signedDist whether to compute the signed or positive (SQUARED) distances
+		\param dists [out] distance between each point and the triangle (array of size 'count')
+	**/
+	static void computePoints2TriangleDistances(const PointCoordinateType* x,
+												const PointCoordinateType* y,
+												const PointCoordinateType* z,
+												unsigned count,
+												const GenericTriangle* theTriangle,
+												bool signedDist,
+												ScalarType* dists);
+
+	//! Computes the (signed) distances between a set of points and a plane
+	/** Batched version of computePoint2PlaneDistance (same results).
+		The points are given as separate arrays of coordinates (one per dimension).
+		SIMD instructions are used if the CPU supports them (see GetSIMDInstructionSet).
+		\param x points X coordinates
+		\param y points Y coordinates
+		\param z points Z coordinates
+		\param count number of points
+		\param planeEquation plane equation: [a,b,c,d] as 'ax+by+cz=d' with norm(a,bc)==1
+		\param dists [out] signed distance between each point and the plane (array of size 'count')
+	**/
+	static void computePoints2PlaneDistances(	const PointCoordinateType* x,
+												const PointCoordinateType* y,
+												const PointCoordinateType* z,
+												unsigned count,
+												const PointCoordinateType* planeEquation,
+												ScalarType* dists);
+
+	//! SIMD instruction sets used by the batched distance computations
+	enum SIMD_INSTRUCTION_SET
+	{
+		SIMD_NONE,		/**< Scalar code **/
+		SIMD_SSE4_1,	/**< SSE 4.1 **/
+		SIMD_AVX2,		/**< AVX2 **/
+	};
+
+	//! Returns the instruction set used by the batched distance computations
+	/** By default, the best instruction set supported by the CPU (and the OS) is used.
+	**/
+	static SIMD_INSTRUCTION_SET GetSIMDInstructionSet();
+
+	//! Returns the best instruction set supported by the CPU (and the OS)
+	static SIMD_INSTRUCTION_SET GetSupportedSIMDInstructionSet();
+
+	//! Sets the instruction set used by the batched distance computations (for testing/benchmarking purposes)
+	/** WARNING: not thread safe (must not be called while distances are computed).
+		\param set instruction set (if not supported, the best supported one is used instead)
+		\return the instruction set actually used
+	**/
+	static SIMD_INSTRUCTION_SET SetSIMDInstructionSet(SIMD_INSTRUCTION_SET set);
+
 	//! Error estimators
 	enum ERROR_MEASURES
 	{
@@ -357,6 +522,7 @@ public: //other methods
 		\param referenceOctree the second octree
 		\param maxSearchDist max search distance (or any negative value if no max distance is defined)
 		\param progressCb the client method can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\param reuseReferenceOctree whether to keep the reference octree as is if possible (see Cloud2CloudDistanceComputationParams::reuseReferenceOctree). If not possible, 'referenceOctree' is replaced by a new octree (that the caller must delete).
 		\return return code
 	**/
 	static SOReturnCode synchronizeOctrees(	GenericIndexedCloudPersist* comparedCloud,
@@ -364,7 +530,8 @@ public: //other methods
 											DgmOctree* &comparedOctree,
 											DgmOctree* &referenceOctree,
 											PointCoordinateType maxSearchDist = 0,
-											GenericProgressCallback* progressCb = 0);
+											GenericProgressCallback* progressCb = 0,
+											bool reuseReferenceOctree = false);
 
 	//! Returns whether multi-threading (parallel) computation is supported or not
 	static bool MultiThreadSupport();
@@ -392,6 +559,20 @@ protected:
 													Cloud2MeshDistanceComputationParams& params,
 													GenericProgressCallback* progressCb = 0);
 
+	//! Computes the distances between a point cloud and a mesh with a Bounding Volume Hierarchy (see MeshBVH)
+	/** This method is used by computeCloud2MeshDistance if Cloud2MeshDistanceComputationParams::useBVH is true
+		(or if a distance grid is set, in which case its hierarchy is used).
+		\param pointCloud the compared cloud
+		\param mesh the reference mesh
+		\param params parameters
+		\param progressCb the client method can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return -1 if an error occurred (e.g. not enough memory) and 0 otherwise
+	**/
+	static int computeCloud2MeshDistanceWithBVH(GenericIndexedCloudPersist* pointCloud,
+												GenericIndexedMesh* mesh,
+												Cloud2MeshDistanceComputationParams& params,
+												GenericProgressCallback* progressCb = 0);
+
 	//! Computes the "nearest neighbour distance" without local modeling for all points of an octree cell
 	/** This method has the generic syntax of a "cellular function" (see DgmOctree::localFunctionPtr).
 		Specific parameters are transmitted via the "additionalParameters" structure.
@@ -422,6 +603,18 @@ protected:
 	static bool computeCellHausdorffDistanceWithLocalModel(	const DgmOctree::octreeCell& cell,
 															void** additionalParameters,
 															NormalizedProgress* nProgress = 0);
+
+	//! Computes the "nearest neighbour distance" with precomputed local models for all points of an octree cell
+	/** This method has the generic syntax of a "cellular function" (see DgmOctree::localFunctionPtr).
+		Same as computeCellHausdorffDistanceWithLocalModel, except that the models are
+		retrieved from a LocalModelGrid (5th additional parameter) instead of being computed.
+		\param cell structure describing the cell on which processing is applied
+		\param additionalParameters see method description
+		\param nProgress optional (normalized) progress notification (per-point)
+	**/
+	static bool computeCellHausdorffDistanceWithLocalModelGrid(	const DgmOctree::octreeCell& cell,
+																void** additionalParameters,
+																NormalizedProgress* nProgress = 0);
 };
 
 }
@@ -0,0 +1,185 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef FLAT_KD_TREE_HEADER
+#define FLAT_KD_TREE_HEADER
+
+//Local
+#include "CCCoreLib.h"
+#include "CCGeom.h"
+#include "CCTypes.h"
+
+//system
+#include <vector>
+#include <algorithm>
+
+namespace CCLib
+{
+
+class GenericIndexedCloud;
+class GenericProgressCallback;
+
+//! Implicit (array-based) KD-tree dedicated to point to point distance queries
+/** The tree is balanced (median splits) and stored in flat arrays: the sons of
+	node i are nodes 2i+1 and 2i+2, and no cell is allocated individually. Each
+	leaf holds a bucket of MAX_LEAF_SIZE/2 to MAX_LEAF_SIZE points whose coordinates
+	are copied contiguously (in the tree order). Queries are iterative (no recursion)
+	and can be batched (in which case they are processed in parallel if possible).
+	\warning The points coordinates are copied: the tree must be built again if the cloud changes.
+**/
+class CC_CORE_LIB_API FlatKDTree
+{
+public:
+
+	//! Max number of points per leaf
+	static const unsigned MAX_LEAF_SIZE = 32;
+
+	//! Invalid point index (see FlatKDTree::findNearestNeighbours)
+	static const unsigned INVALID_INDEX = (~0u);
+
+	//! Default constructor
+	FlatKDTree();
+
+	//! Destructor
+	virtual ~FlatKDTree();
+
+	//! Builds the tree
+	/** \param cloud the point cloud from which to build the tree
+		\param progressCb the client method can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return success
+	**/
+	bool buildFromCloud(GenericIndexedCloud* cloud, GenericProgressCallback* progressCb = 0);
+
+	//! Clears the tree
+	void clear();
+
+	//! Returns the point cloud from which the tree has been built
+	inline GenericIndexedCloud* getAssociatedCloud() const { return m_associatedCloud; }
+
+	//! Returns the number of points in the tree
+	inline unsigned size() const { return static_cast<unsigned>(m_indexes.size()); }
+
+	//! Nearest point search
+	/** \param queryPoint coordinates of the query point
+		\param nearestPointIndex [out] index (in the associated cloud) of the nearest point
+		\param maxDist distance above which points are ignored
+		\return whether a point p such that ||p-queryPoint|| < maxDist has been found
+	**/
+	bool findNearestNeighbour(	const PointCoordinateType* queryPoint,
+								unsigned& nearestPointIndex,
+								ScalarType maxDist) const;
+
+	//! Checks if there's a point p in the tree such that ||p-queryPoint|| < maxDist
+	/** Faster than FlatKDTree::findNearestNeighbour as the search stops at the first valid point.
+	**/
+	bool findPointBelowDistance(const PointCoordinateType* queryPoint,
+								ScalarType maxDist) const;
+
+	//! Searches for the points that lie to a given distance (up to a tolerance) from a query point
+	/** \param queryPoint query point coordinates
+		\param distance distance wished between the query point and resulting points
+		\param tolerance each resulting point p is such that distance-tolerance <= ||p-queryPoint|| <= distance+tolerance
+		\param points [out] indexes (in the associated cloud) of the matching points (appended to the vector)
+		\return the number of matching points
+	**/
+	unsigned findPointsLyingToDistance(	const PointCoordinateType* queryPoint,
+										ScalarType distance,
+										ScalarType tolerance,
+										std::vector<unsigned>& points) const;
+
+	/**** BATCHED QUERIES ****/
+
+	//! Counts the query points that have at least one point of the tree closer than maxDist
+	/** Equivalent to calling FlatKDTree::findPointBelowDistance for each query point.
+		\param queryPoints query points
+		\param count number of query points
+		\param maxDist max distance
+		\return the number of query points having a point of the tree at a distance < maxDist
+	**/
+	unsigned countPointsBelowDistance(	const CCVector3* queryPoints,
+										unsigned count,
+										ScalarType maxDist) const;
+
+	//! Nearest point search for a set of query points
+	/** Equivalent to calling FlatKDTree::findNearestNeighbour for each query point.
+		\param queryPoints query points
+		\param count number of query points
+		\param maxDist distance above which points are ignored
+		\param nearestPointIndexes [out] nearest point index for each query point (or INVALID_INDEX if none was found)
+		\return false if there's not enough memory
+	**/
+	bool findNearestNeighbours(	const CCVector3* queryPoints,
+								unsigned count,
+								ScalarType maxDist,
+								std::vector<unsigned>& nearestPointIndexes) const;
+
+protected:
+
+	//! Returns the square distance between a point and the bounding-box of a node (0 if inside)
+	inline PointCoordinateType pointToNodeSquareDistance(const PointCoordinateType* P, unsigned node) const
+	{
+		const CCVector3& bbMin = m_nodeMin[node];
+		const CCVector3& bbMax = m_nodeMax[node];
+		PointCoordinateType d2 = 0;
+		for (int dim=0; dim<3; ++dim)
+		{
+			PointCoordinateType d = 0;
+			if (P[dim] < bbMin.u[dim])
+				d = bbMin.u[dim] - P[dim];
+			else if (P[dim] > bbMax.u[dim])
+				d = P[dim] - bbMax.u[dim];
+			d2 += d*d;
+		}
+		return d2;
+	}
+
+	//! Returns the square distance between a point and the farthest corner of the bounding-box of a node
+	inline PointCoordinateType pointToNodeMaxSquareDistance(const PointCoordinateType* P, unsigned node) const
+	{
+		const CCVector3& bbMin = m_nodeMin[node];
+		const CCVector3& bbMax = m_nodeMax[node];
+		PointCoordinateType d2 = 0;
+		for (int dim=0; dim<3; ++dim)
+		{
+			PointCoordinateType d = std::max(P[dim] - bbMin.u[dim], bbMax.u[dim] - P[dim]);
+			d2 += d*d;
+		}
+		return d2;
+	}
+
+	//! Returns the range of points (in the tree order) below a given node
+	void getNodePointsRange(unsigned node, unsigned& first, unsigned& last) const;
+
+	//! Points coordinates (in the tree order)
+	std::vector<CCVector3> m_points;
+	//! Points indexes in the associated cloud (in the tree order)
+	std::vector<unsigned> m_indexes;
+	//! Lower corner of each node bounding-box (tight)
+	std::vector<CCVector3> m_nodeMin;
+	//! Upper corner of each node bounding-box (tight)
+	std::vector<CCVector3> m_nodeMax;
+	//! First point of each leaf (+ total number of points)
+	std::vector<unsigned> m_leafStart;
+	//! Index of the first leaf (= number of internal nodes)
+	unsigned m_firstLeaf;
+	//! Associated cloud
+	GenericIndexedCloud* m_associatedCloud;
+};
+
+}
+
+#endif //FLAT_KD_TREE_HEADER
@@ -25,6 +25,11 @@
 #endif
 
 #include "CCPlatform.h"
+#include "CCTypes.h"
+
+#if defined(CC_CORE_LIB_USES_64_BITS_INDEXES) && !defined(CC_ENV_64)
+#error 64 bits point indexes require a 64 bits environment
+#endif
 
 //DGM: we don't really need to 'chunk' the memory on 64 bits architectures
 //But we keep this mechanism as it is handy when displaying entities!
@@ -71,13 +76,13 @@ public:
 	/** This corresponds to the number of inserted elements
 		\return the number of elements actually inserted into this array
 	**/
-	inline unsigned currentSize() const { return m_count; }
+	inline PointIndexType currentSize() const { return m_count; }
 
 	//! Returns the maximum array size
 	/** This is the total (reserved) size, not only the number of inserted elements
 		\return the number of elements that can be stored in this array
 	**/
-	inline unsigned capacity() const { return m_capacity; }
+	inline PointIndexType capacity() const { return m_capacity; }
 
 	//! Specifies if the array has been initialized or not
 	/** The array is initialized after a call to reserve or resize (with at least one element).
@@ -162,21 +167,21 @@ public:
 			_cDest += N;
 
 #ifdef CC_ENV_64
-			unsigned elemToFill = m_capacity;
+			PointIndexType elemToFill = m_capacity;
 #else
-			unsigned elemToFill = m_perChunkCount[0];
+			PointIndexType elemToFill = m_perChunkCount[0];
 #endif
-			unsigned elemFilled = 1;
-			unsigned copySize = 1;
+			PointIndexType elemFilled = 1;
+			PointIndexType copySize = 1;
 
 			//recurrence
 			while (elemFilled < elemToFill)
 			{
-				unsigned cs = elemToFill-elemFilled;
+				PointIndexType cs = elemToFill-elemFilled;
 				if (copySize < cs)
 					cs = copySize;
 				memcpy(_cDest,_cSrc,cs*sizeof(ElementType)*N);
-				_cDest += cs*static_cast<unsigned>(N);
+				_cDest += cs*static_cast<PointIndexType>(N);
 				elemFilled += cs;
 				copySize <<= 1;
 			}
@@ -202,12 +207,12 @@ public:
 		\param capacity the new number of elements
 		\return true if the method succeeds, false otherwise
 	**/
-	bool reserve(unsigned capacity)
+	bool reserve(PointIndexType capacity)
 	{
 #ifdef CC_ENV_64
 		try
 		{
-			m_data.resize(capacity * N);
+			m_data.resize(static_cast<size_t>(capacity) * N);
 		}
 		catch (const std::bad_alloc&)
 		{
@@ -226,7 +231,7 @@ public:
 			}
 
 			//the number of new elements that we want to reserve
-			unsigned capacityForThisChunk = capacity - m_capacity;
+			PointIndexType capacityForThisChunk = capacity - m_capacity;
 			//free room left in the current chunk
 			unsigned freeSpaceInThisChunk = MAX_NUMBER_OF_ELEMENTS_PER_CHUNK-m_perChunkCount.back();
 			//of course, we can't take more than that...
@@ -267,7 +272,7 @@ public:
 		\param valueForNewElements the default value for the new elements (only necessary if the previous parameter is true)
 		\return true if the method succeeds, false otherwise
 	**/
-	bool resize(unsigned count, bool initNewElements = false, const ElementType* valueForNewElements = 0)
+	bool resize(PointIndexType count, bool initNewElements = false, const ElementType* valueForNewElements = 0)
 	{
 		//if the new size is 0, we can simply clear the array!
 		if (count == 0)
@@ -284,7 +289,7 @@ public:
 			if (initNewElements)
 			{
 				//m_capacity should be up-to-date after a call to 'reserve'
-				for (unsigned i=m_count; i<m_capacity; ++i)
+				for (PointIndexType i=m_count; i<m_capacity; ++i)
 					setValue(i,valueForNewElements);
 			}
 		}
@@ -293,7 +298,7 @@ public:
 #ifdef CC_ENV_64
 			try
 			{
-				m_data.resize(count * N); //shouldn't fail, smaller
+				m_data.resize(static_cast<size_t>(count) * N); //shouldn't fail, smaller
 			}
 			catch (const std::bad_alloc&)
 			{
@@ -310,7 +315,7 @@ public:
 					return true;
 
 				//number of elements to remove
-				unsigned spaceToFree = m_capacity - count;
+				PointIndexType spaceToFree = m_capacity - count;
 				//number of elements in this chunk
 				unsigned numberOfElementsForThisChunk = m_perChunkCount.back();
 
@@ -359,7 +364,7 @@ public:
 		- global iterator may be invalidated
 		\param size new size (must be inferior to m_capacity)
 	**/
-	void setCurrentSize(unsigned size)
+	void setCurrentSize(PointIndexType size)
 	{
 		if (size > m_capacity)
 		{
@@ -374,7 +379,7 @@ public:
 	/** \param index an element index
 		\return pointer to the ith element.
 	**/
-	inline ElementType* operator[] (unsigned index) { return getValue(index); }
+	inline ElementType* operator[] (PointIndexType index) { return getValue(index); }
 
 	//***** data access *****//
 
@@ -407,11 +412,11 @@ public:
 	/** \param index the index of the element to return
 		\return a pointer to the ith element
 	**/
-	inline ElementType* getValue(unsigned index)
+	inline ElementType* getValue(PointIndexType index)
 	{
 		assert(index < m_capacity);
 #ifdef CC_ENV_64
-		return &(m_data[index * N]);
+		return &(m_data[static_cast<size_t>(index) * N]);
 #else
 		return m_theChunks[index >> CHUNK_INDEX_BIT_DEC]+((index & ELEMENT_INDEX_BIT_MASK)*N);
 #endif
@@ -421,11 +426,11 @@ public:
 	/** \param index the index of the element to return
 		\return a pointer to the ith element
 	**/
-	inline const ElementType* getValue(unsigned index) const
+	inline const ElementType* getValue(PointIndexType index) const
 	{
 		assert(index < m_capacity);
 #ifdef CC_ENV_64
-		return &(m_data[index * N]);
+		return &(m_data[static_cast<size_t>(index) * N]);
 #else
 		return m_theChunks[index >> CHUNK_INDEX_BIT_DEC]+((index & ELEMENT_INDEX_BIT_MASK)*N);
 #endif
@@ -435,7 +440,7 @@ public:
 	/** \param index the index of the element to update
 		\param value the new value for the element
 	**/
-	inline void setValue(unsigned index, const ElementType* value)
+	inline void setValue(PointIndexType index, const ElementType* value)
 	{
 		assert(index < m_capacity);
 		memcpy(getValue(index), value, N*sizeof(ElementType));
@@ -493,7 +498,7 @@ public:
 		memcpy(m_maxVal,m_minVal,sizeof(ElementType)*N);
 
 		//we update boundaries with all other values
-		for (unsigned i=1; i<m_count; ++i)
+		for (PointIndexType i=1; i<m_count; ++i)
 		{
 			const ElementType* val = getValue(i);
 			for (unsigned j=0; j<N; ++j)
@@ -510,7 +515,7 @@ public:
 	/** \param firstElementIndex first element index
 		\param secondElementIndex second element index
 	**/
-	void swap(unsigned firstElementIndex, unsigned secondElementIndex)
+	void swap(PointIndexType firstElementIndex, PointIndexType secondElementIndex)
 	{
 		assert(firstElementIndex < m_count && secondElementIndex < m_count);
 		ElementType* v1 = getValue(firstElementIndex);
@@ -540,7 +545,7 @@ public:
 	{
 #ifdef CC_ENV_64
 		//fake chunk count
-		return (m_count >> CHUNK_INDEX_BIT_DEC) + ((m_count & (MAX_NUMBER_OF_ELEMENTS_PER_CHUNK-1)) ? 1 : 0);
+		return static_cast<unsigned>(m_count >> CHUNK_INDEX_BIT_DEC) + ((m_count & (MAX_NUMBER_OF_ELEMENTS_PER_CHUNK-1)) ? 1 : 0);
 #else
 		return static_cast<unsigned>(m_theChunks.size());
 #endif
@@ -551,7 +556,7 @@ public:
 	{
 		assert(index < chunksCount());
 #ifdef CC_ENV_64
-		return  (index + 1 < chunksCount() ? MAX_NUMBER_OF_ELEMENTS_PER_CHUNK : currentSize() % MAX_NUMBER_OF_ELEMENTS_PER_CHUNK);
+		return  (index + 1 < chunksCount() ? MAX_NUMBER_OF_ELEMENTS_PER_CHUNK : static_cast<unsigned>(currentSize() % MAX_NUMBER_OF_ELEMENTS_PER_CHUNK));
 #else
 		return m_perChunkCount[index];
 #endif
@@ -562,7 +567,7 @@ public:
 	{
 		assert(index < chunksCount());
 #ifdef CC_ENV_64
-		return data() + (index * MAX_NUMBER_OF_ELEMENTS_PER_CHUNK * N);
+		return data() + (static_cast<size_t>(index) * MAX_NUMBER_OF_ELEMENTS_PER_CHUNK * N);
 #else
 		return m_theChunks[index];
 #endif
@@ -573,7 +578,7 @@ public:
 	{
 		assert(index < chunksCount());
 #ifdef CC_ENV_64
-		return data() + (index * MAX_NUMBER_OF_ELEMENTS_PER_CHUNK * N);
+		return data() + (static_cast<size_t>(index) * MAX_NUMBER_OF_ELEMENTS_PER_CHUNK * N);
 #else
 		return m_theChunks[index];
 #endif
@@ -585,7 +590,7 @@ public:
 	**/
 	bool copy(GenericChunkedArray<N,ElementType>& dest) const
 	{
-		unsigned count = currentSize();
+		PointIndexType count = currentSize();
 		if (!dest.resize(count))
 			return false;
 		
@@ -593,11 +598,11 @@ public:
 #ifdef CC_ENV_64
 		std::copy(m_data.begin(),m_data.end(),dest.m_data.begin());
 #else
-		unsigned copyCount = 0;
+		PointIndexType copyCount = 0;
 		assert(dest.m_theChunks.size() <= m_theChunks.size());
 		for (size_t i=0; i<dest.m_theChunks.size(); ++i)
 		{
-			unsigned toCopyCount = std::min<unsigned>(count-copyCount,m_perChunkCount[i]);
+			unsigned toCopyCount = static_cast<unsigned>(std::min<PointIndexType>(count-copyCount,m_perChunkCount[i]));
 			assert(dest.m_perChunkCount[i] >= toCopyCount);
 			memcpy(dest.m_theChunks[i],m_theChunks[i],toCopyCount*sizeof(ElementType)*N);
 			copyCount += toCopyCount;
@@ -639,12 +644,12 @@ protected:
 #endif
 
 	//! Total number of elements
-	unsigned m_count;
+	PointIndexType m_count;
 	//! Max total number of elements
-	unsigned m_capacity;
+	PointIndexType m_capacity;
 
 	//! Iterator
-	unsigned m_iterator;
+	PointIndexType m_iterator;
 };
 
 //! Specialization of GenericChunkedArray for the case where N=1 (speed up)
@@ -668,13 +673,13 @@ public:
 	/** This corresponds to the number of inserted elements
 		\return the number of elements actually inserted into this array
 	**/
-	inline unsigned currentSize() const { return m_count; }
+	inline PointIndexType currentSize() const { return m_count; }
 
 	//! Returns the maximum array size
 	/** This is the total (reserved) size, not only the number of inserted elements
 		\return the number of elements that can be stored in this array
 	**/
-	inline unsigned capacity() const { return m_capacity; }
+	inline PointIndexType capacity() const { return m_capacity; }
 
 	//! Specifies if the array has been initialized or not
 	/** The array is initialized after a call to reserve or resize (with at least one element).
@@ -749,14 +754,14 @@ public:
 			//we copy only the first element to init recurrence
 			*_cDest++ = fillValue;
 
-			unsigned elemToFill = m_perChunkCount[0];
-			unsigned elemFilled = 1;
-			unsigned copySize = 1;
+			PointIndexType elemToFill = m_perChunkCount[0];
+			PointIndexType elemFilled = 1;
+			PointIndexType copySize = 1;
 
 			//recurrence
 			while (elemFilled < elemToFill)
 			{
-				unsigned cs = elemToFill-elemFilled;
+				PointIndexType cs = elemToFill-elemFilled;
 				if (copySize < cs)
 					cs = copySize;
 				memcpy(_cDest,_cSrc,cs*sizeof(ElementType));
@@ -785,12 +790,12 @@ public:
 		\param capacity the new number of elements
 		\return true if the method succeeds, false otherwise
 	**/
-	bool reserve(unsigned capacity)
+	bool reserve(PointIndexType capacity)
 	{
 #ifdef CC_ENV_64
 		try
 		{
-			m_data.resize(capacity);
+			m_data.resize(static_cast<size_t>(capacity));
 		}
 		catch (const std::bad_alloc&)
 		{
@@ -809,7 +814,7 @@ public:
 			}
 
 			//the number of new elements that we want to reserve
-			unsigned capacityForThisChunk = capacity - m_capacity;
+			PointIndexType capacityForThisChunk = capacity - m_capacity;
 			//free room left in the current chunk
 			unsigned freeSpaceInThisChunk = MAX_NUMBER_OF_ELEMENTS_PER_CHUNK - m_perChunkCount.back();
 			//of course, we can't take more than that...
@@ -849,7 +854,7 @@ public:
 		\param valueForNewElements the default value for the new elements (only necessary if the previous parameter is true)
 		\return true if the method succeeds, false otherwise
 	**/
-	bool resize(unsigned count, bool initNewElements = false, const ElementType& valueForNewElements = 0)
+	bool resize(PointIndexType count, bool initNewElements = false, const ElementType& valueForNewElements = 0)
 	{
 		//if the new size is 0, we can simply clear the array!
 		if (count == 0)
@@ -865,7 +870,7 @@ public:
 			if (initNewElements)
 			{
 				//m_capacity should be up-to-date after a call to 'reserve'
-				for (unsigned i=m_count; i<m_capacity; ++i)
+				for (PointIndexType i=m_count; i<m_capacity; ++i)
 					setValue(i,valueForNewElements);
 			}
 		}
@@ -874,7 +879,7 @@ public:
 #ifdef CC_ENV_64
 			try
 			{
-				m_data.resize(count); //shouldn't fail, smaller
+				m_data.resize(static_cast<size_t>(count)); //shouldn't fail, smaller
 			}
 			catch (const std::bad_alloc&)
 			{
@@ -891,7 +896,7 @@ public:
 					return true;
 
 				//number of elements to remove
-				unsigned spaceToFree = m_capacity-count;
+				PointIndexType spaceToFree = m_capacity-count;
 				//number of elements in this chunk
 				unsigned numberOfElementsForThisChunk = m_perChunkCount.back();
 
@@ -940,7 +945,7 @@ public:
 		- global iterator may be invalidated
 		\param size new size (must be inferior to m_capacity)
 	**/
-	void setCurrentSize(unsigned size)
+	void setCurrentSize(PointIndexType size)
 	{
 		if (size > m_capacity)
 		{
@@ -955,7 +960,7 @@ public:
 	/** \param index an element index
 		\return pointer to the ith element.
 	**/
-	inline ElementType& operator[] (unsigned index) { return getValue(index); }
+	inline ElementType& operator[] (PointIndexType index) { return getValue(index); }
 
 	//***** data access *****//
 
@@ -996,11 +1001,11 @@ public:
 	/** \param index the index of the element to return
 		\return a pointer to the ith element
 	**/
-	inline ElementType& getValue(unsigned index)
+	inline ElementType& getValue(PointIndexType index)
 	{
 		assert(index < m_capacity);
 #ifdef CC_ENV_64
-		return m_data[index];
+		return m_data[static_cast<size_t>(index)];
 #else
 		return m_theChunks[index >> CHUNK_INDEX_BIT_DEC][index & ELEMENT_INDEX_BIT_MASK];
 #endif
@@ -1010,11 +1015,11 @@ public:
 	/** \param index the index of the element to return
 		\return a pointer to the ith element
 	**/
-	inline const ElementType& getValue(unsigned index) const
+	inline const ElementType& getValue(PointIndexType index) const
 	{
 		assert(index < m_capacity);
 #ifdef CC_ENV_64
-		return m_data[index];
+		return m_data[static_cast<size_t>(index)];
 #else
 		return m_theChunks[index >> CHUNK_INDEX_BIT_DEC][index & ELEMENT_INDEX_BIT_MASK];
 #endif
@@ -1024,7 +1029,7 @@ public:
 	/** \param index the index of the element to update
 		\param value the new value for the element
 	**/
-	inline void setValue(unsigned index, const ElementType& value) { getValue(index) = value; }
+	inline void setValue(PointIndexType index, const ElementType& value) { getValue(index) = value; }
 
 	//! Returns the element with the minimum value stored in the array
 	/** The computeMinAndMax method must be called prior to this one
@@ -1076,7 +1081,7 @@ public:
 		m_minVal = m_minVal = getValue(0);
 
 		//we update boundaries with all other values
-		for (unsigned i=1; i<m_capacity; ++i)
+		for (PointIndexType i=1; i<m_capacity; ++i)
 		{
 			const ElementType& val = getValue(i);
 			if (val < m_minVal)
@@ -1090,7 +1095,7 @@ public:
 	/** \param firstElementIndex first element index
 		\param secondElementIndex second element index
 	**/
-	inline void swap(unsigned firstElementIndex, unsigned secondElementIndex)
+	inline void swap(PointIndexType firstElementIndex, PointIndexType secondElementIndex)
 	{
 		assert(firstElementIndex < m_count && secondElementIndex < m_count);
 		ElementType& v1 = (*this)[firstElementIndex];
@@ -1113,7 +1118,7 @@ public:
 	{
 #ifdef CC_ENV_64
 		//fake chunk count
-		return (m_count >> CHUNK_INDEX_BIT_DEC) + ((m_count & (MAX_NUMBER_OF_ELEMENTS_PER_CHUNK-1)) ? 1 : 0);
+		return static_cast<unsigned>(m_count >> CHUNK_INDEX_BIT_DEC) + ((m_count & (MAX_NUMBER_OF_ELEMENTS_PER_CHUNK-1)) ? 1 : 0);
 #else
 		return static_cast<unsigned>(m_theChunks.size());
 #endif
@@ -1124,7 +1129,7 @@ public:
 	{
 		assert(index < chunksCount());
 #ifdef CC_ENV_64
-		return  (index + 1 < chunksCount() ? MAX_NUMBER_OF_ELEMENTS_PER_CHUNK : currentSize() % MAX_NUMBER_OF_ELEMENTS_PER_CHUNK);
+		return  (index + 1 < chunksCount() ? MAX_NUMBER_OF_ELEMENTS_PER_CHUNK : static_cast<unsigned>(currentSize() % MAX_NUMBER_OF_ELEMENTS_PER_CHUNK));
 #else
 		return m_perChunkCount[index];
 #endif
@@ -1135,7 +1140,7 @@ public:
 	{
 		assert(index < chunksCount());
 #ifdef CC_ENV_64
-		return data() + (index * MAX_NUMBER_OF_ELEMENTS_PER_CHUNK);
+		return data() + (static_cast<size_t>(index) * MAX_NUMBER_OF_ELEMENTS_PER_CHUNK);
 #else
 		return m_theChunks[index];
 #endif
@@ -1146,7 +1151,7 @@ public:
 	{
 		assert(index < chunksCount());
 #ifdef CC_ENV_64
-		return data() + (index * MAX_NUMBER_OF_ELEMENTS_PER_CHUNK);
+		return data() + (static_cast<size_t>(index) * MAX_NUMBER_OF_ELEMENTS_PER_CHUNK);
 #else
 		return m_theChunks[index];
 #endif
@@ -1158,7 +1163,7 @@ public:
 	**/
 	bool copy(GenericChunkedArray<1,ElementType>& dest) const
 	{
-		unsigned count = currentSize();
+		PointIndexType count = currentSize();
 		if (!dest.resize(count))
 			return false;
 		
@@ -1166,11 +1171,11 @@ public:
 #ifdef CC_ENV_64
 		std::copy(m_data.begin(),m_data.end(),dest.m_data.begin());
 #else
-		unsigned copyCount = 0;
+		PointIndexType copyCount = 0;
 		assert(dest.m_theChunks.size() <= m_theChunks.size());
 		for (size_t i=0; i<dest.m_theChunks.size(); ++i)
 		{
-			unsigned toCopyCount = std::min<unsigned>(count-copyCount,m_perChunkCount[i]);
+			unsigned toCopyCount = static_cast<unsigned>(std::min<PointIndexType>(count-copyCount,m_perChunkCount[i]));
 			assert(dest.m_perChunkCount[i] >= toCopyCount);
 			memcpy(dest.m_theChunks[i],m_theChunks[i],toCopyCount*sizeof(ElementType));
 			copyCount += toCopyCount;
@@ -1212,12 +1217,12 @@ protected:
 #endif
 
 	//! Total number of elements
-	unsigned m_count;
+	PointIndexType m_count;
 	//! Max total number of elements
-	unsigned m_capacity;
+	PointIndexType m_capacity;
 
 	//! Iterator
-	unsigned m_iterator;
+	PointIndexType m_iterator;
 };
 
 #endif //GENERIC_CHUNKED_ARRAY_HEADER
@@ -0,0 +1,70 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef GENERIC_POINT_STREAM_HEADER
+#define GENERIC_POINT_STREAM_HEADER
+
+//Local
+#include "CCCoreLib.h"
+#include "CCGeom.h"
+#include "CCTypes.h"
+
+namespace CCLib
+{
+
+//! A generic sequential point source (typically: a file read point by point)
+/** Used by the out-of-core algorithms, so that the points never have to be
+	loaded all at once. The points may be read several times: they must always
+	come in the same order.
+**/
+class CC_CORE_LIB_API GenericPointStream
+{
+public:
+
+	//! Default destructor
+	virtual ~GenericPointStream() {}
+
+	//! Restarts the reading from the first point
+	/** \return false if the stream can't be read (again)
+	**/
+	virtual bool rewind() = 0;
+
+	//! Reads the next point
+	/** \param P next point
+		\return false once all the points have been read
+	**/
+	virtual bool readNext(CCVector3& P) = 0;
+};
+
+//! A generic sequential output of distances (one per point of a GenericPointStream)
+class CC_CORE_LIB_API GenericDistanceOutput
+{
+public:
+
+	//! Default destructor
+	virtual ~GenericDistanceOutput() {}
+
+	//! Writes the distance of the next point
+	/** \param d distance of the point that has just been read from the associated stream
+		\return false if an error occurred
+	**/
+	virtual bool writeNext(ScalarType d) = 0;
+};
+
+}
+
+#endif //GENERIC_POINT_STREAM_HEADER
@@ -30,6 +30,7 @@ namespace CCLib
 
 class GenericProgressCallback;
 class GenericCloud;
+class NeighbourhoodCache;
 class ScalarField;
 
 //! Several algorithms to compute point-clouds geometric characteristics  (curvature, density, etc.)
@@ -80,13 +81,15 @@ public:
 		\param kernelRadius neighbouring sphere radius
 		\param progressCb client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
 		\param inputOctree if not set as input, octree will be automatically computed.
+		\param cache precomputed neighbourhoods (optional - the neighbourhoods it can't provide are extracted on the fly)
 		\return success (0) or error code (<0)
 	**/
 	static int computeLocalDensity(	GenericIndexedCloudPersist* theCloud,
 									Density densityType,
 									PointCoordinateType kernelRadius,
 									GenericProgressCallback* progressCb = 0,
-									DgmOctree* inputOctree = 0);
+									DgmOctree* inputOctree = 0,
+									const NeighbourhoodCache* cache = 0);
 
 	//! Computes the local roughness
 	/** Roughness is defined as the distance to the locally (least square) fitted plane.
@@ -96,12 +99,50 @@ public:
 		\param kernelRadius neighbouring sphere radius
 		\param progressCb client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
 		\param inputOctree if not set as input, octree will be automatically computed.
+		\param cache precomputed neighbourhoods (optional - the neighbourhoods it can't provide are extracted on the fly)
 		\return success (0) or error code (<0)
 	**/
 	static int computeRoughness(GenericIndexedCloudPersist* theCloud,
 								PointCoordinateType kernelRadius,
 								GenericProgressCallback* progressCb = 0,
-								DgmOctree* inputOctree = 0);
+								DgmOctree* inputOctree = 0,
+								const NeighbourhoodCache* cache = 0);
+
+	//! Multi-scale features (see computeMultiScaleFeatures)
+	enum MultiScaleFeature {	MS_DENSITY				= 1,	/**< Local density (see computeLocalDensity) **/
+								MS_ROUGHNESS			= 2,	/**< Roughness (see computeRoughness) **/
+								MS_MEAN_CURVATURE		= 4,	/**< Mean curvature (see computeCurvature) **/
+								MS_GAUSSIAN_CURVATURE	= 8,	/**< Gaussian curvature (see computeCurvature) **/
+								MS_NORMAL_CHANGE_RATE	= 16,	/**< Normal change rate (see computeCurvature) **/
+								MS_EIGENVALUE_1			= 32,	/**< Largest eigenvalue of the neighbourhood covariance matrix **/
+								MS_EIGENVALUE_2			= 64,	/**< Intermediate eigenvalue of the neighbourhood covariance matrix **/
+								MS_EIGENVALUE_3			= 128,	/**< Smallest eigenvalue of the neighbourhood covariance matrix **/
+	};
+
+	//! Computes several geometric features at several scales in a single pass
+	/** The neighbourhood of each point is extracted only once (at the largest
+		scale) and sorted by increasing distance. The features at the smaller scales
+		are then derived incrementally from the nested sub-neighbourhoods (moments
+		of the neighbours are accumulated from one scale to the next). The features
+		are the same as the ones computed by computeLocalDensity, computeRoughness
+		and computeCurvature (and the covariance matrix eigenvalues).
+		The computation is done in parallel (over the octree cells).
+		\param theCloud processed cloud
+		\param radii neighbouring sphere radii (one per scale)
+		\param features requested features (combination of MultiScaleFeature flags)
+		\param outputFields output scalar fields (one per feature and per scale: for each requested feature, in the MultiScaleFeature order, one field per radius, in the 'radii' order). They must have (at least) as many values as there are points in the cloud.
+		\param densityType the 'type' of density to compute (MS_DENSITY)
+		\param progressCb client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\param inputOctree if not set as input, octree will be automatically computed.
+		\return success (0) or error code (<0)
+	**/
+	static int computeMultiScaleFeatures(	GenericIndexedCloudPersist* theCloud,
+											const std::vector<PointCoordinateType>& radii,
+											int features,
+											const std::vector<ScalarField*>& outputFields,
+											Density densityType = DENSITY_3D,
+											GenericProgressCallback* progressCb = 0,
+											DgmOctree* inputOctree = 0);
 
 	//! Computes the gravity center of a point cloud
 	/** \warning this method uses the cloud global iterator
@@ -173,6 +214,24 @@ public:
 									GenericProgressCallback* progressCb = 0,
 									DgmOctree* inputOctree = 0);
 
+	//! Flag duplicate points with a hashed grid (no octree required)
+	/** Same output as flagDuplicatePoints (scalar value 1 for duplicate points, 0 for the others).
+		Points are hashed on a regular grid with cells twice as large as the min distance,
+		so that the neighbours of a point always lie in its cell or in (at most 7 of) the 26
+		adjacent ones.
+		Cells are processed in parallel (in 27 passes, so that concurrent cells never share a
+		neighbour cell): the output doesn't depend on the number of threads.
+		\param theCloud processed cloud
+		\param minDistanceBetweenPoints min distance between (output) points
+		\param progressCb client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\param multiThread whether to process the cells in parallel or not
+		\return success (0) or error code (<0)
+	**/
+	static int flagDuplicatePointsWithGrid(	GenericIndexedCloudPersist* theCloud,
+											double minDistanceBetweenPoints = 1.0e-12,
+											GenericProgressCallback* progressCb = 0,
+											bool multiThread = true);
+
 	//! Tries to detect a sphere in a point cloud
 	/** Inspired from "Parameter Estimation Techniques: A Tutorial with Application
 		to Conic Fitting" by Zhengyou Zhang (Inria Technical Report n2676).
@@ -248,6 +307,15 @@ protected:
 														void** additionalParameters,
 														NormalizedProgress* nProgress = 0);
 
+	//! Computes the multi-scale features of the points inside a cell
+	/**	\param cell structure describing the cell on which processing is applied
+		\param additionalParameters see method description
+		\param nProgress optional (normalized) progress notification (per-point)
+	**/
+	static bool computeMultiScaleFeaturesInACellAtLevel(const DgmOctree::octreeCell& cell,
+														void** additionalParameters,
+														NormalizedProgress* nProgress = 0);
+
 	//! Flags duplicate points inside a cell
 	/**	\param cell structure describing the cell on which processing is applied
 		\param additionalParameters see method description
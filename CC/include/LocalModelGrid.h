@@ -0,0 +1,167 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef LOCAL_MODEL_GRID_HEADER
+#define LOCAL_MODEL_GRID_HEADER
+
+//Local
+#include "CCCoreLib.h"
+#include "CCConst.h"
+#include "CCGeom.h"
+#include "CCTypes.h"
+
+//system
+#include <vector>
+
+namespace CCLib
+{
+
+class DgmOctree;
+class GenericProgressCallback;
+
+//! Local models (see CC_LOCAL_MODEL_TYPES) precomputed on a regular grid
+/** One model is computed for each non empty cell of the octree of a cloud (at a
+	given level of subdivision). It is fitted on the neighbours of the cell point
+	that is the closest to the cell center. The models are computed in parallel
+	and stored compactly (their parameters in a single array, and the triangles of
+	the 2.5D Delaunay models in another one).
+	The model associated to a given point of the cloud is the one of the surrounding
+	cells that includes this point (i.e. the point lies inside the sphere defined by
+	the model center and size) and whose center is the closest.
+	Queries are thread-safe (the grid doesn't depend on the octree once built).
+**/
+class CC_CORE_LIB_API LocalModelGrid
+{
+public:
+
+	//! Default constructor
+	LocalModelGrid();
+
+	//! Destructor
+	virtual ~LocalModelGrid();
+
+	//! Builds the grid
+	/** \param octree octree of the cloud on which to compute the models
+		\param level level of subdivision of the octree defining the grid (0 = automatically determined from the neighbourhood size)
+		\param modelType type of local model (must not be NO_MODEL)
+		\param useSphericalSearch whether to use a fixed radius (true) or a fixed number of neighbours (false) to compute the models
+		\param kNN number of neighbours (if useSphericalSearch is false)
+		\param radius neighbourhood radius (if useSphericalSearch is true)
+		\param multiThread whether to compute the models in parallel or not
+		\param progressCb the client method can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return success
+	**/
+	bool build(	DgmOctree* octree,
+				unsigned char level,
+				CC_LOCAL_MODEL_TYPES modelType,
+				bool useSphericalSearch,
+				unsigned kNN,
+				PointCoordinateType radius,
+				bool multiThread = true,
+				GenericProgressCallback* progressCb = 0);
+
+	//! Clears the grid
+	void clear();
+
+	//! Returns the number of (valid) models
+	unsigned modelCount() const;
+
+	//! Returns the level of subdivision of the grid
+	inline unsigned char getLevel() const { return m_level; }
+
+	//! Computes the (unsigned) distance between a point and the model associated to a point of the cloud
+	/** \param cloudPoint point of the cloud (typically the nearest neighbour of 'P' in the cloud)
+		\param P query point
+		\param[out] dist the (unsigned) distance between P and the model
+		\return false if no model is associated to 'cloudPoint'
+	**/
+	bool computeDistance(const CCVector3& cloudPoint, const CCVector3& P, ScalarType& dist) const;
+
+	//! Compact local model description
+	struct Model
+	{
+		//! Model center
+		CCVector3 center;
+		//! Model size (squared radius - 0 if the model is invalid)
+		PointCoordinateType squareSize;
+		//! Plane equation (LS) or height function coefficients (QUADRIC)
+		PointCoordinateType eq[6];
+		//! Gravity center (QUADRIC)
+		CCVector3 gravityCenter;
+		//! Height function dimensions (QUADRIC)
+		unsigned char dims[3];
+		//! First triangle (TRI)
+		unsigned firstTriangle;
+		//! Number of triangles (TRI)
+		unsigned triangleCount;
+
+		//! Default constructor
+		Model();
+	};
+
+protected:
+
+	//! Empty slot of the hash table
+	static const unsigned long long EMPTY_KEY = (~0ull);
+
+	//! Returns the key of a cell (from its position in the grid)
+	static inline unsigned long long CellKey(int i, int j, int k)
+	{
+		return		static_cast<unsigned long long>(i)
+				|	(static_cast<unsigned long long>(j) << 21)
+				|	(static_cast<unsigned long long>(k) << 42);
+	}
+
+	//! Returns the slot of a cell key in the hash table
+	inline size_t hashSlot(unsigned long long key) const
+	{
+		//Fibonacci hashing
+		return static_cast<size_t>((key * 11400714819323198485ull) >> 32) & m_hashMask;
+	}
+
+	//! Returns the model of a given cell (or 0 if the cell is empty)
+	const Model* getCellModel(int i, int j, int k) const;
+
+	//! Returns the (unsigned) distance between a point and a model
+	ScalarType distanceToModel(const Model& model, const CCVector3& P) const;
+
+	//! Type of models
+	CC_LOCAL_MODEL_TYPES m_modelType;
+	//! Level of subdivision
+	unsigned char m_level;
+	//! Grid origin
+	CCVector3 m_origin;
+	//! Grid step
+	PointCoordinateType m_cellSize;
+	//! Number of cells along each dimension
+	int m_gridSize;
+
+	//! Model of each non empty cell
+	std::vector<Model> m_models;
+	//! Hash table: keys of the non empty cells (or EMPTY_KEY)
+	std::vector<unsigned long long> m_hashKeys;
+	//! Hash table: index of the model of each cell
+	std::vector<unsigned> m_hashModelIndexes;
+	//! Hash table size minus one (the size is a power of 2)
+	size_t m_hashMask;
+	//! Triangles vertices of the 2.5D Delaunay models (3 per triangle)
+	std::vector<CCVector3> m_triangleVertices;
+};
+
+}
+
+#endif //LOCAL_MODEL_GRID_HEADER
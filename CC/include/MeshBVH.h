@@ -0,0 +1,161 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef MESH_BVH_HEADER
+#define MESH_BVH_HEADER
+
+//Local
+#include "CCCoreLib.h"
+#include "CCGeom.h"
+#include "CCTypes.h"
+
+//system
+#include <vector>
+#include <stdio.h>
+
+namespace CCLib
+{
+
+class GenericIndexedMesh;
+class GenericProgressCallback;
+
+//! Bounding Volume Hierarchy over the triangles of a mesh (dedicated to point to mesh distance queries)
+/** The hierarchy is built with the Surface Area Heuristic (binned version) and
+	stored in a single flat array of nodes (depth-first order: the first son of
+	node i is node i+1). Its memory footprint only depends on the number of
+	triangles, as each triangle is referenced by exactly one leaf. The triangles
+	vertices are copied contiguously (in the tree order). Queries are iterative
+	(no recursion) and can be called concurrently.
+	\warning The vertices coordinates are copied: the hierarchy must be built again if the mesh changes.
+**/
+class CC_CORE_LIB_API MeshBVH
+{
+public:
+
+	//! Max number of triangles per leaf
+	static const unsigned MAX_LEAF_SIZE = 8;
+
+	//! Invalid triangle index
+	static const unsigned INVALID_INDEX = (~0u);
+
+	//! Default constructor
+	MeshBVH();
+
+	//! Destructor
+	virtual ~MeshBVH();
+
+	//! Builds the hierarchy
+	/** \param mesh the mesh from which to build the hierarchy
+		\param progressCb the client method can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return success
+	**/
+	bool buildFromMesh(GenericIndexedMesh* mesh, GenericProgressCallback* progressCb = 0);
+
+	//! Clears the hierarchy
+	void clear();
+
+	//! Saves the hierarchy to a (binary) file
+	/** \param fp file (opened in binary write mode)
+		\return success
+	**/
+	bool toFile(FILE* fp) const;
+
+	//! Loads the hierarchy from a (binary) file
+	/** The associated mesh is not restored (see MeshBVH::getAssociatedMesh).
+		\param fp file (opened in binary read mode)
+		\return success
+	**/
+	bool fromFile(FILE* fp);
+
+	//! Returns the mesh from which the hierarchy has been built
+	inline GenericIndexedMesh* getAssociatedMesh() const { return m_associatedMesh; }
+
+	//! Returns the number of triangles in the hierarchy
+	inline unsigned size() const { return static_cast<unsigned>(m_triIndexes.size()); }
+
+	//! Returns the number of nodes
+	inline unsigned nodeCount() const { return static_cast<unsigned>(m_nodes.size()); }
+
+	//! Nearest triangle search
+	/** \param queryPoint coordinates of the query point
+		\param triIndex [out] index (in the associated mesh) of the nearest triangle
+		\param squareDist [out] square distance between the query point and the nearest triangle
+		\param maxSquareDist if strictly positive, the triangles lying at a square distance >= maxSquareDist are ignored
+		\param triVertices [out] if not null, the 3 vertices of the nearest triangle are copied in this array
+		\return whether a triangle has been found
+	**/
+	bool findNearestTriangle(	const CCVector3& queryPoint,
+								unsigned& triIndex,
+								double& squareDist,
+								double maxSquareDist = 0,
+								CCVector3* triVertices = 0) const;
+
+	//! Computes the square distances between a point and a set of triangles
+	/** \param P query point
+		\param vertices triangles vertices (A0,B0,C0,A1,B1,C1,...)
+		\param count number of triangles
+		\param squareDists [out] square distance between P and each triangle
+	**/
+	static void ComputeSquareDistancesToTriangles(	const CCVector3& P,
+													const CCVector3* vertices,
+													unsigned count,
+													double* squareDists);
+
+protected:
+
+	//! Tree node
+	struct Node
+	{
+		//! Bounding-box lower corner
+		CCVector3 bbMin;
+		//! Second son (internal node) or first triangle (leaf)
+		unsigned first;
+		//! Bounding-box upper corner
+		CCVector3 bbMax;
+		//! Number of triangles (0 for internal nodes)
+		unsigned count;
+	};
+
+	//! Returns the square distance between a point and the bounding-box of a node (0 if inside)
+	static inline PointCoordinateType PointToNodeSquareDistance(const CCVector3& P, const Node& node)
+	{
+		PointCoordinateType d2 = 0;
+		for (int dim=0; dim<3; ++dim)
+		{
+			PointCoordinateType d = 0;
+			if (P.u[dim] < node.bbMin.u[dim])
+				d = node.bbMin.u[dim] - P.u[dim];
+			else if (P.u[dim] > node.bbMax.u[dim])
+				d = P.u[dim] - node.bbMax.u[dim];
+			d2 += d*d;
+		}
+		return d2;
+	}
+
+	//! Nodes (depth-first order)
+	std::vector<Node> m_nodes;
+	//! Triangles vertices (in the tree order - 3 per triangle)
+	std::vector<CCVector3> m_vertices;
+	//! Triangles indexes in the associated mesh (in the tree order)
+	std::vector<unsigned> m_triIndexes;
+	//! Associated mesh
+	GenericIndexedMesh* m_associatedMesh;
+};
+
+}
+
+#endif //MESH_BVH_HEADER
@@ -0,0 +1,164 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef MESH_DISTANCE_GRID_HEADER
+#define MESH_DISTANCE_GRID_HEADER
+
+//Local
+#include "CCCoreLib.h"
+#include "CCGeom.h"
+#include "CCTypes.h"
+#include "MeshBVH.h"
+
+//system
+#include <vector>
+
+namespace CCLib
+{
+
+class GenericIndexedMesh;
+class GenericProgressCallback;
+
+//! Sparse signed distance grid around a mesh (dedicated to repeated cloud-to-mesh distance computations)
+/** The grid only covers a band of a given width around the mesh. It is made of
+	bricks of BRICK_SIZE^3 cells and only the bricks intersecting the band are
+	allocated (they are determined with a Saito distance transform computed on
+	the grid of bricks). The exact signed distance to the mesh is stored at each
+	node of the allocated bricks, so that the distance of any point inside the
+	band can be estimated by trilinear interpolation.
+	Close to the surface (see MeshDistanceGrid::getExactBandWidth) distances should
+	be computed exactly. For this purpose the grid embeds a hierarchy (MeshBVH) built
+	on the mesh triangles: the interpolated values give a tight bound to the nearest
+	triangle search. The grid can be saved to a file and loaded again so as to be
+	reused for several comparisons against the same mesh.
+	\warning The mesh vertices are copied (see MeshBVH): the grid must be built again if the mesh changes.
+**/
+class CC_CORE_LIB_API MeshDistanceGrid
+{
+public:
+
+	//! Number of cells of a brick (along each dimension)
+	static const unsigned BRICK_SIZE = 8;
+
+	//! Invalid brick index (empty brick)
+	static const unsigned INVALID_INDEX = (~0u);
+
+	//! Default constructor
+	MeshDistanceGrid();
+
+	//! Destructor
+	virtual ~MeshDistanceGrid();
+
+	//! Builds the grid
+	/** \param mesh the mesh from which to build the grid
+		\param cellSize grid step
+		\param bandWidth the distances are stored up to this distance from the mesh
+		\param exactBandWidth the points with an (interpolated) distance below this value should be computed exactly
+		\param progressCb the client method can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return success
+	**/
+	bool build(	GenericIndexedMesh* mesh,
+				PointCoordinateType cellSize,
+				PointCoordinateType bandWidth,
+				PointCoordinateType exactBandWidth,
+				GenericProgressCallback* progressCb = 0);
+
+	//! Clears the grid
+	void clear();
+
+	//! Returns whether the grid has been built (or loaded) or not
+	inline bool isValid() const { return !m_brickIndexes.empty(); }
+
+	//! Checks whether the grid has been built on a given mesh
+	/** The number of triangles and the bounding-box of the mesh are checked first, then
+		a checksum of its vertices and triangles (which requires a pass on all the triangles).
+	**/
+	bool isCompatibleWith(GenericIndexedMesh* mesh) const;
+
+	//! Saves the grid to a (binary) file
+	/** \warning The file format depends on the platform and on the type of the coordinates (it is a cache file).
+		\param filename output filename
+		\return success
+	**/
+	bool saveToFile(const char* filename) const;
+
+	//! Loads the grid from a (binary) file
+	/** \param filename input filename
+		\return success
+	**/
+	bool loadFromFile(const char* filename);
+
+	//! Returns the grid step
+	inline PointCoordinateType getCellSize() const { return m_cellSize; }
+	//! Returns the width of the band around the mesh
+	inline PointCoordinateType getBandWidth() const { return m_bandWidth; }
+	//! Returns the width of the band in which distances should be computed exactly
+	inline PointCoordinateType getExactBandWidth() const { return m_exactBandWidth; }
+	//! Sets the width of the band in which distances should be computed exactly
+	inline void setExactBandWidth(PointCoordinateType width) { m_exactBandWidth = width; }
+	//! Returns the number of allocated bricks
+	inline unsigned brickCount() const { return static_cast<unsigned>(m_nodeValues.size() / NODES_PER_BRICK); }
+
+	//! Returns the hierarchy built on the mesh triangles
+	inline const MeshBVH& getBVH() const { return m_bvh; }
+
+	//! Returns the (interpolated) signed distance at a given position
+	/** \param P query point
+		\param signedDist [out] interpolated signed distance
+		\param upperBound [out] if not null, upper bound of the exact (unsigned) distance
+		\param signChange [out] if not null, whether the sign of the distance changes inside the cell (in which case the sign of the interpolated value is not reliable)
+		\return false if the point lies outside of the band (i.e. its distance to the mesh is greater than the band width)
+	**/
+	bool interpolateDistance(const CCVector3& P, ScalarType& signedDist, PointCoordinateType* upperBound = 0, bool* signChange = 0) const;
+
+protected:
+
+	//! Number of nodes of a brick (along each dimension)
+	static const unsigned BRICK_NODES = BRICK_SIZE + 1;
+	//! Number of nodes of a brick
+	static const unsigned NODES_PER_BRICK = BRICK_NODES * BRICK_NODES * BRICK_NODES;
+
+	//! Grid origin
+	CCVector3 m_origin;
+	//! Grid step
+	PointCoordinateType m_cellSize;
+	//! Band width
+	PointCoordinateType m_bandWidth;
+	//! Exact band width
+	PointCoordinateType m_exactBandWidth;
+	//! Number of bricks (along each dimension)
+	Tuple3ui m_brickGridSize;
+	//! Index of each brick (or INVALID_INDEX if the brick is empty)
+	std::vector<unsigned> m_brickIndexes;
+	//! Nodes values (NODES_PER_BRICK per allocated brick)
+	std::vector<ScalarType> m_nodeValues;
+	//! Hierarchy built on the mesh triangles
+	MeshBVH m_bvh;
+
+	//! Number of triangles of the mesh
+	unsigned m_meshTriangleCount;
+	//! Mesh bounding-box (min corner)
+	CCVector3 m_meshMinBB;
+	//! Mesh bounding-box (max corner)
+	CCVector3 m_meshMaxBB;
+	//! Checksum of the mesh vertices and triangles
+	unsigned long long m_meshChecksum;
+};
+
+}
+
+#endif //MESH_DISTANCE_GRID_HEADER
@@ -0,0 +1,137 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef NEIGHBOURHOOD_CACHE_HEADER
+#define NEIGHBOURHOOD_CACHE_HEADER
+
+//Local
+#include "CCCoreLib.h"
+#include "CCTypes.h"
+#include "DgmOctree.h"
+#include "GenericIndexedCloudPersist.h"
+
+//system
+#include <vector>
+
+namespace CCLib
+{
+
+class GenericProgressCallback;
+
+//! Cache of the k nearest neighbours of all the points of a cloud
+/** The neighbours of each point are computed once (in parallel) and stored
+	compactly: exactly min(k,number of points) neighbours per point (the point
+	itself included), sorted by increasing distance, in two flat arrays (indexes
+	and square distances). The cache can then be shared by several algorithms
+	(SOR filter, noise filter, local density, roughness, etc.).
+	The cached neighbourhood of a point also answers the spherical neighbourhood
+	queries with a radius smaller than the distance to its farthest cached neighbour.
+	The other queries must be done 'on the fly' (i.e. with the octree).
+	Queries are thread-safe.
+**/
+class CC_CORE_LIB_API NeighbourhoodCache
+{
+public:
+
+	//! Default constructor
+	NeighbourhoodCache();
+
+	//! Destructor
+	virtual ~NeighbourhoodCache();
+
+	//! Computes the neighbourhoods
+	/** \param cloud cloud
+		\param k number of neighbours per point (the point itself included)
+		\param octree octree of the cloud (will be computed if not set)
+		\param maxMemory max memory the cache can use, in bytes (0 = no limit)
+		\param multiThread whether to compute the neighbourhoods in parallel or not
+		\param progressCb the client method can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return false if the cache would exceed the memory limit, if there's not enough memory or if the process has been cancelled
+	**/
+	bool compute(	GenericIndexedCloudPersist* cloud,
+					unsigned k,
+					DgmOctree* octree = 0,
+					size_t maxMemory = 0,
+					bool multiThread = true,
+					GenericProgressCallback* progressCb = 0);
+
+	//! Returns the memory required to cache the neighbourhoods of a cloud (in bytes)
+	/** \param pointCount number of points
+		\param k number of neighbours per point
+	**/
+	static size_t RequiredMemory(PointIndexType pointCount, unsigned k);
+
+	//! Clears the cache
+	void clear();
+
+	//! Returns whether the cache corresponds to a given cloud or not
+	/** The cloud must not have been modified since the cache has been computed!
+	**/
+	inline bool isValidFor(const GenericIndexedCloudPersist* cloud) const { return cloud && cloud == m_cloud && cloud->size() == m_pointCount; }
+
+	//! Returns the number of cached neighbours per point
+	inline unsigned neighbourCount() const { return m_k; }
+
+	//! Returns the memory used by the cache (in bytes)
+	inline size_t memoryUsage() const { return m_indexes.capacity() * sizeof(PointIndexType) + m_squareDists.capacity() * sizeof(PointCoordinateType); }
+
+	//! Returns whether the cache holds the k nearest neighbours of all the points
+	inline bool hasNearestNeighbours(unsigned k) const { return m_cloud && (k <= m_k || m_k == m_pointCount); }
+
+	//! Returns the k nearest neighbours of a point (the point itself included)
+	/** \param pointIndex point index
+		\param k number of neighbours
+		\param[out] neighbours neighbours (sorted by increasing distance)
+		\return false if the cache doesn't hold the k nearest neighbours (see hasNearestNeighbours)
+	**/
+	bool getNearestNeighbours(PointIndexType pointIndex, unsigned k, DgmOctree::NeighboursSet& neighbours) const;
+
+	//! Returns the neighbours of a point inside a sphere centered on it (the point itself included)
+	/** \param pointIndex point index
+		\param radius sphere radius
+		\param[out] neighbours neighbours (sorted by increasing distance)
+		\return false if the cached neighbourhood may not include all the neighbours (the query must be done on the fly)
+	**/
+	bool getNeighboursInSphere(PointIndexType pointIndex, PointCoordinateType radius, DgmOctree::NeighboursSet& neighbours) const;
+
+	//! Returns the number of neighbours of a point inside a sphere centered on it (the point itself included)
+	/** \param pointIndex point index
+		\param radius sphere radius
+		\return the number of neighbours, or -1 if the cached neighbourhood may not include all of them
+	**/
+	int countNeighboursInSphere(PointIndexType pointIndex, PointCoordinateType radius) const;
+
+protected:
+
+	//! Fills a neighbours set with the first cached neighbours of a point
+	void getCachedNeighbours(PointIndexType pointIndex, unsigned count, DgmOctree::NeighboursSet& neighbours) const;
+
+	//! Associated cloud
+	GenericIndexedCloudPersist* m_cloud;
+	//! Number of points of the associated cloud
+	PointIndexType m_pointCount;
+	//! Number of neighbours per point
+	unsigned m_k;
+	//! Neighbours indexes (m_k per point)
+	std::vector<PointIndexType> m_indexes;
+	//! Neighbours square distances (m_k per point)
+	std::vector<PointCoordinateType> m_squareDists;
+};
+
+}
+
+#endif //NEIGHBOURHOOD_CACHE_HEADER
@@ -44,7 +44,7 @@ public:
 	virtual ~ReferenceCloud();
 
 	//**** inherited form GenericCloud ****//
-	inline virtual unsigned size() const { return m_theIndexes->currentSize(); }
+	inline virtual PointIndexType size() const { return m_theIndexes->currentSize(); }
 	virtual void forEach(genericPointAction& action);
 	virtual void getBoundingBox(CCVector3& bbMin, CCVector3& bbMax);
 	inline virtual unsigned char testVisibility(const CCVector3& P) const { assert(m_theAssociatedCloud); return m_theAssociatedCloud->testVisibility(P); }
@@ -52,20 +52,20 @@ public:
 	inline virtual const CCVector3* getNextPoint() { assert(m_theAssociatedCloud); return (m_globalIterator < size() ? m_theAssociatedCloud->getPoint(m_theIndexes->getValue(m_globalIterator++)) : 0); }
 	inline virtual bool enableScalarField() { assert(m_theAssociatedCloud); return m_theAssociatedCloud->enableScalarField(); }
 	inline virtual bool isScalarFieldEnabled() const { assert(m_theAssociatedCloud); return m_theAssociatedCloud->isScalarFieldEnabled(); }
-	inline virtual void setPointScalarValue(unsigned pointIndex, ScalarType value) { assert(m_theAssociatedCloud && pointIndex<size()); m_theAssociatedCloud->setPointScalarValue(m_theIndexes->getValue(pointIndex),value); }
-	inline virtual ScalarType getPointScalarValue(unsigned pointIndex) const { assert(m_theAssociatedCloud && pointIndex<size()); return m_theAssociatedCloud->getPointScalarValue(m_theIndexes->getValue(pointIndex)); }
+	inline virtual void setPointScalarValue(PointIndexType pointIndex, ScalarType value) { assert(m_theAssociatedCloud && pointIndex<size()); m_theAssociatedCloud->setPointScalarValue(m_theIndexes->getValue(pointIndex),value); }
+	inline virtual ScalarType getPointScalarValue(PointIndexType pointIndex) const { assert(m_theAssociatedCloud && pointIndex<size()); return m_theAssociatedCloud->getPointScalarValue(m_theIndexes->getValue(pointIndex)); }
 
 	//**** inherited form GenericIndexedCloud ****//
-	inline virtual const CCVector3* getPoint(unsigned index) { assert(m_theAssociatedCloud && index < size()); return m_theAssociatedCloud->getPoint(m_theIndexes->getValue(index)); }
-	inline virtual void getPoint(unsigned index, CCVector3& P) const { assert(m_theAssociatedCloud && index < size()); m_theAssociatedCloud->getPoint(m_theIndexes->getValue(index),P); }
+	inline virtual const CCVector3* getPoint(PointIndexType index) { assert(m_theAssociatedCloud && index < size()); return m_theAssociatedCloud->getPoint(m_theIndexes->getValue(index)); }
+	inline virtual void getPoint(PointIndexType index, CCVector3& P) const { assert(m_theAssociatedCloud && index < size()); m_theAssociatedCloud->getPoint(m_theIndexes->getValue(index),P); }
 
 	//**** inherited form GenericIndexedCloudPersist ****//
-	inline virtual const CCVector3* getPointPersistentPtr(unsigned index) { assert(m_theAssociatedCloud && index < size()); return m_theAssociatedCloud->getPointPersistentPtr(m_theIndexes->getValue(index)); }
+	inline virtual const CCVector3* getPointPersistentPtr(PointIndexType index) { assert(m_theAssociatedCloud && index < size()); return m_theAssociatedCloud->getPointPersistentPtr(m_theIndexes->getValue(index)); }
 
 	//! Returns global index (i.e. relative to the associated cloud) of a given element
 	/** \param localIndex local index (i.e. relative to the internal index container)
 	**/
-	inline virtual unsigned getPointGlobalIndex(unsigned localIndex) const { return m_theIndexes->getValue(localIndex); }
+	inline virtual PointIndexType getPointGlobalIndex(PointIndexType localIndex) const { return m_theIndexes->getValue(localIndex); }
 
 	//! Returns the coordinates of the point pointed by the current element
 	/** Returns a persistent pointer.
@@ -73,7 +73,7 @@ public:
 	virtual const CCVector3* getCurrentPointCoordinates() const;
 
 	//! Returns the global index of the point pointed by the current element
-	inline virtual unsigned getCurrentPointGlobalIndex() const { assert(m_globalIterator < size()); return m_theIndexes->getValue(m_globalIterator); }
+	inline virtual PointIndexType getCurrentPointGlobalIndex() const { assert(m_globalIterator < size()); return m_theIndexes->getValue(m_globalIterator); }
 
     //! Returns the current point associated scalar value
 	inline virtual ScalarType getCurrentPointScalarValue() const { assert(m_theAssociatedCloud && m_globalIterator<size()); return m_theAssociatedCloud->getPointScalarValue(m_theIndexes->getValue(m_globalIterator)); }
@@ -91,33 +91,33 @@ public:
 	/** \param globalIndex a point global index
 		\return false if not enough memory
 	**/
-	virtual bool addPointIndex(unsigned globalIndex);
+	virtual bool addPointIndex(PointIndexType globalIndex);
 
 	//! Point global index insertion mechanism (range)
 	/** \param firstIndex first point global index of range
 		\param lastIndex last point global index of range (excluded)
 		\return false if not enough memory
 	**/
-	virtual bool addPointIndex(unsigned firstIndex, unsigned lastIndex);
+	virtual bool addPointIndex(PointIndexType firstIndex, PointIndexType lastIndex);
 
 	//! Sets global index for a given element
 	/** \param localIndex local index
         \param globalIndex global index
 	**/
-	virtual void setPointIndex(unsigned localIndex, unsigned globalIndex);
+	virtual void setPointIndex(PointIndexType localIndex, PointIndexType globalIndex);
 
 	//! Reserves some memory for hosting the point references
 	/** \param n the number of points (references)
 	**/
-	virtual bool reserve(unsigned n);
+	virtual bool reserve(PointIndexType n);
 
 	//! Presets the size of the vector used to store point references
 	/** \param n the number of points (references)
 	**/
-	virtual bool resize(unsigned n);
+	virtual bool resize(PointIndexType n);
 
 	//! Returns max capacity
-	inline virtual unsigned capacity() const { return m_theIndexes->capacity(); }
+	inline virtual PointIndexType capacity() const { return m_theIndexes->capacity(); }
 
 	//! Swaps two point references
 	/** the point references indexes should be smaller than the total
@@ -125,7 +125,7 @@ public:
 		\param i the first point index
 		\param j the second point index
 	**/
-	inline virtual void swap(unsigned i, unsigned j) {m_theIndexes->swap(i,j);}
+	inline virtual void swap(PointIndexType i, PointIndexType j) {m_theIndexes->swap(i,j);}
 
 	//! Removes current element
 	/** WARNING: this method change the structure size!
@@ -135,7 +135,7 @@ public:
 	//! Removes a given element
 	/** WARNING: this method change the structure size!
 	**/
-	virtual void removePointGlobalIndex(unsigned localIndex);
+	virtual void removePointGlobalIndex(PointIndexType localIndex);
 
     //! Returns the associated (source) cloud
 	inline virtual GenericIndexedCloudPersist* getAssociatedCloud() { return m_theAssociatedCloud; }
@@ -167,13 +167,13 @@ protected:
 	virtual void updateBBWithPoint(const CCVector3& P);
 
 	//! Container of 3D point indexes
-	typedef GenericChunkedArray<1,unsigned> ReferencesContainer;
+	typedef GenericChunkedArray<1,PointIndexType> ReferencesContainer;
 
 	//! Indexes of (some of) the associated cloud points
 	ReferencesContainer* m_theIndexes;
 
 	//! Iterator on the point references container
-	unsigned m_globalIterator;
+	PointIndexType m_globalIterator;
 
 	//! Bounding-box min corner
 	CCVector3 m_bbMin;
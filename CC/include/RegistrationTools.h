@@ -22,7 +22,7 @@
 #include "CCCoreLib.h"
 #include "CCToolbox.h"
 #include "PointProjectionTools.h"
-#include "KdTree.h"
+#include "FlatKdTree.h"
 
 //system
 #include <vector>
@@ -261,7 +261,7 @@ protected:
         \param results the resulting bases
         \return the number of bases found (number of element in the results array) or -1 is a problem occurred
     **/
-    static int FindCongruentBases(	KDTree* tree,
+    static int FindCongruentBases(	FlatKDTree* tree,
 									ScalarType delta,
 									const CCVector3* base[4],
 									std::vector<Base>& results);
@@ -272,12 +272,12 @@ protected:
         \param dataCloud data point cloud
         \param dataToModel transformation that, applied to data points, register model and data clouds
         \param delta tolerance above which data points are not counted (if a point is less than delta-appart from de model cloud, then it is counted)
-        \return the number of data points which are distance-appart from the model cloud
+        \return the number of data points which are distance-appart from the model cloud (or -1 if not enough memory)
     **/
-    static unsigned ComputeRegistrationScore(	KDTree *modelTree,
-												GenericIndexedCloud *dataCloud,
-												ScalarType delta,
-												const ScaledTransformation& dataToModel);
+    static int ComputeRegistrationScore(	FlatKDTree *modelTree,
+											GenericIndexedCloud *dataCloud,
+											ScalarType delta,
+											const ScaledTransformation& dataToModel);
 
     //! Find the 3D pseudo intersection between two lines
     /** This function finds the 3D point which is the nearest from the both lines (when this point is unique, i.e. when
@@ -52,6 +52,9 @@ namespace CCLib
 			transformations of an n-dimensional digitised picture with applications",
 			Pattern Recognition, 27(11), pp. 1551-1565, 1994
 
+			The passes are separable (and multi-threaded if CC_CORE_LIB is compiled
+			with Qt). The output doesn't depend on the number of threads.
+
 			\warning Output distances are squared
 
 			\param progressCb progress callback (optional)
@@ -61,11 +64,10 @@ namespace CCLib
 
 	protected:
 
-		//! 1D Euclidean Distance Transform
-		static bool EDT_1D(GridElement* slice, size_t r, size_t c);
-		//! 2D Exact Squared Distance Transform
-		static bool SDT_2D(Grid3D<GridElement>& image, size_t sliceIndex, const std::vector<GridElement>& sq);
 		//! 3D Exact Squared Distance Transform
+		/** The slices (2D passes) and then the rows (final pass along Z) are
+			processed in parallel if CC_CORE_LIB is compiled with Qt.
+		**/
 		static bool SDT_3D(Grid3D<GridElement>& image, GenericProgressCallback* progressCb = 0);
 	};
 
@@ -75,11 +75,10 @@ public:
 		BaseNode* rightChild;
 		
 		Node() : BaseNode(NODE_TYPE), splitDim(X_DIM), splitValue(0), leftChild(0), rightChild(0) {}
-		virtual ~Node()
-		{
-			if (leftChild) delete leftChild;
-			if (rightChild) delete rightChild;
-		}
+		//! Destructor
+		/** Nodes and leaves are allocated by the tree (memory pool): children are released by TrueKdTree::clear.
+		**/
+		virtual ~Node() {}
 	};
 
 	//! Tree leaf
@@ -150,11 +149,36 @@ public:
 protected:
 
 	//! Recursive split process
-	BaseNode* split(ReferenceCloud* subset);
+	/** \param subset the subset to split (always taken care of by this method)
+		\param sortBuffer buffer (of the same size as the subset) used to sort the points coordinates
+		\param reportProgress whether progress can be reported (i.e. we are in the caller thread)
+		\return the new (sub)tree or 0 if not enough memory
+	**/
+	BaseNode* split(ReferenceCloud* subset, PointCoordinateType* sortBuffer, bool reportProgress);
+
+	//! Memory pool for nodes and leaves
+	class NodePool;
+
+	//! Creates a new node (from the build pool)
+	Node* newNode() const;
+	//! Creates a new leaf (from the build pool)
+	/** \warning If not enough memory, the subset is deleted
+	**/
+	Leaf* newLeaf(ReferenceCloud* set, const PointCoordinateType planeEquation[], ScalarType error) const;
+	//! Releases a (sub)tree built with TrueKdTree::split
+	static void releaseSubTree(BaseNode* node);
+	//! Copies a (sub)tree in a given pool (in depth-first order) and releases the original one
+	static BaseNode* moveSubTree(BaseNode* node, NodePool* pool);
 
 	//! Root node
 	BaseNode* m_root;
 
+	//! Pool from which the nodes and leaves are allocated
+	NodePool* m_nodePool;
+
+	//! Pool used during the build (see TrueKdTree::split)
+	NodePool* m_buildPool;
+
 	//! Associated cloud
 	GenericIndexedCloudPersist* m_associatedCloud;
 
@@ -26,8 +26,15 @@
 #include <assert.h>
 #include <stdio.h> //for sprintf
 
+#ifdef USE_QT
+#include <QtCore>
+#include <QtConcurrentMap>
+#endif
+
 using namespace CCLib;
 
+typedef ChamferDistanceTransform::GridElement GridElement;
+
 //! Forward mask shifts and weights (Chamfer 3-4-5)
 const char ForwardNeighbours345[14*4] = {
 	-1,-1,-1, 5,
@@ -164,6 +171,66 @@ const char BackwardNeighbours111[14*4] = {
 //	return maxDist;
 //}
 
+//! Row of the grid processed by a single thread (Chamfer scans)
+struct chamferRowJob
+{
+	//! First cell of the row (in the scan order)
+	GridElement* cell;
+	//! Row length
+	unsigned length;
+	//! Scan direction (+1 = forward, -1 = backward)
+	int order;
+	//! Neighbours shifts (relatively to the current cell)
+	const int* neighborShift;
+	//! Neighbours (shifts and weights)
+	const char* neighbours;
+	//! Max distance along the row (output)
+	GridElement maxDist;
+	//! Progress notification
+	NormalizedProgress* nProgress;
+	//! Whether the process has been cancelled (shared by all jobs)
+	bool* cancelled;
+};
+
+//! Applies the Chamfer mask to each cell of a row (in the scan order)
+static void ScanChamferRow(chamferRowJob& job)
+{
+	if (*job.cancelled)
+		return;
+
+	GridElement* _grid = job.cell;
+	GridElement maxDist = 0;
+
+	for (unsigned i=0; i<job.length; ++i)
+	{
+		GridElement minVal = _grid[job.neighborShift[0]] + static_cast<GridElement>(job.neighbours[3]);
+
+		for (unsigned char v=1; v<14; ++v)
+		{
+			const char* neighbour = job.neighbours + 4*v;
+			GridElement neighborVal = _grid[job.neighborShift[v]] + static_cast<GridElement>(neighbour[3]);
+			minVal = std::min(minVal, neighborVal);
+		}
+
+		*_grid = minVal;
+		_grid += job.order;
+
+		//we track the max distance
+		if (minVal > maxDist)
+		{
+			maxDist = minVal;
+		}
+	}
+
+	job.maxDist = maxDist;
+
+	if (job.nProgress && !job.nProgress->oneStep())
+	{
+		//process cancelled by the user
+		*job.cancelled = true;
+	}
+}
+
 int ChamferDistanceTransform::propagateDistance(CC_CHAMFER_DISTANCE_TYPE type, GenericProgressCallback* progressCb)
 {
 	if (m_grid.empty())
@@ -196,6 +263,22 @@ int ChamferDistanceTransform::propagateDistance(CC_CHAMFER_DISTANCE_TYPE type, G
 		return -1;
 	}
 
+	//the rows of a same 'wavefront' (j + 2*k = constant) only depend on the rows
+	//of the previous wavefronts (the masks only span the previous/next row and slice):
+	//they can be processed in parallel, with exactly the same result as a serial scan.
+	const unsigned wavefrontCount = m_innerSize.y + 2 * (m_innerSize.z - 1);
+	const unsigned maxWavefrontSize = std::min(m_innerSize.z, (m_innerSize.y + 1) / 2);
+	std::vector<chamferRowJob> jobs;
+	try
+	{
+		jobs.reserve(maxWavefrontSize);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return -1;
+	}
+
 	NormalizedProgress normProgress(progressCb,m_innerSize.y*m_innerSize.z*2);
 	if (progressCb)
 	{
@@ -207,102 +290,78 @@ int ChamferDistanceTransform::propagateDistance(CC_CHAMFER_DISTANCE_TYPE type, G
 		progressCb->start();
 	}
 
-	//1st pass: forward scan
+	bool cancelled = false;
+	GridElement maxDist = 0;
+
+	//1st pass: forward scan / 2nd pass: backward scan
+	for (int pass=0; pass<2; ++pass)
 	{
-		GridElement* _grid = &(m_grid[pos2index(0,0,0)]);
+		bool forward = (pass == 0);
+		const char* neighbours = (forward ? fwNeighbours : bwNeighbours);
 
 		//accelerating structure
 		int neighborShift[14];
 		{
 			for (unsigned char v=0; v<14; ++v)
 			{
-				const char* fwNeighbour = fwNeighbours + 4*v;
-				neighborShift[v] =	static_cast<int>(fwNeighbour[0]) +
-									static_cast<int>(fwNeighbour[1]) * static_cast<int>(m_rowSize) +
-									static_cast<int>(fwNeighbour[2]) * static_cast<int>(m_sliceSize);
+				const char* neighbour = neighbours + 4*v;
+				neighborShift[v] =	static_cast<int>(neighbour[0]) +
+									static_cast<int>(neighbour[1]) * static_cast<int>(m_rowSize) +
+									static_cast<int>(neighbour[2]) * static_cast<int>(m_sliceSize);
 			}
 		}
 
-		for (unsigned k=0; k<m_innerSize.z; ++k)
+		chamferRowJob job;
+		job.length = m_innerSize.x;
+		job.order = (forward ? 1 : -1);
+		job.neighborShift = neighborShift;
+		job.neighbours = neighbours;
+		job.maxDist = 0;
+		job.nProgress = (progressCb ? &normProgress : 0);
+		job.cancelled = &cancelled;
+
+		for (unsigned w=0; w<wavefrontCount && !cancelled; ++w)
 		{
-			for (unsigned j=0; j<m_innerSize.y; ++j)
+			//rows of the current wavefront (in the scan order)
+			jobs.clear();
+			unsigned kMax = std::min(m_innerSize.z - 1, w / 2);
+			unsigned kMin = (w >= m_innerSize.y ? (w - m_innerSize.y + 2) / 2 : 0);
+			for (unsigned k=kMin; k<=kMax; ++k)
 			{
-				for (unsigned i=0; i<m_innerSize.x; ++i)
-				{
-					GridElement minVal = _grid[neighborShift[0]] + static_cast<GridElement>(fwNeighbours[3]);
-
-					for (unsigned char v=1; v<14; ++v)
-					{
-						const char* fwNeighbour = fwNeighbours + 4*v;
-						GridElement neighborVal = _grid[neighborShift[v]] + static_cast<GridElement>(fwNeighbour[3]);
-						minVal = std::min(minVal, neighborVal);
-					}
-
-					*_grid++ = minVal;
-				}
-				_grid += 2; //next line
-
-				if (progressCb && !normProgress.oneStep())
-				{
-					break;
-				}
+				unsigned j = w - 2*k;
+				job.cell = forward	? &(m_grid[pos2index(0, static_cast<int>(j), static_cast<int>(k))])
+									: &(m_grid[pos2index(	static_cast<int>(m_innerSize.x) - 1,
+															static_cast<int>(m_innerSize.y - 1 - j),
+															static_cast<int>(m_innerSize.z - 1 - k))]);
+				jobs.push_back(job);
 			}
 
-			_grid += 2*m_rowSize; //next slice
-		}
-	}
-
-	//2nd pass: backward scan
-	GridElement maxDist = 0;
-	{
-		//accelerating structure
-		int neighborShift[14];
-		{
-			for (unsigned char v=0; v<14; ++v)
+#ifdef USE_QT
+			if (jobs.size() > 1)
 			{
-				const char* bwNeighbour = bwNeighbours + 4*v;
-				neighborShift[v] =	static_cast<int>(bwNeighbour[0]) +
-									static_cast<int>(bwNeighbour[1]) * static_cast<int>(m_rowSize) +
-									static_cast<int>(bwNeighbour[2]) * static_cast<int>(m_sliceSize);
+				QtConcurrent::blockingMap(jobs, ScanChamferRow);
 			}
-		}
-
-		GridElement* _grid = &(m_grid[pos2index(static_cast<int>(m_innerSize.x)-1, static_cast<int>(m_innerSize.y)-1, static_cast<int>(m_innerSize.z)-1)]);
-
-		for (unsigned k=0; k<m_innerSize.z; ++k)
-		{
-			for (unsigned j=0; j<m_innerSize.y; ++j)
+			else
+#endif
 			{
-				for (unsigned i=0; i<m_innerSize.x; ++i)
-				{
-					GridElement minVal = _grid[neighborShift[0]] + static_cast<GridElement>(bwNeighbours[3]);
-
-					for (unsigned char v=1; v<14; ++v)
-					{
-						const char* bwNeighbour = bwNeighbours + 4*v;
-						GridElement neighborVal = _grid[neighborShift[v]] + static_cast<GridElement>(bwNeighbour[3]);
-						minVal = std::min(minVal, neighborVal);
-					}
-
-					*_grid-- = minVal;
-
-					//we track the max distance
-					if (minVal > maxDist)
-					{
-						maxDist = minVal;
-					}
-				}
-				_grid -= 2; //next line
-
-				if (progressCb && !normProgress.oneStep())
-				{
-					break;
-				}
+				for (size_t n=0; n<jobs.size(); ++n)
+					ScanChamferRow(jobs[n]);
 			}
 
-			_grid -= 2*m_rowSize; //next slice
+			//we track the max distance (only after the last pass)
+			if (!forward)
+			{
+				for (size_t n=0; n<jobs.size(); ++n)
+					maxDist = std::max(maxDist, jobs[n].maxDist);
+			}
 		}
 	}
 
+	if (cancelled)
+	{
+		//process cancelled by the user
+		return -1;
+	}
+
 	return static_cast<int>(maxDist);
 }
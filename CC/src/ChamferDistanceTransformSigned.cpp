@@ -226,6 +226,22 @@ bool ChamferDistanceTransformSigned::initDT(GenericIndexedMesh* mesh,
 	std::vector<CellToTest> cellsToTest(1); //initial size must be > 0
 	unsigned cellsToTestCount = 0;
 
+	//cells centers of a row (see DistanceComputationTools::computePoints2TriangleDistances)
+	std::vector<PointCoordinateType> rowX, rowY, rowZ;
+	std::vector<ScalarType> rowDists;
+	try
+	{
+		rowX.resize(size().x);
+		rowY.resize(size().x);
+		rowZ.resize(size().x);
+		rowDists.resize(size().x);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
 	//number of triangles
 	unsigned numberOfTriangles = mesh->size();
 
@@ -298,19 +314,25 @@ bool ChamferDistanceTransformSigned::initDT(GenericIndexedMesh* mesh,
 				maxSize = std::max(maxSize, delta.z);
 			}
 
-			//test each cell
+			//test each cell (row by row)
+			unsigned rowSize = static_cast<unsigned>(maxPos.x - minPos.x + 1);
+			for (int i = minPos.x; i <= maxPos.x; ++i)
+			{
+				rowX[i - minPos.x] = gridMinCorner.x + i * cellLength + halfCellSize;
+			}
 			for (int k = minPos.z; k <= maxPos.z; ++k)
 			{
-				CCVector3 C(0, 0, gridMinCorner.z + k * cellLength + halfCellSize);
+				std::fill(rowZ.begin(), rowZ.begin() + rowSize, gridMinCorner.z + k * cellLength + halfCellSize);
 				for (int j = minPos.y; j <= maxPos.y; ++j)
 				{
-					C.y = gridMinCorner.y + j * cellLength + halfCellSize;
+					std::fill(rowY.begin(), rowY.begin() + rowSize, gridMinCorner.y + j * cellLength + halfCellSize);
+
+					//compute the distances between the (absolute) cells centers and the triangle
+					DistanceComputationTools::computePoints2TriangleDistances(&(rowX[0]), &(rowY[0]), &(rowZ[0]), rowSize, T, true, &(rowDists[0]));
+
 					for (int i = minPos.x; i <= maxPos.x; ++i)
 					{
-						//compute the (absolute) cell center
-						C.x = gridMinCorner.x + i * cellLength + halfCellSize;
-
-						ScalarType dist = DistanceComputationTools::computePoint2TriangleDistance(&C, T, true);
+						ScalarType dist = rowDists[i - minPos.x];
 						GridElement& cellValue = getValue(i, j, k);
 						if (fabs(cellValue) > fabs(dist))
 						{
@@ -62,8 +62,8 @@ void ChunkedPointCloud::forEach(genericPointAction& action)
 		return;
 	}
 
-	unsigned n = size();
-	for (unsigned i=0; i<n; ++i)
+	PointIndexType n = size();
+	for (PointIndexType i=0; i<n; ++i)
 	{
 		action(*getPoint(i),(*currentOutScalarFieldArray)[i]);
 	}
@@ -96,9 +96,9 @@ const CCVector3* ChunkedPointCloud::getNextPoint()
 	return (m_currentPointIndex < m_points->currentSize() ? point(m_currentPointIndex++) : 0);
 }
 
-bool ChunkedPointCloud::resize(unsigned newCount)
+bool ChunkedPointCloud::resize(PointIndexType newCount)
 {
-	unsigned oldCount = m_points->currentSize();
+	PointIndexType oldCount = m_points->currentSize();
 
 	//we try to enlarge the 3D points array
 	if (!m_points->resize(newCount))
@@ -125,7 +125,7 @@ bool ChunkedPointCloud::resize(unsigned newCount)
 	return true;
 }
 
-bool ChunkedPointCloud::reserve(unsigned newCapacity)
+bool ChunkedPointCloud::reserve(PointIndexType newCapacity)
 {
 	//we try to enlarge the 3D points array
 	if (!m_points->reserve(newCapacity))
@@ -162,19 +162,19 @@ void ChunkedPointCloud::addPoint(const CCVector3 &P)
 
 void ChunkedPointCloud::applyTransformation(PointProjectionTools::Transformation& trans)
 {
-	unsigned count = size();
+	PointIndexType count = size();
 
 	//always apply the scale before everything (applying before or after rotation does not changes anything)
 	if (fabs(static_cast<double>(trans.s) - 1.0) > ZERO_TOLERANCE)
 	{
-		for (unsigned i=0; i<count; ++i)
+		for (PointIndexType i=0; i<count; ++i)
 			*point(i) *= trans.s;
 		m_validBB = false; //invalidate bb
 	}
 
 	if (trans.R.isValid())
 	{
-		for (unsigned i=0; i<count; ++i)
+		for (PointIndexType i=0; i<count; ++i)
 		{
 			CCVector3* P = point(i);
 			(*P) = trans.R * (*P);
@@ -184,7 +184,7 @@ void ChunkedPointCloud::applyTransformation(PointProjectionTools::Transformation
 
 	if (trans.T.norm() > ZERO_TOLERANCE) //T applied only if it makes sense
 	{
-		for (unsigned i=0; i<count; ++i)
+		for (PointIndexType i=0; i<count; ++i)
 			*point(i) += trans.T;
 		m_validBB = false;
 	}
@@ -237,7 +237,7 @@ bool ChunkedPointCloud::enableScalarField()
 	return currentInScalarField->resize(m_points->capacity());
 }
 
-void ChunkedPointCloud::setPointScalarValue(unsigned pointIndex, ScalarType value)
+void ChunkedPointCloud::setPointScalarValue(PointIndexType pointIndex, ScalarType value)
 {
 	assert(m_currentInScalarFieldIndex>=0 && m_currentInScalarFieldIndex<(int)m_scalarFields.size());
 	//slow version
@@ -249,7 +249,7 @@ void ChunkedPointCloud::setPointScalarValue(unsigned pointIndex, ScalarType valu
     m_scalarFields[m_currentInScalarFieldIndex]->setValue(pointIndex,value);
 }
 
-ScalarType ChunkedPointCloud::getPointScalarValue(unsigned pointIndex) const
+ScalarType ChunkedPointCloud::getPointScalarValue(PointIndexType pointIndex) const
 {
 	assert(m_currentOutScalarFieldIndex>=0 && m_currentOutScalarFieldIndex<(int)m_scalarFields.size());
 
@@ -366,7 +366,7 @@ bool ChunkedPointCloud::renameScalarField(int index, const char* newName)
 	return false;
 }
 
-void ChunkedPointCloud::swapPoints(unsigned firstIndex, unsigned secondIndex)
+void ChunkedPointCloud::swapPoints(PointIndexType firstIndex, PointIndexType secondIndex)
 {
 	if (firstIndex==secondIndex || firstIndex>=m_points->currentSize() || secondIndex>=m_points->currentSize())
         return;
@@ -23,6 +23,7 @@
 #include "SimpleCloud.h"
 #include "ReferenceCloud.h"
 #include "Neighbourhood.h"
+#include "NeighbourhoodCache.h"
 #include "SimpleMesh.h"
 #include "GenericProgressCallback.h"
 #include "DgmOctreeReferenceCloud.h"
@@ -32,6 +33,11 @@
 //system
 #include <assert.h>
 
+#ifdef USE_QT
+#include <QtCore>
+#include <QtConcurrentMap>
+#endif
+
 using namespace CCLib;
 
 GenericIndexedCloud* CloudSamplingTools::resampleCloudWithOctree(	GenericIndexedCloudPersist* inputCloud,
@@ -249,11 +255,227 @@ ReferenceCloud* CloudSamplingTools::subsampleCloudRandomly(GenericIndexedCloudPe
 	return newCloud;
 }
 
+//! Spatial resampling: state of the points (see CloudSamplingTools::resampleCloudSpatially)
+enum SpatialResamplingMarkers
+{
+	SR_REMOVED = 0,		//!< too close to a selected point
+	SR_CANDIDATE = 1,	//!< not processed yet
+	SR_SELECTED = 2		//!< selected (parallel mode only)
+};
+
+//! Spatial resampling parameters (shared by all the threads)
+struct SpatialResamplingContext
+{
+	//! Input cloud
+	GenericIndexedCloudPersist* cloud;
+	//! Input cloud octree
+	const DgmOctree* octree;
+	//! Points state (see SpatialResamplingMarkers)
+	GenericChunkedArray<1,char>* markers;
+	//! Default min distance between points
+	PointCoordinateType minDistance;
+	//! Whether the min distance is modulated by the scalar field
+	bool modParamsEnabled;
+	//! Modulation parameters
+	const CloudSamplingTools::SFModulationParams* modParams;
+	//! Min scalar value
+	ScalarType sfMin;
+	//! Max scalar value
+	ScalarType sfMax;
+	//! Best octree level(s) for neighbourhood extraction (from sfMin to sfMax if modulated)
+	const std::vector<unsigned char>* bestOctreeLevel;
+
+	//! Returns the min distance around a given point and the best level to extract the corresponding neighbourhood
+	void getMinDistance(unsigned pointIndex, PointCoordinateType& dist, unsigned char& level) const
+	{
+		if (modParamsEnabled)
+		{
+			ScalarType sfVal = cloud->getPointScalarValue(pointIndex);
+			if (ScalarField::ValidValue(sfVal))
+			{
+				//modulate minDistance
+				dist = static_cast<PointCoordinateType>(sfVal * modParams->a + modParams->b);
+				//get (approximate) best level
+				size_t levelIndex = 0;
+				if (sfMax > sfMin)
+					levelIndex = static_cast<size_t>(bestOctreeLevel->size() * ((sfVal - sfMin) / (sfMax - sfMin)));
+				if (levelIndex >= bestOctreeLevel->size())
+					levelIndex = bestOctreeLevel->size() - 1;
+				level = (*bestOctreeLevel)[levelIndex];
+				return;
+			}
+		}
+
+		dist = minDistance;
+		level = bestOctreeLevel->front();
+	}
+};
+
+//! Max number of points per chunk of cells (parallel spatial resampling)
+static const unsigned SPATIAL_RESAMPLING_POINTS_PER_CHUNK = 16384;
+
+//! Chunk of cells processed by a single thread (parallel spatial resampling)
+struct SpatialResamplingChunk
+{
+	//! Shared parameters
+	const SpatialResamplingContext* context;
+	//! All the cells (index of their first point in the octree structure)
+	const DgmOctree::cellsContainer* cells;
+	//! Cells to process (indexes in 'cells')
+	const unsigned* cellIndexes;
+	//! Number of cells to process
+	unsigned count;
+	//! Progress notification (per point)
+	NormalizedProgress* nProgress;
+	//! Whether the process has been cancelled (shared by all chunks)
+	bool* cancelled;
+};
+
+static void ResampleCellsSpatially(SpatialResamplingChunk& chunk)
+{
+	if (*chunk.cancelled)
+		return;
+
+	const SpatialResamplingContext& context = *chunk.context;
+	const DgmOctree::cellsContainer& pointsAndCodes = context.octree->pointsAndTheirCellCodes();
+	const unsigned pointCount = context.octree->getNumberOfProjectedPoints();
+
+	DgmOctree::NeighboursSet neighbours;
+	for (unsigned c=0; c<chunk.count; ++c)
+	{
+		unsigned cellIndex = chunk.cellIndexes[c];
+		unsigned first = (*chunk.cells)[cellIndex].theIndex;
+		unsigned last = (cellIndex + 1 < chunk.cells->size() ? (*chunk.cells)[cellIndex+1].theIndex : pointCount);
+
+		for (unsigned j=first; j<last; ++j)
+		{
+			unsigned pointIndex = pointsAndCodes[j].theIndex;
+			if (context.markers->getValue(pointIndex) != SR_CANDIDATE)
+				continue;
+
+			//the point is the only candidate in its neighbourhood, so it is selected
+			context.markers->setValue(pointIndex,SR_SELECTED);
+
+			PointCoordinateType minDistBetweenPoints = 0;
+			unsigned char octreeLevel = 0;
+			context.getMinDistance(pointIndex,minDistBetweenPoints,octreeLevel);
+
+			//look for neighbors and 'de-mark' them
+			//(they lie in the current cell or in its neighbours, which are not processed concurrently)
+			neighbours.clear();
+			context.octree->getPointsInSphericalNeighbourhood(*context.cloud->getPoint(pointIndex),minDistBetweenPoints,neighbours,octreeLevel);
+			for (DgmOctree::NeighboursSet::const_iterator it = neighbours.begin(); it != neighbours.end(); ++it)
+				if (it->pointIndex != pointIndex && context.markers->getValue(it->pointIndex) != SR_SELECTED)
+					context.markers->setValue(it->pointIndex,SR_REMOVED);
+		}
+
+		if (chunk.nProgress && !chunk.nProgress->steps(last-first))
+		{
+			//process cancelled by the user
+			*chunk.cancelled = true;
+			return;
+		}
+	}
+}
+
+//! Parallel spatial resampling (see CloudSamplingTools::resampleCloudSpatially)
+/** \return false if not enough memory or if the process has been cancelled
+**/
+static bool ResampleCloudSpatiallyByColors(	const SpatialResamplingContext& context,
+											PointCoordinateType maxDistance,
+											NormalizedProgress* nProgress)
+{
+	const DgmOctree* octree = context.octree;
+
+	//cells as small as possible, but larger than the max distance between points
+	//(so that the neighbourhood of a point never exceeds the 26 neighbours of its cell)
+	unsigned char level = static_cast<unsigned char>(DgmOctree::MAX_OCTREE_LEVEL);
+	while (level > 1 && octree->getCellSize(level) < maxDistance)
+		--level;
+
+	//we sort the cells by color (parity of their position)
+	DgmOctree::cellsContainer cells;
+	std::vector<unsigned> colorCells[8];
+	try
+	{
+		if (!octree->getCellCodesAndIndexes(level,cells,true))
+			return false;
+
+		for (size_t n=0; n<cells.size(); ++n)
+		{
+			Tuple3i cellPos;
+			octree->getCellPos(cells[n].theCode,level,cellPos,true);
+			colorCells[(cellPos.x & 1) | ((cellPos.y & 1) << 1) | ((cellPos.z & 1) << 2)].push_back(static_cast<unsigned>(n));
+		}
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return false;
+	}
+
+	const unsigned pointCount = octree->getNumberOfProjectedPoints();
+	bool cancelled = false;
+
+	//the colors are processed one after the other
+	for (unsigned color=0; color<8 && !cancelled; ++color)
+	{
+		const std::vector<unsigned>& cellIndexes = colorCells[color];
+		if (cellIndexes.empty())
+			continue;
+
+		//chunks of (roughly) SPATIAL_RESAMPLING_POINTS_PER_CHUNK points
+		std::vector<SpatialResamplingChunk> chunks;
+		try
+		{
+			unsigned chunkPoints = 0;
+			for (size_t c=0; c<cellIndexes.size(); ++c)
+			{
+				if (chunks.empty() || chunkPoints >= SPATIAL_RESAMPLING_POINTS_PER_CHUNK)
+				{
+					SpatialResamplingChunk chunk;
+					chunk.context = &context;
+					chunk.cells = &cells;
+					chunk.cellIndexes = &(cellIndexes[c]);
+					chunk.count = 0;
+					chunk.nProgress = nProgress;
+					chunk.cancelled = &cancelled;
+					chunks.push_back(chunk);
+					chunkPoints = 0;
+				}
+
+				unsigned cellIndex = cellIndexes[c];
+				unsigned last = (cellIndex + 1 < cells.size() ? cells[cellIndex+1].theIndex : pointCount);
+				chunkPoints += last - cells[cellIndex].theIndex;
+				++chunks.back().count;
+			}
+		}
+		catch (const std::bad_alloc&) //out of memory
+		{
+			return false;
+		}
+
+#ifdef USE_QT
+		if (chunks.size() > 1)
+		{
+			QtConcurrent::blockingMap(chunks, ResampleCellsSpatially);
+		}
+		else
+#endif
+		{
+			for (size_t n=0; n<chunks.size(); ++n)
+				ResampleCellsSpatially(chunks[n]);
+		}
+	}
+
+	return !cancelled;
+}
+
 ReferenceCloud* CloudSamplingTools::resampleCloudSpatially(GenericIndexedCloudPersist* inputCloud,
 															PointCoordinateType minDistance,
 															const SFModulationParams& modParams,
 															DgmOctree* inputOctree/*=0*/,
-															GenericProgressCallback* progressCb/*=0*/)
+															GenericProgressCallback* progressCb/*=0*/,
+															bool multiThread/*=false*/)
 {
 	assert(inputCloud);
     unsigned cloudSize = inputCloud->size();
@@ -294,6 +516,8 @@ ReferenceCloud* CloudSamplingTools::resampleCloudSpatially(GenericIndexedCloudPe
 	std::vector<unsigned char> bestOctreeLevel;
 	bool modParamsEnabled = modParams.enabled;
 	ScalarType sfMin = 0, sfMax = 0;
+	//max distance between points
+	PointCoordinateType maxDistance = minDistance;
 	try
 	{
 		if (modParams.enabled)
@@ -313,6 +537,7 @@ ReferenceCloud* CloudSamplingTools::resampleCloudSpatially(GenericIndexedCloudPe
 				PointCoordinateType dist1 = static_cast<PointCoordinateType>(sfMax * modParams.a + modParams.b);
 				unsigned char level0 = octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(dist0);
 				unsigned char level1 = octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(dist1);
+				maxDistance = std::max(maxDistance,std::max(dist0,dist1));
 
 				bestOctreeLevel.push_back(level0);
 				if (level1 != level0)
@@ -361,76 +586,99 @@ ReferenceCloud* CloudSamplingTools::resampleCloudSpatially(GenericIndexedCloudPe
 		progressCb->start();
 	}
 
-	//for each point in the cloud that is still 'marked', we look
-	//for its neighbors and remove their own marks
-	markers->placeIteratorAtBegining();
-	bool error = false;
-	//default octree level
+	//shared parameters
+	SpatialResamplingContext context;
+	context.cloud = inputCloud;
+	context.octree = octree;
+	context.markers = markers;
+	context.minDistance = minDistance;
+	context.modParamsEnabled = modParamsEnabled;
+	context.modParams = &modParams;
+	context.sfMin = sfMin;
+	context.sfMax = sfMax;
+	context.bestOctreeLevel = &bestOctreeLevel;
 	assert(!bestOctreeLevel.empty());
-	unsigned char octreeLevel = bestOctreeLevel.front();
-	//default distance between points
-	PointCoordinateType minDistBetweenPoints = minDistance;
-	for (unsigned i=0; i<cloudSize; i++, markers->forwardIterator())
+
+	bool error = false;
+	if (multiThread)
 	{
-		//no mark? we skip this point
-		if (markers->getCurrentValue() != 0)
+		if (ResampleCloudSpatiallyByColors(context,maxDistance,normProgress))
 		{
-			//init neighbor search structure
-			const CCVector3* P = inputCloud->getPoint(i);
+			//we gather the selected points (in the same order as the input cloud)
+			unsigned count = 0;
+			for (unsigned i=0; i<cloudSize; ++i)
+				if (markers->getValue(i) == SR_SELECTED)
+					++count;
 
-			//parameters modulation
-			if (modParamsEnabled)
+			if (sampledCloud->reserve(count))
+			{
+				for (unsigned i=0; i<cloudSize; ++i)
+					if (markers->getValue(i) == SR_SELECTED)
+						sampledCloud->addPointIndex(i);
+			}
+			else
+			{
+				//not enough memory
+				error = true;
+			}
+		}
+		else
+		{
+			//not enough memory or process cancelled by the user
+			error = true;
+		}
+	}
+	else
+	{
+		//for each point in the cloud that is still 'marked', we look
+		//for its neighbors and remove their own marks
+		markers->placeIteratorAtBegining();
+		for (unsigned i=0; i<cloudSize; i++, markers->forwardIterator())
+		{
+			//no mark? we skip this point
+			if (markers->getCurrentValue() != SR_REMOVED)
 			{
-				ScalarType sfVal = inputCloud->getPointScalarValue(i);
-				if (ScalarField::ValidValue(sfVal))
+				//init neighbor search structure
+				const CCVector3* P = inputCloud->getPoint(i);
+
+				//parameters modulation
+				PointCoordinateType minDistBetweenPoints = minDistance;
+				unsigned char octreeLevel = bestOctreeLevel.front();
+				context.getMinDistance(i,minDistBetweenPoints,octreeLevel);
+
+				//look for neighbors and 'de-mark' them
 				{
-					//modulate minDistance
-					minDistBetweenPoints = static_cast<PointCoordinateType>(sfVal * modParams.a + modParams.b);
-					//get (approximate) best level
-					size_t levelIndex = static_cast<size_t>(bestOctreeLevel.size() * (sfVal / (sfMax-sfMin)));
-					if (levelIndex == bestOctreeLevel.size())
-						--levelIndex;
-					octreeLevel = bestOctreeLevel[levelIndex];
+					DgmOctree::NeighboursSet neighbours;
+					octree->getPointsInSphericalNeighbourhood(*P,minDistBetweenPoints,neighbours,octreeLevel);
+					for (DgmOctree::NeighboursSet::iterator it = neighbours.begin(); it != neighbours.end(); ++it)
+						if (it->pointIndex != i)
+							markers->setValue(it->pointIndex,SR_REMOVED);
 				}
-				else
+
+				//At this stage, the ith point is the only one marked in a radius of <minDistance>.
+				//Therefore it will necessarily be in the final cloud!
+				if (sampledCloud->size() == sampledCloud->capacity() && !sampledCloud->reserve(sampledCloud->capacity() + c_reserveStep))
 				{
-					minDistBetweenPoints = minDistance;
-					octreeLevel = bestOctreeLevel.front();
+					//not enough memory
+					error = true;
+					break;
+				}
+				if (!sampledCloud->addPointIndex(i))
+				{
+					//not enough memory
+					error = true;
+					break;
 				}
 			}
 
-			//look for neighbors and 'de-mark' them
-			{
-				DgmOctree::NeighboursSet neighbours;
-				octree->getPointsInSphericalNeighbourhood(*P,minDistBetweenPoints,neighbours,octreeLevel);
-				for (DgmOctree::NeighboursSet::iterator it = neighbours.begin(); it != neighbours.end(); ++it)
-					if (it->pointIndex != i)
-						markers->setValue(it->pointIndex,0);
-			}
-
-			//At this stage, the ith point is the only one marked in a radius of <minDistance>.
-			//Therefore it will necessarily be in the final cloud!
-			if (sampledCloud->size() == sampledCloud->capacity() && !sampledCloud->reserve(sampledCloud->capacity() + c_reserveStep))
+			//progress indicator
+			if (normProgress && !normProgress->oneStep())
 			{
-				//not enough memory
-				error = true;
-				break;
-			}
-			if (!sampledCloud->addPointIndex(i))
-			{
-				//not enough memory
+				//cancel process
 				error = true;
 				break;
 			}
 		}
-			
-		//progress indicator
-		if (normProgress && !normProgress->oneStep())
-		{
-			//cancel process
-			error = true;
-			break;
-		}
 	}
 
 	//remove unnecessarily allocated memory
@@ -469,7 +717,8 @@ ReferenceCloud* CloudSamplingTools::sorFilter(GenericIndexedCloudPersist* inputC
 											  int knn/*=6*/,
 											  double nSigma/*=1.0*/,
 											  DgmOctree* inputOctree/*=0*/,
-											  GenericProgressCallback* progressCb/*=0*/)
+											  GenericProgressCallback* progressCb/*=0*/,
+											  const NeighbourhoodCache* cache/*=0*/)
 {
 	if (!inputCloud || knn <= 0 || inputCloud->size() <= static_cast<unsigned>(knn))
 	{
@@ -478,8 +727,12 @@ ReferenceCloud* CloudSamplingTools::sorFilter(GenericIndexedCloudPersist* inputC
 		return 0;
 	}
 
+	//the precomputed neighbourhoods are only used if they hold enough neighbours
+	if (cache && (!cache->isValidFor(inputCloud) || !cache->hasNearestNeighbours(static_cast<unsigned>(knn))))
+		cache = 0;
+
 	DgmOctree* octree = inputOctree;
-	if (!octree)
+	if (!octree && !cache)
 	{
 		//compute the octree if necessary
 		octree = new DgmOctree(inputCloud);
@@ -510,6 +763,50 @@ ReferenceCloud* CloudSamplingTools::sorFilter(GenericIndexedCloudPersist* inputC
 		double avgDist = 0, stdDev = 0;
 
 		//1st step: compute the average distance to the neighbors
+		if (cache)
+		{
+			//we read the neighbourhoods directly from the cache
+			NormalizedProgress nProgress(progressCb,pointCount);
+			if (progressCb)
+			{
+				progressCb->reset();
+				progressCb->setMethodTitle("SOR filter");
+				progressCb->start();
+			}
+
+			bool cancelled = false;
+			DgmOctree::NeighboursSet neighbours;
+			for (unsigned i=0; i<pointCount; ++i)
+			{
+				cache->getNearestNeighbours(i,static_cast<unsigned>(knn),neighbours);
+
+				double sumDist = 0;
+				unsigned count = 0;
+				for (size_t j=0; j<neighbours.size(); ++j)
+				{
+					if (neighbours[j].pointIndex != i)
+					{
+						sumDist += sqrt(neighbours[j].squareDistd);
+						++count;
+					}
+				}
+				if (count)
+					meanDistances[i] = static_cast<PointCoordinateType>(sumDist / count);
+
+				if (progressCb && !nProgress.oneStep())
+				{
+					cancelled = true;
+					break;
+				}
+			}
+
+			if (progressCb)
+				progressCb->stop();
+
+			if (cancelled)
+				break;
+		}
+		else
 		{
 			//additional parameters
 			void* additionalParameters[] = {reinterpret_cast<void*>(inputCloud),
@@ -529,8 +826,10 @@ ReferenceCloud* CloudSamplingTools::sorFilter(GenericIndexedCloudPersist* inputC
 				//something went wrong
 				break;
 			}
+		}
 
-			//deduce the average distance and std. dev.
+		//deduce the average distance and std. dev.
+		{
 			double sumDist = 0;
 			double sumSquareDist = 0;
 			for (unsigned i=0; i<pointCount; ++i)
@@ -586,7 +885,8 @@ ReferenceCloud* CloudSamplingTools::noiseFilter(GenericIndexedCloudPersist* inpu
 												bool useAbsoluteError/*=true*/,
 												double absoluteError/*=0.0*/,
 												DgmOctree* inputOctree/*=0*/,
-												GenericProgressCallback* progressCb/*=0*/)
+												GenericProgressCallback* progressCb/*=0*/,
+												const NeighbourhoodCache* cache/*=0*/)
 {
 	if (!inputCloud || inputCloud->size() < 2 || (useKnn && knn <= 0) || (!useKnn && kernelRadius <= 0))
 	{
@@ -595,6 +895,10 @@ ReferenceCloud* CloudSamplingTools::noiseFilter(GenericIndexedCloudPersist* inpu
 		return 0;
 	}
 
+	//the precomputed neighbourhoods must correspond to the input cloud
+	if (cache && !cache->isValidFor(inputCloud))
+		cache = 0;
+
 	DgmOctree* octree = inputOctree;
 	if (!octree)
 	{
@@ -626,7 +930,8 @@ ReferenceCloud* CloudSamplingTools::noiseFilter(GenericIndexedCloudPersist* inpu
 									reinterpret_cast<void*>(&useKnn),
 									reinterpret_cast<void*>(&knn),
 									reinterpret_cast<void*>(&useAbsoluteError),
-									reinterpret_cast<void*>(&absoluteError)
+									reinterpret_cast<void*>(&absoluteError),
+									const_cast<void*>(reinterpret_cast<const void*>(cache))
 	};
 
 	unsigned char octreeLevel = 0;
@@ -741,6 +1046,7 @@ bool CloudSamplingTools::applyNoiseFilterAtLevel(	const DgmOctree::octreeCell& c
 	int knn								= *static_cast<int*>(additionalParameters[5]);
 	bool useAbsoluteError				= *static_cast<bool*>(additionalParameters[6]);
 	double absoluteError				= *static_cast<double*>(additionalParameters[7]);
+	const NeighbourhoodCache* cache		=  static_cast<const NeighbourhoodCache*>(additionalParameters[8]);
 
 	//structure for nearest neighbors search
 	DgmOctree::NearestNeighboursSphericalSearchStruct nNSS;
@@ -753,16 +1059,26 @@ bool CloudSamplingTools::applyNoiseFilterAtLevel(	const DgmOctree::octreeCell& c
 
 	unsigned n = cell.points->size(); //number of points in the current cell
 
+	DgmOctree::NeighboursSet cachedNeighbours;
+
 	//for each point in the cell
 	for (unsigned i=0; i<n; ++i)
 	{
 		cell.points->getPoint(i,nNSS.queryPoint);
+		const unsigned globalIndex = cell.points->getPointGlobalIndex(i);
 
 		//look for neighbors (either inside a sphere or the k nearest ones)
 		//warning: there may be more points at the end of nNSS.pointsInNeighbourhood than the actual nearest neighbors (neighborCount)!
 		unsigned neighborCount = 0;
 
-		if (useKnn)
+		//we use the precomputed neighbourhood if possible (the search structure is left untouched as it is shared by all the cell points)
+		DgmOctree::NeighboursSet* neighbours = &nNSS.pointsInNeighbourhood;
+		if (cache && (useKnn ? cache->getNearestNeighbours(globalIndex,static_cast<unsigned>(knn),cachedNeighbours) : cache->getNeighboursInSphere(globalIndex,kernelRadius,cachedNeighbours)))
+		{
+			neighbours = &cachedNeighbours;
+			neighborCount = static_cast<unsigned>(cachedNeighbours.size());
+		}
+		else if (useKnn)
 			neighborCount = cell.parentOctree->findNearestNeighborsStartingFromCell(nNSS);
 		else
 			neighborCount = cell.parentOctree->findNeighborsInASphereStartingFromCell(nNSS,kernelRadius,false);
@@ -770,19 +1086,18 @@ bool CloudSamplingTools::applyNoiseFilterAtLevel(	const DgmOctree::octreeCell& c
 		if (neighborCount > 3) //we want 3 points or more (other than the point itself!)
 		{
 			//find the query point in the nearest neighbors set and place it at the end
-			const unsigned globalIndex = cell.points->getPointGlobalIndex(i);
 			unsigned localIndex = 0;
-			while (localIndex < neighborCount && nNSS.pointsInNeighbourhood[localIndex].pointIndex != globalIndex)
+			while (localIndex < neighborCount && (*neighbours)[localIndex].pointIndex != globalIndex)
 				++localIndex;
 			//the query point should be in the nearest neighbors set!
 			assert(localIndex < neighborCount);
 			if (localIndex+1 < neighborCount) //no need to swap with another point if it's already at the end!
 			{
-				std::swap(nNSS.pointsInNeighbourhood[localIndex],nNSS.pointsInNeighbourhood[neighborCount-1]);
+				std::swap((*neighbours)[localIndex],(*neighbours)[neighborCount-1]);
 			}
 
 			unsigned realNeighborCount = neighborCount-1;
-			DgmOctreeReferenceCloud neighboursCloud(&nNSS.pointsInNeighbourhood,realNeighborCount); //we don't take the query point into account!
+			DgmOctreeReferenceCloud neighboursCloud(neighbours,realNeighborCount); //we don't take the query point into account!
 			Neighbourhood Z(&neighboursCloud);
 
 			const PointCoordinateType* lsPlane = Z.getLSPlane();
@@ -823,7 +1138,6 @@ bool CloudSamplingTools::applyNoiseFilterAtLevel(	const DgmOctree::octreeCell& c
 			if (!removeIsolatedPoints)
 			{
 				//we keep the point
-				unsigned globalIndex = cell.points->getPointGlobalIndex(i);
 				cloud->addPointIndex(globalIndex);
 			}
 		}
@@ -843,30 +1157,37 @@ bool CloudSamplingTools::applySORFilterAtLevel(	const DgmOctree::octreeCell& cel
 	int knn											= *static_cast<int*>(additionalParameters[1]);
 	std::vector<PointCoordinateType>& meanDistances	= *static_cast<std::vector<PointCoordinateType>*>(additionalParameters[2]);
 
-	//structure for nearest neighbors search
-	DgmOctree::NearestNeighboursSphericalSearchStruct nNSS;
-	nNSS.level = cell.level;
-	nNSS.minNumberOfNeighbors = knn; //DGM: I woud have put knn+1 (as the point itself will be ignored) but in this case we won't get the same result as PCL!
-	cell.parentOctree->getCellPos(cell.truncatedCode,cell.level,nNSS.cellPos,true);
-	cell.parentOctree->computeCellCenter(nNSS.cellPos,cell.level,nNSS.cellCenter);
-
 	unsigned n = cell.points->size(); //number of points in the current cell
 
+	//we look for the k nearest neighbors of all the cell points at once
+	//DGM: I woud have asked for knn+1 neighbours (as the point itself will be ignored) but in this case we won't get the same result as PCL!
+	DgmOctree::NeighboursBatch batch;
+	try
+	{
+		std::vector<CCVector3> queryPoints(n);
+		for (unsigned i=0; i<n; ++i)
+			cell.points->getPoint(i,queryPoints[i]);
+
+		if (n != 0 && !cell.parentOctree->findNearestNeighborsBatch(&queryPoints[0],n,static_cast<unsigned>(knn),cell.level,batch))
+			return false;
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return false;
+	}
+
 	//for each point in the cell
 	for (unsigned i=0; i<n; ++i)
 	{
-		cell.points->getPoint(i,nNSS.queryPoint);
 		const unsigned globalIndex = cell.points->getPointGlobalIndex(i);
 
-		//look for the k nearest neighbors
-		unsigned neighborCount = cell.parentOctree->findNearestNeighborsStartingFromCell(nNSS);
 		double sumDist = 0;
 		unsigned count = 0;
-		for (unsigned j=0; j<neighborCount; ++j)
+		for (unsigned j=batch.offsets[i]; j<batch.offsets[i+1]; ++j)
 		{
-			if (nNSS.pointsInNeighbourhood[j].pointIndex != globalIndex)
+			if (batch.indexes[j] != globalIndex)
 			{
-				sumDist += sqrt(nNSS.pointsInNeighbourhood[j].squareDistd);
+				sumDist += sqrt(static_cast<double>(batch.squareDists[j]));
 				++count;
 			}
 		}
@@ -29,6 +29,7 @@
 #include <string.h>
 #include <assert.h>
 #include <stdio.h>
+#include <limits.h>
 #include <set>
 
 //DGM: tests in progress
@@ -148,15 +149,49 @@ void getPointsInTreeCell(octreeTreeCell* cell, CCLib::DgmOctree::NeighboursSet&
 
 #endif
 
-#ifdef USE_QT
-#ifndef _DEBUG
+//threading layer (Qt or C++11 threads)
+#include "ParallelTools.h"
+
+#if defined(CC_PARALLEL_SUPPORT) && !defined(_DEBUG)
 //enables multi-threading handling
 #define ENABLE_MT_OCTREE
 #endif
-#endif
 
 using namespace CCLib;
 
+//! Cell index lookup tables, per level of subdivision
+/** The tables are built on demand, possibly by concurrent threads (e.g. when
+	the cell functions are run in parallel): they must be published atomically
+	(see DgmOctree::getCellIndexTable).
+**/
+struct DgmOctree::CellIndexTables
+{
+	//! Default constructor
+	CellIndexTables()
+	{
+		for (int i=0; i<=MAX_OCTREE_LEVEL; ++i)
+			set(i,0);
+	}
+
+#ifdef ENABLE_MT_OCTREE
+	//! Returns the table of a given level (or 0 if not built yet)
+	inline CellIndexTable* get(int level) const { return tables[level].load(); }
+	//! Sets the table of a given level
+	inline void set(int level, CellIndexTable* table) { tables[level].store(table); }
+
+	//! Tables
+	Parallel::AtomicPointer<CellIndexTable> tables[MAX_OCTREE_LEVEL+1];
+#else
+	//! Returns the table of a given level (or 0 if not built yet)
+	inline CellIndexTable* get(int level) const { return tables[level]; }
+	//! Sets the table of a given level
+	inline void set(int level, CellIndexTable* table) { tables[level] = table; }
+
+	//! Tables
+	CellIndexTable* tables[MAX_OCTREE_LEVEL+1];
+#endif
+};
+
 bool DgmOctree::MultiThreadSupport()
 {
 #ifdef ENABLE_MT_OCTREE
@@ -169,6 +204,10 @@ bool DgmOctree::MultiThreadSupport()
 DgmOctree::DgmOctree(GenericIndexedCloudPersist* cloud)
 	: m_theAssociatedCloud(cloud)
 	, m_numberOfProjectedPoints(0)
+	, m_parallelBuild(true)
+	, m_keepOrderedPoints(false)
+	, m_cellIndexTables(new CellIndexTables)
+	, m_useCellIndexTables(true)
 {
 	clear();
 
@@ -177,6 +216,10 @@ DgmOctree::DgmOctree(GenericIndexedCloudPersist* cloud)
 
 DgmOctree::~DgmOctree()
 {
+	releaseCellIndexTables();
+	delete m_cellIndexTables;
+	m_cellIndexTables = 0;
+
 #ifdef OCTREE_TREE_TEST
 	if (s_root)
 		delete s_root;
@@ -191,6 +234,8 @@ void DgmOctree::clear()
 
 	m_numberOfProjectedPoints = 0;
 	m_thePointsAndTheirCellCodes.clear();
+	m_orderedPoints.clear();
+	releaseCellIndexTables();
 
 	memset(m_fillIndexes,0,sizeof(int)*(MAX_OCTREE_LEVEL+1)*6);
 	memset(m_cellSize,0,sizeof(PointCoordinateType)*(MAX_OCTREE_LEVEL+2));
@@ -226,127 +271,453 @@ int DgmOctree::build(	const CCVector3& octreeMin,
 	return genericBuild(progressCb);
 }
 
-int DgmOctree::genericBuild(GenericProgressCallback* progressCb)
-{
-	unsigned pointCount = (m_theAssociatedCloud ? m_theAssociatedCloud->size() : 0);
-	if (pointCount == 0)
-	{
-		//no cloud/point?!
-		return -1;
-	}
+/*** PARALLEL BUILD ***/
 
-	//allocate memory
-	try
-	{
-		m_thePointsAndTheirCellCodes.resize(pointCount); //resize + operator[] is faster than reserve + push_back!
-	}
-	catch (.../*const std::bad_alloc&*/) //out of memory
-	{
-		return -1;
-	}
-	m_numberOfProjectedPoints = 0;
+//! Minimal number of points per chunk during the octree build
+static const unsigned MIN_POINTS_PER_BUILD_CHUNK = 65536;
 
-	//update the pre-computed 'cell size per level of subdivision' array
-	updateCellSizeTable();
+//! Clouds smaller than this are sorted with std::sort (the radix sort overhead is not worth it)
+static const unsigned MIN_POINTS_FOR_RADIX_SORT = 65536;
 
-	//progress notification (optional)
-	if (progressCb)
-	{
-		progressCb->reset();
-		progressCb->setMethodTitle("Build Octree");
-		char infosBuffer[256];
-		sprintf(infosBuffer,"Projecting %u points\nMax. depth: %i",pointCount,MAX_OCTREE_LEVEL);
-		progressCb->setInfo(infosBuffer);
-		progressCb->start();
-	}
-	NormalizedProgress nprogress(progressCb,pointCount,90); //first phase: 90% (we keep 10% for sort)
+//! Number of bits per radix sort digit
+static const unsigned char RADIX_BITS = 8;
+//! Number of buckets per radix sort digit
+static const unsigned RADIX_BUCKETS = (1 << RADIX_BITS);
 
-	//fill indexes table (we'll fill the max. level, then deduce the others from this one)
-	int* fillIndexesAtMaxLevel = m_fillIndexes + (MAX_OCTREE_LEVEL*6);
+//! Returns the number of chunks in which a job on 'count' elements should be split
+static unsigned GetBuildChunkCount(PointIndexType count)
+{
+	unsigned maxChunks = 1;
+#ifdef ENABLE_MT_OCTREE
+	maxChunks = Parallel::IdealThreadCount();
+#endif
+	unsigned chunks = static_cast<unsigned>(std::min<PointIndexType>(maxChunks, count / MIN_POINTS_PER_BUILD_CHUNK));
+	return std::max(chunks, 1u);
+}
 
-	//for all points
-	cellsContainer::iterator it = m_thePointsAndTheirCellCodes.begin();
-	for (unsigned i=0; i<pointCount; i++)
+//! Chunk of points projected by a single thread during the octree build
+struct octreeBuildChunk
+{
+	//! Associated octree
+	const DgmOctree* octree;
+	//! Associated cloud
+	GenericIndexedCloudPersist* cloud;
+	//! Lower limits of the accepted points box
+	CCVector3 pointsMin;
+	//! Upper limits of the accepted points box
+	CCVector3 pointsMax;
+	//! First point index
+	PointIndexType firstIndex;
+	//! Number of points to process
+	PointIndexType count;
+	//! Output buffer (for this chunk)
+	DgmOctree::IndexAndCode* output;
+	//! Number of points actually projected (output)
+	PointIndexType projectedCount;
+	//! Min and max cell positions at the deepest level of subdivision (output)
+	int fillIndexes[6];
+	//! Progress notification (shared)
+	NormalizedProgress* nprogress;
+	//! Process cancellation flag (shared)
+	volatile bool* canceled;
+};
+
+//! Computes the cell codes of a chunk of points (see DgmOctree::genericBuild)
+static void ProjectPointsChunk(octreeBuildChunk& chunk)
+{
+	chunk.projectedCount = 0;
+	DgmOctree::IndexAndCode* it = chunk.output;
+
+	//progress notification is sent by packets to limit contention between threads
+	static const unsigned PROGRESS_STEP = 4096;
+	unsigned pendingSteps = 0;
+
+	for (PointIndexType j=0; j<chunk.count; ++j)
 	{
-		const CCVector3* P = m_theAssociatedCloud->getPoint(i);
+		PointIndexType i = chunk.firstIndex + j;
+		const CCVector3* P = chunk.cloud->getPoint(i);
 
 		//does the point falls in the 'accepted points' box?
 		//(potentially different from the octree box - see DgmOctree::build)
-		if (	(P->x >= m_pointsMin[0]) && (P->x <= m_pointsMax[0])
-			&&	(P->y >= m_pointsMin[1]) && (P->y <= m_pointsMax[1])
-			&&	(P->z >= m_pointsMin[2]) && (P->z <= m_pointsMax[2]) )
+		if (	(P->x >= chunk.pointsMin[0]) && (P->x <= chunk.pointsMax[0])
+			&&	(P->y >= chunk.pointsMin[1]) && (P->y <= chunk.pointsMax[1])
+			&&	(P->z >= chunk.pointsMin[2]) && (P->z <= chunk.pointsMax[2]) )
 		{
 			//compute the position of the cell that includes this point
 			Tuple3i cellPos;
-			getTheCellPosWhichIncludesThePoint(P,cellPos);
+			chunk.octree->getTheCellPosWhichIncludesThePoint(P,cellPos);
 
 			//clipping X
 			if (cellPos.x < 0)
 				cellPos.x = 0;
-			else if (cellPos.x > MAX_OCTREE_LENGTH)
-				cellPos.x = MAX_OCTREE_LENGTH;
+			else if (cellPos.x > DgmOctree::MAX_OCTREE_LENGTH)
+				cellPos.x = DgmOctree::MAX_OCTREE_LENGTH;
 			//clipping Y
 			if (cellPos.y < 0)
 				cellPos.y = 0;
-			else if (cellPos.y > MAX_OCTREE_LENGTH)
-				cellPos.y = MAX_OCTREE_LENGTH;
+			else if (cellPos.y > DgmOctree::MAX_OCTREE_LENGTH)
+				cellPos.y = DgmOctree::MAX_OCTREE_LENGTH;
 			//clipping Z
 			if (cellPos.z < 0)
 				cellPos.z = 0;
-			else if (cellPos.z > MAX_OCTREE_LENGTH)
-				cellPos.z = MAX_OCTREE_LENGTH;
+			else if (cellPos.z > DgmOctree::MAX_OCTREE_LENGTH)
+				cellPos.z = DgmOctree::MAX_OCTREE_LENGTH;
 
 			it->theIndex = i;
-			it->theCode = generateTruncatedCellCode(cellPos,MAX_OCTREE_LEVEL);
+			it->theCode = chunk.octree->generateTruncatedCellCode(cellPos,DgmOctree::MAX_OCTREE_LEVEL);
 
-			if (m_numberOfProjectedPoints)
+			if (chunk.projectedCount)
 			{
-				if (fillIndexesAtMaxLevel[0] > cellPos.x)
-					fillIndexesAtMaxLevel[0] = cellPos.x;
-				else if (fillIndexesAtMaxLevel[3] < cellPos.x)
-					fillIndexesAtMaxLevel[3] = cellPos.x;
-
-				if (fillIndexesAtMaxLevel[1] > cellPos.y)
-					fillIndexesAtMaxLevel[1] = cellPos.y;
-				else if (fillIndexesAtMaxLevel[4] < cellPos.y)
-					fillIndexesAtMaxLevel[4] = cellPos.y;
-
-				if (fillIndexesAtMaxLevel[2] > cellPos.z)
-					fillIndexesAtMaxLevel[2] = cellPos.z;
-				else if (fillIndexesAtMaxLevel[5] < cellPos.z)
-					fillIndexesAtMaxLevel[5] = cellPos.z;
+				if (chunk.fillIndexes[0] > cellPos.x)
+					chunk.fillIndexes[0] = cellPos.x;
+				else if (chunk.fillIndexes[3] < cellPos.x)
+					chunk.fillIndexes[3] = cellPos.x;
+
+				if (chunk.fillIndexes[1] > cellPos.y)
+					chunk.fillIndexes[1] = cellPos.y;
+				else if (chunk.fillIndexes[4] < cellPos.y)
+					chunk.fillIndexes[4] = cellPos.y;
+
+				if (chunk.fillIndexes[2] > cellPos.z)
+					chunk.fillIndexes[2] = cellPos.z;
+				else if (chunk.fillIndexes[5] < cellPos.z)
+					chunk.fillIndexes[5] = cellPos.z;
 			}
 			else
 			{
-				fillIndexesAtMaxLevel[0] = fillIndexesAtMaxLevel[3] = cellPos.x;
-				fillIndexesAtMaxLevel[1] = fillIndexesAtMaxLevel[4] = cellPos.y;
-				fillIndexesAtMaxLevel[2] = fillIndexesAtMaxLevel[5] = cellPos.z;
+				chunk.fillIndexes[0] = chunk.fillIndexes[3] = cellPos.x;
+				chunk.fillIndexes[1] = chunk.fillIndexes[4] = cellPos.y;
+				chunk.fillIndexes[2] = chunk.fillIndexes[5] = cellPos.z;
 			}
 
 			++it;
-			++m_numberOfProjectedPoints;
+			++chunk.projectedCount;
 		}
 
-		if (!nprogress.oneStep())
+		if (++pendingSteps == PROGRESS_STEP || j+1 == chunk.count)
 		{
-			m_thePointsAndTheirCellCodes.clear();
-			m_numberOfProjectedPoints = 0;
-			progressCb->stop();
-			return 0;
+			if (*chunk.canceled)
+				return;
+			if (chunk.nprogress && !chunk.nprogress->steps(pendingSteps))
+			{
+				*chunk.canceled = true;
+				return;
+			}
+			pendingSteps = 0;
 		}
 	}
+}
 
-	//we deduce the lower levels 'fill indexes' from the highest level
+//! ProjectPoints return code when the process has been canceled by the user
+static const int PROJECTION_CANCELED = -2;
+
+//! Computes the cell codes of a range of points (by chunks, in parallel if possible)
+/** Projected points are packed at the beginning of the output buffer.
+	\param octree octree
+	\param cloud associated cloud
+	\param firstIndex index of the first point
+	\param count number of points
+	\param pointsMin lower limits of the accepted points box
+	\param pointsMax upper limits of the accepted points box
+	\param output output buffer (at least 'count' elements)
+	\param fillIndexes min and max cell positions of the projected points at the deepest level of subdivision (output)
+	\param nprogress optional progress notification
+	\param[out] projectedCount the number of projected points
+	\param parallel whether the points should be processed in parallel or not
+	\return 0 on success, -1 if not enough memory or PROJECTION_CANCELED
+**/
+static int ProjectPoints(	const DgmOctree* octree,
+							GenericIndexedCloudPersist* cloud,
+							PointIndexType firstIndex,
+							PointIndexType count,
+							const CCVector3& pointsMin,
+							const CCVector3& pointsMax,
+							DgmOctree::IndexAndCode* output,
+							int* fillIndexes,
+							NormalizedProgress* nprogress,
+							PointIndexType& projectedCount,
+							bool parallel = true)
+{
+	projectedCount = 0;
+
+	//we split the points in chunks (one per thread)
+	std::vector<octreeBuildChunk> chunks;
+	try
+	{
+		chunks.resize(parallel ? GetBuildChunkCount(count) : 1);
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return -1;
+	}
+
+	volatile bool canceled = false;
+	{
+		const PointIndexType chunkSize = count / static_cast<PointIndexType>(chunks.size());
+		for (size_t k=0; k<chunks.size(); ++k)
+		{
+			octreeBuildChunk& chunk = chunks[k];
+			PointIndexType offset = static_cast<PointIndexType>(k) * chunkSize;
+			chunk.octree = octree;
+			chunk.cloud = cloud;
+			chunk.pointsMin = pointsMin;
+			chunk.pointsMax = pointsMax;
+			chunk.firstIndex = firstIndex + offset;
+			chunk.count = (k+1 == chunks.size() ? count - offset : chunkSize);
+			chunk.output = output + offset;
+			chunk.projectedCount = 0;
+			memset(chunk.fillIndexes,0,sizeof(int)*6);
+			chunk.nprogress = nprogress;
+			chunk.canceled = &canceled;
+		}
+	}
+
+#ifdef ENABLE_MT_OCTREE
+	if (chunks.size() > 1)
+		Parallel::BlockingMap(chunks, ProjectPointsChunk);
+	else
+#endif
+		ProjectPointsChunk(chunks.front());
+
+	if (canceled)
+		return PROJECTION_CANCELED;
+
+	//merge the chunks (projected points are packed at the beginning of the buffer)
+	for (size_t k=0; k<chunks.size(); ++k)
+	{
+		const octreeBuildChunk& chunk = chunks[k];
+		if (chunk.projectedCount == 0)
+			continue;
+
+		if (chunk.output != output + projectedCount)
+		{
+			std::copy(chunk.output, chunk.output + chunk.projectedCount, output + projectedCount);
+		}
+
+		if (projectedCount)
+		{
+			for (int dim=0; dim<3; ++dim)
+			{
+				fillIndexes[dim] = std::min(fillIndexes[dim],chunk.fillIndexes[dim]);
+				fillIndexes[dim+3] = std::max(fillIndexes[dim+3],chunk.fillIndexes[dim+3]);
+			}
+		}
+		else
+		{
+			memcpy(fillIndexes,chunk.fillIndexes,sizeof(int)*6);
+		}
+
+		projectedCount += chunk.projectedCount;
+	}
+
+	return 0;
+}
+
+//! Chunk of elements processed by a single thread during one radix sort pass
+struct radixSortChunk
+{
+	//! Input buffer
+	const DgmOctree::IndexAndCode* src;
+	//! Output buffer
+	DgmOctree::IndexAndCode* dst;
+	//! First element (included)
+	PointIndexType begin;
+	//! Last element (excluded)
+	PointIndexType end;
+	//! Binary shift of the current digit
+	unsigned char shift;
+	//! Digit histogram (then output offsets)
+	PointIndexType buckets[RADIX_BUCKETS];
+};
+
+//! Computes the histogram of the current digit over a chunk
+static void RadixHistogramChunk(radixSortChunk& chunk)
+{
+	memset(chunk.buckets,0,sizeof(PointIndexType)*RADIX_BUCKETS);
+	for (PointIndexType i=chunk.begin; i<chunk.end; ++i)
+		++chunk.buckets[static_cast<unsigned>(chunk.src[i].theCode >> chunk.shift) & (RADIX_BUCKETS-1)];
+}
+
+//! Scatters the elements of a chunk to their sorted position for the current digit
+static void RadixScatterChunk(radixSortChunk& chunk)
+{
+	for (PointIndexType i=chunk.begin; i<chunk.end; ++i)
+	{
+		const DgmOctree::IndexAndCode& e = chunk.src[i];
+		chunk.dst[chunk.buckets[static_cast<unsigned>(e.theCode >> chunk.shift) & (RADIX_BUCKETS-1)]++] = e;
+	}
+}
+
+//! Sorts a set of 'IndexAndCode' elements by ascending code order (LSD radix sort)
+/** Each pass is split in chunks that are processed in parallel (histogram
+	computation then scattering). The sort is stable. Passes for which all
+	codes share the same digit are skipped.
+	\param cells elements to sort
+	\return false if there's not enough memory (in which case 'cells' is left untouched)
+**/
+static bool RadixSortCellCodes(DgmOctree::cellsContainer& cells)
+{
+	const PointIndexType count = static_cast<PointIndexType>(cells.size());
+
+	DgmOctree::cellsContainer buffer;
+	std::vector<radixSortChunk> chunks;
+	try
+	{
+		buffer.resize(count);
+		chunks.resize(GetBuildChunkCount(count));
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	const PointIndexType chunkSize = count / static_cast<PointIndexType>(chunks.size());
+	for (size_t k=0; k<chunks.size(); ++k)
+	{
+		chunks[k].begin = static_cast<PointIndexType>(k) * chunkSize;
+		chunks[k].end = (k+1 == chunks.size() ? count : chunks[k].begin + chunkSize);
+	}
+
+	DgmOctree::IndexAndCode* src = &(cells[0]);
+	DgmOctree::IndexAndCode* dst = &(buffer[0]);
+
+	static const unsigned char CODE_BITS = 3*DgmOctree::MAX_OCTREE_LEVEL;
+	for (unsigned char shift=0; shift<CODE_BITS; shift+=RADIX_BITS)
 	{
-		for (int k=MAX_OCTREE_LEVEL-1; k>=0; k--)
+		for (size_t k=0; k<chunks.size(); ++k)
+		{
+			chunks[k].src = src;
+			chunks[k].dst = dst;
+			chunks[k].shift = shift;
+		}
+
+#ifdef ENABLE_MT_OCTREE
+		Parallel::BlockingMap(chunks, RadixHistogramChunk);
+#else
+		for (size_t k=0; k<chunks.size(); ++k)
+			RadixHistogramChunk(chunks[k]);
+#endif
+
+		//convert the histograms to output offsets (bucket by bucket, then chunk by chunk)
+		PointIndexType offset = 0;
+		bool singleBucket = false;
+		for (unsigned b=0; b<RADIX_BUCKETS; ++b)
 		{
-			int* fillIndexes = m_fillIndexes + (k*6);
-			for (int dim=0; dim<6; ++dim)
+			PointIndexType bucketStart = offset;
+			for (size_t k=0; k<chunks.size(); ++k)
+			{
+				PointIndexType n = chunks[k].buckets[b];
+				chunks[k].buckets[b] = offset;
+				offset += n;
+			}
+			if (offset - bucketStart == count)
 			{
-				fillIndexes[dim] = (fillIndexes[dim+6] >> 1);
+				//all codes share the same digit: nothing to do for this pass
+				singleBucket = true;
+				break;
 			}
 		}
+		if (singleBucket)
+			continue;
+
+#ifdef ENABLE_MT_OCTREE
+		Parallel::BlockingMap(chunks, RadixScatterChunk);
+#else
+		for (size_t k=0; k<chunks.size(); ++k)
+			RadixScatterChunk(chunks[k]);
+#endif
+
+		std::swap(src,dst);
+	}
+
+	//the sorted elements are in the temporary buffer?
+	if (src != &(cells[0]))
+		cells.swap(buffer);
+
+	return true;
+}
+
+//! Sorts a set of 'IndexAndCode' elements by ascending code order
+/** Radix sort on large sets, with std::sort as a fallback if there's not enough memory.
+	\param cells elements to sort
+	\param useRadixSort whether the radix sort can be used or not (otherwise std::sort is always used)
+**/
+static void SortCellCodes(DgmOctree::cellsContainer& cells, bool useRadixSort = true)
+{
+	if (	!useRadixSort
+		||	cells.size() < MIN_POINTS_FOR_RADIX_SORT
+		||	!RadixSortCellCodes(cells) )
+	{
+		std::sort(cells.begin(),cells.end(),DgmOctree::IndexAndCode::codeComp);
+	}
+}
+
+int DgmOctree::genericBuild(GenericProgressCallback* progressCb)
+{
+	PointIndexType pointCount = (m_theAssociatedCloud ? m_theAssociatedCloud->size() : 0);
+	if (pointCount == 0)
+	{
+		//no cloud/point?!
+		return -1;
+	}
+
+	//allocate memory
+	try
+	{
+		m_thePointsAndTheirCellCodes.resize(pointCount); //resize + operator[] is faster than reserve + push_back!
+	}
+	catch (.../*const std::bad_alloc&*/) //out of memory
+	{
+		return -1;
+	}
+	m_numberOfProjectedPoints = 0;
+	releaseCellIndexTables();
+
+	//update the pre-computed 'cell size per level of subdivision' array
+	updateCellSizeTable();
+
+	//progress notification (optional)
+	if (progressCb)
+	{
+		progressCb->reset();
+		progressCb->setMethodTitle("Build Octree");
+		char infosBuffer[256];
+		sprintf(infosBuffer,"Projecting %llu points\nMax. depth: %i",static_cast<unsigned long long>(pointCount),MAX_OCTREE_LEVEL);
+		progressCb->setInfo(infosBuffer);
+		progressCb->start();
+	}
+	NormalizedProgress nprogress(progressCb,pointCount,90); //first phase: 90% (we keep 10% for sort)
+
+	//fill indexes table (we'll fill the max. level, then deduce the others from this one)
+	int* fillIndexesAtMaxLevel = m_fillIndexes + (MAX_OCTREE_LEVEL*6);
+
+	//compute the cell codes of all points
+	PointIndexType projectedCount = 0;
+	int result = ProjectPoints(	this,
+								m_theAssociatedCloud,
+								0,
+								pointCount,
+								m_pointsMin,
+								m_pointsMax,
+								&(m_thePointsAndTheirCellCodes[0]),
+								fillIndexesAtMaxLevel,
+								progressCb ? &nprogress : 0,
+								projectedCount,
+								m_parallelBuild);
+
+	if (result < 0)
+	{
+		//process canceled or not enough memory
+		m_thePointsAndTheirCellCodes.clear();
+		m_numberOfProjectedPoints = 0;
+		if (progressCb)
+			progressCb->stop();
+		return (result == PROJECTION_CANCELED ? 0 : -1);
 	}
+	m_numberOfProjectedPoints = projectedCount;
+
+	//we deduce the lower levels 'fill indexes' from the highest level
+	updateFillIndexesFromDeepestLevel();
 
 	if (m_numberOfProjectedPoints < pointCount)
 		m_thePointsAndTheirCellCodes.resize(m_numberOfProjectedPoints); //smaller --> should always be ok
@@ -355,11 +726,18 @@ int DgmOctree::genericBuild(GenericProgressCallback* progressCb)
 		progressCb->setInfo("Sorting cells...");
 
 	//we sort the 'cells' by ascending code order
-	std::sort(m_thePointsAndTheirCellCodes.begin(),m_thePointsAndTheirCellCodes.end(),IndexAndCode::codeComp);
+	SortCellCodes(m_thePointsAndTheirCellCodes,m_parallelBuild);
 
 	//update the pre-computed 'number of cells per level of subdivision' array
 	updateCellCountTable();
 
+	//ordered copy of the points coordinates (optional)
+	if (m_keepOrderedPoints && !computeOrderedPoints())
+	{
+		//not enough memory: we'll do without it
+		m_keepOrderedPoints = false;
+	}
+
 	//end of process notification
 	if (progressCb)
 	{
@@ -368,14 +746,14 @@ int DgmOctree::genericBuild(GenericProgressCallback* progressCb)
 		char buffer[256];
 		if (m_numberOfProjectedPoints == pointCount)
 		{
-			sprintf(buffer,"[Octree::build] Octree successfully built... %u points (ok)!",m_numberOfProjectedPoints);
+			sprintf(buffer,"[Octree::build] Octree successfully built... %llu points (ok)!",static_cast<unsigned long long>(m_numberOfProjectedPoints));
 		}
 		else
 		{
 			if (m_numberOfProjectedPoints == 0)
 				sprintf(buffer,"[Octree::build] Warning : no point projected in the Octree!");
 			else
-				sprintf(buffer,"[Octree::build] Warning: some points have been filtered out (%u/%u)",pointCount-m_numberOfProjectedPoints,pointCount);
+				sprintf(buffer,"[Octree::build] Warning: some points have been filtered out (%llu/%llu)",static_cast<unsigned long long>(pointCount-m_numberOfProjectedPoints),static_cast<unsigned long long>(pointCount));
 		}
 
 		progressCb->setInfo(buffer);
@@ -468,7 +846,400 @@ int DgmOctree::genericBuild(GenericProgressCallback* progressCb)
 	}
 #endif
 
-	return static_cast<int>(m_numberOfProjectedPoints);
+	return static_cast<int>(std::min<PointIndexType>(m_numberOfProjectedPoints,INT_MAX));
+}
+
+bool DgmOctree::setKeepOrderedPoints(bool state)
+{
+	m_keepOrderedPoints = state;
+
+	if (!state)
+	{
+		releaseOrderedPoints();
+		return true;
+	}
+
+	if (!m_thePointsAndTheirCellCodes.empty() && !computeOrderedPoints())
+	{
+		//not enough memory
+		m_keepOrderedPoints = false;
+		return false;
+	}
+
+	return true;
+}
+
+void DgmOctree::releaseOrderedPoints()
+{
+	//we force the memory release (clear doesn't)
+	std::vector<CCVector3>().swap(m_orderedPoints);
+}
+
+//! Chunk of octree elements whose coordinates are copied by a single thread
+struct orderedPointsChunk
+{
+	//! Associated cloud
+	GenericIndexedCloudPersist* cloud;
+	//! First octree element
+	const DgmOctree::IndexAndCode* input;
+	//! Output coordinates
+	CCVector3* output;
+	//! Number of elements
+	PointIndexType count;
+};
+
+static void CopyOrderedPointsChunk(orderedPointsChunk& chunk)
+{
+	for (PointIndexType i=0; i<chunk.count; ++i)
+		chunk.cloud->getPoint(chunk.input[i].theIndex,chunk.output[i]);
+}
+
+bool DgmOctree::computeOrderedPoints()
+{
+	releaseOrderedPoints();
+
+	if (m_thePointsAndTheirCellCodes.empty())
+		return true;
+
+	std::vector<orderedPointsChunk> chunks;
+	try
+	{
+		m_orderedPoints.resize(m_numberOfProjectedPoints);
+		chunks.resize(GetBuildChunkCount(m_numberOfProjectedPoints));
+	}
+	catch (const std::bad_alloc&)
+	{
+		releaseOrderedPoints();
+		return false;
+	}
+
+	const PointIndexType chunkSize = m_numberOfProjectedPoints / static_cast<PointIndexType>(chunks.size());
+	for (size_t k=0; k<chunks.size(); ++k)
+	{
+		PointIndexType first = static_cast<PointIndexType>(k) * chunkSize;
+		chunks[k].cloud = m_theAssociatedCloud;
+		chunks[k].input = &(m_thePointsAndTheirCellCodes[first]);
+		chunks[k].output = &(m_orderedPoints[first]);
+		chunks[k].count = (k+1 == chunks.size() ? m_numberOfProjectedPoints - first : chunkSize);
+	}
+
+#ifdef ENABLE_MT_OCTREE
+	Parallel::BlockingMap(chunks, CopyOrderedPointsChunk);
+#else
+	for (size_t k=0; k<chunks.size(); ++k)
+		CopyOrderedPointsChunk(chunks[k]);
+#endif
+
+	return true;
+}
+
+/*** INCREMENTAL UPDATE ***/
+
+//! Keeps (and re-indexes) the octree elements corresponding to a subset of points
+/** The elements order is preserved. 'input' and 'output' can be the same buffer.
+	\return the number of kept elements
+**/
+static PointIndexType CompactCells(	const DgmOctree::IndexAndCode* input,
+									PointIndexType count,
+									const std::vector<PointIndexType>& newIndexes,
+									DgmOctree::IndexAndCode* output)
+{
+	PointIndexType keptCount = 0;
+	for (PointIndexType i=0; i<count; ++i)
+	{
+		assert(input[i].theIndex < newIndexes.size());
+		PointIndexType newIndex = newIndexes[input[i].theIndex];
+		if (newIndex != DgmOctree::INVALID_POINT_INDEX)
+		{
+			output[keptCount].theCode = input[i].theCode;
+			output[keptCount].theIndex = newIndex;
+			++keptCount;
+		}
+	}
+
+	return keptCount;
+}
+
+void DgmOctree::shrinkPointsBoundingBox()
+{
+	if (m_thePointsAndTheirCellCodes.empty())
+		return;
+
+	//the remaining points are necessarily inside the previous box
+	CCVector3 bbMin,bbMax;
+	m_theAssociatedCloud->getBoundingBox(bbMin,bbMax);
+	for (int dim=0; dim<3; ++dim)
+	{
+		m_pointsMin.u[dim] = std::max(m_pointsMin.u[dim],bbMin.u[dim]);
+		m_pointsMax.u[dim] = std::min(m_pointsMax.u[dim],bbMax.u[dim]);
+	}
+
+	//the cell position being monotonic, the fill indexes at the deepest level
+	//are simply the cell positions of the bounding-box corners
+	Tuple3i minPos,maxPos;
+	getTheCellPosWhichIncludesThePoint(&m_pointsMin,minPos);
+	getTheCellPosWhichIncludesThePoint(&m_pointsMax,maxPos);
+
+	const int maxLength = MAX_OCTREE_LENGTH;
+	int* fillIndexesAtMaxLevel = m_fillIndexes + (MAX_OCTREE_LEVEL*6);
+	for (int dim=0; dim<3; ++dim)
+	{
+		int minIndex = std::min(std::max(minPos.u[dim],0),maxLength);
+		int maxIndex = std::min(std::max(maxPos.u[dim],0),maxLength);
+		fillIndexesAtMaxLevel[dim] = std::max(fillIndexesAtMaxLevel[dim],minIndex);
+		fillIndexesAtMaxLevel[dim+3] = std::min(fillIndexesAtMaxLevel[dim+3],maxIndex);
+	}
+}
+
+void DgmOctree::finishIncrementalUpdate()
+{
+	m_numberOfProjectedPoints = static_cast<PointIndexType>(m_thePointsAndTheirCellCodes.size());
+	releaseCellIndexTables();
+
+	updateFillIndexesFromDeepestLevel();
+	updateCellCountTable();
+
+	//ordered copy of the points coordinates (optional)
+	if (m_keepOrderedPoints)
+	{
+		if (!computeOrderedPoints())
+		{
+			//not enough memory: we'll do without it
+			m_keepOrderedPoints = false;
+		}
+	}
+	else
+	{
+		releaseOrderedPoints();
+	}
+}
+
+bool DgmOctree::removePoints(const std::vector<PointIndexType>& newIndexes)
+{
+	if (!m_thePointsAndTheirCellCodes.empty())
+	{
+		PointIndexType keptCount = CompactCells(	&(m_thePointsAndTheirCellCodes[0]),
+													static_cast<PointIndexType>(m_thePointsAndTheirCellCodes.size()),
+													newIndexes,
+													&(m_thePointsAndTheirCellCodes[0]) );
+		m_thePointsAndTheirCellCodes.resize(keptCount); //smaller --> should always be ok
+	}
+
+	shrinkPointsBoundingBox();
+	finishIncrementalUpdate();
+
+	return true;
+}
+
+bool DgmOctree::insertPoints(PointIndexType firstIndex)
+{
+	PointIndexType pointCount = (m_theAssociatedCloud ? m_theAssociatedCloud->size() : 0);
+	if (firstIndex > pointCount)
+	{
+		assert(false);
+		return false;
+	}
+	if (m_thePointsAndTheirCellCodes.empty())
+	{
+		//the octree should be built first!
+		return false;
+	}
+	PointIndexType count = pointCount - firstIndex;
+	if (count == 0)
+	{
+		//nothing to do
+		return true;
+	}
+
+	//we compute the cell codes of the new points (they must lie inside the octree box)
+	cellsContainer newCells;
+	try
+	{
+		newCells.resize(count);
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return false;
+	}
+
+	int newFillIndexes[6];
+	PointIndexType projectedCount = 0;
+	if (	ProjectPoints(this,m_theAssociatedCloud,firstIndex,count,m_dimMin,m_dimMax,&(newCells[0]),newFillIndexes,0,projectedCount) < 0
+		||	projectedCount != count )
+	{
+		//some points are outside the octree box (or not enough memory)
+		return false;
+	}
+
+	//we sort the new elements...
+	SortCellCodes(newCells);
+
+	//... and merge them with the existing ones
+	size_t previousCount = m_thePointsAndTheirCellCodes.size();
+	try
+	{
+		m_thePointsAndTheirCellCodes.insert(m_thePointsAndTheirCellCodes.end(),newCells.begin(),newCells.end());
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		m_thePointsAndTheirCellCodes.resize(previousCount);
+		return false;
+	}
+	cellsContainer().swap(newCells);
+	std::inplace_merge(	m_thePointsAndTheirCellCodes.begin(),
+						m_thePointsAndTheirCellCodes.begin()+previousCount,
+						m_thePointsAndTheirCellCodes.end(),
+						IndexAndCode::codeComp );
+
+	//update the points bounding-box and the fill indexes
+	for (PointIndexType i=firstIndex; i<pointCount; ++i)
+	{
+		const CCVector3* P = m_theAssociatedCloud->getPoint(i);
+		for (int dim=0; dim<3; ++dim)
+		{
+			if (P->u[dim] < m_pointsMin.u[dim])
+				m_pointsMin.u[dim] = P->u[dim];
+			else if (P->u[dim] > m_pointsMax.u[dim])
+				m_pointsMax.u[dim] = P->u[dim];
+		}
+	}
+	int* fillIndexesAtMaxLevel = m_fillIndexes + (MAX_OCTREE_LEVEL*6);
+	for (int dim=0; dim<3; ++dim)
+	{
+		fillIndexesAtMaxLevel[dim] = std::min(fillIndexesAtMaxLevel[dim],newFillIndexes[dim]);
+		fillIndexesAtMaxLevel[dim+3] = std::max(fillIndexesAtMaxLevel[dim+3],newFillIndexes[dim+3]);
+	}
+
+	finishIncrementalUpdate();
+
+	return true;
+}
+
+int DgmOctree::buildFromSubset(const DgmOctree& source, const std::vector<PointIndexType>& newIndexes)
+{
+	clear();
+
+	//we count the points of the subset first (to allocate the right amount of memory)
+	PointIndexType keptCount = 0;
+	{
+		for (cellsContainer::const_iterator p = source.m_thePointsAndTheirCellCodes.begin(); p != source.m_thePointsAndTheirCellCodes.end(); ++p)
+		{
+			assert(p->theIndex < newIndexes.size());
+			if (newIndexes[p->theIndex] != INVALID_POINT_INDEX)
+				++keptCount;
+		}
+	}
+	if (keptCount == 0)
+	{
+		//empty subset?!
+		return -1;
+	}
+
+	try
+	{
+		m_thePointsAndTheirCellCodes.resize(keptCount);
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return -1;
+	}
+
+	CompactCells(	&(source.m_thePointsAndTheirCellCodes[0]),
+					static_cast<PointIndexType>(source.m_thePointsAndTheirCellCodes.size()),
+					newIndexes,
+					&(m_thePointsAndTheirCellCodes[0]) );
+
+	//same bounding-box as the source octree
+	m_dimMin = source.m_dimMin;
+	m_dimMax = source.m_dimMax;
+	m_pointsMin = source.m_pointsMin;
+	m_pointsMax = source.m_pointsMax;
+	memcpy(m_fillIndexes,source.m_fillIndexes,sizeof(int)*(MAX_OCTREE_LEVEL+1)*6);
+	updateCellSizeTable();
+
+	shrinkPointsBoundingBox();
+	finishIncrementalUpdate();
+
+	return static_cast<int>(std::min<PointIndexType>(m_numberOfProjectedPoints,INT_MAX));
+}
+
+//! Number of points (regularly sampled) whose cell code is checked by DgmOctree::restoreStructure
+static const unsigned RESTORE_CHECK_SAMPLES = 4096;
+
+bool DgmOctree::restoreStructure(	cellsContainer& cells,
+									const CCVector3& octreeMin,
+									const CCVector3& octreeMax,
+									const CCVector3& pointsMin,
+									const CCVector3& pointsMax,
+									const int fillIndexes[6])
+{
+	clear();
+
+	PointIndexType pointCount = (m_theAssociatedCloud ? m_theAssociatedCloud->size() : 0);
+	if (cells.empty() || cells.size() > pointCount)
+		return false;
+
+	//fill indexes
+	const int maxLength = MAX_OCTREE_LENGTH;
+	for (int dim=0; dim<3; ++dim)
+	{
+		if (	fillIndexes[dim] < 0
+			||	fillIndexes[dim+3] > maxLength
+			||	fillIndexes[dim] > fillIndexes[dim+3]
+			||	octreeMin.u[dim] > octreeMax.u[dim] )
+		{
+			return false;
+		}
+	}
+
+	//indexes and codes order
+	{
+		const OctreeCellCodeType maxCode = (static_cast<OctreeCellCodeType>(1) << (3*MAX_OCTREE_LEVEL)) - 1;
+		OctreeCellCodeType previousCode = 0;
+		for (cellsContainer::const_iterator c = cells.begin(); c != cells.end(); ++c)
+		{
+			if (c->theIndex >= pointCount || c->theCode < previousCode || c->theCode > maxCode)
+				return false;
+			previousCode = c->theCode;
+		}
+	}
+
+	m_dimMin = octreeMin;
+	m_dimMax = octreeMax;
+	m_pointsMin = pointsMin;
+	m_pointsMax = pointsMax;
+	updateCellSizeTable();
+
+	//cell codes of a regular sample of the points (the cloud may have changed)
+	{
+		size_t step = std::max<size_t>(cells.size() / RESTORE_CHECK_SAMPLES, 1);
+		for (size_t i=0; i<cells.size(); i+=step)
+		{
+			const IndexAndCode& c = cells[i];
+			Tuple3i cellPos;
+			getTheCellPosWhichIncludesThePoint(m_theAssociatedCloud->getPoint(c.theIndex),cellPos);
+			for (int dim=0; dim<3; ++dim)
+			{
+				if (cellPos.u[dim] < 0)
+					cellPos.u[dim] = 0;
+				else if (cellPos.u[dim] > maxLength)
+					cellPos.u[dim] = maxLength;
+			}
+
+			if (generateTruncatedCellCode(cellPos,MAX_OCTREE_LEVEL) != c.theCode)
+			{
+				clear();
+				return false;
+			}
+		}
+	}
+
+	m_thePointsAndTheirCellCodes.swap(cells);
+	memcpy(m_fillIndexes+(MAX_OCTREE_LEVEL*6),fillIndexes,sizeof(int)*6);
+
+	finishIncrementalUpdate();
+
+	return true;
 }
 
 void DgmOctree::updateMinAndMaxTables()
@@ -483,6 +1254,18 @@ void DgmOctree::updateMinAndMaxTables()
 	CCMiscTools::MakeMinAndMaxCubical(m_dimMin,m_dimMax);
 }
 
+void DgmOctree::updateFillIndexesFromDeepestLevel()
+{
+	for (int k=MAX_OCTREE_LEVEL-1; k>=0; k--)
+	{
+		int* fillIndexes = m_fillIndexes + (k*6);
+		for (int dim=0; dim<6; ++dim)
+		{
+			fillIndexes[dim] = (fillIndexes[dim+6] >> 1);
+		}
+	}
+}
+
 void DgmOctree::updateCellSizeTable()
 {
 	//update the cell dimension for each subdivision level
@@ -494,8 +1277,42 @@ void DgmOctree::updateCellSizeTable()
 	}
 }
 
+#ifdef ENABLE_MT_OCTREE
+//! Computation of the cells statistics of one level of subdivision (see DgmOctree::updateCellCountTable)
+struct cellsStatisticsTask
+{
+	//! Octree
+	DgmOctree* octree;
+	//! Statistics computation method
+	void (DgmOctree::*compute)(unsigned char);
+	//! Level of subdivision
+	unsigned char level;
+};
+
+static void ComputeCellsStatisticsTask(cellsStatisticsTask& task)
+{
+	(task.octree->*task.compute)(task.level);
+}
+#endif
+
 void DgmOctree::updateCellCountTable()
 {
+#ifdef ENABLE_MT_OCTREE
+	if (m_parallelBuild && m_thePointsAndTheirCellCodes.size() >= MIN_POINTS_PER_BUILD_CHUNK)
+	{
+		//levels are independent: we process them in parallel
+		std::vector<cellsStatisticsTask> tasks(MAX_OCTREE_LEVEL+1);
+		for (unsigned char i=0; i<=MAX_OCTREE_LEVEL; ++i)
+		{
+			tasks[i].octree = this;
+			tasks[i].compute = &DgmOctree::computeCellsStatistics;
+			tasks[i].level = i;
+		}
+		Parallel::BlockingMap(tasks, ComputeCellsStatisticsTask);
+		return;
+	}
+#endif
+
 	//level 0 is just the octree bounding-box
 	for (unsigned char i=0; i<=MAX_OCTREE_LEVEL; ++i)
 	{
@@ -522,7 +1339,7 @@ void DgmOctree::computeCellsStatistics(unsigned char level)
 	if (level == 0)
 	{
 		m_cellCount[level] = 1;
-		m_maxCellPopulation[level] = static_cast<unsigned>(m_thePointsAndTheirCellCodes.size());
+		m_maxCellPopulation[level] = static_cast<PointIndexType>(m_thePointsAndTheirCellCodes.size());
 		m_averageCellPopulation[level] = static_cast<double>(m_thePointsAndTheirCellCodes.size());
 		m_stdDevCellPopulation[level] = 0.0;
 		return;
@@ -536,9 +1353,9 @@ void DgmOctree::computeCellsStatistics(unsigned char level)
 
 	//we init scan with first element
 	OctreeCellCodeType predCode = (p->theCode >> bitDec);
-	unsigned counter = 0;
-	unsigned cellCounter = 0;
-	unsigned maxCellPop = 0;
+	PointIndexType counter = 0;
+	PointIndexType cellCounter = 0;
+	PointIndexType maxCellPop = 0;
 	double sum = 0.0, sum2 = 0.0;
 
 	for (; p != m_thePointsAndTheirCellCodes.end(); ++p)
@@ -713,15 +1530,210 @@ bool DgmOctree::getPointsInCell(OctreeCellCodeType cellCode,
 	return true;
 }
 
-unsigned DgmOctree::getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned char bitDec) const
+/*** CELL INDEX LOOKUP TABLES ***/
+
+//! Levels up to this one may use a dense lookup table (one entry per potential cell, i.e. 8^level entries)
+static const int MAX_LEVEL_FOR_DENSE_CELL_INDEX_TABLE = 7;
+
+//! Beyond this number of cells, a level keeps the binary search (the hash table would be too big)
+static const unsigned MAX_CELLS_FOR_HASHED_CELL_INDEX_TABLE = (1 << 22);
+
+//! Minimal average cell population for a hashed lookup table (x10)
+/** Below, almost each cell holds a single point and the hash table doesn't beat
+	the binary search anymore (both are bound by the memory accesses).
+**/
+static const unsigned MIN_POPULATION_FOR_HASHED_CELL_INDEX_TABLE_X10 = 15;
+
+//! Cell index lookup table (for a given level of subdivision)
+struct DgmOctree::CellIndexTable
 {
+	//! Hash table slot
+	struct Slot
+	{
+		//! Truncated cell code
+		OctreeCellCodeType code;
+		//! Index of the first point of the cell (or INVALID_POINT_INDEX if the slot is empty)
+		PointIndexType index;
+	};
+
+	//! Dense table (index of the first point of each potential cell, or INVALID_POINT_INDEX if the cell is empty)
+	std::vector<PointIndexType> dense;
+	//! Hash table (open addressing with linear probing)
+	std::vector<Slot> slots;
+	//! Binary shift applied to the hashed code (so as to get an index in the 'slots' table)
+	unsigned char hashShift;
+
+	//! Default constructor
+	CellIndexTable() : hashShift(0) {}
+
+	//! Returns whether the table can be used
+	inline bool isAvailable() const { return !dense.empty() || !slots.empty(); }
+
+	//! Hash function (Fibonacci hashing)
+	inline size_t hash(OctreeCellCodeType truncatedCellCode) const
+	{
+		return static_cast<size_t>((static_cast<unsigned long long>(truncatedCellCode) * 0x9E3779B97F4A7C15ULL) >> hashShift);
+	}
+
+	//! Returns the index of the first point of a cell (or INVALID_POINT_INDEX if the cell is empty)
+	inline PointIndexType find(OctreeCellCodeType truncatedCellCode) const
+	{
+		if (!dense.empty())
+		{
+			return (truncatedCellCode < dense.size() ? dense[static_cast<size_t>(truncatedCellCode)] : static_cast<PointIndexType>(INVALID_POINT_INDEX));
+		}
+
+		const size_t mask = slots.size()-1;
+		for (size_t i = hash(truncatedCellCode); ; i = ((i+1) & mask))
+		{
+			const Slot& slot = slots[i];
+			if (slot.index == INVALID_POINT_INDEX)
+				return INVALID_POINT_INDEX;
+			if (slot.code == truncatedCellCode)
+				return slot.index;
+		}
+	}
+
+	//! Builds the table for a given level of subdivision
+	/** \return false if there's not enough memory or if the level has too many cells
+	**/
+	bool build(const cellsContainer& cells, unsigned char level, PointIndexType cellCount)
+	{
+		const unsigned char bitDec = GET_BIT_SHIFT(level);
+
+		try
+		{
+			const unsigned denseSize = (level <= MAX_LEVEL_FOR_DENSE_CELL_INDEX_TABLE ? (1u << (3*level)) : 0);
+			if (denseSize != 0 && denseSize <= std::max<PointIndexType>(8*cellCount, 65536))
+			{
+				const PointIndexType invalidIndex = INVALID_POINT_INDEX; //DGM: avoids a reference to the static member
+				dense.resize(denseSize,invalidIndex);
+
+				OctreeCellCodeType currentCode = INVALID_CELL_CODE;
+				for (size_t i=0; i<cells.size(); ++i)
+				{
+					OctreeCellCodeType code = (cells[i].theCode >> bitDec);
+					if (code != currentCode)
+					{
+						dense[static_cast<size_t>(code)] = static_cast<PointIndexType>(i);
+						currentCode = code;
+					}
+				}
+			}
+			else if (	cellCount != 0
+					&&	cellCount <= MAX_CELLS_FOR_HASHED_CELL_INDEX_TABLE
+					&&	static_cast<size_t>(cellCount) * MIN_POPULATION_FOR_HASHED_CELL_INDEX_TABLE_X10 <= 10 * cells.size() )
+			{
+				//at least twice as many slots as cells (power of 2)
+				unsigned char log2Size = 1;
+				while ((static_cast<size_t>(1) << log2Size) < 2 * static_cast<size_t>(cellCount))
+					++log2Size;
+				hashShift = static_cast<unsigned char>(64 - log2Size);
+
+				Slot emptySlot;
+				emptySlot.code = 0;
+				emptySlot.index = INVALID_POINT_INDEX;
+				slots.resize(static_cast<size_t>(1) << log2Size,emptySlot);
+
+				const size_t mask = slots.size()-1;
+				OctreeCellCodeType currentCode = INVALID_CELL_CODE;
+				for (size_t i=0; i<cells.size(); ++i)
+				{
+					OctreeCellCodeType code = (cells[i].theCode >> bitDec);
+					if (code != currentCode)
+					{
+						size_t j = hash(code);
+						while (slots[j].index != INVALID_POINT_INDEX)
+							j = ((j+1) & mask);
+						slots[j].code = code;
+						slots[j].index = static_cast<PointIndexType>(i);
+						currentCode = code;
+					}
+				}
+			}
+		}
+		catch (const std::bad_alloc&) //out of memory
+		{
+			std::vector<PointIndexType>().swap(dense);
+			std::vector<Slot>().swap(slots);
+			return false;
+		}
+
+		return isAvailable();
+	}
+};
+
+#ifdef ENABLE_MT_OCTREE
+//! Protects the (lazy) construction of the cell index lookup tables
+static Parallel::Mutex s_cellIndexTablesMutex;
+#endif
+
+void DgmOctree::setUseCellIndexTables(bool state)
+{
+	m_useCellIndexTables = state;
+	if (!state)
+		releaseCellIndexTables();
+}
+
+void DgmOctree::releaseCellIndexTables()
+{
+	for (int i=0; i<=MAX_OCTREE_LEVEL; ++i)
+	{
+		CellIndexTable* table = m_cellIndexTables->get(i);
+		if (table)
+		{
+			m_cellIndexTables->set(i,0);
+			delete table;
+		}
+	}
+}
+
+const DgmOctree::CellIndexTable* DgmOctree::getCellIndexTable(unsigned char bitDec) const
+{
+	if (!m_useCellIndexTables)
+		return 0;
+
+	const int level = MAX_OCTREE_LEVEL - bitDec/3;
+	assert(level >= 0 && level <= MAX_OCTREE_LEVEL);
+
+	CellIndexTable* table = m_cellIndexTables->get(level);
+	if (!table)
+	{
+#ifdef ENABLE_MT_OCTREE
+		Parallel::MutexLocker locker(&s_cellIndexTablesMutex);
+		//another thread may have built it in the meantime
+		table = m_cellIndexTables->get(level);
+		if (!table)
+#endif
+		{
+			table = new CellIndexTable;
+			//if the table can't be built, we keep it (empty) so as to not try again
+			table->build(m_thePointsAndTheirCellCodes,static_cast<unsigned char>(level),m_cellCount[level]);
+			//the table is published once complete
+			m_cellIndexTables->set(level,table);
+		}
+	}
+
+	return table->isAvailable() ? table : 0;
+}
+
+PointIndexType DgmOctree::getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned char bitDec) const
+{
+	//lookup table (if available)
+	const CellIndexTable* table = getCellIndexTable(bitDec);
+	if (table)
+	{
+		PointIndexType index = table->find(truncatedCellCode);
+		return (index != INVALID_POINT_INDEX ? index : m_numberOfProjectedPoints);
+	}
+
 	//inspired from the algorithm proposed by MATT PULVER (see http://eigenjoy.com/2011/01/21/worlds-fastest-binary-search/)
 	//DGM:	it's not faster, but the code is simpler ;)
-	unsigned i = 0;
-	unsigned b = (1 << static_cast<int>( log(static_cast<double>(m_numberOfProjectedPoints-1)) / LOG_NAT_2 ));
+	PointIndexType i = 0;
+	PointIndexType b = (static_cast<PointIndexType>(1) << static_cast<int>( log(static_cast<double>(m_numberOfProjectedPoints-1)) / LOG_NAT_2 ));
 	for ( ; b ; b >>= 1 )
 	{
-		unsigned j = i | b;
+		PointIndexType j = i | b;
 		if ( j < m_numberOfProjectedPoints)
 		{
 			OctreeCellCodeType middleCode = (m_thePointsAndTheirCellCodes[j].theCode >> bitDec);
@@ -753,7 +1765,7 @@ static double s_binarySearchCount = 0.0;
 #endif
 
 #ifdef ADAPTATIVE_BINARY_SEARCH
-unsigned DgmOctree::getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned char bitDec, unsigned begin, unsigned end) const
+PointIndexType DgmOctree::getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned char bitDec, PointIndexType begin, PointIndexType end) const
 {
 	assert(truncatedCellCode != INVALID_CELL_CODE);
 	assert(end >= begin);
@@ -763,6 +1775,14 @@ unsigned DgmOctree::getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned
 	s_binarySearchCount += 1;
 #endif
 
+	//lookup table (if available)
+	const CellIndexTable* table = getCellIndexTable(bitDec);
+	if (table)
+	{
+		PointIndexType index = table->find(truncatedCellCode);
+		return (index >= begin && index <= end ? index : m_numberOfProjectedPoints);
+	}
+
 	//if query cell code is lower than or equal to the first octree cell code, then it's
 	//either the good one or there's no match
 	OctreeCellCodeType beginCode = (m_thePointsAndTheirCellCodes[begin].theCode >> bitDec);
@@ -779,7 +1799,7 @@ unsigned DgmOctree::getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned
 	while (true)
 	{
 		float centralPoint = 0.5f + 0.75f*(static_cast<float>(truncatedCellCode-beginCode)/(-0.5f)); //0.75 = speed coef (empirical)
-		unsigned middle = begin + static_cast<unsigned>(centralPoint*float(end-begin));
+		PointIndexType middle = begin + static_cast<PointIndexType>(centralPoint*float(end-begin));
 		OctreeCellCodeType middleCode = (m_thePointsAndTheirCellCodes[middle].theCode >> bitDec);
 
 		if (middleCode < truncatedCellCode)
@@ -820,7 +1840,7 @@ unsigned DgmOctree::getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned
 
 #else
 
-unsigned DgmOctree::getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned char bitDec, unsigned begin, unsigned end) const
+PointIndexType DgmOctree::getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned char bitDec, PointIndexType begin, PointIndexType end) const
 {
 	assert(truncatedCellCode != INVALID_CELL_CODE);
 	assert(end >= begin && end < m_numberOfProjectedPoints);
@@ -829,14 +1849,22 @@ unsigned DgmOctree::getCellIndex(OctreeCellCodeType truncatedCellCode, unsigned
 	s_binarySearchCount += 1;
 #endif
 
+	//lookup table (if available)
+	const CellIndexTable* table = getCellIndexTable(bitDec);
+	if (table)
+	{
+		PointIndexType index = table->find(truncatedCellCode);
+		return (index >= begin && index <= end ? index : m_numberOfProjectedPoints);
+	}
+
 	//inspired from the algorithm proposed by MATT PULVER (see http://eigenjoy.com/2011/01/21/worlds-fastest-binary-search/)
 	//DGM:	it's not faster, but the code is simpler ;)
-	unsigned i = 0;
-	unsigned count = end-begin+1;
-	unsigned b = (1 << static_cast<int>( log(static_cast<double>(count-1)) / LOG_NAT_2 ));
+	PointIndexType i = 0;
+	PointIndexType count = end-begin+1;
+	PointIndexType b = (static_cast<PointIndexType>(1) << static_cast<int>( log(static_cast<double>(count-1)) / LOG_NAT_2 ));
 	for ( ; b ; b >>= 1 )
 	{
-		unsigned j = i | b;
+		PointIndexType j = i | b;
 		if ( j < count)
 		{
 			OctreeCellCodeType middleCode = (m_thePointsAndTheirCellCodes[begin+j].theCode >> bitDec);
@@ -1096,7 +2124,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSearchStruct &n
 						{
 							if (!getOnlyPointsWithValidScalar || ScalarField::ValidValue(m_theAssociatedCloud->getPointScalarValue(p->theIndex)))
 							{
-								PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+								PointDescriptor newPoint(getPointAt(p),p->theIndex);
 								nNSS.pointsInNeighbourhood.push_back(newPoint);
 							}
 						}
@@ -1127,7 +2155,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSearchStruct &n
 						{
 							if (!getOnlyPointsWithValidScalar || ScalarField::ValidValue(m_theAssociatedCloud->getPointScalarValue(p->theIndex)))
 							{
-								PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+								PointDescriptor newPoint(getPointAt(p),p->theIndex);
 								nNSS.pointsInNeighbourhood.push_back(newPoint);
 							}
 						}
@@ -1155,7 +2183,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSearchStruct &n
 						{
 							if (!getOnlyPointsWithValidScalar || ScalarField::ValidValue(m_theAssociatedCloud->getPointScalarValue(p->theIndex)))
 							{
-								PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+								PointDescriptor newPoint(getPointAt(p),p->theIndex);
 								nNSS.pointsInNeighbourhood.push_back(newPoint);
 							}
 						}
@@ -1191,7 +2219,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSphericalSearch
 
 			for (cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin()+index; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == truncatedCellCode); ++p)
 			{
-				PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+				PointDescriptor newPoint(getPointAt(p),p->theIndex);
 				nNSS.pointsInSphericalNeighbourhood.push_back(newPoint);
 			}
 		}
@@ -1246,7 +2274,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSphericalSearch
 
 						for (cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin()+index; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == c2); ++p)
                         {
-							PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+							PointDescriptor newPoint(getPointAt(p),p->theIndex);
                             nNSS.pointsInSphericalNeighbourhood.push_back(newPoint);
                         }
 
@@ -1286,7 +2314,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSphericalSearch
 
 						for (cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin()+index; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == c2); ++p)
                         {
-							PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+							PointDescriptor newPoint(getPointAt(p),p->theIndex);
                             nNSS.pointsInSphericalNeighbourhood.push_back(newPoint);
                         }
 
@@ -1326,7 +2354,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSphericalSearch
 
 						for (cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin()+index; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == c2); ++p)
                         {
-							PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+							PointDescriptor newPoint(getPointAt(p),p->theIndex);
                             nNSS.pointsInSphericalNeighbourhood.push_back(newPoint);
                         }
 
@@ -1366,7 +2394,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSphericalSearch
 
 						for (cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin()+index; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == c2); ++p)
                         {
-							PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+							PointDescriptor newPoint(getPointAt(p),p->theIndex);
                             nNSS.pointsInSphericalNeighbourhood.push_back(newPoint);
                         }
 
@@ -1405,7 +2433,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSphericalSearch
 
 						for (cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin()+index; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == c1); ++p)
 						{
-							PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+							PointDescriptor newPoint(getPointAt(p),p->theIndex);
 							nNSS.pointsInSphericalNeighbourhood.push_back(newPoint);
 						}
 
@@ -1444,7 +2472,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSphericalSearch
 
 						for (cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin()+index; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == c1); ++p)
 						{
-							PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+							PointDescriptor newPoint(getPointAt(p),p->theIndex);
 							nNSS.pointsInSphericalNeighbourhood.push_back(newPoint);
 						}
 
@@ -1499,6 +2527,8 @@ double DgmOctree::findTheNearestNeighborStartingFromCell(NearestNeighboursSearch
 			//fill indexes for current level
 			const int* _fillIndexes = m_fillIndexes+6*nNSS.level;
 			int diagonalDistance = 0;
+			//number of empty cells between the query cell and the filled part of the octree (squared, along all dimensions)
+			int gapDistance = 0;
 			for (int dim=0; dim<3; ++dim)
 			{
 				//distance to min border of octree along each axis
@@ -1514,6 +2544,7 @@ double DgmOctree::findTheNearestNeighborStartingFromCell(NearestNeighboursSearch
 				{
 					visitedCellDistance = std::max(distToBorder,visitedCellDistance);
 					diagonalDistance += distToBorder*distToBorder;
+					gapDistance += (distToBorder-1)*(distToBorder-1);
 				}
 
 				//next dimension
@@ -1526,8 +2557,9 @@ double DgmOctree::findTheNearestNeighborStartingFromCell(NearestNeighboursSearch
 
 			if (nNSS.maxSearchSquareDistd > 0)
 			{
-				//Distance to the nearest point
-				double minDist = static_cast<double>(eligibleCellDistance-1) * cs;
+				//Distance to the nearest point (at least the empty cells gap, as the query point can
+				//lie anywhere in its own cell - the rounded 'diagonal' distance may be too large)
+				double minDist = sqrt(static_cast<double>(gapDistance)) * cs;
 				//if we are already outside of the search limit, we can quit
 				if (minDist*minDist > nNSS.maxSearchSquareDistd)
 				{
@@ -1581,7 +2613,7 @@ double DgmOctree::findTheNearestNeighborStartingFromCell(NearestNeighboursSearch
 			while (m < m_numberOfProjectedPoints && (p->theCode >> bitDec) == code)
 			{
 				//square distance to query point
-				double dist2 = (*m_theAssociatedCloud->getPointPersistentPtr(p->theIndex) - nNSS.queryPoint).norm2d();
+				double dist2 = (*getPointAt(p) - nNSS.queryPoint).norm2d();
 				//we keep track of the closest one
 				if (dist2 < minSquareDist || minSquareDist < 0)
 				{
@@ -1663,7 +2695,7 @@ unsigned DgmOctree::findNearestNeighborsStartingFromCell(	NearestNeighboursSearc
 			{
 				if (!getOnlyPointsWithValidScalar || ScalarField::ValidValue(m_theAssociatedCloud->getPointScalarValue(p->theIndex)))
 				{
-					PointDescriptor newPoint(m_theAssociatedCloud->getPointPersistentPtr(p->theIndex),p->theIndex);
+					PointDescriptor newPoint(getPointAt(p),p->theIndex);
 					nNSS.pointsInNeighbourhood.push_back(newPoint);
 					++p;
 				}
@@ -1678,6 +2710,8 @@ unsigned DgmOctree::findNearestNeighborsStartingFromCell(	NearestNeighboursSearc
 			//fill indexes for current level
 			const int* _fillIndexes = m_fillIndexes+6*nNSS.level;
 			int diagonalDistance = 0;
+			//number of empty cells between the query cell and the filled part of the octree (squared, along all dimensions)
+			int gapDistance = 0;
 			for (int dim=0; dim<3; ++dim)
 			{
 				//distance to min border of octree along each axis
@@ -1693,6 +2727,7 @@ unsigned DgmOctree::findNearestNeighborsStartingFromCell(	NearestNeighboursSearc
 				{
 					visitedCellDistance = std::max(distToBorder,visitedCellDistance);
 					diagonalDistance += distToBorder*distToBorder;
+					gapDistance += (distToBorder-1)*(distToBorder-1);
 				}
 
 				//next dimension
@@ -1705,8 +2740,8 @@ unsigned DgmOctree::findNearestNeighborsStartingFromCell(	NearestNeighboursSearc
 
 			if (nNSS.maxSearchSquareDistd > 0)
 			{
-				//Distance of the nearest point
-				double minDist = static_cast<double>(eligibleCellDistance-1) * cs;
+				//Distance of the nearest point (see findTheNearestNeighborStartingFromCell)
+				double minDist = sqrt(static_cast<double>(gapDistance)) * cs;
 				//if we are already outside of the search limit, we can quit
 				if (minDist*minDist > nNSS.maxSearchSquareDistd)
 				{
@@ -1865,7 +2900,7 @@ int DgmOctree::getPointsInSphericalNeighbourhood(	const CCVector3& sphereCenter,
 						//while the (partial) cell code matches this cell
 						for ( ; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == searchCode); ++p)
 						{
-							const CCVector3* P = m_theAssociatedCloud->getPoint(p->theIndex);
+							const CCVector3* P = getPointAt(p);
 							double d2 = (*P - sphereCenter).norm2d();
 							//we keep the points falling inside the sphere
 							if (d2 <= squareRadius)
@@ -1987,7 +3022,7 @@ size_t DgmOctree::getPointsInCylindricalNeighbourhood(CylindricalNeighbourhood&
 						//while the (partial) cell code matches this cell
 						for ( ; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == searchCode); ++p)
 						{
-							const CCVector3* P = m_theAssociatedCloud->getPoint(p->theIndex);
+							const CCVector3* P = getPointAt(p);
 
 							//we keep the points falling inside the sphere
 							CCVector3 OP = (*P - params.center);
@@ -2145,7 +3180,7 @@ size_t DgmOctree::getPointsInCylindricalNeighbourhoodProgressive(ProgressiveCyli
 							//while the (partial) cell code matches this cell
 							for ( ; (p != m_thePointsAndTheirCellCodes.end()) && ((p->theCode >> bitDec) == searchCode); ++p)
 							{
-								const CCVector3* P = m_theAssociatedCloud->getPoint(p->theIndex);
+								const CCVector3* P = getPointAt(p);
 
 								//we keep the points falling inside the sphere
 								CCVector3 OP = (*P - params.center);
@@ -2780,6 +3815,439 @@ int DgmOctree::findNeighborsInASphereStartingFromCell(NearestNeighboursSpherical
 	return numberOfEligiblePoints;
 }
 
+/*** BATCHED NEIGHBOURHOOD SEARCH ***/
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCTREE_BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+//! Query point descriptor for batched searches
+struct batchQuery
+{
+	//! Truncated code of the cell including the query (INVALID_CELL_CODE if outside the octree)
+	DgmOctree::OctreeCellCodeType code;
+	//! Query index
+	unsigned index;
+
+	//! Sorts the queries by cell code (then by index)
+	static bool codeComp(const batchQuery& a, const batchQuery& b)
+	{
+		return a.code < b.code || (a.code == b.code && a.index < b.index);
+	}
+};
+
+//! Candidate points of a batched search (packed coordinates)
+struct batchCandidates
+{
+	std::vector<PointCoordinateType> x,y,z;
+	std::vector<PointIndexType> indexes;
+	//! Square distances to the current query point
+	std::vector<PointCoordinateType> squareDists;
+
+	//! Appends the points of a neighbours set (starting from 'first')
+	void append(const DgmOctree::NeighboursSet& points, size_t first)
+	{
+		size_t count = points.size();
+		x.reserve(count);
+		y.reserve(count);
+		z.reserve(count);
+		indexes.reserve(count);
+		for (size_t i=first; i<count; ++i)
+		{
+			const CCVector3* P = points[i].point;
+			x.push_back(P->x);
+			y.push_back(P->y);
+			z.push_back(P->z);
+			indexes.push_back(points[i].pointIndex);
+		}
+		squareDists.resize(indexes.size());
+	}
+
+	void clear()
+	{
+		x.clear(); y.clear(); z.clear();
+		indexes.clear();
+		squareDists.clear();
+	}
+
+	size_t size() const { return indexes.size(); }
+};
+
+//! Updates the square distances between the candidates (starting from 'first') and a query point
+static void ComputeSquareDistances(batchCandidates& candidates, size_t first, const CCVector3& Q)
+{
+	size_t count = candidates.size();
+	size_t i = first;
+
+#ifdef OCTREE_BATCH_SSE2
+	const __m128 qx = _mm_set1_ps(Q.x);
+	const __m128 qy = _mm_set1_ps(Q.y);
+	const __m128 qz = _mm_set1_ps(Q.z);
+	for (; i+4<=count; i+=4)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(&candidates.x[i]),qx);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(&candidates.y[i]),qy);
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(&candidates.z[i]),qz);
+		__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx,dx),_mm_mul_ps(dy,dy)),_mm_mul_ps(dz,dz));
+		_mm_storeu_ps(&candidates.squareDists[i],d2);
+	}
+#endif
+
+	//remaining points (or all of them if SSE2 is not available)
+	for (; i<count; ++i)
+	{
+		PointCoordinateType dx = candidates.x[i]-Q.x;
+		PointCoordinateType dy = candidates.y[i]-Q.y;
+		PointCoordinateType dz = candidates.z[i]-Q.z;
+		candidates.squareDists[i] = dx*dx + dy*dy + dz*dz;
+	}
+}
+
+//! Sorts candidates positions by increasing square distance (ties are broken by position for determinism)
+struct candidatesDistComp
+{
+	const PointCoordinateType* squareDists;
+
+	candidatesDistComp(const PointCoordinateType* d2) : squareDists(d2) {}
+
+	bool operator()(unsigned a, unsigned b) const
+	{
+		return squareDists[a] < squareDists[b] || (squareDists[a] == squareDists[b] && a < b);
+	}
+};
+
+//! Sorts the query points by octree cell
+static void SortBatchQueries(	const DgmOctree& octree,
+								const CCVector3* queryPoints,
+								unsigned count,
+								unsigned char level,
+								std::vector<batchQuery>& queries)
+{
+	queries.resize(count);
+	for (unsigned i=0; i<count; ++i)
+	{
+		Tuple3i cellPos;
+		bool inBounds = false;
+		octree.getTheCellPosWhichIncludesThePoint(queryPoints+i,cellPos,level,inBounds);
+		queries[i].code = (inBounds ? octree.generateTruncatedCellCode(cellPos,level) : DgmOctree::INVALID_CELL_CODE);
+		queries[i].index = i;
+	}
+
+	//queries are generally already grouped by cell (e.g. points of a given cell)
+	for (unsigned i=1; i<count; ++i)
+	{
+		if (batchQuery::codeComp(queries[i],queries[i-1]))
+		{
+			std::sort(queries.begin(),queries.end(),batchQuery::codeComp);
+			break;
+		}
+	}
+}
+
+//! Returns the (Chebyshev) distance between a cell and the filled part of the octree
+static int DistanceToFilledCells(const Tuple3i& cellPos, const int* fillIndexes)
+{
+	int dist = 0;
+	for (int dim=0; dim<3; ++dim)
+	{
+		int d = std::max(fillIndexes[dim]-cellPos.u[dim], cellPos.u[dim]-fillIndexes[3+dim]);
+		dist = std::max(d,dist);
+	}
+	return dist;
+}
+
+//! Returns the (Chebyshev) distance between a cell and the farthest filled cell of the octree
+static int DistanceToFarthestFilledCell(const Tuple3i& cellPos, const int* fillIndexes)
+{
+	int dist = 0;
+	for (int dim=0; dim<3; ++dim)
+	{
+		int d = std::max(cellPos.u[dim]-fillIndexes[dim], fillIndexes[3+dim]-cellPos.u[dim]);
+		dist = std::max(d,dist);
+	}
+	return dist;
+}
+
+//! Reorders the rows of a batch built in the 'queries' order
+static void ReorderBatchRows(	const std::vector<batchQuery>& queries,
+								const std::vector<PointIndexType>& rowStarts,
+								DgmOctree::NeighboursBatch& batch)
+{
+	unsigned count = static_cast<unsigned>(queries.size());
+
+	//rows are already in the right order?
+	bool identity = true;
+	for (unsigned i=0; i<count && identity; ++i)
+		identity = (queries[i].index == i);
+
+	if (identity)
+	{
+		for (unsigned i=0; i<count; ++i)
+			batch.offsets[i] = rowStarts[i];
+		batch.offsets[count] = static_cast<PointIndexType>(batch.indexes.size());
+		return;
+	}
+
+	//rowStarts are expressed in the processing order
+	std::vector<PointIndexType> rowCounts(count);
+	for (unsigned i=0; i<count; ++i)
+	{
+		PointIndexType end = (i+1<count ? rowStarts[i+1] : static_cast<PointIndexType>(batch.indexes.size()));
+		rowCounts[queries[i].index] = end-rowStarts[i];
+	}
+	batch.offsets[0] = 0;
+	for (unsigned i=0; i<count; ++i)
+		batch.offsets[i+1] = batch.offsets[i] + rowCounts[i];
+
+	std::vector<PointIndexType> indexes(batch.indexes.size());
+	std::vector<PointCoordinateType> squareDists(batch.squareDists.size());
+	for (unsigned i=0; i<count; ++i)
+	{
+		unsigned q = queries[i].index;
+		PointIndexType n = rowCounts[q];
+		std::copy(batch.indexes.begin()+rowStarts[i],batch.indexes.begin()+(rowStarts[i]+n),indexes.begin()+batch.offsets[q]);
+		std::copy(batch.squareDists.begin()+rowStarts[i],batch.squareDists.begin()+(rowStarts[i]+n),squareDists.begin()+batch.offsets[q]);
+	}
+	batch.indexes.swap(indexes);
+	batch.squareDists.swap(squareDists);
+}
+
+bool DgmOctree::findNeighborsInASphereBatch(const CCVector3* queryPoints,
+											unsigned count,
+											PointCoordinateType radius,
+											unsigned char level,
+											NeighboursBatch& batch,
+											bool sortValues/*=false*/) const
+{
+	batch.clear();
+
+	try
+	{
+		batch.offsets.resize(count+1,0);
+		if (count == 0 || m_numberOfProjectedPoints == 0)
+			return true;
+
+		std::vector<batchQuery> queries;
+		SortBatchQueries(*this,queryPoints,count,level,queries);
+
+		//current level cell size
+		const PointCoordinateType& cs = getCellSize(level);
+		const int* fillIndexes = m_fillIndexes+6*level;
+		PointCoordinateType squareRadius = radius*radius;
+
+		NearestNeighboursSearchStruct nNSS;
+		nNSS.level = level;
+		batchCandidates candidates;
+		std::vector<unsigned> positions;
+		std::vector<PointIndexType> rowStarts(count);
+
+		unsigned qi = 0;
+		while (qi < count)
+		{
+			//queries lying in the same cell (queries outside the octree are processed one by one)
+			unsigned groupEnd = qi+1;
+			if (queries[qi].code != INVALID_CELL_CODE)
+				while (groupEnd < count && queries[groupEnd].code == queries[qi].code)
+					++groupEnd;
+
+			getTheCellPosWhichIncludesThePoint(queryPoints+queries[qi].index,nNSS.cellPos,level);
+			computeCellCenter(nNSS.cellPos,level,nNSS.cellCenter);
+			nNSS.pointsInNeighbourhood.clear();
+			//the cells closer than the filled part of the octree are necessarily empty
+			nNSS.alreadyVisitedNeighbourhoodSize = DistanceToFilledCells(nNSS.cellPos,fillIndexes);
+			candidates.clear();
+
+			for (; qi<groupEnd; ++qi)
+			{
+				const CCVector3& Q = queryPoints[queries[qi].index];
+
+				//we deduce the minimum cell neighbourhood size (integer) that includes the search sphere
+				PointCoordinateType minDistToBorder = ComputeMinDistanceToCellBorder(Q,cs,nNSS.cellCenter);
+				int minNeighbourhoodSize = 1+(radius>minDistToBorder ? static_cast<int>(ceil((radius-minDistToBorder)/cs)) : 0);
+
+				//if we don't have visited such a neighbourhood...
+				if (nNSS.alreadyVisitedNeighbourhoodSize < minNeighbourhoodSize)
+				{
+					size_t first = nNSS.pointsInNeighbourhood.size();
+					for (int i=nNSS.alreadyVisitedNeighbourhoodSize; i<minNeighbourhoodSize; ++i)
+						getPointsInNeighbourCellsAround(nNSS,i);
+					nNSS.alreadyVisitedNeighbourhoodSize = minNeighbourhoodSize;
+
+					candidates.append(nNSS.pointsInNeighbourhood,first);
+				}
+
+				ComputeSquareDistances(candidates,0,Q);
+
+				rowStarts[qi] = static_cast<PointIndexType>(batch.indexes.size());
+				if (sortValues)
+				{
+					positions.clear();
+					for (size_t j=0; j<candidates.size(); ++j)
+						if (candidates.squareDists[j] <= squareRadius)
+							positions.push_back(static_cast<unsigned>(j));
+					if (!positions.empty())
+						std::sort(positions.begin(),positions.end(),candidatesDistComp(&candidates.squareDists[0]));
+					for (size_t j=0; j<positions.size(); ++j)
+					{
+						batch.indexes.push_back(candidates.indexes[positions[j]]);
+						batch.squareDists.push_back(candidates.squareDists[positions[j]]);
+					}
+				}
+				else
+				{
+					for (size_t j=0; j<candidates.size(); ++j)
+					{
+						if (candidates.squareDists[j] <= squareRadius)
+						{
+							batch.indexes.push_back(candidates.indexes[j]);
+							batch.squareDists.push_back(candidates.squareDists[j]);
+						}
+					}
+				}
+			}
+		}
+
+		ReorderBatchRows(queries,rowStarts,batch);
+	}
+	catch (const std::bad_alloc&)
+	{
+		batch.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool DgmOctree::findNearestNeighborsBatch(	const CCVector3* queryPoints,
+											unsigned count,
+											unsigned k,
+											unsigned char level,
+											NeighboursBatch& batch) const
+{
+	batch.clear();
+
+	try
+	{
+		batch.offsets.resize(count+1,0);
+		if (count == 0 || k == 0 || m_numberOfProjectedPoints == 0)
+			return true;
+
+		std::vector<batchQuery> queries;
+		SortBatchQueries(*this,queryPoints,count,level,queries);
+
+		//current level cell size
+		const PointCoordinateType& cs = getCellSize(level);
+		const int* fillIndexes = m_fillIndexes+6*level;
+
+		NearestNeighboursSearchStruct nNSS;
+		nNSS.level = level;
+		batchCandidates candidates;
+		std::vector<unsigned> positions;
+		std::vector<PointIndexType> rowStarts(count);
+
+		unsigned qi = 0;
+		while (qi < count)
+		{
+			//queries lying in the same cell (queries outside the octree are processed one by one)
+			unsigned groupEnd = qi+1;
+			if (queries[qi].code != INVALID_CELL_CODE)
+				while (groupEnd < count && queries[groupEnd].code == queries[qi].code)
+					++groupEnd;
+
+			getTheCellPosWhichIncludesThePoint(queryPoints+queries[qi].index,nNSS.cellPos,level);
+			computeCellCenter(nNSS.cellPos,level,nNSS.cellCenter);
+			nNSS.pointsInNeighbourhood.clear();
+			//the cells closer than the filled part of the octree are necessarily empty
+			nNSS.alreadyVisitedNeighbourhoodSize = DistanceToFilledCells(nNSS.cellPos,fillIndexes);
+			//beyond this distance, all the points have been gathered
+			int maxNeighbourhoodSize = DistanceToFarthestFilledCell(nNSS.cellPos,fillIndexes)+1;
+			candidates.clear();
+
+			for (; qi<groupEnd; ++qi)
+			{
+				const CCVector3& Q = queryPoints[queries[qi].index];
+
+				//radius of the biggest sphere centered on the query point and totally included in its cell
+				PointCoordinateType minDistToBorder = ComputeMinDistanceToCellBorder(Q,cs,nNSS.cellCenter);
+
+				ComputeSquareDistances(candidates,0,Q);
+
+				while (nNSS.alreadyVisitedNeighbourhoodSize < maxNeighbourhoodSize)
+				{
+					size_t candidateCount = candidates.size();
+					int neighbourhoodSize = nNSS.alreadyVisitedNeighbourhoodSize+1;
+					if (candidateCount >= k)
+					{
+						//the k-th nearest candidate gives the neighbourhood size that is sure to contain the k nearest points
+						positions.resize(candidateCount);
+						for (size_t j=0; j<candidateCount; ++j)
+							positions[j] = static_cast<unsigned>(j);
+						std::nth_element(positions.begin(),positions.begin()+(k-1),positions.end(),candidatesDistComp(&candidates.squareDists[0]));
+						PointCoordinateType dk = sqrt(candidates.squareDists[positions[k-1]]);
+
+						neighbourhoodSize = 1+(dk>minDistToBorder ? static_cast<int>(ceil((dk-minDistToBorder)/cs)) : 0);
+						if (neighbourhoodSize <= nNSS.alreadyVisitedNeighbourhoodSize)
+							break;
+						neighbourhoodSize = std::min(neighbourhoodSize,maxNeighbourhoodSize);
+					}
+
+					//we get the (new) points lying in the added area
+					for (int i=nNSS.alreadyVisitedNeighbourhoodSize; i<neighbourhoodSize; ++i)
+						getPointsInNeighbourCellsAround(nNSS,i);
+					nNSS.alreadyVisitedNeighbourhoodSize = neighbourhoodSize;
+
+					candidates.append(nNSS.pointsInNeighbourhood,candidateCount);
+					ComputeSquareDistances(candidates,candidateCount,Q);
+				}
+
+				//eventually we keep the k nearest candidates
+				size_t candidateCount = candidates.size();
+				positions.resize(candidateCount);
+				for (size_t j=0; j<candidateCount; ++j)
+					positions[j] = static_cast<unsigned>(j);
+				size_t n = std::min<size_t>(k,candidateCount);
+				if (n != 0)
+					std::partial_sort(positions.begin(),positions.begin()+n,positions.end(),candidatesDistComp(&candidates.squareDists[0]));
+
+				rowStarts[qi] = static_cast<PointIndexType>(batch.indexes.size());
+				for (size_t j=0; j<n; ++j)
+				{
+					batch.indexes.push_back(candidates.indexes[positions[j]]);
+					batch.squareDists.push_back(candidates.squareDists[positions[j]]);
+				}
+			}
+		}
+
+		ReorderBatchRows(queries,rowStarts,batch);
+	}
+	catch (const std::bad_alloc&)
+	{
+		batch.clear();
+		return false;
+	}
+
+	return true;
+}
+
+unsigned DgmOctree::getBatchNeighbours(	const NeighboursBatch& batch,
+										unsigned queryIndex,
+										NeighboursSet& neighbours) const
+{
+	assert(queryIndex < batch.size());
+
+	unsigned start = batch.offsets[queryIndex];
+	unsigned n = batch.offsets[queryIndex+1]-start;
+	neighbours.resize(n);
+	for (unsigned i=0; i<n; ++i)
+	{
+		unsigned index = batch.indexes[start+i];
+		neighbours[i] = PointDescriptor(m_theAssociatedCloud->getPointPersistentPtr(index),index,static_cast<double>(batch.squareDists[start+i]));
+	}
+
+	return n;
+}
+
 unsigned char DgmOctree::findBestLevelForAGivenNeighbourhoodSizeExtraction(PointCoordinateType radius) const
 {
 	static const PointCoordinateType c_neighbourhoodSizeExtractionFactor = static_cast<PointCoordinateType>(2.5);
@@ -3566,9 +5034,9 @@ DgmOctree::octreeCell::~octreeCell()
 
 #ifdef ENABLE_MT_OCTREE
 
-#include <QtCore>
+#ifdef USE_QT
 #include <QApplication>
-#include <QtConcurrentMap>
+#endif
 
 /*** FOR THE MULTI THREADING WRAPPER ***/
 struct octreeCellDesc
@@ -3616,7 +5084,9 @@ void LaunchOctreeCellFunc_MT(const octreeCellDesc& desc)
 		if (s_progressCb_MT)
 		{
 			s_progressCb_MT->setInfo("Cancelling...");
+#ifdef USE_QT
 			QApplication::processEvents();
+#endif
 		}
 
 		//if (s_normProgressCb_MT)
@@ -3631,6 +5101,210 @@ void LaunchOctreeCellFunc_MT(const octreeCellDesc& desc)
 	}
 }
 
+/*** WORK STEALING SCHEDULER ***/
+
+//! Range of cells (indexes in the cells descriptors array) owned by a worker
+struct cellsDeque_MT
+{
+	//! Protects the range bounds
+	Parallel::Mutex mutex;
+	//! First remaining cell (the owner pops cells from the front)
+	unsigned begin;
+	//! Last remaining cell, excluded (thieves steal cells from the back)
+	unsigned end;
+
+	cellsDeque_MT() : begin(0), end(0) {}
+};
+
+//! State of the work stealing scheduler (for one call to ProcessCellsWithWorkStealing_MT)
+struct cellsScheduler_MT
+{
+	//! Cells descriptors
+	const std::vector<octreeCellDesc>* cells;
+	//! Cells deques (one per worker)
+	std::vector<cellsDeque_MT*> deques;
+	//! Target population of a batch of cells (in points)
+	unsigned grain;
+
+	cellsScheduler_MT() : cells(0), grain(1) {}
+
+	~cellsScheduler_MT()
+	{
+		for (size_t i=0; i<deques.size(); ++i)
+			delete deques[i];
+	}
+};
+
+//! Worker of the work stealing scheduler
+struct cellsWorker_MT
+{
+	//! Scheduler
+	cellsScheduler_MT* scheduler;
+	//! Worker index (i.e. index of its own deque)
+	unsigned index;
+};
+
+//! Pops a batch of cells from the front of a deque
+/** The batch is built so that its total population is close to the scheduler
+	grain size (dense cells are processed alone while sparse cells are grouped).
+**/
+static bool PopCells_MT(const cellsScheduler_MT& scheduler, cellsDeque_MT& deque, unsigned& begin, unsigned& end)
+{
+	Parallel::MutexLocker locker(&deque.mutex);
+	if (deque.begin >= deque.end)
+		return false;
+
+	begin = end = deque.begin;
+	unsigned population = 0;
+	while (end < deque.end && population < scheduler.grain)
+	{
+		const octreeCellDesc& desc = (*scheduler.cells)[end++];
+		population += desc.i2 - desc.i1 + 1;
+	}
+	deque.begin = end;
+
+	return true;
+}
+
+//! Steals half of the remaining cells of the most loaded worker (from the back of its deque)
+static bool StealCells_MT(cellsScheduler_MT& scheduler, unsigned thiefIndex, unsigned& begin, unsigned& end)
+{
+	std::vector<cellsDeque_MT*>& deques = scheduler.deques;
+
+	while (true)
+	{
+		//look for the victim with the most remaining cells
+		size_t victimIndex = deques.size();
+		unsigned maxRemaining = 0;
+		for (size_t i=0; i<deques.size(); ++i)
+		{
+			if (i == thiefIndex)
+				continue;
+			Parallel::MutexLocker locker(&deques[i]->mutex);
+			unsigned remaining = deques[i]->end - deques[i]->begin;
+			if (remaining > maxRemaining)
+			{
+				maxRemaining = remaining;
+				victimIndex = i;
+			}
+		}
+
+		//no more work
+		if (victimIndex == deques.size())
+			return false;
+
+		cellsDeque_MT& victim = *deques[victimIndex];
+		Parallel::MutexLocker locker(&victim.mutex);
+		unsigned remaining = victim.end - victim.begin;
+		if (remaining == 0)
+		{
+			//the victim has finished its job meanwhile: try again
+			continue;
+		}
+
+		unsigned stolen = (remaining + 1) / 2;
+		end = victim.end;
+		begin = victim.end - stolen;
+		victim.end = begin;
+
+		return true;
+	}
+}
+
+//! Worker loop: processes its own cells first, then steals cells from the other workers
+static void CellsWorker_MT(cellsWorker_MT& worker)
+{
+	cellsScheduler_MT& scheduler = *worker.scheduler;
+	cellsDeque_MT& ownDeque = *scheduler.deques[worker.index];
+
+	while (s_cellFunc_MT_success)
+	{
+		unsigned begin = 0, end = 0;
+		if (!PopCells_MT(scheduler, ownDeque, begin, end))
+		{
+			unsigned stolenBegin = 0, stolenEnd = 0;
+			if (!StealCells_MT(scheduler, worker.index, stolenBegin, stolenEnd))
+				break;
+
+			//the stolen cells now belong to this worker (and can be stolen again)
+			{
+				Parallel::MutexLocker locker(&ownDeque.mutex);
+				ownDeque.begin = stolenBegin;
+				ownDeque.end = stolenEnd;
+			}
+			continue;
+		}
+
+		for (unsigned i=begin; i<end; ++i)
+			LaunchOctreeCellFunc_MT((*scheduler.cells)[i]);
+	}
+}
+
+//! Applies the current cell function (see s_func_MT) to all cells with a work stealing scheduler
+/** Cells are first distributed in contiguous ranges of (roughly) equal population
+	between the workers (one per thread). Each worker then processes its own range
+	by batches of similar population and steals cells from the most loaded worker
+	once it's done.
+	\return false if there's not enough memory
+**/
+static bool ProcessCellsWithWorkStealing_MT(const std::vector<octreeCellDesc>& cells)
+{
+	if (cells.empty())
+		return true;
+
+	unsigned cellCount = static_cast<unsigned>(cells.size());
+	unsigned workerCount = std::min(Parallel::IdealThreadCount(), cellCount);
+
+	//total population
+	unsigned totalPopulation = 0;
+	for (unsigned i=0; i<cellCount; ++i)
+		totalPopulation += cells[i].i2 - cells[i].i1 + 1;
+
+	//adaptive grain size (in points): several batches per worker, to let the others steal some work
+	static const unsigned BATCHES_PER_WORKER = 16;
+	cellsScheduler_MT scheduler;
+	scheduler.grain = std::max(totalPopulation / (workerCount * BATCHES_PER_WORKER), 1u);
+	scheduler.cells = &cells;
+
+	//initial distribution (contiguous ranges of equal population)
+	std::vector<cellsWorker_MT> workers;
+	try
+	{
+		workers.resize(workerCount);
+		scheduler.deques.resize(workerCount,0);
+		for (unsigned w=0; w<workerCount; ++w)
+			scheduler.deques[w] = new cellsDeque_MT;
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	{
+		unsigned cellIndex = 0;
+		unsigned population = 0;
+		for (unsigned w=0; w<workerCount; ++w)
+		{
+			workers[w].scheduler = &scheduler;
+			workers[w].index = w;
+			scheduler.deques[w]->begin = cellIndex;
+
+			unsigned maxPopulation = static_cast<unsigned>((static_cast<double>(totalPopulation) * (w+1)) / workerCount);
+			while (cellIndex < cellCount && (population < maxPopulation || w+1 == workerCount))
+			{
+				population += cells[cellIndex].i2 - cells[cellIndex].i1 + 1;
+				++cellIndex;
+			}
+			scheduler.deques[w]->end = cellIndex;
+		}
+	}
+
+	Parallel::BlockingMap(workers, CellsWorker_MT);
+
+	return true;
+}
+
 #endif
 
 unsigned DgmOctree::executeFunctionForAllCellsAtLevel(unsigned char level,
@@ -3645,7 +5319,7 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(unsigned char level,
 
 #ifdef ENABLE_MT_OCTREE
 
-	//cells that will be processed by QtConcurrent::map
+	//cells that will be processed by the work stealing scheduler
 	const unsigned cellsNumber = getCellNumber(level);
 	std::vector<octreeCellDesc> cells;
 
@@ -3697,7 +5371,7 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(unsigned char level,
 			if (functionTitle)
 				progressCb->setMethodTitle(functionTitle);
 			char buffer[512];
-			sprintf(buffer, "Octree level %i\nCells: %u\nMean population: %3.2f (+/-%3.2f)\nMax population: %u", level, cellCount, m_averageCellPopulation[level], m_stdDevCellPopulation[level], m_maxCellPopulation[level]);
+			sprintf(buffer, "Octree level %i\nCells: %u\nMean population: %3.2f (+/-%3.2f)\nMax population: %llu", level, cellCount, m_averageCellPopulation[level], m_stdDevCellPopulation[level], static_cast<unsigned long long>(m_maxCellPopulation[level]));
 			progressCb->setInfo(buffer);
 			progressCb->start();
 		}
@@ -3818,7 +5492,7 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(unsigned char level,
 			if (functionTitle)
 				progressCb->setMethodTitle(functionTitle);
 			char buffer[512];
-			sprintf(buffer,"Octree level %i\nCells: %i\nAverage population: %3.2f (+/-%3.2f)\nMax population: %u",level,static_cast<int>(cells.size()),m_averageCellPopulation[level],m_stdDevCellPopulation[level],m_maxCellPopulation[level]);
+			sprintf(buffer,"Octree level %i\nCells: %i\nAverage population: %3.2f (+/-%3.2f)\nMax population: %llu",level,static_cast<int>(cells.size()),m_averageCellPopulation[level],m_stdDevCellPopulation[level],static_cast<unsigned long long>(m_maxCellPopulation[level]));
 			progressCb->setInfo(buffer);
 			s_normProgressCb_MT = new NormalizedProgress(progressCb,m_theAssociatedCloud->size());
 			progressCb->start();
@@ -3831,7 +5505,11 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(unsigned char level,
 		s_binarySearchCount = 0.0;
 #endif
 
-		QtConcurrent::blockingMap(cells, LaunchOctreeCellFunc_MT);
+		if (!ProcessCellsWithWorkStealing_MT(cells))
+		{
+			//not enough memory
+			s_cellFunc_MT_success = false;
+		}
 
 #ifdef COMPUTE_NN_SEARCH_STATISTICS
 		FILE* fp = fopen("octree_log.txt", "at");
@@ -3890,7 +5568,7 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 
 #ifdef ENABLE_MT_OCTREE
 
-	//cells that will be processed by QtConcurrent::map
+	//cells that will be processed by the work stealing scheduler
 	std::vector<octreeCellDesc> cells;
 	if (multiThread)
 	{
@@ -3926,12 +5604,12 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 			if (functionTitle)
 				progressCb->setMethodTitle(functionTitle);
 			char buffer[1024];
-			sprintf(buffer, "Octree levels %i - %i\nCells: %i - %i\nAverage population: %3.2f (+/-%3.2f) - %3.2f (+/-%3.2f)\nMax population: %u - %u",
+			sprintf(buffer, "Octree levels %i - %i\nCells: %llu - %llu\nAverage population: %3.2f (+/-%3.2f) - %3.2f (+/-%3.2f)\nMax population: %llu - %llu",
 				startingLevel, MAX_OCTREE_LEVEL,
-				getCellNumber(startingLevel), getCellNumber(MAX_OCTREE_LEVEL),
+				static_cast<unsigned long long>(getCellNumber(startingLevel)), static_cast<unsigned long long>(getCellNumber(MAX_OCTREE_LEVEL)),
 				m_averageCellPopulation[startingLevel], m_stdDevCellPopulation[startingLevel],
 				m_averageCellPopulation[MAX_OCTREE_LEVEL], m_stdDevCellPopulation[MAX_OCTREE_LEVEL],
-				m_maxCellPopulation[startingLevel], m_maxCellPopulation[MAX_OCTREE_LEVEL]);
+				static_cast<unsigned long long>(m_maxCellPopulation[startingLevel]), static_cast<unsigned long long>(m_maxCellPopulation[MAX_OCTREE_LEVEL]));
 			progressCb->setInfo(buffer);
 			progressCb->start();
 		}
@@ -4361,7 +6039,11 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 		s_binarySearchCount = 0.0;
 #endif
 
-		QtConcurrent::blockingMap(cells, LaunchOctreeCellFunc_MT);
+		if (!ProcessCellsWithWorkStealing_MT(cells))
+		{
+			//not enough memory
+			s_cellFunc_MT_success = false;
+		}
 
 #ifdef COMPUTE_NN_SEARCH_STATISTICS
 		FILE* fp=fopen("octree_log.txt","at");
@@ -0,0 +1,554 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+//Batched (SIMD) point-to-triangle and point-to-plane distances
+//(see DistanceComputationTools::computePoints2TriangleDistances
+//and DistanceComputationTools::computePoints2PlaneDistances)
+
+#include "DistanceComputationTools.h"
+
+//local
+#include "GenericTriangle.h"
+
+//system
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+
+//SIMD kernels are only available on x86 CPUs (and with compilers that
+//can generate code for a given instruction set on a per function basis)
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#if defined(_MSC_VER) || defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define CC_DISTANCE_KERNELS_SIMD
+#endif
+#endif
+
+#ifdef CC_DISTANCE_KERNELS_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CC_TARGET_SSE4_1
+#define CC_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define CC_TARGET_SSE4_1 __attribute__((target("sse4.1")))
+#define CC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+using namespace CCLib;
+
+//! Triangle data shared by all the points (see computePoints2TriangleDistances)
+/** The distance of a point to a triangle is the distance to its supporting plane
+	if the point projects inside the triangle, and the distance to the nearest edge
+	otherwise. Contrary to the region based approach of computePoint2TriangleDistance,
+	this doesn't need any branch (all the terms are computed, then selected).
+	Computations are done with double precision (the vectors relative to A are
+	computed as in computePoint2TriangleDistance).
+**/
+struct TriangleKernelData
+{
+	//! First vertex
+	CCVector3 A;
+	//! Edges (AB, AC and BC) and triangle normal (AB x AC)
+	CCVector3d AB, AC, BC, N;
+	//! Terms of the projection on the triangle plane (in barycentric coordinates)
+	double a00, a01, a11, det;
+	//! Inverse square lengths of the edges (0 if degenerate)
+	double invAB2, invAC2, invBC2;
+	//! Inverse square norm of the normal
+	double invN2;
+
+	//! Constructor
+	explicit TriangleKernelData(const GenericTriangle* triangle)
+	{
+		const CCVector3* _A = triangle->_getA();
+		const CCVector3* _B = triangle->_getB();
+		const CCVector3* _C = triangle->_getC();
+
+		A = *_A;
+		AB = CCVector3d(_B->x - _A->x, _B->y - _A->y, _B->z - _A->z);
+		AC = CCVector3d(_C->x - _A->x, _C->y - _A->y, _C->z - _A->z);
+		BC = AC - AB;
+		N = AB.cross(AC);
+
+		a00 = AB.dot(AB);
+		a01 = AB.dot(AC);
+		a11 = AC.dot(AC);
+		det = a00 * a11 - a01 * a01;
+
+		double bc2 = BC.dot(BC);
+		double n2 = N.dot(N);
+		invAB2 = (a00 > 0 ? 1.0 / a00 : 0);
+		invAC2 = (a11 > 0 ? 1.0 / a11 : 0);
+		invBC2 = (bc2 > 0 ? 1.0 / bc2 : 0);
+		invN2 = (n2 > 0 ? 1.0 / n2 : 0);
+		if (n2 <= 0)
+		{
+			//degenerate triangle: no point can project inside
+			det = -1.0;
+		}
+	}
+};
+
+//! Clamps a value between 0 and 1
+static inline double Clamp01(double v)
+{
+	return std::min(std::max(v, 0.0), 1.0);
+}
+
+//! Scalar version of the point-to-triangle kernel
+static void Points2TriangleDistances_Scalar(const PointCoordinateType* x,
+											const PointCoordinateType* y,
+											const PointCoordinateType* z,
+											unsigned count,
+											const TriangleKernelData& T,
+											bool signedDist,
+											ScalarType* dists)
+{
+	for (unsigned i=0; i<count; ++i)
+	{
+		double apx = static_cast<double>(x[i] - T.A.x);
+		double apy = static_cast<double>(y[i] - T.A.y);
+		double apz = static_cast<double>(z[i] - T.A.z);
+
+		//projection on the triangle plane
+		double b0 = apx*T.AB.x + apy*T.AB.y + apz*T.AB.z;
+		double b1 = apx*T.AC.x + apy*T.AC.y + apz*T.AC.z;
+		double s = T.a11*b0 - T.a01*b1;
+		double t = T.a00*b1 - T.a01*b0;
+		double dn = apx*T.N.x + apy*T.N.y + apz*T.N.z;
+		bool inside = (s >= 0 && t >= 0 && s + t <= T.det);
+		double faceD2 = dn*dn*T.invN2;
+
+		//edge AB
+		double u = Clamp01(b0*T.invAB2);
+		double ex = apx - u*T.AB.x;
+		double ey = apy - u*T.AB.y;
+		double ez = apz - u*T.AB.z;
+		double e1 = ex*ex + ey*ey + ez*ez;
+
+		//edge AC
+		double v = Clamp01(b1*T.invAC2);
+		ex = apx - v*T.AC.x;
+		ey = apy - v*T.AC.y;
+		ez = apz - v*T.AC.z;
+		double e2 = ex*ex + ey*ey + ez*ez;
+
+		//edge BC
+		double bpx = apx - T.AB.x;
+		double bpy = apy - T.AB.y;
+		double bpz = apz - T.AB.z;
+		double w = Clamp01((bpx*T.BC.x + bpy*T.BC.y + bpz*T.BC.z)*T.invBC2);
+		ex = bpx - w*T.BC.x;
+		ey = bpy - w*T.BC.y;
+		ez = bpz - w*T.BC.z;
+		double e3 = ex*ex + ey*ey + ez*ez;
+
+		double squareDist = (inside ? faceD2 : std::min(e1, std::min(e2, e3)));
+		if (signedDist)
+		{
+			ScalarType d = static_cast<ScalarType>(sqrt(squareDist));
+			dists[i] = (dn < 0 ? -d : d);
+		}
+		else
+		{
+			dists[i] = static_cast<ScalarType>(squareDist);
+		}
+	}
+}
+
+//! Scalar version of the point-to-plane kernel (also used for the remaining points of the SIMD versions)
+static void Points2PlaneDistances_Scalar(	const PointCoordinateType* x,
+											const PointCoordinateType* y,
+											const PointCoordinateType* z,
+											unsigned start,
+											unsigned count,
+											const PointCoordinateType* planeEquation,
+											ScalarType* dists)
+{
+	for (unsigned i=start; i<count; ++i)
+		dists[i] = static_cast<ScalarType>(x[i]*planeEquation[0] + y[i]*planeEquation[1] + z[i]*planeEquation[2] - planeEquation[3]);
+}
+
+#ifdef CC_DISTANCE_KERNELS_SIMD
+
+/*** SSE 4.1 (2 points per iteration for triangles, 4 for planes) ***/
+
+CC_TARGET_SSE4_1 static inline __m128d Clamp01_SSE(__m128d v)
+{
+	return _mm_min_pd(_mm_max_pd(v, _mm_setzero_pd()), _mm_set1_pd(1.0));
+}
+
+CC_TARGET_SSE4_1 static inline __m128d Dot_SSE(__m128d x, __m128d y, __m128d z, const CCVector3d& V)
+{
+	return _mm_add_pd(_mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(V.x)), _mm_mul_pd(y, _mm_set1_pd(V.y))), _mm_mul_pd(z, _mm_set1_pd(V.z)));
+}
+
+//! Square distance between (2) points and a segment [O, O+V] (coordinates relative to O)
+CC_TARGET_SSE4_1 static inline __m128d SegmentSquareDistance_SSE(__m128d x, __m128d y, __m128d z, __m128d u, const CCVector3d& V)
+{
+	__m128d ex = _mm_sub_pd(x, _mm_mul_pd(u, _mm_set1_pd(V.x)));
+	__m128d ey = _mm_sub_pd(y, _mm_mul_pd(u, _mm_set1_pd(V.y)));
+	__m128d ez = _mm_sub_pd(z, _mm_mul_pd(u, _mm_set1_pd(V.z)));
+	return _mm_add_pd(_mm_add_pd(_mm_mul_pd(ex, ex), _mm_mul_pd(ey, ey)), _mm_mul_pd(ez, ez));
+}
+
+//! Loads 2 coordinates relative to the given origin
+CC_TARGET_SSE4_1 static inline __m128d LoadRelative_SSE(const PointCoordinateType* v, __m128 origin)
+{
+	__m128 f = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(v));
+	return _mm_cvtps_pd(_mm_sub_ps(f, origin));
+}
+
+CC_TARGET_SSE4_1 static void Points2TriangleDistances_SSE4_1(	const PointCoordinateType* x,
+																const PointCoordinateType* y,
+																const PointCoordinateType* z,
+																unsigned count,
+																const TriangleKernelData& T,
+																bool signedDist,
+																ScalarType* dists)
+{
+	const __m128 Ax = _mm_set1_ps(T.A.x);
+	const __m128 Ay = _mm_set1_ps(T.A.y);
+	const __m128 Az = _mm_set1_ps(T.A.z);
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d signMask = _mm_set1_pd(-0.0);
+
+	unsigned i = 0;
+	for (; i+2 <= count; i += 2)
+	{
+		__m128d apx = LoadRelative_SSE(x+i, Ax);
+		__m128d apy = LoadRelative_SSE(y+i, Ay);
+		__m128d apz = LoadRelative_SSE(z+i, Az);
+
+		//projection on the triangle plane
+		__m128d b0 = Dot_SSE(apx, apy, apz, T.AB);
+		__m128d b1 = Dot_SSE(apx, apy, apz, T.AC);
+		__m128d s = _mm_sub_pd(_mm_mul_pd(_mm_set1_pd(T.a11), b0), _mm_mul_pd(_mm_set1_pd(T.a01), b1));
+		__m128d t = _mm_sub_pd(_mm_mul_pd(_mm_set1_pd(T.a00), b1), _mm_mul_pd(_mm_set1_pd(T.a01), b0));
+		__m128d dn = Dot_SSE(apx, apy, apz, T.N);
+		__m128d inside = _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(s, zero), _mm_cmpge_pd(t, zero)), _mm_cmple_pd(_mm_add_pd(s, t), _mm_set1_pd(T.det)));
+		__m128d faceD2 = _mm_mul_pd(_mm_mul_pd(dn, dn), _mm_set1_pd(T.invN2));
+
+		//edges
+		__m128d e1 = SegmentSquareDistance_SSE(apx, apy, apz, Clamp01_SSE(_mm_mul_pd(b0, _mm_set1_pd(T.invAB2))), T.AB);
+		__m128d e2 = SegmentSquareDistance_SSE(apx, apy, apz, Clamp01_SSE(_mm_mul_pd(b1, _mm_set1_pd(T.invAC2))), T.AC);
+		__m128d bpx = _mm_sub_pd(apx, _mm_set1_pd(T.AB.x));
+		__m128d bpy = _mm_sub_pd(apy, _mm_set1_pd(T.AB.y));
+		__m128d bpz = _mm_sub_pd(apz, _mm_set1_pd(T.AB.z));
+		__m128d e3 = SegmentSquareDistance_SSE(bpx, bpy, bpz, Clamp01_SSE(_mm_mul_pd(Dot_SSE(bpx, bpy, bpz, T.BC), _mm_set1_pd(T.invBC2))), T.BC);
+
+		__m128d squareDist = _mm_blendv_pd(_mm_min_pd(e1, _mm_min_pd(e2, e3)), faceD2, inside);
+
+		if (signedDist)
+		{
+			//same sign as the dot product between AP and the triangle normal
+			__m128d d = _mm_sqrt_pd(squareDist);
+			squareDist = _mm_blendv_pd(d, _mm_xor_pd(d, signMask), _mm_cmplt_pd(dn, zero));
+		}
+		_mm_storel_pi(reinterpret_cast<__m64*>(dists+i), _mm_cvtpd_ps(squareDist));
+	}
+
+	//remaining points: processed as a full batch (padded with the last point)
+	if (i < count)
+	{
+		PointCoordinateType px[2], py[2], pz[2];
+		ScalarType pd[2];
+		for (unsigned k=0; k<2; ++k)
+		{
+			unsigned index = std::min(i+k, count-1);
+			px[k] = x[index];
+			py[k] = y[index];
+			pz[k] = z[index];
+		}
+		Points2TriangleDistances_SSE4_1(px, py, pz, 2, T, signedDist, pd);
+		for (unsigned k=0; i+k<count; ++k)
+			dists[i+k] = pd[k];
+	}
+}
+
+CC_TARGET_SSE4_1 static void Points2PlaneDistances_SSE4_1(	const PointCoordinateType* x,
+															const PointCoordinateType* y,
+															const PointCoordinateType* z,
+															unsigned count,
+															const PointCoordinateType* planeEquation,
+															ScalarType* dists)
+{
+	const __m128 a = _mm_set1_ps(planeEquation[0]);
+	const __m128 b = _mm_set1_ps(planeEquation[1]);
+	const __m128 c = _mm_set1_ps(planeEquation[2]);
+	const __m128 d = _mm_set1_ps(planeEquation[3]);
+
+	unsigned i = 0;
+	for (; i+4 <= count; i += 4)
+	{
+		__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(x+i), a), _mm_mul_ps(_mm_loadu_ps(y+i), b)), _mm_mul_ps(_mm_loadu_ps(z+i), c));
+		_mm_storeu_ps(dists+i, _mm_sub_ps(v, d));
+	}
+
+	Points2PlaneDistances_Scalar(x, y, z, i, count, planeEquation, dists);
+}
+
+/*** AVX2 (4 points per iteration for triangles, 8 for planes) ***/
+
+CC_TARGET_AVX2 static inline __m256d Clamp01_AVX2(__m256d v)
+{
+	return _mm256_min_pd(_mm256_max_pd(v, _mm256_setzero_pd()), _mm256_set1_pd(1.0));
+}
+
+CC_TARGET_AVX2 static inline __m256d Dot_AVX2(__m256d x, __m256d y, __m256d z, const CCVector3d& V)
+{
+	return _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(V.x)), _mm256_mul_pd(y, _mm256_set1_pd(V.y))), _mm256_mul_pd(z, _mm256_set1_pd(V.z)));
+}
+
+//! Square distance between (4) points and a segment [O, O+V] (coordinates relative to O)
+CC_TARGET_AVX2 static inline __m256d SegmentSquareDistance_AVX2(__m256d x, __m256d y, __m256d z, __m256d u, const CCVector3d& V)
+{
+	__m256d ex = _mm256_sub_pd(x, _mm256_mul_pd(u, _mm256_set1_pd(V.x)));
+	__m256d ey = _mm256_sub_pd(y, _mm256_mul_pd(u, _mm256_set1_pd(V.y)));
+	__m256d ez = _mm256_sub_pd(z, _mm256_mul_pd(u, _mm256_set1_pd(V.z)));
+	return _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ex, ex), _mm256_mul_pd(ey, ey)), _mm256_mul_pd(ez, ez));
+}
+
+//! Loads 4 coordinates relative to the given origin
+CC_TARGET_AVX2 static inline __m256d LoadRelative_AVX2(const PointCoordinateType* v, __m128 origin)
+{
+	return _mm256_cvtps_pd(_mm_sub_ps(_mm_loadu_ps(v), origin));
+}
+
+CC_TARGET_AVX2 static void Points2TriangleDistances_AVX2(	const PointCoordinateType* x,
+															const PointCoordinateType* y,
+															const PointCoordinateType* z,
+															unsigned count,
+															const TriangleKernelData& T,
+															bool signedDist,
+															ScalarType* dists)
+{
+	const __m128 Ax = _mm_set1_ps(T.A.x);
+	const __m128 Ay = _mm_set1_ps(T.A.y);
+	const __m128 Az = _mm_set1_ps(T.A.z);
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d signMask = _mm256_set1_pd(-0.0);
+
+	unsigned i = 0;
+	for (; i+4 <= count; i += 4)
+	{
+		__m256d apx = LoadRelative_AVX2(x+i, Ax);
+		__m256d apy = LoadRelative_AVX2(y+i, Ay);
+		__m256d apz = LoadRelative_AVX2(z+i, Az);
+
+		//projection on the triangle plane
+		__m256d b0 = Dot_AVX2(apx, apy, apz, T.AB);
+		__m256d b1 = Dot_AVX2(apx, apy, apz, T.AC);
+		__m256d s = _mm256_sub_pd(_mm256_mul_pd(_mm256_set1_pd(T.a11), b0), _mm256_mul_pd(_mm256_set1_pd(T.a01), b1));
+		__m256d t = _mm256_sub_pd(_mm256_mul_pd(_mm256_set1_pd(T.a00), b1), _mm256_mul_pd(_mm256_set1_pd(T.a01), b0));
+		__m256d dn = Dot_AVX2(apx, apy, apz, T.N);
+		__m256d inside = _mm256_and_pd(	_mm256_and_pd(_mm256_cmp_pd(s, zero, _CMP_GE_OQ), _mm256_cmp_pd(t, zero, _CMP_GE_OQ)),
+											_mm256_cmp_pd(_mm256_add_pd(s, t), _mm256_set1_pd(T.det), _CMP_LE_OQ));
+		__m256d faceD2 = _mm256_mul_pd(_mm256_mul_pd(dn, dn), _mm256_set1_pd(T.invN2));
+
+		//edges
+		__m256d e1 = SegmentSquareDistance_AVX2(apx, apy, apz, Clamp01_AVX2(_mm256_mul_pd(b0, _mm256_set1_pd(T.invAB2))), T.AB);
+		__m256d e2 = SegmentSquareDistance_AVX2(apx, apy, apz, Clamp01_AVX2(_mm256_mul_pd(b1, _mm256_set1_pd(T.invAC2))), T.AC);
+		__m256d bpx = _mm256_sub_pd(apx, _mm256_set1_pd(T.AB.x));
+		__m256d bpy = _mm256_sub_pd(apy, _mm256_set1_pd(T.AB.y));
+		__m256d bpz = _mm256_sub_pd(apz, _mm256_set1_pd(T.AB.z));
+		__m256d e3 = SegmentSquareDistance_AVX2(bpx, bpy, bpz, Clamp01_AVX2(_mm256_mul_pd(Dot_AVX2(bpx, bpy, bpz, T.BC), _mm256_set1_pd(T.invBC2))), T.BC);
+
+		__m256d squareDist = _mm256_blendv_pd(_mm256_min_pd(e1, _mm256_min_pd(e2, e3)), faceD2, inside);
+
+		if (signedDist)
+		{
+			//same sign as the dot product between AP and the triangle normal
+			__m256d d = _mm256_sqrt_pd(squareDist);
+			squareDist = _mm256_blendv_pd(d, _mm256_xor_pd(d, signMask), _mm256_cmp_pd(dn, zero, _CMP_LT_OQ));
+		}
+		_mm_storeu_ps(dists+i, _mm256_cvtpd_ps(squareDist));
+	}
+
+	//remaining points: processed as a full batch (padded with the last point)
+	if (i < count)
+	{
+		PointCoordinateType px[4], py[4], pz[4];
+		ScalarType pd[4];
+		for (unsigned k=0; k<4; ++k)
+		{
+			unsigned index = std::min(i+k, count-1);
+			px[k] = x[index];
+			py[k] = y[index];
+			pz[k] = z[index];
+		}
+		Points2TriangleDistances_AVX2(px, py, pz, 4, T, signedDist, pd);
+		for (unsigned k=0; i+k<count; ++k)
+			dists[i+k] = pd[k];
+	}
+}
+
+CC_TARGET_AVX2 static void Points2PlaneDistances_AVX2(	const PointCoordinateType* x,
+														const PointCoordinateType* y,
+														const PointCoordinateType* z,
+														unsigned count,
+														const PointCoordinateType* planeEquation,
+														ScalarType* dists)
+{
+	const __m256 a = _mm256_set1_ps(planeEquation[0]);
+	const __m256 b = _mm256_set1_ps(planeEquation[1]);
+	const __m256 c = _mm256_set1_ps(planeEquation[2]);
+	const __m256 d = _mm256_set1_ps(planeEquation[3]);
+
+	unsigned i = 0;
+	for (; i+8 <= count; i += 8)
+	{
+		__m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(x+i), a), _mm256_mul_ps(_mm256_loadu_ps(y+i), b)), _mm256_mul_ps(_mm256_loadu_ps(z+i), c));
+		_mm256_storeu_ps(dists+i, _mm256_sub_ps(v, d));
+	}
+
+	Points2PlaneDistances_Scalar(x, y, z, i, count, planeEquation, dists);
+}
+
+#endif //CC_DISTANCE_KERNELS_SIMD
+
+//! Detects the best instruction set supported by the CPU and the OS
+static DistanceComputationTools::SIMD_INSTRUCTION_SET DetectSIMDInstructionSet()
+{
+#ifdef CC_DISTANCE_KERNELS_SIMD
+
+	unsigned leaf1ECX = 0, leaf7EBX = 0;
+	bool hasLeaf7 = false;
+	unsigned long long xcr0 = 0;
+
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	hasLeaf7 = (info[0] >= 7);
+	__cpuid(info, 1);
+	leaf1ECX = static_cast<unsigned>(info[2]);
+	if (hasLeaf7)
+	{
+		__cpuidex(info, 7, 0);
+		leaf7EBX = static_cast<unsigned>(info[1]);
+	}
+	if (leaf1ECX & (1u << 27)) //OSXSAVE
+		xcr0 = _xgetbv(0);
+#else
+	unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return DistanceComputationTools::SIMD_NONE;
+	leaf1ECX = ecx;
+	hasLeaf7 = (__get_cpuid_max(0, 0) >= 7);
+	if (hasLeaf7)
+	{
+		__cpuid_count(7, 0, eax, ebx, ecx, edx);
+		leaf7EBX = ebx;
+	}
+	if (leaf1ECX & (1u << 27)) //OSXSAVE
+	{
+		unsigned lo = 0, hi = 0;
+		__asm__ __volatile__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		xcr0 = (static_cast<unsigned long long>(hi) << 32) | lo;
+	}
+#endif
+
+	bool sse41 = ((leaf1ECX & (1u << 19)) != 0);
+	//AVX registers must be saved by the OS (XMM and YMM states)
+	bool avx = ((leaf1ECX & (1u << 28)) != 0) && ((xcr0 & 6) == 6);
+	bool avx2 = avx && ((leaf7EBX & (1u << 5)) != 0);
+
+	if (avx2)
+		return DistanceComputationTools::SIMD_AVX2;
+	if (sse41)
+		return DistanceComputationTools::SIMD_SSE4_1;
+
+#endif //CC_DISTANCE_KERNELS_SIMD
+
+	return DistanceComputationTools::SIMD_NONE;
+}
+
+//! Best instruction set supported by the CPU
+static const DistanceComputationTools::SIMD_INSTRUCTION_SET s_supportedInstructionSet = DetectSIMDInstructionSet();
+//! Instruction set currently used
+static DistanceComputationTools::SIMD_INSTRUCTION_SET s_instructionSet = s_supportedInstructionSet;
+
+DistanceComputationTools::SIMD_INSTRUCTION_SET DistanceComputationTools::GetSIMDInstructionSet()
+{
+	return s_instructionSet;
+}
+
+DistanceComputationTools::SIMD_INSTRUCTION_SET DistanceComputationTools::GetSupportedSIMDInstructionSet()
+{
+	return s_supportedInstructionSet;
+}
+
+DistanceComputationTools::SIMD_INSTRUCTION_SET DistanceComputationTools::SetSIMDInstructionSet(SIMD_INSTRUCTION_SET set)
+{
+	s_instructionSet = std::min(set, s_supportedInstructionSet);
+	return s_instructionSet;
+}
+
+void DistanceComputationTools::computePoints2TriangleDistances(	const PointCoordinateType* x,
+																const PointCoordinateType* y,
+																const PointCoordinateType* z,
+																unsigned count,
+																const GenericTriangle* theTriangle,
+																bool signedDist,
+																ScalarType* dists)
+{
+	assert(theTriangle && (count == 0 || (x && y && z && dists)));
+
+	TriangleKernelData T(theTriangle);
+
+	switch (s_instructionSet)
+	{
+#ifdef CC_DISTANCE_KERNELS_SIMD
+	case SIMD_AVX2:
+		Points2TriangleDistances_AVX2(x, y, z, count, T, signedDist, dists);
+		break;
+	case SIMD_SSE4_1:
+		Points2TriangleDistances_SSE4_1(x, y, z, count, T, signedDist, dists);
+		break;
+#endif
+	default:
+		Points2TriangleDistances_Scalar(x, y, z, count, T, signedDist, dists);
+		break;
+	}
+}
+
+void DistanceComputationTools::computePoints2PlaneDistances(const PointCoordinateType* x,
+															const PointCoordinateType* y,
+															const PointCoordinateType* z,
+															unsigned count,
+															const PointCoordinateType* planeEquation,
+															ScalarType* dists)
+{
+	assert(planeEquation && (count == 0 || (x && y && z && dists)));
+
+	switch (s_instructionSet)
+	{
+#ifdef CC_DISTANCE_KERNELS_SIMD
+	case SIMD_AVX2:
+		Points2PlaneDistances_AVX2(x, y, z, count, planeEquation, dists);
+		break;
+	case SIMD_SSE4_1:
+		Points2PlaneDistances_SSE4_1(x, y, z, count, planeEquation, dists);
+		break;
+#endif
+	default:
+		Points2PlaneDistances_Scalar(x, y, z, 0, count, planeEquation, dists);
+		break;
+	}
+}
@@ -23,6 +23,8 @@
 #include "ChunkedPointCloud.h"
 #include "DgmOctreeReferenceCloud.h"
 #include "ReferenceCloud.h"
+#include "SimpleCloud.h"
+#include "GenericPointStream.h"
 #include "Neighbourhood.h"
 #include "GenericTriangle.h"
 #include "GenericIndexedMesh.h"
@@ -33,14 +35,21 @@
 #include "CCConst.h"
 #include "CCMiscTools.h"
 #include "LocalModel.h"
+#include "LocalModelGrid.h"
 #include "SimpleTriangle.h"
+#include "MeshBVH.h"
+#include "MeshDistanceGrid.h"
 #include "ScalarField.h"
+#include "ParallelTools.h"
 
 //system
 #include <assert.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <limits>
+#include <algorithm>
+#include <string>
 
 #ifdef USE_QT
 #ifndef _DEBUG
@@ -146,13 +155,6 @@ int DistanceComputationTools::computeCloud2CloudDistance(	GenericIndexedCloudPer
 {
 	assert(comparedCloud && referenceCloud);
 
-	if (params.CPSet && params.maxSearchDist > 0)
-	{
-		//we can't use a 'max search distance' criterion if the "Closest Point Set" is requested
-		assert(false);
-		return -666;
-	}
-
 	//we spatially 'synchronize' the octrees
 	DgmOctree *comparedOctree = compOctree, *referenceOctree = refOctree;
 	SOReturnCode soCode = synchronizeOctrees(	comparedCloud,
@@ -160,7 +162,8 @@ int DistanceComputationTools::computeCloud2CloudDistance(	GenericIndexedCloudPer
 												comparedOctree,
 												referenceOctree,
 												params.maxSearchDist,
-												progressCb);
+												progressCb,
+												params.reuseReferenceOctree);
 	
 	if (soCode != SYNCHRONIZED && soCode != DISJOINT)
 	{
@@ -181,17 +184,23 @@ int DistanceComputationTools::computeCloud2CloudDistance(	GenericIndexedCloudPer
 	//closest point set
 	if (params.CPSet)
 	{
-		assert(maxSearchSquareDistd <= 0);
-		
 		if (!params.CPSet->resize(comparedCloud->size()))
 		{
 			//not enough memory
-			if (comparedOctree && !compOctree)
+			if (comparedOctree && comparedOctree != compOctree)
 				delete comparedOctree;
-			if (referenceOctree && !refOctree)
+			if (referenceOctree && referenceOctree != refOctree)
 				delete referenceOctree;
 			return -1;
 		}
+
+		if (maxSearchSquareDistd > 0)
+		{
+			//points farther than 'maxSearchDist' won't be processed (nor even projected in the octree)
+			const PointIndexType noMatchIndex = DgmOctree::INVALID_POINT_INDEX;
+			for (unsigned i=0; i<comparedCloud->size(); ++i)
+				params.CPSet->setPointIndex(i,noMatchIndex);
+		}
 	}
 
 	//by default we reset any former value stored in the 'enabled' scalar field
@@ -215,32 +224,62 @@ int DistanceComputationTools::computeCloud2CloudDistance(	GenericIndexedCloudPer
 		params.octreeLevel = comparedOctree->findBestLevelForComparisonWithOctree(referenceOctree);
 	}
 
+	int result = 0;
+
+	//precomputed local models
+	LocalModelGrid* modelGrid = 0;
+	if (params.localModel != NO_MODEL && params.useLocalModelGrid && referenceOctree)
+	{
+		modelGrid = new LocalModelGrid;
+		if (!modelGrid->build(	referenceOctree,
+								params.localModelGridLevel,
+								params.localModel,
+								params.useSphericalSearchForLocalModel,
+								params.kNNForLocalModel,
+								static_cast<PointCoordinateType>(params.radiusForLocalModel),
+								params.multiThread,
+								progressCb))
+		{
+			//not enough memory (or process cancelled by the user)
+			result = -2;
+		}
+	}
+
 	//additional parameters
-	void* additionalParameters[4] = {	reinterpret_cast<void*>(referenceCloud),
+	void* additionalParameters[5] = {	reinterpret_cast<void*>(referenceCloud),
 										reinterpret_cast<void*>(referenceOctree),
 										reinterpret_cast<void*>(&params),
-										reinterpret_cast<void*>(&maxSearchSquareDistd)
+										reinterpret_cast<void*>(&maxSearchSquareDistd),
+										reinterpret_cast<void*>(modelGrid)
 	};
 
-	int result = 0;
+	DgmOctree::octreeCellFunc cellFunc = computeCellHausdorffDistance;
+	if (params.localModel != NO_MODEL)
+		cellFunc = (modelGrid ? computeCellHausdorffDistanceWithLocalModelGrid : computeCellHausdorffDistanceWithLocalModel);
 
-	if (comparedOctree->executeFunctionForAllCellsAtLevel(	params.octreeLevel,
-															params.localModel == NO_MODEL ? computeCellHausdorffDistance : computeCellHausdorffDistanceWithLocalModel,
-															additionalParameters,
-															params.multiThread,
-															progressCb,
-															"Cloud-Cloud Distance") == 0)
+	if (result == 0 && comparedOctree->executeFunctionForAllCellsAtLevel(	params.octreeLevel,
+																			cellFunc,
+																			additionalParameters,
+																			params.multiThread,
+																			progressCb,
+																			"Cloud-Cloud Distance") == 0)
 	{
 		//something went wrong
 		result = -2;
 	}
 
-	if (comparedOctree && !compOctree)
+	if (modelGrid)
+	{
+		delete modelGrid;
+		modelGrid = 0;
+	}
+
+	if (comparedOctree && comparedOctree != compOctree)
 	{
 		delete comparedOctree;
 		comparedOctree = 0;
 	}
-	if (referenceOctree && !refOctree)
+	if (referenceOctree && referenceOctree != refOctree)
 	{
 		delete referenceOctree;
 		referenceOctree = 0;
@@ -249,13 +288,889 @@ int DistanceComputationTools::computeCloud2CloudDistance(	GenericIndexedCloudPer
 	return result;
 }
 
+//! Max number of cells (along each dimension) of the grid used to define the tiles
+static const unsigned TILING_GRID_MAX_RES = 128;
+
+//! Estimated memory required to process a single point of a tile (subset + octree + octree sort buffer)
+static const size_t TILING_BYTES_PER_POINT = sizeof(PointIndexType) + 2 * sizeof(DgmOctree::IndexAndCode);
+
+//! Estimated memory required to process a single point of an out-of-core tile (loaded point + distance + index)
+static const size_t OUT_OF_CORE_BYTES_PER_POINT = TILING_BYTES_PER_POINT + sizeof(CCVector3) + sizeof(ScalarType) + sizeof(unsigned long long);
+
+//! Regular grid of point counts used to define the tiles
+/** Counts are integrated (summed volume table) so that the number of points
+	in any box of cells can be computed in constant time.
+**/
+struct TilingCountGrid
+{
+	//! Grid dimensions
+	Tuple3i res;
+	//! Summed counts ((res.x+1) x (res.y+1) x (res.z+1))
+	std::vector<unsigned long long> sums;
+
+	//! Default constructor
+	explicit TilingCountGrid(const Tuple3i& _res) : res(_res) {}
+
+	//! Initializes the grid
+	bool init()
+	{
+		try
+		{
+			sums.resize(static_cast<size_t>(res.x+1) * (res.y+1) * (res.z+1), 0);
+		}
+		catch (const std::bad_alloc&) //out of memory
+		{
+			return false;
+		}
+		return true;
+	}
+
+	//! Returns the summed count at a given position (in the summed table)
+	inline unsigned long long& at(int i, int j, int k) { return sums[(static_cast<size_t>(k) * (res.y+1) + j) * (res.x+1) + i]; }
+
+	//! Adds a point in a given cell
+	inline void add(const Tuple3i& cell) { ++at(cell.x+1, cell.y+1, cell.z+1); }
+
+	//! Integrates the counts (must be called once all points have been added)
+	void integrate()
+	{
+		for (int k=1; k<=res.z; ++k)
+			for (int j=1; j<=res.y; ++j)
+				for (int i=1; i<=res.x; ++i)
+					at(i,j,k) += at(i-1,j,k) + at(i,j-1,k) + at(i,j,k-1)
+								- at(i-1,j-1,k) - at(i-1,j,k-1) - at(i,j-1,k-1)
+								+ at(i-1,j-1,k-1);
+	}
+
+	//! Returns the number of points in a box of cells (minCell included, maxCell excluded)
+	inline unsigned long long count(const Tuple3i& minCell, const Tuple3i& maxCell)
+	{
+		return		at(maxCell.x,maxCell.y,maxCell.z)
+				-	at(minCell.x,maxCell.y,maxCell.z) - at(maxCell.x,minCell.y,maxCell.z) - at(maxCell.x,maxCell.y,minCell.z)
+				+	at(minCell.x,minCell.y,maxCell.z) + at(minCell.x,maxCell.y,minCell.z) + at(maxCell.x,minCell.y,minCell.z)
+				-	at(minCell.x,minCell.y,minCell.z);
+	}
+};
+
+//! Cloud-to-cloud distances tile (box of cells of the tiling grid)
+struct C2CTile
+{
+	//! First cell (included)
+	Tuple3i minCell;
+	//! Last cell (excluded)
+	Tuple3i maxCell;
+
+	//! Default constructor
+	C2CTile(const Tuple3i& _minCell, const Tuple3i& _maxCell) : minCell(_minCell), maxCell(_maxCell) {}
+};
+
+//! Geometry of the grid used to define the tiles
+/** The grid covers the compared cloud bounding-box enlarged by the max search distance
+	(+ a small margin to avoid round-off issues when counting the reference points).
+**/
+struct C2CTilingGrid
+{
+	//! Grid origin
+	CCVector3 origin;
+	//! Grid upper corner
+	CCVector3 gridMax;
+	//! Cell size
+	PointCoordinateType cellSize;
+	//! Grid dimensions
+	Tuple3i res;
+	//! Tiles margin (in cells)
+	int marginCells;
+
+	//! Default constructor
+	C2CTilingGrid(const CCVector3& bbMin, const CCVector3& bbMax, ScalarType maxSearchDist)
+	{
+		CCVector3 diag = bbMax - bbMin;
+		PointCoordinateType maxDim = std::max(diag.x,std::max(diag.y,diag.z));
+		PointCoordinateType margin = static_cast<PointCoordinateType>(maxSearchDist) + maxDim / 100000;
+
+		origin = bbMin - CCVector3(margin,margin,margin);
+		cellSize = (maxDim + 2*margin) / TILING_GRID_MAX_RES;
+		for (unsigned char k=0; k<3; ++k)
+			res.u[k] = std::max(1, std::min(static_cast<int>(ceil((diag.u[k] + 2*margin) / cellSize)), static_cast<int>(TILING_GRID_MAX_RES)));
+		gridMax = origin + CCVector3(res.x*cellSize, res.y*cellSize, res.z*cellSize);
+		marginCells = static_cast<int>(ceil(margin / cellSize)) + 1;
+	}
+
+	//! Returns the total number of cells
+	inline size_t cellCount() const { return static_cast<size_t>(res.x) * res.y * res.z; }
+
+	//! Returns the (linear) index of a cell
+	inline size_t cellIndex(const Tuple3i& cell) const { return (static_cast<size_t>(cell.z) * res.y + cell.y) * res.x + cell.x; }
+
+	//! Returns whether a point lies inside the grid
+	inline bool contains(const CCVector3& P) const
+	{
+		return	P.x >= origin.x && P.y >= origin.y && P.z >= origin.z
+			&&	P.x <= gridMax.x && P.y <= gridMax.y && P.z <= gridMax.z;
+	}
+
+	//! Returns the cell of a given point
+	inline Tuple3i cell(const CCVector3& P) const
+	{
+		Tuple3i c;
+		for (unsigned char k=0; k<3; ++k)
+		{
+			int i = static_cast<int>(floor((P.u[k] - origin.u[k]) / cellSize));
+			c.u[k] = std::max(0, std::min(i, res.u[k]-1));
+		}
+		return c;
+	}
+
+	//! Returns the box of cells where the reference points of a tile may lie (tile enlarged by the margin)
+	inline C2CTile enlargedTile(const C2CTile& tile) const
+	{
+		C2CTile box(tile);
+		for (unsigned char k=0; k<3; ++k)
+		{
+			box.minCell.u[k] = std::max(0, tile.minCell.u[k] - marginCells);
+			box.maxCell.u[k] = std::min(res.u[k], tile.maxCell.u[k] + marginCells);
+		}
+		return box;
+	}
+};
+
+//! Splits the tiling grid in tiles so that each tile (+ its margin) contains less than 'maxTilePoints'
+/** \return false if not enough memory
+**/
+static bool ComputeC2CTiles(const C2CTilingGrid& grid,
+							TilingCountGrid& compGrid,
+							TilingCountGrid& refGrid,
+							unsigned long long maxTilePoints,
+							std::vector<C2CTile>& tiles)
+{
+	try
+	{
+		std::vector<C2CTile> boxes;
+		boxes.push_back(C2CTile(Tuple3i(0,0,0),grid.res));
+		while (!boxes.empty())
+		{
+			C2CTile box = boxes.back();
+			boxes.pop_back();
+
+			unsigned long long tileCompCount = compGrid.count(box.minCell,box.maxCell);
+			if (tileCompCount == 0)
+				continue;
+
+			C2CTile refBox = grid.enlargedTile(box);
+			unsigned long long tileRefCount = refGrid.count(refBox.minCell,refBox.maxCell);
+
+			//largest dimension of the box (in cells)
+			unsigned char splitDim = 0;
+			for (unsigned char k=1; k<3; ++k)
+				if (box.maxCell.u[k] - box.minCell.u[k] > box.maxCell.u[splitDim] - box.minCell.u[splitDim])
+					splitDim = k;
+
+			if (tileCompCount + tileRefCount <= maxTilePoints || box.maxCell.u[splitDim] - box.minCell.u[splitDim] == 1)
+			{
+				//the tile fits in memory (or can't be split anymore)
+				tiles.push_back(box);
+			}
+			else
+			{
+				int mid = (box.minCell.u[splitDim] + box.maxCell.u[splitDim]) / 2;
+				C2CTile first(box), second(box);
+				first.maxCell.u[splitDim] = mid;
+				second.minCell.u[splitDim] = mid;
+				//the first half is processed first (so that the tiles are spatially coherent)
+				boxes.push_back(second);
+				boxes.push_back(first);
+			}
+		}
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return false;
+	}
+
+	return true;
+}
+
+//! Point indexes sorted by cell of the tiling grid (so that the points of each tile are gathered without scanning the whole cloud)
+struct TilingCellBuckets
+{
+	//! Index (in 'indexes') of the first point of each cell (+ the total number of points at the end)
+	std::vector<PointIndexType> cellStart;
+	//! Point indexes (sorted by cell)
+	std::vector<PointIndexType> indexes;
+
+	//! Sorts the points of a cloud by cell (and counts them in 'countGrid')
+	/** The points outside of the grid are ignored.
+		\return false if not enough memory
+	**/
+	bool init(GenericIndexedCloudPersist* cloud, const C2CTilingGrid& grid, TilingCountGrid& countGrid)
+	{
+		unsigned pointCount = cloud->size();
+		try
+		{
+			cellStart.resize(grid.cellCount() + 1, 0);
+		}
+		catch (const std::bad_alloc&) //out of memory
+		{
+			return false;
+		}
+
+		//count the points per cell
+		for (unsigned i=0; i<pointCount; ++i)
+		{
+			const CCVector3* P = cloud->getPointPersistentPtr(i);
+			if (grid.contains(*P))
+			{
+				Tuple3i cell = grid.cell(*P);
+				countGrid.add(cell);
+				++cellStart[grid.cellIndex(cell) + 1];
+			}
+		}
+		for (size_t c=1; c<cellStart.size(); ++c)
+			cellStart[c] += cellStart[c-1];
+
+		//sort them
+		try
+		{
+			indexes.resize(cellStart.back());
+		}
+		catch (const std::bad_alloc&) //out of memory
+		{
+			return false;
+		}
+		std::vector<PointIndexType> fillPos(cellStart);
+		for (unsigned i=0; i<pointCount; ++i)
+		{
+			const CCVector3* P = cloud->getPointPersistentPtr(i);
+			if (grid.contains(*P))
+				indexes[fillPos[grid.cellIndex(grid.cell(*P))]++] = i;
+		}
+
+		return true;
+	}
+};
+
+int DistanceComputationTools::computeCloud2CloudDistanceTiled(	GenericIndexedCloudPersist* comparedCloud,
+																GenericIndexedCloudPersist* referenceCloud,
+																Cloud2CloudDistanceComputationParams& params,
+																size_t maxTileMemory,
+																GenericProgressCallback* progressCb/*=0*/)
+{
+	assert(comparedCloud && referenceCloud);
+
+	if (params.maxSearchDist <= 0 || params.localModel != NO_MODEL || maxTileMemory == 0)
+	{
+		//the tiles margin is defined by the max search distance
+		return -2;
+	}
+
+	unsigned compCount = comparedCloud->size();
+	unsigned refCount = referenceCloud->size();
+	if (compCount == 0 || refCount == 0)
+		return -2;
+
+	//we 'enable' a scalar field  (if it is not already done) to store resulting distances
+	if (!comparedCloud->enableScalarField())
+	{
+		//not enough memory
+		return -1;
+	}
+
+	//closest point set
+	const PointIndexType noMatchIndex = DgmOctree::INVALID_POINT_INDEX;
+	if (params.CPSet)
+	{
+		if (!params.CPSet->resize(compCount))
+		{
+			//not enough memory
+			return -1;
+		}
+		for (unsigned i=0; i<compCount; ++i)
+			params.CPSet->setPointIndex(i,noMatchIndex);
+	}
+
+	//tiling grid
+	CCVector3 bbMin, bbMax;
+	comparedCloud->getBoundingBox(bbMin,bbMax);
+	C2CTilingGrid grid(bbMin,bbMax,params.maxSearchDist);
+
+	//the points of both clouds are sorted by cell once and for all
+	TilingCountGrid compGrid(grid.res), refGrid(grid.res);
+	TilingCellBuckets compBuckets, refBuckets;
+	if (	!compGrid.init() || !refGrid.init()
+		||	!compBuckets.init(comparedCloud,grid,compGrid)
+		||	!refBuckets.init(referenceCloud,grid,refGrid) )
+	{
+		//not enough memory
+		return -1;
+	}
+	compGrid.integrate();
+	refGrid.integrate();
+
+	//we split the grid until each tile fits in memory
+	std::vector<C2CTile> tiles;
+	if (!ComputeC2CTiles(grid,compGrid,refGrid,std::max<unsigned long long>(1, maxTileMemory / TILING_BYTES_PER_POINT),tiles))
+	{
+		//not enough memory
+		return -1;
+	}
+
+	//now we process each tile
+	for (size_t t=0; t<tiles.size(); ++t)
+	{
+		const C2CTile& tile = tiles[t];
+		C2CTile refBox = grid.enlargedTile(tile);
+
+		ReferenceCloud compTile(comparedCloud);
+		ReferenceCloud refTile(referenceCloud);
+		if (	!compTile.reserve(static_cast<PointIndexType>(compGrid.count(tile.minCell,tile.maxCell)))
+			||	!refTile.reserve(static_cast<PointIndexType>(refGrid.count(refBox.minCell,refBox.maxCell))) )
+		{
+			//not enough memory
+			return -1;
+		}
+
+		//compared points inside the tile
+		for (int k=tile.minCell.z; k<tile.maxCell.z; ++k)
+		{
+			for (int j=tile.minCell.y; j<tile.maxCell.y; ++j)
+			{
+				size_t firstCell = grid.cellIndex(Tuple3i(tile.minCell.x,j,k));
+				size_t lastCell = grid.cellIndex(Tuple3i(tile.maxCell.x-1,j,k));
+				for (PointIndexType n=compBuckets.cellStart[firstCell]; n<compBuckets.cellStart[lastCell+1]; ++n)
+					compTile.addPointIndex(compBuckets.indexes[n]);
+			}
+		}
+
+		//reference points inside the bounding-box of the compared points enlarged by 'maxSearchDist'
+		//(all of them will be projected in the tile octrees - see synchronizeOctrees)
+		CCVector3 tileMin, tileMax;
+		compTile.getBoundingBox(tileMin,tileMax);
+		{
+			PointCoordinateType maxDist = static_cast<PointCoordinateType>(params.maxSearchDist);
+			for (unsigned char k=0; k<3; ++k)
+			{
+				tileMin.u[k] -= maxDist;
+				tileMax.u[k] += maxDist;
+			}
+		}
+		for (int k=refBox.minCell.z; k<refBox.maxCell.z; ++k)
+		{
+			for (int j=refBox.minCell.y; j<refBox.maxCell.y; ++j)
+			{
+				size_t firstCell = grid.cellIndex(Tuple3i(refBox.minCell.x,j,k));
+				size_t lastCell = grid.cellIndex(Tuple3i(refBox.maxCell.x-1,j,k));
+				for (PointIndexType n=refBuckets.cellStart[firstCell]; n<refBuckets.cellStart[lastCell+1]; ++n)
+				{
+					PointIndexType index = refBuckets.indexes[n];
+					const CCVector3* P = referenceCloud->getPointPersistentPtr(index);
+					if (	P->x >= tileMin.x && P->y >= tileMin.y && P->z >= tileMin.z
+						&&	P->x <= tileMax.x && P->y <= tileMax.y && P->z <= tileMax.z)
+					{
+						refTile.addPointIndex(index);
+					}
+				}
+			}
+		}
+
+		if (refTile.size() == 0)
+		{
+			//no reference point below 'maxSearchDist'
+			if (params.resetFormerDistances)
+				for (unsigned i=0; i<compTile.size(); ++i)
+					compTile.setPointScalarValue(i,params.maxSearchDist);
+			continue;
+		}
+
+		Cloud2CloudDistanceComputationParams tileParams = params;
+		ReferenceCloud tileCPSet(&refTile);
+		tileParams.CPSet = (params.CPSet ? &tileCPSet : 0);
+
+		int result = computeCloud2CloudDistance(&compTile,&refTile,tileParams,progressCb);
+		if (result < 0)
+			return result;
+
+		if (params.CPSet)
+		{
+			//convert the tile CPSet indexes (relative to 'refTile') to global indexes
+			for (unsigned i=0; i<compTile.size(); ++i)
+			{
+				PointIndexType localIndex = tileCPSet.getPointGlobalIndex(i);
+				params.CPSet->setPointIndex(compTile.getPointGlobalIndex(i), localIndex == noMatchIndex ? noMatchIndex : refTile.getPointGlobalIndex(localIndex));
+			}
+		}
+
+		if (progressCb && progressCb->isCancelRequested())
+		{
+			//process cancelled by the user
+			return -2;
+		}
+	}
+
+	return 0;
+}
+
+//! Sets the position of a (possibly large) file
+static bool SeekLargeFile(FILE* fp, unsigned long long pos)
+{
+#ifdef _MSC_VER
+	return _fseeki64(fp, static_cast<__int64>(pos), SEEK_SET) == 0;
+#else
+	return fseeko(fp, static_cast<off_t>(pos), SEEK_SET) == 0;
+#endif
+}
+
+//! Temporary file filled by blocks (out-of-core tiled distances)
+/** The file is only opened while a block is written, so that
+	many of them can be filled at the same time.
+**/
+class OutOfCoreTileFile
+{
+public:
+
+	//! Default constructor
+	OutOfCoreTileFile() : recordCount(0), m_error(false) {}
+
+	//! Initializes the file (the file is created)
+	bool init(const std::string& filename, size_t bufferSize)
+	{
+		m_filename = filename;
+		try
+		{
+			m_buffer.reserve(bufferSize);
+		}
+		catch (const std::bad_alloc&) //out of memory
+		{
+			return false;
+		}
+		FILE* fp = fopen(m_filename.c_str(), "wb");
+		if (!fp)
+			return false;
+		fclose(fp);
+		return true;
+	}
+
+	//! Adds a record
+	inline void add(const void* data, size_t size)
+	{
+		if (m_buffer.size() + size > m_buffer.capacity())
+			flush();
+		const char* bytes = static_cast<const char*>(data);
+		m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+	}
+
+	//! Writes the buffered records
+	void flush()
+	{
+		if (m_buffer.empty())
+			return;
+		FILE* fp = fopen(m_filename.c_str(), "ab");
+		if (!fp || fwrite(&(m_buffer[0]), 1, m_buffer.size(), fp) != m_buffer.size())
+			m_error = true;
+		if (fp)
+			fclose(fp);
+		m_buffer.clear();
+	}
+
+	//! Releases the buffer and deletes the file
+	void remove()
+	{
+		std::vector<char>().swap(m_buffer);
+		if (!m_filename.empty())
+			::remove(m_filename.c_str());
+	}
+
+	//! File name
+	const std::string& filename() const { return m_filename; }
+	//! Number of records (must be updated by the caller)
+	unsigned long long recordCount;
+	//! Whether an error occurred
+	bool error() const { return m_error; }
+
+protected:
+
+	//! File name
+	std::string m_filename;
+	//! Buffer
+	std::vector<char> m_buffer;
+	//! Whether an error occurred
+	bool m_error;
+};
+
+//! Temporary files of an out-of-core tiled comparison (deleted with the object)
+struct OutOfCoreTileFiles
+{
+	//! Compared points of each tile (index + point)
+	std::vector<OutOfCoreTileFile> compFiles;
+	//! Reference points of each tile
+	std::vector<OutOfCoreTileFile> refFiles;
+
+	//! Destructor
+	~OutOfCoreTileFiles()
+	{
+		for (size_t t=0; t<compFiles.size(); ++t)
+			compFiles[t].remove();
+		for (size_t t=0; t<refFiles.size(); ++t)
+			refFiles[t].remove();
+	}
+};
+
+int DistanceComputationTools::computeCloud2CloudDistanceOutOfCore(	GenericPointStream* comparedStream,
+																	GenericPointStream* referenceStream,
+																	GenericDistanceOutput* output,
+																	Cloud2CloudDistanceComputationParams& params,
+																	size_t maxTileMemory,
+																	const char* tempFilesPrefix,
+																	GenericProgressCallback* progressCb/*=0*/)
+{
+	assert(comparedStream && referenceStream && output && tempFilesPrefix);
+
+	if (params.maxSearchDist <= 0 || params.localModel != NO_MODEL || params.CPSet || maxTileMemory == 0)
+	{
+		//the tiles margin is defined by the max search distance
+		return -2;
+	}
+
+	//first pass: bounding-box of the compared points
+	unsigned long long compCount = 0;
+	CCVector3 bbMin, bbMax;
+	{
+		if (!comparedStream->rewind())
+			return -3;
+		CCVector3 P;
+		while (comparedStream->readNext(P))
+		{
+			if (compCount++ == 0)
+			{
+				bbMin = bbMax = P;
+			}
+			else
+			{
+				for (unsigned char k=0; k<3; ++k)
+				{
+					if (P.u[k] < bbMin.u[k])
+						bbMin.u[k] = P.u[k];
+					else if (P.u[k] > bbMax.u[k])
+						bbMax.u[k] = P.u[k];
+				}
+			}
+		}
+	}
+	if (compCount == 0)
+		return -2;
+
+	//second pass: points count per cell
+	C2CTilingGrid grid(bbMin,bbMax,params.maxSearchDist);
+	TilingCountGrid compGrid(grid.res), refGrid(grid.res);
+	if (!compGrid.init() || !refGrid.init())
+	{
+		//not enough memory
+		return -1;
+	}
+	{
+		CCVector3 P;
+		if (!comparedStream->rewind())
+			return -3;
+		while (comparedStream->readNext(P))
+			compGrid.add(grid.cell(P));
+		if (!referenceStream->rewind())
+			return -3;
+		while (referenceStream->readNext(P))
+			if (grid.contains(P))
+				refGrid.add(grid.cell(P));
+	}
+	compGrid.integrate();
+	refGrid.integrate();
+
+	//we split the grid until each tile fits in memory
+	std::vector<C2CTile> tiles;
+	if (!ComputeC2CTiles(grid,compGrid,refGrid,std::max<unsigned long long>(1, maxTileMemory / OUT_OF_CORE_BYTES_PER_POINT),tiles))
+	{
+		//not enough memory
+		return -1;
+	}
+	if (tiles.empty())
+		return -2;
+
+	//tile of each cell (compared points) and tiles overlapping each cell (reference points)
+	std::vector<unsigned> cellTile;
+	std::vector<unsigned> cellRefTilesStart;
+	std::vector<unsigned> cellRefTiles;
+	try
+	{
+		cellTile.resize(grid.cellCount(), 0);
+		cellRefTilesStart.resize(grid.cellCount() + 1, 0);
+		for (size_t t=0; t<tiles.size(); ++t)
+		{
+			const C2CTile& tile = tiles[t];
+			for (int k=tile.minCell.z; k<tile.maxCell.z; ++k)
+				for (int j=tile.minCell.y; j<tile.maxCell.y; ++j)
+					for (int i=tile.minCell.x; i<tile.maxCell.x; ++i)
+						cellTile[grid.cellIndex(Tuple3i(i,j,k))] = static_cast<unsigned>(t);
+
+			C2CTile refBox = grid.enlargedTile(tile);
+			for (int k=refBox.minCell.z; k<refBox.maxCell.z; ++k)
+				for (int j=refBox.minCell.y; j<refBox.maxCell.y; ++j)
+					for (int i=refBox.minCell.x; i<refBox.maxCell.x; ++i)
+						++cellRefTilesStart[grid.cellIndex(Tuple3i(i,j,k)) + 1];
+		}
+		for (size_t c=1; c<cellRefTilesStart.size(); ++c)
+			cellRefTilesStart[c] += cellRefTilesStart[c-1];
+		cellRefTiles.resize(cellRefTilesStart.back());
+		std::vector<unsigned> fillPos(cellRefTilesStart);
+		for (size_t t=0; t<tiles.size(); ++t)
+		{
+			C2CTile refBox = grid.enlargedTile(tiles[t]);
+			for (int k=refBox.minCell.z; k<refBox.maxCell.z; ++k)
+				for (int j=refBox.minCell.y; j<refBox.maxCell.y; ++j)
+					for (int i=refBox.minCell.x; i<refBox.maxCell.x; ++i)
+						cellRefTiles[fillPos[grid.cellIndex(Tuple3i(i,j,k))]++] = static_cast<unsigned>(t);
+		}
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return -1;
+	}
+
+	//third pass: the points are sorted by tile in temporary files
+	OutOfCoreTileFiles tileFiles;
+	{
+		//the write buffers use (at most) half of the memory budget
+		size_t bufferSize = std::max<size_t>(4096, std::min<size_t>(1 << 20, maxTileMemory / (4 * tiles.size())));
+		try
+		{
+			tileFiles.compFiles.resize(tiles.size());
+			tileFiles.refFiles.resize(tiles.size());
+		}
+		catch (const std::bad_alloc&) //out of memory
+		{
+			return -1;
+		}
+		for (size_t t=0; t<tiles.size(); ++t)
+		{
+			char buffer[32];
+			sprintf(buffer, "_%u", static_cast<unsigned>(t));
+			if (	!tileFiles.compFiles[t].init(std::string(tempFilesPrefix) + buffer + "_comp.tmp", bufferSize)
+				||	!tileFiles.refFiles[t].init(std::string(tempFilesPrefix) + buffer + "_ref.tmp", bufferSize) )
+			{
+				return -3;
+			}
+		}
+
+		CCVector3 P;
+		if (!comparedStream->rewind())
+			return -3;
+		for (unsigned long long index=0; comparedStream->readNext(P); ++index)
+		{
+			OutOfCoreTileFile& file = tileFiles.compFiles[cellTile[grid.cellIndex(grid.cell(P))]];
+			file.add(&index, sizeof(unsigned long long));
+			file.add(P.u, sizeof(CCVector3));
+			++file.recordCount;
+		}
+		if (!referenceStream->rewind())
+			return -3;
+		while (referenceStream->readNext(P))
+		{
+			if (!grid.contains(P))
+				continue;
+			size_t cellIndex = grid.cellIndex(grid.cell(P));
+			for (unsigned n=cellRefTilesStart[cellIndex]; n<cellRefTilesStart[cellIndex+1]; ++n)
+			{
+				OutOfCoreTileFile& file = tileFiles.refFiles[cellRefTiles[n]];
+				file.add(P.u, sizeof(CCVector3));
+				++file.recordCount;
+			}
+		}
+
+		for (size_t t=0; t<tiles.size(); ++t)
+		{
+			tileFiles.compFiles[t].flush();
+			tileFiles.refFiles[t].flush();
+			if (tileFiles.compFiles[t].error() || tileFiles.refFiles[t].error())
+				return -3;
+		}
+	}
+
+	//release the grids memory before processing the tiles
+	std::vector<unsigned>().swap(cellTile);
+	std::vector<unsigned>().swap(cellRefTilesStart);
+	std::vector<unsigned>().swap(cellRefTiles);
+
+	//the distances are stored in a temporary file (in the compared stream order)
+	std::string distFilename = std::string(tempFilesPrefix) + "_dist.tmp";
+	FILE* distFile = fopen(distFilename.c_str(), "w+b");
+	if (!distFile)
+		return -3;
+
+	//now we process each tile
+	int result = 0;
+	for (size_t t=0; t<tiles.size() && result == 0; ++t)
+	{
+		OutOfCoreTileFile& compFile = tileFiles.compFiles[t];
+		OutOfCoreTileFile& refFile = tileFiles.refFiles[t];
+		if (compFile.recordCount == 0)
+		{
+			compFile.remove();
+			refFile.remove();
+			continue;
+		}
+
+		//load the tile points
+		SimpleCloud compTile, refTile;
+		std::vector<unsigned long long> indexes;
+		try
+		{
+			indexes.resize(static_cast<size_t>(compFile.recordCount));
+		}
+		catch (const std::bad_alloc&) //out of memory
+		{
+			result = -1;
+			break;
+		}
+		if (	!compTile.reserve(static_cast<unsigned>(compFile.recordCount))
+			||	!refTile.reserve(static_cast<unsigned>(refFile.recordCount)) )
+		{
+			result = -1;
+			break;
+		}
+		{
+			FILE* fp = fopen(compFile.filename().c_str(), "rb");
+			if (!fp)
+			{
+				result = -3;
+				break;
+			}
+			for (size_t i=0; i<indexes.size(); ++i)
+			{
+				CCVector3 P;
+				if (	fread(&(indexes[i]), sizeof(unsigned long long), 1, fp) != 1
+					||	fread(P.u, sizeof(CCVector3), 1, fp) != 1 )
+				{
+					result = -3;
+					break;
+				}
+				compTile.addPoint(P);
+			}
+			fclose(fp);
+		}
+		if (result == 0 && refFile.recordCount != 0)
+		{
+			FILE* fp = fopen(refFile.filename().c_str(), "rb");
+			if (!fp)
+			{
+				result = -3;
+				break;
+			}
+			for (unsigned long long i=0; i<refFile.recordCount; ++i)
+			{
+				CCVector3 P;
+				if (fread(P.u, sizeof(CCVector3), 1, fp) != 1)
+				{
+					result = -3;
+					break;
+				}
+				refTile.addPoint(P);
+			}
+			fclose(fp);
+		}
+		compFile.remove();
+		refFile.remove();
+		if (result != 0)
+			break;
+
+		//compute the distances
+		if (!compTile.enableScalarField())
+		{
+			result = -1;
+			break;
+		}
+		if (refTile.size() == 0)
+		{
+			//no reference point below 'maxSearchDist'
+			for (unsigned i=0; i<compTile.size(); ++i)
+				compTile.setPointScalarValue(i,params.maxSearchDist);
+		}
+		else
+		{
+			Cloud2CloudDistanceComputationParams tileParams = params;
+			tileParams.resetFormerDistances = true;
+			int tileResult = computeCloud2CloudDistance(&compTile,&refTile,tileParams,progressCb);
+			if (tileResult < 0)
+			{
+				result = tileResult;
+				break;
+			}
+		}
+
+		//write them (the indexes are sorted: consecutive points are written at once)
+		std::vector<ScalarType> run;
+		for (size_t i=0; i<indexes.size() && result == 0; )
+		{
+			size_t runStart = i;
+			run.clear();
+			do
+			{
+				run.push_back(compTile.getPointScalarValue(static_cast<unsigned>(i)));
+				++i;
+			}
+			while (i<indexes.size() && indexes[i] == indexes[i-1] + 1);
+
+			if (	!SeekLargeFile(distFile, indexes[runStart] * sizeof(ScalarType))
+				||	fwrite(&(run[0]), sizeof(ScalarType), run.size(), distFile) != run.size() )
+			{
+				result = -3;
+			}
+		}
+
+		if (result == 0 && progressCb && progressCb->isCancelRequested())
+		{
+			//process cancelled by the user
+			result = -2;
+		}
+	}
+
+	//last pass: the distances are sent to the output, in the compared stream order
+	if (result == 0)
+	{
+		if (!comparedStream->rewind() || !SeekLargeFile(distFile,0))
+		{
+			result = -3;
+		}
+		else
+		{
+			CCVector3 P;
+			unsigned long long count = 0;
+			while (comparedStream->readNext(P))
+			{
+				ScalarType d = 0;
+				if (fread(&d, sizeof(ScalarType), 1, distFile) != 1 || !output->writeNext(d))
+				{
+					result = -3;
+					break;
+				}
+				++count;
+			}
+			if (result == 0 && count != compCount)
+			{
+				//the stream has changed?!
+				result = -3;
+			}
+		}
+	}
+
+	fclose(distFile);
+	remove(distFilename.c_str());
+
+	return result;
+}
+
 DistanceComputationTools::SOReturnCode
 	DistanceComputationTools::synchronizeOctrees(	GenericIndexedCloudPersist* comparedCloud,
 													GenericIndexedCloudPersist* referenceCloud,
 													DgmOctree* &comparedOctree,
 													DgmOctree* &referenceOctree,
 													PointCoordinateType maxDist,
-													GenericProgressCallback* progressCb/*=0*/)
+													GenericProgressCallback* progressCb/*=0*/,
+													bool reuseReferenceOctree/*=false*/)
 {
 	assert(comparedCloud && referenceCloud);
 
@@ -297,8 +1212,40 @@ DistanceComputationTools::SOReturnCode
 	CCVector3 minPoints = minD;
 	CCVector3 maxPoints = maxD;
 
-	//we make this bounding-box cubical (+1% growth to avoid round-off issues)
-	CCMiscTools::MakeMinAndMaxCubical(minD,maxD,0.01);
+	//the reference octree can be kept as is if its bounding-box contains all the points to project
+	bool keepReferenceOctree = false;
+	if (reuseReferenceOctree && referenceOctree && referenceOctree->getNumberOfProjectedPoints() != 0)
+	{
+		const CCVector3& octreeMin = referenceOctree->getOctreeMins();
+		const CCVector3& octreeMax = referenceOctree->getOctreeMaxs();
+		keepReferenceOctree = true;
+		for (unsigned char k=0; k<3; k++)
+		{
+			if (minPoints.u[k] < octreeMin.u[k] || maxPoints.u[k] > octreeMax.u[k])
+			{
+				keepReferenceOctree = false;
+				break;
+			}
+		}
+
+		if (keepReferenceOctree)
+		{
+			//the compared octree will be built in the same frame
+			minD = octreeMin;
+			maxD = octreeMax;
+		}
+		else
+		{
+			//we won't modify the input octree (a temporary one will be built instead)
+			referenceOctree = 0;
+		}
+	}
+
+	if (!keepReferenceOctree)
+	{
+		//we make this bounding-box cubical (+1% growth to avoid round-off issues)
+		CCMiscTools::MakeMinAndMaxCubical(minD,maxD,0.01);
+	}
 
 	//then we (re)compute octree A if necessary
 	bool needToRecalculateOctreeA = true;
@@ -329,14 +1276,16 @@ DistanceComputationTools::SOReturnCode
 			octreeACreated = true;
 		}
 
-		if (comparedOctree->build(minD,maxD,&minPoints,&maxPoints,progressCb) < 1)
+		int projectedCount = comparedOctree->build(minD,maxD,&minPoints,&maxPoints,progressCb);
+		if (projectedCount < 1)
 		{
 			if (octreeACreated)
 			{
 				delete comparedOctree;
 				comparedOctree = 0;
 			}
-			return OUT_OF_MEMORY;
+			//with a max distance, all the points may lie outside of the reduced bounding-box (i.e. farther than 'maxDist')
+			return (projectedCount == 0 && maxDist > 0 && !(progressCb && progressCb->isCancelRequested()) ? DISJOINT : OUT_OF_MEMORY);
 		}
 	}
 
@@ -369,7 +1318,8 @@ DistanceComputationTools::SOReturnCode
 			octreeBCreated = true;
 		}
 
-		if (referenceOctree->build(minD,maxD,&minPoints,&maxPoints,progressCb) < 1)
+		int projectedCount = referenceOctree->build(minD,maxD,&minPoints,&maxPoints,progressCb);
+		if (projectedCount < 1)
 		{
 			if (octreeACreated)
 			{
@@ -381,7 +1331,8 @@ DistanceComputationTools::SOReturnCode
 				delete referenceOctree;
 				referenceOctree = 0;
 			}
-			return OUT_OF_MEMORY;
+			//same as above
+			return (projectedCount == 0 && maxDist > 0 && !(progressCb && progressCb->isCancelRequested()) ? DISJOINT : OUT_OF_MEMORY);
 		}
 	}
 
@@ -435,9 +1386,10 @@ bool DistanceComputationTools::computeCellHausdorffDistance(const DgmOctree::oct
 				if (params->CPSet)
 					params->CPSet->setPointIndex(cell.points->getPointGlobalIndex(i),nNSS.theNearestPointIndex);
 			}
-			else
+			else if (params->CPSet)
 			{
-				assert(!params->CPSet);
+				//no point below the max search distance
+				params->CPSet->setPointIndex(cell.points->getPointGlobalIndex(i),static_cast<PointIndexType>(DgmOctree::INVALID_POINT_INDEX));
 			}
 		}
 		else
@@ -615,27 +1567,111 @@ bool DistanceComputationTools::computeCellHausdorffDistanceWithLocalModel(	const
 					}
 				}
 
-				//if we have a local model
-				if (lm)
-				{
-					ScalarType distToModel = lm->computeDistanceFromModelToPoint(&nNSS.queryPoint);
+				//if we have a local model
+				if (lm)
+				{
+					ScalarType distToModel = lm->computeDistanceFromModelToPoint(&nNSS.queryPoint);
+
+					//we take the best estimation between the nearest neighbor and the model!
+					//this way we only reduce any potential noise (that would be due to sampling)
+					//instead of 'adding' noise if the model is badly shaped
+					distPt = std::min(distToNearestPoint,distToModel);
+
+					if (!params->reuseExistingLocalModels)
+					{
+						//we don't need the local model anymore!
+						delete lm;
+						lm = 0;
+					}
+				}
+				else
+				{
+					distPt = distToNearestPoint;
+				}
+			}
+			else if (nNSS.maxSearchSquareDistd > 0)
+			{
+				distPt = static_cast<ScalarType>(sqrt(nNSS.maxSearchSquareDistd));
+			}
+
+			if (params->CPSet)
+			{
+				//no match if there's no point below the max search distance
+				PointIndexType nearestPointIndex = (squareDistToNearestPoint >= 0 ? nNSS.theNearestPointIndex : static_cast<PointIndexType>(DgmOctree::INVALID_POINT_INDEX));
+				params->CPSet->setPointIndex(cell.points->getPointGlobalIndex(i),nearestPointIndex);
+			}
+		}
+	
+		cell.points->setPointScalarValue(i,distPt);
+
+		if (nProgress && !nProgress->oneStep())
+			return false;
+	}
+
+	//clear all models for this cell
+	while (!models.empty())
+	{
+		delete models.back();
+		models.pop_back();
+	}
+
+	return true;
+}
+
+//Description of expected 'additionalParameters'
+// [0] -> (GenericIndexedCloudPersist*) reference cloud
+// [1] -> (Octree*): reference cloud octree
+// [2] -> (Cloud2CloudDistanceComputationParams*): parameters
+// [3] -> (ScalarType*): max search distance (squared)
+// [4] -> (LocalModelGrid*): precomputed local models
+bool DistanceComputationTools::computeCellHausdorffDistanceWithLocalModelGrid(	const DgmOctree::octreeCell& cell,
+																				void** additionalParameters,
+																				NormalizedProgress* nProgress/*=0*/)
+{
+	//additional parameters
+	GenericIndexedCloudPersist* referenceCloud		= reinterpret_cast<GenericIndexedCloudPersist*>(additionalParameters[0]);
+	const DgmOctree* referenceOctree				= reinterpret_cast<DgmOctree*>(additionalParameters[1]);
+	Cloud2CloudDistanceComputationParams* params	= reinterpret_cast<Cloud2CloudDistanceComputationParams*>(additionalParameters[2]);
+	const double* maxSearchSquareDistd				= reinterpret_cast<double*>(additionalParameters[3]);
+	const LocalModelGrid* modelGrid					= reinterpret_cast<LocalModelGrid*>(additionalParameters[4]);
+
+	assert(modelGrid);
 
-					//we take the best estimation between the nearest neighbor and the model!
-					//this way we only reduce any potential noise (that would be due to sampling)
-					//instead of 'adding' noise if the model is badly shaped
-					distPt = std::min(distToNearestPoint,distToModel);
+	//structure for the nearest neighbor seach
+	DgmOctree::NearestNeighboursSearchStruct nNSS;
+	nNSS.level								= cell.level;
+	nNSS.alreadyVisitedNeighbourhoodSize	= 0;
+	nNSS.theNearestPointIndex				= 0;
+	nNSS.maxSearchSquareDistd				= *maxSearchSquareDistd;
+	//we already compute the position of the 'equivalent' cell in the reference octree
+	referenceOctree->getCellPos(cell.truncatedCode,cell.level,nNSS.cellPos,true);
+	//and we deduce its center
+	referenceOctree->computeCellCenter(nNSS.cellPos,cell.level,nNSS.cellCenter);
 
-					if (!params->reuseExistingLocalModels)
-					{
-						//we don't need the local model anymore!
-						delete lm;
-						lm = 0;
-					}
-				}
-				else
-				{
-					distPt = distToNearestPoint;
-				}
+	//for each point of the current cell (compared octree) we look its nearest neighbour in the reference cloud
+	unsigned pointCount = cell.points->size();
+	for (unsigned i=0; i<pointCount; ++i)
+	{
+		//distance of the current point
+		ScalarType distPt = NAN_VALUE;
+
+		cell.points->getPoint(i,nNSS.queryPoint);
+		if (params->CPSet || referenceCloud->testVisibility(nNSS.queryPoint) == POINT_VISIBLE) //to build the closest point set up we must process the point whatever its visibility is!
+		{
+			//first, we look for the nearest point to "_queryPoint" in the reference cloud
+			double squareDistToNearestPoint = referenceOctree->findTheNearestNeighborStartingFromCell(nNSS);
+
+			//if it exists
+			if (squareDistToNearestPoint >= 0)
+			{
+				distPt = static_cast<ScalarType>(sqrt(squareDistToNearestPoint));
+
+				//we take the best estimation between the nearest neighbor and the model of the 'nearest point' (if any)
+				CCVector3 nearestPoint;
+				referenceCloud->getPoint(nNSS.theNearestPointIndex,nearestPoint);
+				ScalarType distToModel = 0;
+				if (modelGrid->computeDistance(nearestPoint,nNSS.queryPoint,distToModel))
+					distPt = std::min(distPt,distToModel);
 			}
 			else if (nNSS.maxSearchSquareDistd > 0)
 			{
@@ -643,22 +1679,19 @@ bool DistanceComputationTools::computeCellHausdorffDistanceWithLocalModel(	const
 			}
 
 			if (params->CPSet)
-				params->CPSet->setPointIndex(cell.points->getPointGlobalIndex(i),nNSS.theNearestPointIndex);
+			{
+				//no match if there's no point below the max search distance
+				PointIndexType nearestPointIndex = (squareDistToNearestPoint >= 0 ? nNSS.theNearestPointIndex : static_cast<PointIndexType>(DgmOctree::INVALID_POINT_INDEX));
+				params->CPSet->setPointIndex(cell.points->getPointGlobalIndex(i),nearestPointIndex);
+			}
 		}
-	
+
 		cell.points->setPointScalarValue(i,distPt);
 
 		if (nProgress && !nProgress->oneStep())
 			return false;
 	}
 
-	//clear all models for this cell
-	while (!models.empty())
-	{
-		delete models.back();
-		models.pop_back();
-	}
-
 	return true;
 }
 
@@ -915,6 +1948,38 @@ int DistanceComputationTools::intersectMeshWithOctree(	OctreeAndMeshIntersection
 	return result;
 }
 
+//! Points coordinates and distances stored in separate arrays (see ComparePointsAndTriangles)
+struct PointsAndDistancesArrays
+{
+	//! Points coordinates
+	std::vector<PointCoordinateType> x, y, z;
+	//! Current (min) distances
+	std::vector<ScalarType> minDists;
+	//! Distances to the current triangle
+	std::vector<ScalarType> triDists;
+
+	//! Resizes the arrays (if necessary)
+	bool resize(unsigned count)
+	{
+		if (x.size() < count)
+		{
+			try
+			{
+				x.resize(count);
+				y.resize(count);
+				z.resize(count);
+				minDists.resize(count);
+				triDists.resize(count);
+			}
+			catch (const std::bad_alloc&)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
 //! Method used by computeCloud2MeshDistanceWithOctree
 void ComparePointsAndTriangles(	ReferenceCloud& Yk,
 								unsigned& remainingPoints,
@@ -923,7 +1988,8 @@ void ComparePointsAndTriangles(	ReferenceCloud& Yk,
 								size_t& trianglesToTestCount,
 								std::vector<ScalarType>& minDists,
 								ScalarType maxRadius,
-								CCLib::DistanceComputationTools::Cloud2MeshDistanceComputationParams& params)
+								CCLib::DistanceComputationTools::Cloud2MeshDistanceComputationParams& params,
+								PointsAndDistancesArrays& arrays)
 {
 	assert(mesh);
 	assert(remainingPoints <= Yk.size());
@@ -931,10 +1997,60 @@ void ComparePointsAndTriangles(	ReferenceCloud& Yk,
 
 	bool firstComparisonDone = (trianglesToTestCount != 0);
 
+	//batched computation: all the points are compared to each triangle at once
+	//(not possible if we need the nearest points, or if we lack memory)
+	if (firstComparisonDone && remainingPoints != 0 && !params.CPSet && arrays.resize(remainingPoints))
+	{
+		for (unsigned j=0; j<remainingPoints; ++j)
+		{
+			const CCVector3* P = Yk.getPoint(j);
+			arrays.x[j] = P->x;
+			arrays.y[j] = P->y;
+			arrays.z[j] = P->z;
+			arrays.minDists[j] = Yk.getPointScalarValue(j);
+		}
+
+		//for each triangle
+		while (trianglesToTestCount != 0)
+		{
+			//we query the vertex coordinates
+			CCLib::SimpleTriangle tri;
+			mesh->getTriangleVertices(trianglesToTest[--trianglesToTestCount], tri.A, tri.B, tri.C);
+
+			//compute the distances (SQUARED if not signed) to the triangle
+			DistanceComputationTools::computePoints2TriangleDistances(&(arrays.x[0]), &(arrays.y[0]), &(arrays.z[0]), remainingPoints, &tri, params.signedDistances, &(arrays.triDists[0]));
+
+			//keep them if they are smaller
+			if (params.signedDistances)
+			{
+				for (unsigned j=0; j<remainingPoints; ++j)
+				{
+					ScalarType dPTri = arrays.triDists[j];
+					ScalarType min_d = arrays.minDists[j];
+					if (!ScalarField::ValidValue(min_d) || min_d*min_d > dPTri*dPTri)
+						arrays.minDists[j] = (params.flipNormals ? -dPTri : dPTri);
+				}
+			}
+			else
+			{
+				for (unsigned j=0; j<remainingPoints; ++j)
+				{
+					ScalarType dPTri = arrays.triDists[j];
+					ScalarType min_d = arrays.minDists[j];
+					if (!ScalarField::ValidValue(min_d) || dPTri < min_d)
+						arrays.minDists[j] = dPTri;
+				}
+			}
+		}
+
+		for (unsigned j=0; j<remainingPoints; ++j)
+			Yk.setPointScalarValue(j, arrays.minDists[j]);
+	}
+
 	CCVector3 nearestPoint;
 	CCVector3* _nearestPoint = params.CPSet ? &nearestPoint : 0;
 
-	//for each triangle
+	//otherwise, for each triangle (if any left)
 	while (trianglesToTestCount != 0)
 	{
 		//we query the vertex coordinates
@@ -1039,7 +2155,36 @@ static CCLib::DistanceComputationTools::Cloud2MeshDistanceComputationParams s_pa
 
 //'processTriangles' mechanism (based on bit mask)
 #include <QtCore/QBitArray>
-static std::vector<QBitArray*> s_bitArrayPool_MT;
+//! Per-thread triangles mask
+/** Only the bits set while processing a cell are reset afterwards (instead
+	of the whole mask) so that the cost doesn't depend on the mesh size.
+**/
+struct TrianglesMask_MT
+{
+	//! Bit mask (one bit per triangle)
+	QBitArray bits;
+	//! Triangles whose bit is currently set
+	std::vector<unsigned> marked;
+
+	//! Sets the bit of a given triangle (returns false if it was already set)
+	inline bool mark(unsigned indexTri)
+	{
+		if (bits.testBit(indexTri))
+			return false;
+		bits.setBit(indexTri);
+		marked.push_back(indexTri);
+		return true;
+	}
+
+	//! Resets all the marked bits
+	void reset()
+	{
+		for (size_t i=0; i<marked.size(); ++i)
+			bits.clearBit(marked[i]);
+		marked.clear();
+	}
+};
+static std::vector<TrianglesMask_MT*> s_bitArrayPool_MT;
 static bool s_useBitArrays_MT = true;
 static QMutex s_currentBitMaskMutex;
 
@@ -1126,17 +2271,17 @@ void cloudMeshDistCellFunc_MT(const DgmOctree::IndexAndCode& desc)
 	std::vector<unsigned> trianglesToTest;
 	size_t trianglesToTestCount = 0;
 	size_t trianglesToTestCapacity = 0;
+	PointsAndDistancesArrays arrays;
 
 	//bit mask for efficient comparisons
-	QBitArray* bitArray = 0;
+	TrianglesMask_MT* bitArray = 0;
 	if (s_useBitArrays_MT)
 	{
 		s_currentBitMaskMutex.lock();
 		if (s_bitArrayPool_MT.empty())
 		{
-			bitArray = new QBitArray();
-			bitArray->resize(s_intersection_MT->mesh->size());
-			//s_bitArrayPool_MT.push_back(bitArray);
+			bitArray = new TrianglesMask_MT;
+			bitArray->bits.resize(s_intersection_MT->mesh->size()); //all bits are initially cleared
 		}
 		else
 		{
@@ -1144,7 +2289,6 @@ void cloudMeshDistCellFunc_MT(const DgmOctree::IndexAndCode& desc)
 			s_bitArrayPool_MT.pop_back();
 		}
 		s_currentBitMaskMutex.unlock();
-		bitArray->fill(0);
 	}
 
 	//for each point, we pre-compute its distance to the nearest cell border
@@ -1208,10 +2352,9 @@ void cloudMeshDistCellFunc_MT(const DgmOctree::IndexAndCode& desc)
 								{
 									unsigned indexTri = triList->indexes[p];
 									//if the triangles has not been processed yet
-									if (!bitArray->testBit(indexTri))
+									if (bitArray->mark(indexTri))
 									{
 										trianglesToTest[trianglesToTestCount++] = indexTri;
-										bitArray->setBit(indexTri);
 									}
 								}
 								else
@@ -1241,12 +2384,11 @@ void cloudMeshDistCellFunc_MT(const DgmOctree::IndexAndCode& desc)
 							{
 								if (bitArray)
 								{
-									const unsigned& indexTri = triList->indexes[p];
+									unsigned indexTri = triList->indexes[p];
 									//if the triangles has not been processed yet
-									if (!bitArray->testBit(indexTri))
+									if (bitArray->mark(indexTri))
 									{
 										trianglesToTest[trianglesToTestCount++] = indexTri;
-										bitArray->setBit(indexTri);
 									}
 								}
 								else
@@ -1274,12 +2416,11 @@ void cloudMeshDistCellFunc_MT(const DgmOctree::IndexAndCode& desc)
 							{
 								if (bitArray)
 								{
-									const unsigned& indexTri = triList->indexes[p];
+									unsigned indexTri = triList->indexes[p];
 									//if the triangles has not been processed yet
-									if (!bitArray->testBit(indexTri))
+									if (bitArray->mark(indexTri))
 									{
 										trianglesToTest[trianglesToTestCount++] = indexTri;
-										bitArray->setBit(indexTri);
 									}
 								}
 								else
@@ -1293,12 +2434,13 @@ void cloudMeshDistCellFunc_MT(const DgmOctree::IndexAndCode& desc)
 			}
 		}
 
-		ComparePointsAndTriangles(Yk, remainingPoints, s_intersection_MT->mesh, trianglesToTest, trianglesToTestCount, minDists, maxRadius, s_params_MT);
+		ComparePointsAndTriangles(Yk, remainingPoints, s_intersection_MT->mesh, trianglesToTest, trianglesToTestCount, minDists, maxRadius, s_params_MT, arrays);
 	}
 
 	//release bit mask
 	if (bitArray)
 	{
+		bitArray->reset();
 		s_currentBitMaskMutex.lock();
 		s_bitArrayPool_MT.push_back(bitArray);
 		s_currentBitMaskMutex.unlock();
@@ -1313,7 +2455,6 @@ int DistanceComputationTools::computeCloud2MeshDistanceWithOctree(	OctreeAndMesh
 {
 	assert(intersection);
 	assert(!params.signedDistances || !intersection->distanceTransform); //signed distances are not compatible with Distance Transform acceleration
-	assert(!params.multiThread || params.maxSearchDist <= 0); //maxSearchDist is not compatible with parallel processing
 
 	DgmOctree* octree = intersection->octree;
 	if (!octree)
@@ -1326,7 +2467,6 @@ int DistanceComputationTools::computeCloud2MeshDistanceWithOctree(	OctreeAndMesh
 	//Closest Point Set
 	if (params.CPSet)
 	{
-		assert(params.maxSearchDist <= 0);
 		assert(params.useDistanceMap == false);
 
 		//reserve memory for the Closest Point Set
@@ -1414,6 +2554,7 @@ int DistanceComputationTools::computeCloud2MeshDistanceWithOctree(	OctreeAndMesh
 		std::vector<unsigned> trianglesToTest;
 		size_t trianglesToTestCount = 0;
 		size_t trianglesToTestCapacity = 0;
+		PointsAndDistancesArrays arrays;
 		const ScalarType normalSign = static_cast<ScalarType>(params.flipNormals ? -1.0 : 1.0);
 		unsigned numberOfTriangles = mesh->size();
 
@@ -1640,7 +2781,7 @@ int DistanceComputationTools::computeCloud2MeshDistanceWithOctree(	OctreeAndMesh
 					}
 				}
 
-				ComparePointsAndTriangles(Yk, remainingPoints, mesh, trianglesToTest, trianglesToTestCount, minDists, maxRadius, params);
+				ComparePointsAndTriangles(Yk, remainingPoints, mesh, trianglesToTest, trianglesToTestCount, minDists, maxRadius, params, arrays);
 			}
 
 			//Yk.clear(); //not necessary
@@ -1671,7 +2812,7 @@ int DistanceComputationTools::computeCloud2MeshDistanceWithOctree(	OctreeAndMesh
 			sprintf(buffer,"Cells=%u",numberOfCells);
 			progressCb->reset();
 			progressCb->setInfo(buffer);
-			progressCb->setMethodTitle("Compute signed distances");
+			progressCb->setMethodTitle(params.signedDistances ? "Compute signed distances" : "Compute distances");
 			progressCb->start();
 		}
 
@@ -1712,6 +2853,250 @@ inline void applySqrtToPointDist(const CCVector3 &aPoint, ScalarType& aScalarVal
 		aScalarValue = sqrt(aScalarValue);
 }
 
+//! 'No match' point of the cloud-to-mesh Closest Point Set (no triangle below maxSearchDist)
+static inline CCVector3 CPSetNoMatchPoint()
+{
+	PointCoordinateType nan = std::numeric_limits<PointCoordinateType>::quiet_NaN();
+	return CCVector3(nan, nan, nan);
+}
+
+//! Chunk of points processed by a single thread (BVH based cloud-to-mesh distances)
+struct BVHDistanceChunk
+{
+	//! Compared cloud
+	GenericIndexedCloudPersist* cloud;
+	//! Hierarchy built on the mesh
+	const MeshBVH* bvh;
+	//! Precomputed distance grid (optional)
+	const MeshDistanceGrid* grid;
+	//! Parameters
+	const DistanceComputationTools::Cloud2MeshDistanceComputationParams* params;
+	//! Points to process (spatial code + index)
+	const std::pair<unsigned, unsigned>* points;
+	//! Number of points
+	unsigned count;
+	//! Progress notification (per chunk)
+	NormalizedProgress* nProgress;
+	//! Whether the process has been cancelled (shared by all chunks)
+	Parallel::AtomicFlag* cancelled;
+};
+
+//! Number of points processed by a single thread in a row (BVH based cloud-to-mesh distances)
+static const unsigned BVH_POINTS_PER_CHUNK = 4096;
+
+//! Spreads the 10 lowest bits of an integer (one bit out of three)
+static inline unsigned SpreadBits10(unsigned x)
+{
+	x &= 0x000003ff;
+	x = (x | (x << 16)) & 0xff0000ff;
+	x = (x | (x << 8)) & 0x0300f00f;
+	x = (x | (x << 4)) & 0x030c30c3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+static void ComputeBVHDistancesChunk(BVHDistanceChunk& chunk)
+{
+	if (chunk.cancelled->isSet())
+		return;
+
+	const DistanceComputationTools::Cloud2MeshDistanceComputationParams& params = *chunk.params;
+	const bool boundedSearch = (params.maxSearchDist > 0);
+	const double maxSquareDist = (boundedSearch ? static_cast<double>(params.maxSearchDist) * params.maxSearchDist : 0);
+	const ScalarType normalSign = static_cast<ScalarType>(params.flipNormals ? -1.0 : 1.0);
+
+	CCVector3 nearestPoint;
+	CCVector3* _nearestPoint = params.CPSet ? &nearestPoint : 0;
+
+	for (unsigned j = 0; j < chunk.count; ++j)
+	{
+		unsigned i = chunk.points[j].second;
+		const CCVector3* P = chunk.cloud->getPointPersistentPtr(i);
+
+		double pointMaxSquareDist = maxSquareDist;
+		if (chunk.grid)
+		{
+			ScalarType gridDist = 0;
+			PointCoordinateType upperBound = 0;
+			bool signChange = false;
+			if (!chunk.grid->interpolateDistance(*P, gridDist, &upperBound, &signChange))
+			{
+				//the point is farther than the band width
+				if (boundedSearch && params.maxSearchDist <= chunk.grid->getBandWidth())
+				{
+					chunk.cloud->setPointScalarValue(i, params.maxSearchDist);
+					if (params.CPSet)
+						*const_cast<CCVector3*>(params.CPSet->getPoint(i)) = CPSetNoMatchPoint();
+					continue;
+				}
+			}
+			else if (!params.CPSet && fabs(gridDist) > chunk.grid->getExactBandWidth() && !(params.signedDistances && signChange))
+			{
+				//far from the mesh: we keep the interpolated distance
+				if (boundedSearch && fabs(gridDist) >= params.maxSearchDist)
+					chunk.cloud->setPointScalarValue(i, params.maxSearchDist);
+				else
+					chunk.cloud->setPointScalarValue(i, params.signedDistances ? normalSign * gridDist : static_cast<ScalarType>(fabs(gridDist)));
+				continue;
+			}
+			else
+			{
+				//close to the mesh (or unreliable sign): the bound (slightly enlarged to cope with round-off errors) speeds up the search
+				double bound = upperBound * (1.0 + 1.0e-5) + chunk.grid->getCellSize() * 1.0e-5;
+				if (!boundedSearch || bound * bound < maxSquareDist)
+					pointMaxSquareDist = bound * bound;
+			}
+		}
+
+		unsigned triIndex = 0;
+		double squareDist = 0;
+		CCVector3 V[3];
+		bool found = chunk.bvh->findNearestTriangle(*P, triIndex, squareDist, pointMaxSquareDist, V);
+		if (!found && pointMaxSquareDist != maxSquareDist)
+		{
+			//shouldn't happen (round-off issue?)
+			found = chunk.bvh->findNearestTriangle(*P, triIndex, squareDist, maxSquareDist, V);
+		}
+
+		if (found)
+		{
+			//the final distance is computed as with the octree based method
+			SimpleTriangle tri(V[0], V[1], V[2]);
+			ScalarType d = DistanceComputationTools::computePoint2TriangleDistance(P, &tri, params.signedDistances, _nearestPoint);
+			chunk.cloud->setPointScalarValue(i, params.signedDistances ? normalSign * d : sqrt(d));
+			if (params.CPSet)
+			{
+				//Closest Point Set: save the nearest point as well
+				*const_cast<CCVector3*>(params.CPSet->getPoint(i)) = nearestPoint;
+			}
+		}
+		else
+		{
+			//no triangle below maxSearchDist
+			assert(boundedSearch);
+			chunk.cloud->setPointScalarValue(i, params.maxSearchDist);
+			if (params.CPSet)
+				*const_cast<CCVector3*>(params.CPSet->getPoint(i)) = CPSetNoMatchPoint();
+		}
+	}
+
+	if (chunk.nProgress && !chunk.nProgress->oneStep())
+	{
+		//process cancelled by the user
+		chunk.cancelled->set();
+	}
+}
+
+int DistanceComputationTools::computeCloud2MeshDistanceWithBVH(	GenericIndexedCloudPersist* pointCloud,
+																GenericIndexedMesh* mesh,
+																Cloud2MeshDistanceComputationParams& params,
+																GenericProgressCallback* progressCb/*=0*/)
+{
+	assert(pointCloud && mesh);
+	assert(!params.useDistanceMap);
+
+	unsigned pointCount = pointCloud->size();
+
+	//Closest Point Set
+	if (params.CPSet)
+	{
+		//reserve memory for the Closest Point Set
+		if (!params.CPSet->resize(pointCount))
+		{
+			//not enough memory
+			return -1;
+		}
+	}
+
+	//we use the hierarchy of the distance grid if any
+	MeshBVH localBVH;
+	const MeshBVH* bvh = &localBVH;
+	if (params.distanceGrid)
+	{
+		bvh = &params.distanceGrid->getBVH();
+	}
+	else if (!localBVH.buildFromMesh(mesh, progressCb))
+	{
+		//not enough memory (or process cancelled by the user)
+		return -1;
+	}
+
+	std::vector<BVHDistanceChunk> chunks;
+	std::vector< std::pair<unsigned, unsigned> > points;
+	try
+	{
+		chunks.resize((pointCount + BVH_POINTS_PER_CHUNK - 1) / BVH_POINTS_PER_CHUNK);
+		points.resize(pointCount);
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return -1;
+	}
+
+	//the points are processed in Morton order (so that consecutive queries visit the same nodes)
+	{
+		CCVector3 bbMin, bbMax;
+		pointCloud->getBoundingBox(bbMin, bbMax);
+		CCVector3 diag = bbMax - bbMin;
+		PointCoordinateType maxDim = std::max(diag.x, std::max(diag.y, diag.z));
+		PointCoordinateType scale = (maxDim > 0 ? static_cast<PointCoordinateType>(1023) / maxDim : 0);
+		for (unsigned i = 0; i < pointCount; ++i)
+		{
+			CCVector3 P = (*pointCloud->getPointPersistentPtr(i) - bbMin) * scale;
+			points[i].first =			SpreadBits10(static_cast<unsigned>(P.x))
+								|	(	SpreadBits10(static_cast<unsigned>(P.y)) << 1)
+								|	(	SpreadBits10(static_cast<unsigned>(P.z)) << 2);
+			points[i].second = i;
+		}
+		std::sort(points.begin(), points.end());
+	}
+
+	//reset the output distances
+	pointCloud->enableScalarField();
+	pointCloud->forEach(ScalarFieldTools::SetScalarValueToNaN);
+
+	//Progress callback
+	NormalizedProgress nProgress(progressCb, static_cast<unsigned>(chunks.size()));
+	if (progressCb)
+	{
+		char buffer[256];
+		sprintf(buffer, "Points: %u\nTriangles: %u", pointCount, mesh->size());
+		progressCb->reset();
+		progressCb->setInfo(buffer);
+		progressCb->setMethodTitle(params.signedDistances ? "Compute signed distances" : "Compute distances");
+		progressCb->start();
+	}
+
+	Parallel::AtomicFlag cancelled;
+	for (size_t k = 0; k < chunks.size(); ++k)
+	{
+		BVHDistanceChunk& chunk = chunks[k];
+		chunk.cloud = pointCloud;
+		chunk.bvh = bvh;
+		chunk.grid = params.distanceGrid;
+		chunk.params = &params;
+		unsigned first = static_cast<unsigned>(k) * BVH_POINTS_PER_CHUNK;
+		chunk.points = &(points[first]);
+		chunk.count = std::min(BVH_POINTS_PER_CHUNK, pointCount - first);
+		chunk.nProgress = (progressCb ? &nProgress : 0);
+		chunk.cancelled = &cancelled;
+	}
+
+#ifdef ENABLE_CLOUD2MESH_DIST_MT
+	if (params.multiThread && chunks.size() > 1)
+	{
+		QtConcurrent::blockingMap(chunks, ComputeBVHDistancesChunk);
+	}
+	else
+#endif
+	{
+		for (size_t k = 0; k < chunks.size(); ++k)
+			ComputeBVHDistancesChunk(chunks[k]);
+	}
+
+	return (cancelled.isSet() ? -2 : 0);
+}
+
 int DistanceComputationTools::computeCloud2MeshDistance(	GenericIndexedCloudPersist* pointCloud,
 															GenericIndexedMesh* mesh,
 															Cloud2MeshDistanceComputationParams& params,
@@ -1732,9 +3117,19 @@ int DistanceComputationTools::computeCloud2MeshDistance(	GenericIndexedCloudPers
 	}
 	if (params.CPSet)
 	{
-		//Closest Point Set determination is incompatible with distance map approximation and max seach distance
+		//Closest Point Set determination is incompatible with distance map approximation
 		params.useDistanceMap = false;
-		params.maxSearchDist = 0;
+	}
+	if (params.distanceGrid && !params.distanceGrid->isCompatibleWith(mesh))
+	{
+		//the grid has been built on another mesh
+		return -2;
+	}
+	if (params.useBVH || params.distanceGrid)
+	{
+		//exact distances (the BVH replaces the grid)
+		params.useDistanceMap = false;
+		return computeCloud2MeshDistanceWithBVH(pointCloud, mesh, params, progressCb);
 	}
 
 	//compute the (cubical) bounding box that contains both the cloud and the mehs BBs
@@ -1855,6 +3250,19 @@ int DistanceComputationTools::computeCloud2MeshDistance(	GenericIndexedCloudPers
 		pointCloud->forEach(applySqrtToPointDist);
 	}
 
+	//Closest Point Set: the points without any triangle below maxSearchDist keep the
+	//maxSearchDist value (and a stale nearest point), so we flag them as 'no match'
+	if (result == 0 && params.CPSet && params.maxSearchDist > 0)
+	{
+		unsigned pointCount = pointCloud->size();
+		for (unsigned i = 0; i < pointCount; ++i)
+		{
+			ScalarType d = pointCloud->getPointScalarValue(i);
+			if (!ScalarField::ValidValue(d) || fabs(d) >= params.maxSearchDist)
+				*const_cast<CCVector3*>(params.CPSet->getPoint(i)) = CPSetNoMatchPoint();
+		}
+	}
+
 	if (result < 0)
 	{
         return -7;
@@ -2100,6 +3508,35 @@ ScalarType DistanceComputationTools::computePoint2PlaneDistance(const CCVector3*
 	return static_cast<ScalarType>((CCVector3::vdot(P->u,planeEquation) - planeEquation[3])/*/CCVector3::vnorm(planeEquation)*/); //norm == 1.0!
 }
 
+//! Distances between consecutive points of a cloud and a plane (see computePoints2PlaneDistances)
+struct CloudToPlaneDistancesChunk
+{
+	//! Max number of points per chunk
+	static const unsigned MAX_SIZE = 256;
+
+	//! Points coordinates
+	PointCoordinateType x[MAX_SIZE], y[MAX_SIZE], z[MAX_SIZE];
+	//! Signed distances to the plane
+	ScalarType dists[MAX_SIZE];
+
+	//! Reads the next points of the cloud (with its global iterator) and computes their distance to the plane
+	/** \return the number of points of the chunk
+	**/
+	unsigned readNext(GenericCloud* cloud, unsigned remainingPoints, const PointCoordinateType* planeEquation)
+	{
+		unsigned count = (remainingPoints < MAX_SIZE ? remainingPoints : MAX_SIZE);
+		for (unsigned i=0; i<count; ++i)
+		{
+			const CCVector3* P = cloud->getNextPoint();
+			x[i] = P->x;
+			y[i] = P->y;
+			z[i] = P->z;
+		}
+		DistanceComputationTools::computePoints2PlaneDistances(x, y, z, count, planeEquation, dists);
+		return count;
+	}
+};
+
 ScalarType DistanceComputationTools::computeCloud2PlaneDistanceRMS(	GenericCloud* cloud,
 																	const PointCoordinateType* planeEquation)
 {
@@ -2120,13 +3557,17 @@ ScalarType DistanceComputationTools::computeCloud2PlaneDistanceRMS(	GenericCloud
 	double dSumSq = 0.0;
 
 	//compute deviations
+	CloudToPlaneDistancesChunk chunk;
 	cloud->placeIteratorAtBegining();
-	for (unsigned i=0; i<count; ++i)
+	for (unsigned i=0; i<count; )
 	{
-		const CCVector3* P = cloud->getNextPoint();
-		double d = static_cast<double>(CCVector3::vdot(P->u,planeEquation) - planeEquation[3])/*/norm*/; //norm == 1.0
-		
-		dSumSq += d*d;
+		unsigned chunkSize = chunk.readNext(cloud, count-i, planeEquation);
+		for (unsigned j=0; j<chunkSize; ++j)
+		{
+			double d = static_cast<double>(chunk.dists[j]);
+			dSumSq += d*d;
+		}
+		i += chunkSize;
 	}
 
 	return static_cast<ScalarType>( sqrt(dSumSq/count) );
@@ -2152,42 +3593,38 @@ ScalarType DistanceComputationTools::ComputeCloud2PlaneRobustMax(	GenericCloud*
 	assert(fabs(sqrt(norm2) - PC_ONE) <= std::numeric_limits<PointCoordinateType>::epsilon());
 
 	//we search the max @ 'percent'% (to avoid outliers)
-	std::vector<PointCoordinateType> tail;
 	size_t tailSize = static_cast<size_t>(ceil(static_cast<float>(count) * percent));
-	tail.resize(tailSize);
+	if (tailSize == 0)
+		return ComputeCloud2PlaneMaxDistance(cloud, planeEquation);
+	assert(tailSize <= count);
+
+	std::vector<PointCoordinateType> dists;
+	try
+	{
+		dists.resize(count);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return NAN_VALUE;
+	}
 
 	//compute deviations
+	CloudToPlaneDistancesChunk chunk;
 	cloud->placeIteratorAtBegining();
-	size_t pos = 0;
-	for (unsigned i=0; i<count; ++i)
+	for (unsigned i=0; i<count; )
 	{
-		const CCVector3* P = cloud->getNextPoint();
-		PointCoordinateType d = fabs(CCVector3::vdot(P->u,planeEquation) - planeEquation[3])/*/norm*/; //norm == 1.0
-
-		if (pos < tailSize)
-		{
-			tail[pos++] = d;
-		}
-		else if (tail.back() < d)
-		{
-			tail.back() = d;
-		}
-
-		//search the max element of the tail
-		size_t maxPos = pos-1;
-		if (maxPos != 0)
-		{
-			size_t maxIndex = maxPos;
-			for (size_t j=0; j<maxPos; ++j)
-				if (tail[j] < tail[maxIndex])
-					maxIndex = j;
-			//and put it to the back!
-			if (maxPos != maxIndex)
-				std::swap(tail[maxIndex],tail[maxPos]);
-		}
+		unsigned chunkSize = chunk.readNext(cloud, count-i, planeEquation);
+		for (unsigned j=0; j<chunkSize; ++j)
+			dists[i+j] = fabs(chunk.dists[j]);
+		i += chunkSize;
 	}
 
-	return static_cast<ScalarType>(tail.back());
+	//the max @ 'percent'% is the smallest of the 'tailSize' greatest deviations
+	std::vector<PointCoordinateType>::iterator nth = dists.begin() + (count - tailSize);
+	std::nth_element(dists.begin(), nth, dists.end());
+
+	return static_cast<ScalarType>(*nth);
 }
 
 ScalarType DistanceComputationTools::ComputeCloud2PlaneMaxDistance(	GenericCloud* cloud,
@@ -2210,12 +3647,14 @@ ScalarType DistanceComputationTools::ComputeCloud2PlaneMaxDistance(	GenericCloud
 	//we search the max distance
 	PointCoordinateType maxDist = 0;
 	
+	CloudToPlaneDistancesChunk chunk;
 	cloud->placeIteratorAtBegining();
-	for (unsigned i=0; i<count; ++i)
+	for (unsigned i=0; i<count; )
 	{
-		const CCVector3* P = cloud->getNextPoint();
-		PointCoordinateType d = fabs(CCVector3::vdot(P->u,planeEquation) - planeEquation[3])/*/norm*/; //norm == 1.0
-		maxDist = std::max(d,maxDist);
+		unsigned chunkSize = chunk.readNext(cloud, count-i, planeEquation);
+		for (unsigned j=0; j<chunkSize; ++j)
+			maxDist = std::max(static_cast<PointCoordinateType>(fabs(chunk.dists[j])),maxDist);
+		i += chunkSize;
 	}
 
 	return static_cast<ScalarType>(maxDist);
@@ -0,0 +1,559 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "FlatKdTree.h"
+
+//local
+#include "GenericIndexedCloud.h"
+#include "GenericProgressCallback.h"
+
+//system
+#include <assert.h>
+#include <stdio.h>
+
+#ifdef USE_QT
+#include <QtCore>
+#include <QtConcurrentMap>
+#endif
+
+using namespace CCLib;
+
+//! Max depth of the traversal stack (the tree depth is at most 32)
+static const unsigned MAX_STACK_DEPTH = 64;
+
+//! Number of queries processed by a single thread in a row (batched queries)
+static const unsigned QUERIES_PER_CHUNK = 4096;
+
+FlatKDTree::FlatKDTree()
+	: m_firstLeaf(0)
+	, m_associatedCloud(0)
+{
+}
+
+FlatKDTree::~FlatKDTree()
+{
+}
+
+void FlatKDTree::clear()
+{
+	m_points.clear();
+	m_indexes.clear();
+	m_nodeMin.clear();
+	m_nodeMax.clear();
+	m_leafStart.clear();
+	m_firstLeaf = 0;
+	m_associatedCloud = 0;
+}
+
+//! Point (with its index) used during the tree build
+struct kdBuildPoint
+{
+	CCVector3 P;
+	unsigned index;
+};
+
+//! Compares two points along a given dimension
+struct kdBuildPointComparator
+{
+	explicit kdBuildPointComparator(unsigned char dim) : m_dim(dim) {}
+	inline bool operator()(const kdBuildPoint& a, const kdBuildPoint& b) const { return a.P.u[m_dim] < b.P.u[m_dim]; }
+	unsigned char m_dim;
+};
+
+//! Computes the (tight) bounding-box of a range of points
+static void ComputeRangeBB(const kdBuildPoint* points, unsigned count, CCVector3& bbMin, CCVector3& bbMax)
+{
+	assert(count != 0);
+	bbMin = bbMax = points[0].P;
+	for (unsigned i=1; i<count; ++i)
+	{
+		const CCVector3& P = points[i].P;
+		for (unsigned char dim=0; dim<3; ++dim)
+		{
+			if (P.u[dim] < bbMin.u[dim])
+				bbMin.u[dim] = P.u[dim];
+			else if (P.u[dim] > bbMax.u[dim])
+				bbMax.u[dim] = P.u[dim];
+		}
+	}
+}
+
+bool FlatKDTree::buildFromCloud(GenericIndexedCloud* cloud, GenericProgressCallback* progressCb)
+{
+	clear();
+
+	if (!cloud)
+		return false;
+	unsigned cloudSize = cloud->size();
+	if (cloudSize == 0)
+		return false;
+
+	//tree depth: smallest depth so that leaves contain at most MAX_LEAF_SIZE points
+	//(as splits are made at the median, leaves then contain at least MAX_LEAF_SIZE/2 points)
+	unsigned depth = 0;
+	while (depth < 31 && ((cloudSize - 1) >> depth) + 1 > MAX_LEAF_SIZE)
+		++depth;
+	unsigned leafCount = (1u << depth);
+	unsigned nodeCount = 2*leafCount - 1;
+	m_firstLeaf = leafCount - 1;
+
+	std::vector<kdBuildPoint> buildPoints;
+	std::vector<unsigned> nodeBegin;
+	try
+	{
+		buildPoints.resize(cloudSize);
+		nodeBegin.resize(nodeCount);
+		m_nodeMin.resize(nodeCount);
+		m_nodeMax.resize(nodeCount);
+		m_leafStart.resize(leafCount+1);
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		clear();
+		return false;
+	}
+
+	for (unsigned i=0; i<cloudSize; ++i)
+	{
+		cloud->getPoint(i,buildPoints[i].P);
+		buildPoints[i].index = i;
+	}
+
+	if (progressCb)
+	{
+		progressCb->reset();
+		progressCb->setMethodTitle("Kd-tree computation");
+		char buffer[256];
+		sprintf(buffer,"Points: %u",cloudSize);
+		progressCb->setInfo(buffer);
+		progressCb->start();
+	}
+	NormalizedProgress nprogress(progressCb,m_firstLeaf);
+
+	//nodes are processed in the array order (i.e. level by level)
+	//'nodeBegin[i]' is the first point of node 'i' (the range ends at the beginning of the next node on the same level)
+	nodeBegin[0] = 0;
+	for (unsigned node=0; node<nodeCount; ++node)
+	{
+		unsigned begin = nodeBegin[node];
+		//the last node of each level (i.e. node = 2^(level+1)-2) ends with the cloud
+		unsigned end = ((node & (node+2)) == 0 ? cloudSize : nodeBegin[node+1]);
+		assert(end > begin);
+
+		ComputeRangeBB(&buildPoints[begin], end-begin, m_nodeMin[node], m_nodeMax[node]);
+
+		if (node < m_firstLeaf)
+		{
+			//we split the node along its largest dimension
+			CCVector3 diag = m_nodeMax[node] - m_nodeMin[node];
+			unsigned char splitDim = (diag.x >= diag.y ? (diag.x >= diag.z ? 0 : 2) : (diag.y >= diag.z ? 1 : 2));
+			unsigned mid = (begin + end) / 2;
+			std::nth_element(	buildPoints.begin()+begin,
+								buildPoints.begin()+mid,
+								buildPoints.begin()+end,
+								kdBuildPointComparator(splitDim) );
+
+			nodeBegin[2*node+1] = begin;
+			nodeBegin[2*node+2] = mid;
+
+			if (progressCb && !nprogress.oneStep())
+			{
+				//process cancelled by user
+				clear();
+				return false;
+			}
+		}
+		else
+		{
+			m_leafStart[node-m_firstLeaf] = begin;
+		}
+	}
+	m_leafStart[leafCount] = cloudSize;
+
+	try
+	{
+		m_points.resize(cloudSize);
+		m_indexes.resize(cloudSize);
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		clear();
+		return false;
+	}
+
+	for (unsigned i=0; i<cloudSize; ++i)
+	{
+		m_points[i] = buildPoints[i].P;
+		m_indexes[i] = buildPoints[i].index;
+	}
+
+	m_associatedCloud = cloud;
+
+	return true;
+}
+
+void FlatKDTree::getNodePointsRange(unsigned node, unsigned& first, unsigned& last) const
+{
+	unsigned leftLeaf = node;
+	unsigned rightLeaf = node;
+	while (leftLeaf < m_firstLeaf)
+	{
+		leftLeaf = 2*leftLeaf+1;
+		rightLeaf = 2*rightLeaf+2;
+	}
+	first = m_leafStart[leftLeaf-m_firstLeaf];
+	last = m_leafStart[rightLeaf-m_firstLeaf+1];
+}
+
+//! Traversal stack element
+struct kdStackItem
+{
+	//! Node index
+	unsigned node;
+	//! Min. square distance between the query point and the node
+	PointCoordinateType sqrDist;
+};
+
+bool FlatKDTree::findNearestNeighbour(	const PointCoordinateType* queryPoint,
+										unsigned& nearestPointIndex,
+										ScalarType maxDist) const
+{
+	if (m_points.empty())
+		return false;
+
+	PointCoordinateType bestSqrDist = static_cast<PointCoordinateType>(maxDist) * static_cast<PointCoordinateType>(maxDist);
+	unsigned bestPos = INVALID_INDEX;
+
+	kdStackItem stack[MAX_STACK_DEPTH];
+	unsigned stackSize = 0;
+	stack[stackSize].node = 0;
+	stack[stackSize].sqrDist = pointToNodeSquareDistance(queryPoint,0);
+	++stackSize;
+
+	while (stackSize != 0)
+	{
+		kdStackItem item = stack[--stackSize];
+		if (item.sqrDist >= bestSqrDist)
+			continue;
+
+		unsigned node = item.node;
+		if (node >= m_firstLeaf)
+		{
+			unsigned leaf = node - m_firstLeaf;
+			for (unsigned i=m_leafStart[leaf]; i<m_leafStart[leaf+1]; ++i)
+			{
+				PointCoordinateType sqrDist = CCVector3::vdistance2(m_points[i].u, queryPoint);
+				if (sqrDist < bestSqrDist)
+				{
+					bestSqrDist = sqrDist;
+					bestPos = i;
+				}
+			}
+		}
+		else
+		{
+			//we push the farthest son first so that the nearest one is processed first
+			unsigned leSon = 2*node+1;
+			unsigned gSon = leSon+1;
+			PointCoordinateType leDist = pointToNodeSquareDistance(queryPoint,leSon);
+			PointCoordinateType gDist = pointToNodeSquareDistance(queryPoint,gSon);
+			if (leDist < gDist)
+			{
+				std::swap(leSon,gSon);
+				std::swap(leDist,gDist);
+			}
+			assert(stackSize+2 <= MAX_STACK_DEPTH);
+			if (leDist < bestSqrDist)
+			{
+				stack[stackSize].node = leSon;
+				stack[stackSize].sqrDist = leDist;
+				++stackSize;
+			}
+			if (gDist < bestSqrDist)
+			{
+				stack[stackSize].node = gSon;
+				stack[stackSize].sqrDist = gDist;
+				++stackSize;
+			}
+		}
+	}
+
+	if (bestPos == INVALID_INDEX)
+		return false;
+
+	nearestPointIndex = m_indexes[bestPos];
+	return true;
+}
+
+bool FlatKDTree::findPointBelowDistance(const PointCoordinateType* queryPoint,
+										ScalarType maxDist) const
+{
+	if (m_points.empty())
+		return false;
+
+	PointCoordinateType maxSqrDist = static_cast<PointCoordinateType>(maxDist) * static_cast<PointCoordinateType>(maxDist);
+
+	unsigned stack[MAX_STACK_DEPTH];
+	unsigned stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize != 0)
+	{
+		unsigned node = stack[--stackSize];
+		if (pointToNodeSquareDistance(queryPoint,node) >= maxSqrDist)
+			continue;
+		//all the points of the node are close enough
+		if (pointToNodeMaxSquareDistance(queryPoint,node) < maxSqrDist)
+			return true;
+
+		if (node >= m_firstLeaf)
+		{
+			unsigned leaf = node - m_firstLeaf;
+			for (unsigned i=m_leafStart[leaf]; i<m_leafStart[leaf+1]; ++i)
+				if (CCVector3::vdistance2(m_points[i].u, queryPoint) < maxSqrDist)
+					return true;
+		}
+		else
+		{
+			//the son on the same side as the query point is processed first
+			unsigned leSon = 2*node+1;
+			unsigned gSon = leSon+1;
+			assert(stackSize+2 <= MAX_STACK_DEPTH);
+			if (pointToNodeSquareDistance(queryPoint,leSon) <= pointToNodeSquareDistance(queryPoint,gSon))
+			{
+				stack[stackSize++] = gSon;
+				stack[stackSize++] = leSon;
+			}
+			else
+			{
+				stack[stackSize++] = leSon;
+				stack[stackSize++] = gSon;
+			}
+		}
+	}
+
+	return false;
+}
+
+unsigned FlatKDTree::findPointsLyingToDistance(	const PointCoordinateType* queryPoint,
+												ScalarType distance,
+												ScalarType tolerance,
+												std::vector<unsigned>& points) const
+{
+	if (m_points.empty())
+		return 0;
+
+	PointCoordinateType minDist = static_cast<PointCoordinateType>(distance - tolerance);
+	PointCoordinateType maxDist = static_cast<PointCoordinateType>(distance + tolerance);
+	if (maxDist < 0)
+		return 0;
+	//if minDist is negative, all the points below maxDist are valid
+	PointCoordinateType minSqrDist = (minDist > 0 ? minDist*minDist : 0);
+	PointCoordinateType maxSqrDist = maxDist*maxDist;
+
+	unsigned count = 0;
+	unsigned stack[MAX_STACK_DEPTH];
+	unsigned stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize != 0)
+	{
+		unsigned node = stack[--stackSize];
+
+		PointCoordinateType nodeMinSqrDist = pointToNodeSquareDistance(queryPoint,node);
+		if (nodeMinSqrDist > maxSqrDist)
+			continue;
+		PointCoordinateType nodeMaxSqrDist = pointToNodeMaxSquareDistance(queryPoint,node);
+		if (nodeMaxSqrDist < minSqrDist)
+			continue;
+
+		if (nodeMinSqrDist >= minSqrDist && nodeMaxSqrDist <= maxSqrDist)
+		{
+			//the whole node lies inside the shell
+			unsigned first = 0, last = 0;
+			getNodePointsRange(node,first,last);
+			points.insert(points.end(), m_indexes.begin()+first, m_indexes.begin()+last);
+			count += last-first;
+		}
+		else if (node >= m_firstLeaf)
+		{
+			unsigned leaf = node - m_firstLeaf;
+			for (unsigned i=m_leafStart[leaf]; i<m_leafStart[leaf+1]; ++i)
+			{
+				PointCoordinateType sqrDist = CCVector3::vdistance2(m_points[i].u, queryPoint);
+				if (sqrDist >= minSqrDist && sqrDist <= maxSqrDist)
+				{
+					points.push_back(m_indexes[i]);
+					++count;
+				}
+			}
+		}
+		else
+		{
+			assert(stackSize+2 <= MAX_STACK_DEPTH);
+			stack[stackSize++] = 2*node+2;
+			stack[stackSize++] = 2*node+1;
+		}
+	}
+
+	return count;
+}
+
+/*** BATCHED QUERIES ***/
+
+//! Chunk of queries processed by a single thread
+struct kdQueryChunk
+{
+	//! Associated tree
+	const FlatKDTree* tree;
+	//! Query points
+	const CCVector3* queryPoints;
+	//! Number of query points
+	unsigned count;
+	//! Max distance
+	ScalarType maxDist;
+	//! Nearest point indexes (output - for nearest neighbour queries only)
+	unsigned* nearestPointIndexes;
+	//! Number of query points with a neighbour below maxDist (output)
+	unsigned matchCount;
+};
+
+static void CountPointsBelowDistanceChunk(kdQueryChunk& chunk)
+{
+	chunk.matchCount = 0;
+	for (unsigned i=0; i<chunk.count; ++i)
+		if (chunk.tree->findPointBelowDistance(chunk.queryPoints[i].u, chunk.maxDist))
+			++chunk.matchCount;
+}
+
+static void FindNearestNeighboursChunk(kdQueryChunk& chunk)
+{
+	chunk.matchCount = 0;
+	for (unsigned i=0; i<chunk.count; ++i)
+	{
+		if (chunk.tree->findNearestNeighbour(chunk.queryPoints[i].u, chunk.nearestPointIndexes[i], chunk.maxDist))
+			++chunk.matchCount;
+		else
+			chunk.nearestPointIndexes[i] = FlatKDTree::INVALID_INDEX;
+	}
+}
+
+//! Splits a set of queries in chunks
+static bool PrepareQueryChunks(	const FlatKDTree* tree,
+								const CCVector3* queryPoints,
+								unsigned count,
+								ScalarType maxDist,
+								unsigned* nearestPointIndexes,
+								std::vector<kdQueryChunk>& chunks)
+{
+	try
+	{
+		chunks.resize((count + QUERIES_PER_CHUNK - 1) / QUERIES_PER_CHUNK);
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return false;
+	}
+
+	for (size_t k=0; k<chunks.size(); ++k)
+	{
+		kdQueryChunk& chunk = chunks[k];
+		unsigned offset = static_cast<unsigned>(k) * QUERIES_PER_CHUNK;
+		chunk.tree = tree;
+		chunk.queryPoints = queryPoints + offset;
+		chunk.count = std::min(QUERIES_PER_CHUNK, count - offset);
+		chunk.maxDist = maxDist;
+		chunk.nearestPointIndexes = (nearestPointIndexes ? nearestPointIndexes + offset : 0);
+		chunk.matchCount = 0;
+	}
+
+	return true;
+}
+
+unsigned FlatKDTree::countPointsBelowDistance(	const CCVector3* queryPoints,
+												unsigned count,
+												ScalarType maxDist) const
+{
+	if (m_points.empty() || count == 0)
+		return 0;
+
+	std::vector<kdQueryChunk> chunks;
+	if (!PrepareQueryChunks(this, queryPoints, count, maxDist, 0, chunks))
+	{
+		//not enough memory: we process the queries in a single chunk
+		kdQueryChunk chunk;
+		chunk.tree = this;
+		chunk.queryPoints = queryPoints;
+		chunk.count = count;
+		chunk.maxDist = maxDist;
+		chunk.nearestPointIndexes = 0;
+		CountPointsBelowDistanceChunk(chunk);
+		return chunk.matchCount;
+	}
+
+#ifdef USE_QT
+	if (chunks.size() > 1)
+		QtConcurrent::blockingMap(chunks, CountPointsBelowDistanceChunk);
+	else
+#endif
+	for (size_t k=0; k<chunks.size(); ++k)
+		CountPointsBelowDistanceChunk(chunks[k]);
+
+	unsigned matchCount = 0;
+	for (size_t k=0; k<chunks.size(); ++k)
+		matchCount += chunks[k].matchCount;
+
+	return matchCount;
+}
+
+bool FlatKDTree::findNearestNeighbours(	const CCVector3* queryPoints,
+										unsigned count,
+										ScalarType maxDist,
+										std::vector<unsigned>& nearestPointIndexes) const
+{
+	try
+	{
+		nearestPointIndexes.resize(count);
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return false;
+	}
+
+	if (count == 0)
+		return true;
+
+	if (m_points.empty())
+	{
+		std::fill(nearestPointIndexes.begin(), nearestPointIndexes.end(), static_cast<unsigned>(INVALID_INDEX));
+		return true;
+	}
+
+	std::vector<kdQueryChunk> chunks;
+	if (!PrepareQueryChunks(this, queryPoints, count, maxDist, &(nearestPointIndexes[0]), chunks))
+		return false;
+
+#ifdef USE_QT
+	if (chunks.size() > 1)
+		QtConcurrent::blockingMap(chunks, FindNearestNeighboursChunk);
+	else
+#endif
+	for (size_t k=0; k<chunks.size(); ++k)
+		FindNearestNeighboursChunk(chunks[k]);
+
+	return true;
+}
@@ -20,6 +20,7 @@
 //local
 #include "GenericIndexedCloudPersist.h"
 #include "Neighbourhood.h"
+#include "NeighbourhoodCache.h"
 #include "ReferenceCloud.h"
 #include "GenericProgressCallback.h"
 #include "GenericCloud.h"
@@ -30,6 +31,14 @@
 
 //system
 #include <assert.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+#ifdef USE_QT
+#include <QtCore>
+#include <QtConcurrentMap>
+#endif
 
 using namespace CCLib;
 
@@ -96,61 +105,48 @@ bool GeometricalAnalysisTools::computeCellCurvatureAtLevel(	const DgmOctree::oct
 	Neighbourhood::CC_CURVATURE_TYPE cType	= *static_cast<Neighbourhood::CC_CURVATURE_TYPE*>(additionalParameters[0]);
 	PointCoordinateType radius				= *static_cast<PointCoordinateType*>(additionalParameters[1]);
 
-	//structure for nearest neighbors search
-	DgmOctree::NearestNeighboursSphericalSearchStruct nNSS;
-	nNSS.level = cell.level;
-	nNSS.prepare(radius,cell.parentOctree->getCellSize(nNSS.level));
-	cell.parentOctree->getCellPos(cell.truncatedCode,cell.level,nNSS.cellPos,true);
-	cell.parentOctree->computeCellCenter(nNSS.cellPos,cell.level,nNSS.cellCenter);
-
 	unsigned n = cell.points->size(); //number of points in the current cell
 
-	//we already know some of the neighbours: the points in the current cell!
+	//we extract the neighbourhoods of all the cell points at once
+	DgmOctree::NeighboursBatch batch;
+	DgmOctree::NeighboursSet neighbours;
+	try
 	{
-		try
-		{
-			nNSS.pointsInNeighbourhood.resize(n);
-		}
-		catch (.../*const std::bad_alloc&*/) //out of memory
-		{
-			return false;
-		}
+		std::vector<CCVector3> queryPoints(n);
+		for (unsigned i=0; i<n; ++i)
+			cell.points->getPoint(i,queryPoints[i]);
 
-		DgmOctree::NeighboursSet::iterator it = nNSS.pointsInNeighbourhood.begin();
-		for (unsigned i=0; i<n; ++i,++it)
-		{
-			it->point = cell.points->getPointPersistentPtr(i);
-			it->pointIndex = cell.points->getPointGlobalIndex(i);
-		}
+		if (n != 0 && !cell.parentOctree->findNeighborsInASphereBatch(&queryPoints[0],n,radius,cell.level,batch))
+			return false;
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return false;
 	}
-	nNSS.alreadyVisitedNeighbourhoodSize = 1;
 
 	//for each point in the cell
 	for (unsigned i=0; i<n; ++i)
 	{
 		ScalarType curv = NAN_VALUE;
 
-		cell.points->getPoint(i,nNSS.queryPoint);
-
-		//look for neighbors in a sphere
-		//warning: there may be more points at the end of nNSS.pointsInNeighbourhood than the actual nearest neighbors (neighborCount)!
-		unsigned neighborCount = cell.parentOctree->findNeighborsInASphereStartingFromCell(nNSS,radius,false);
-		//neighborCount = std::min(neighborCount,16);
+		unsigned neighborCount = batch.count(i);
 
 		if (neighborCount > 5)
 		{
+			cell.parentOctree->getBatchNeighbours(batch,i,neighbours);
+
 			//current point index
 			unsigned index = cell.points->getPointGlobalIndex(i);
 			//current point index in neighbourhood (to compute curvature at the right position!)
 			unsigned indexInNeighbourhood = 0;
 
-			DgmOctreeReferenceCloud neighboursCloud(&nNSS.pointsInNeighbourhood,neighborCount);
+			DgmOctreeReferenceCloud neighboursCloud(&neighbours,neighborCount);
 			Neighbourhood Z(&neighboursCloud);
 
 			//look for local index
 			for (unsigned j=0;j<neighborCount;++j)
 			{
-				if (nNSS.pointsInNeighbourhood[j].pointIndex == index)
+				if (neighbours[j].pointIndex == index)
 				{
 					indexInNeighbourhood = j;
 					break;
@@ -271,6 +267,458 @@ bool GeometricalAnalysisTools::flagDuplicatePointsInACellAtLevel(	const DgmOctre
 	return true;
 }
 
+//! Max cell position (along each dimension) of the grid used to flag duplicate points
+static const int DUPLICATE_GRID_MAX_POS = (1 << 20);
+
+//! Number of bits per dimension of the cell keys (see DuplicateGrid::CellKey)
+static const unsigned DUPLICATE_GRID_KEY_BITS = 21;
+
+//! Binary shift applied to the first dimension to define the sorting slabs
+static const unsigned DUPLICATE_GRID_SLAB_SHIFT = 4;
+
+//! Min number of points per sorting slab
+static const unsigned DUPLICATE_GRID_POINTS_PER_SLAB = 65536;
+
+//! Max number of points per chunk of cells (processed by a single thread)
+static const unsigned DUPLICATE_GRID_POINTS_PER_CHUNK = 16384;
+
+//! Point of the grid used to flag duplicate points
+struct DuplicateGridPoint
+{
+	//! Cell key
+	unsigned long long key;
+	//! Point index
+	unsigned index;
+	//! Point coordinates (copied for a faster access)
+	CCVector3 P;
+
+	//! Comparison operator (by cell, then by index)
+	inline bool operator < (const DuplicateGridPoint& other) const
+	{
+		return key < other.key || (key == other.key && index < other.index);
+	}
+};
+
+//! Hashed grid used to flag duplicate points (see GeometricalAnalysisTools::flagDuplicatePointsWithGrid)
+/** The dimensions are sorted by decreasing extent, so that the points can be sorted by slabs
+	along the largest one.
+**/
+struct DuplicateGrid
+{
+	//! Grid origin
+	CCVector3d origin;
+	//! Grid step
+	double cellSize;
+	//! Dimensions (sorted by decreasing extent)
+	unsigned char dims[3];
+	//! Min distance between points
+	double minDist;
+	//! Points sorted by cell
+	std::vector<DuplicateGridPoint> points;
+	//! Index of the first point of each cell in 'points' (+ the total number of points)
+	std::vector<unsigned> cellStarts;
+	//! Hash table: keys of the non empty cells (or EMPTY_KEY)
+	std::vector<unsigned long long> hashKeys;
+	//! Hash table: index of each cell
+	std::vector<unsigned> hashCells;
+	//! Hash table size minus one (the size is a power of 2)
+	size_t hashMask;
+	//! Duplicate flag of each point (same order as 'points')
+	std::vector<char> flags;
+
+	//! Empty slot of the hash table
+	static const unsigned long long EMPTY_KEY = (~0ull);
+
+	//! Returns the (unclamped) position of a point along a given (sorted) dimension, in cells
+	inline double relativePos(const CCVector3& P, unsigned char d) const
+	{
+		return (static_cast<double>(P.u[dims[d]]) - origin.u[dims[d]]) / cellSize;
+	}
+
+	//! Returns the cell position corresponding to a relative position
+	static inline int CellPos(double relPos)
+	{
+		return std::min(std::max(static_cast<int>(floor(relPos)), 0), DUPLICATE_GRID_MAX_POS);
+	}
+
+	//! Returns the key of a cell
+	static inline unsigned long long CellKey(int p0, int p1, int p2)
+	{
+		return		(static_cast<unsigned long long>(p0) << (2*DUPLICATE_GRID_KEY_BITS))
+				|	(static_cast<unsigned long long>(p1) << DUPLICATE_GRID_KEY_BITS)
+				|	static_cast<unsigned long long>(p2);
+	}
+
+	//! Returns the key of the cell including a point
+	inline unsigned long long pointKey(const CCVector3& P) const
+	{
+		return CellKey(CellPos(relativePos(P,0)), CellPos(relativePos(P,1)), CellPos(relativePos(P,2)));
+	}
+
+	//! Returns the slot of a cell key in the hash table
+	inline size_t hashSlot(unsigned long long key) const
+	{
+		//Fibonacci hashing
+		return static_cast<size_t>((key * 11400714819323198485ull) >> 32) & hashMask;
+	}
+
+	//! Returns the index of a cell (or -1 if the cell is empty)
+	inline int findCell(unsigned long long key) const
+	{
+		for (size_t slot = hashSlot(key); hashKeys[slot] != EMPTY_KEY; slot = ((slot + 1) & hashMask))
+			if (hashKeys[slot] == key)
+				return static_cast<int>(hashCells[slot]);
+		return -1;
+	}
+};
+
+//! Range of points sorted by a single thread
+struct DuplicateGridSlab
+{
+	//! First point
+	DuplicateGridPoint* begin;
+	//! Last point (excluded)
+	DuplicateGridPoint* end;
+};
+
+static void SortDuplicateGridSlab(DuplicateGridSlab& slab)
+{
+	std::sort(slab.begin, slab.end);
+}
+
+//! Chunk of cells processed by a single thread (duplicate points flagging)
+struct DuplicateGridChunk
+{
+	//! Grid
+	DuplicateGrid* grid;
+	//! Cells to process
+	const unsigned* cells;
+	//! Number of cells
+	unsigned count;
+	//! Progress notification (per point)
+	NormalizedProgress* nProgress;
+	//! Whether the process has been cancelled (shared by all chunks)
+	bool* cancelled;
+};
+
+static void FlagDuplicatePointsInCells(DuplicateGridChunk& chunk)
+{
+	if (*chunk.cancelled)
+		return;
+
+	DuplicateGrid& grid = *chunk.grid;
+	const double squareMinDist = grid.minDist * grid.minDist;
+	//margin for round-off errors (neighbour cells)
+	const double faceDist = grid.minDist / grid.cellSize + 1.0e-6;
+
+	for (unsigned c=0; c<chunk.count; ++c)
+	{
+		unsigned cellIndex = chunk.cells[c];
+		unsigned first = grid.cellStarts[cellIndex];
+		unsigned last = grid.cellStarts[cellIndex+1];
+
+		for (unsigned s=first; s<last; ++s)
+		{
+			//don't process points already flagged as 'duplicate'
+			if (grid.flags[s] != 0)
+				continue;
+
+			const CCVector3& P = grid.points[s].P;
+
+			//the neighbourhood of the point may only intersect its cell and the adjacent ones
+			int minPos[3], maxPos[3];
+			for (unsigned char d=0; d<3; ++d)
+			{
+				double relPos = grid.relativePos(P,d);
+				int pos = DuplicateGrid::CellPos(relPos);
+				minPos[d] = (pos > 0 && relPos - pos <= faceDist ? pos-1 : pos);
+				maxPos[d] = (pos < DUPLICATE_GRID_MAX_POS && (pos + 1) - relPos <= faceDist ? pos+1 : pos);
+			}
+
+			for (int p0=minPos[0]; p0<=maxPos[0]; ++p0)
+			{
+				for (int p1=minPos[1]; p1<=maxPos[1]; ++p1)
+				{
+					for (int p2=minPos[2]; p2<=maxPos[2]; ++p2)
+					{
+						unsigned long long neighbourKey = DuplicateGrid::CellKey(p0,p1,p2);
+						//no need to look for the current cell in the hash table
+						int neighbourCell = (neighbourKey == grid.points[s].key ? static_cast<int>(cellIndex) : grid.findCell(neighbourKey));
+						if (neighbourCell < 0)
+							continue;
+
+						unsigned neighbourLast = grid.cellStarts[neighbourCell+1];
+						for (unsigned t=grid.cellStarts[neighbourCell]; t<neighbourLast; ++t)
+						{
+							if (t != s && grid.flags[t] == 0 && (grid.points[t].P - P).norm2d() <= squareMinDist)
+							{
+								//flag this point as 'duplicate'
+								grid.flags[t] = 1;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		if (chunk.nProgress && !chunk.nProgress->steps(last-first))
+		{
+			//process cancelled by the user
+			*chunk.cancelled = true;
+			return;
+		}
+	}
+}
+
+int GeometricalAnalysisTools::flagDuplicatePointsWithGrid(	GenericIndexedCloudPersist* theCloud,
+															double minDistanceBetweenPoints/*=1.0e-12*/,
+															GenericProgressCallback* progressCb/*=0*/,
+															bool multiThread/*=true*/)
+{
+	if (!theCloud)
+		return -1;
+
+	unsigned numberOfPoints = theCloud->size();
+	if (numberOfPoints <= 1)
+		return -2;
+
+	DuplicateGrid grid;
+	grid.minDist = std::max(minDistanceBetweenPoints, 0.0);
+
+	//grid dimensions
+	{
+		CCVector3 bbMin, bbMax;
+		theCloud->getBoundingBox(bbMin,bbMax);
+		CCVector3d extents(	static_cast<double>(bbMax.x) - bbMin.x,
+							static_cast<double>(bbMax.y) - bbMin.y,
+							static_cast<double>(bbMax.z) - bbMin.z );
+
+		//dimensions sorted by decreasing extent
+		grid.dims[0] = 0; grid.dims[1] = 1; grid.dims[2] = 2;
+		for (unsigned char i=0; i<2; ++i)
+			for (unsigned char j=i+1; j<3; ++j)
+				if (extents.u[grid.dims[j]] > extents.u[grid.dims[i]])
+					std::swap(grid.dims[i],grid.dims[j]);
+
+		grid.origin = CCVector3d(bbMin.x, bbMin.y, bbMin.z);
+		//cells twice as large as the min distance: the neighbourhood of a point spans at most 2 cells
+		//along each dimension (and the number of cells must remain reasonable)
+		grid.cellSize = std::max(2.0 * grid.minDist, extents.u[grid.dims[0]] / DUPLICATE_GRID_MAX_POS);
+		if (grid.cellSize <= 0)
+		{
+			//all the points are the same!
+			grid.cellSize = 1.0;
+		}
+	}
+
+	//slabs along the first dimension
+	const unsigned binCount = (DUPLICATE_GRID_MAX_POS >> DUPLICATE_GRID_SLAB_SHIFT) + 1;
+	std::vector<unsigned> binSlabs;
+	std::vector<unsigned> slabOffsets;
+	try
+	{
+		grid.points.resize(numberOfPoints);
+		grid.flags.resize(numberOfPoints,0);
+
+		//number of points per bin
+		std::vector<unsigned> binCounts(binCount,0);
+		for (unsigned i=0; i<numberOfPoints; ++i)
+		{
+			int pos0 = DuplicateGrid::CellPos(grid.relativePos(*theCloud->getPoint(i),0));
+			++binCounts[pos0 >> DUPLICATE_GRID_SLAB_SHIFT];
+		}
+
+		//consecutive bins are gathered in slabs
+		const unsigned pointsPerSlab = std::max(DUPLICATE_GRID_POINTS_PER_SLAB, numberOfPoints / 256);
+		binSlabs.resize(binCount);
+		slabOffsets.push_back(0);
+		unsigned slabPoints = 0;
+		for (unsigned b=0; b<binCount; ++b)
+		{
+			if (slabPoints >= pointsPerSlab)
+			{
+				slabOffsets.push_back(slabOffsets.back() + slabPoints);
+				slabPoints = 0;
+			}
+			binSlabs[b] = static_cast<unsigned>(slabOffsets.size()) - 1;
+			slabPoints += binCounts[b];
+		}
+		slabOffsets.push_back(numberOfPoints);
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return -3;
+	}
+
+	//points are dispatched in their slab...
+	{
+		std::vector<unsigned> slabPos(slabOffsets.begin(),slabOffsets.end()-1);
+		for (unsigned i=0; i<numberOfPoints; ++i)
+		{
+			const CCVector3* P = theCloud->getPoint(i);
+			unsigned long long key = grid.pointKey(*P);
+			unsigned slab = binSlabs[static_cast<unsigned>(key >> (2*DUPLICATE_GRID_KEY_BITS)) >> DUPLICATE_GRID_SLAB_SHIFT];
+			DuplicateGridPoint& gp = grid.points[slabPos[slab]++];
+			gp.key = key;
+			gp.index = i;
+			gp.P = *P;
+		}
+	}
+
+	//...then sorted by cell
+	{
+		std::vector<DuplicateGridSlab> slabs;
+		try
+		{
+			for (size_t s=0; s+1<slabOffsets.size(); ++s)
+			{
+				if (slabOffsets[s+1] - slabOffsets[s] > 1)
+				{
+					DuplicateGridSlab slab;
+					slab.begin = &(grid.points[0]) + slabOffsets[s];
+					slab.end = &(grid.points[0]) + slabOffsets[s+1];
+					slabs.push_back(slab);
+				}
+			}
+		}
+		catch (const std::bad_alloc&) //out of memory
+		{
+			return -3;
+		}
+
+#ifdef USE_QT
+		if (multiThread && slabs.size() > 1)
+		{
+			QtConcurrent::blockingMap(slabs, SortDuplicateGridSlab);
+		}
+		else
+#endif
+		{
+			for (size_t s=0; s<slabs.size(); ++s)
+				SortDuplicateGridSlab(slabs[s]);
+		}
+	}
+
+	//cells (and their colors: their position modulo 3)
+	std::vector<unsigned> colorCells[27];
+	try
+	{
+		for (unsigned i=0; i<numberOfPoints; ++i)
+		{
+			unsigned long long key = grid.points[i].key;
+			if (i == 0 || key != grid.points[i-1].key)
+			{
+				const unsigned long long posMask = (1ull << DUPLICATE_GRID_KEY_BITS) - 1;
+				unsigned color =	static_cast<unsigned>((key >> (2*DUPLICATE_GRID_KEY_BITS)) % 3)
+								+	static_cast<unsigned>(((key >> DUPLICATE_GRID_KEY_BITS) & posMask) % 3) * 3
+								+	static_cast<unsigned>((key & posMask) % 3) * 9;
+				colorCells[color].push_back(static_cast<unsigned>(grid.cellStarts.size()));
+				grid.cellStarts.push_back(i);
+			}
+		}
+		grid.cellStarts.push_back(numberOfPoints);
+
+		//hash table (at most half full)
+		size_t cellCount = grid.cellStarts.size() - 1;
+		size_t hashSize = 1;
+		while (hashSize < 2 * cellCount)
+			hashSize <<= 1;
+		grid.hashKeys.resize(hashSize,static_cast<unsigned long long>(DuplicateGrid::EMPTY_KEY));
+		grid.hashCells.resize(hashSize,0);
+		grid.hashMask = hashSize - 1;
+
+		for (size_t c=0; c<cellCount; ++c)
+		{
+			unsigned long long key = grid.points[grid.cellStarts[c]].key;
+			//linear probing
+			size_t slot = grid.hashSlot(key);
+			while (grid.hashKeys[slot] != DuplicateGrid::EMPTY_KEY)
+				slot = ((slot + 1) & grid.hashMask);
+			grid.hashKeys[slot] = key;
+			grid.hashCells[slot] = static_cast<unsigned>(c);
+		}
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return -3;
+	}
+
+	//progress notification
+	NormalizedProgress nProgress(progressCb,numberOfPoints);
+	if (progressCb)
+	{
+		char buffer[256];
+		sprintf(buffer,"Points: %u\nCells: %u",numberOfPoints,static_cast<unsigned>(grid.cellStarts.size()-1));
+		progressCb->reset();
+		progressCb->setInfo(buffer);
+		progressCb->setMethodTitle("Flag duplicate points");
+		progressCb->start();
+	}
+
+	//the cells of a given color never share a neighbour cell, so they can be processed concurrently
+	//(and the result doesn't depend on the number of threads)
+	bool cancelled = false;
+	for (unsigned color=0; color<27 && !cancelled; ++color)
+	{
+		const std::vector<unsigned>& cells = colorCells[color];
+		if (cells.empty())
+			continue;
+
+		//chunks of (roughly) DUPLICATE_GRID_POINTS_PER_CHUNK points
+		std::vector<DuplicateGridChunk> chunks;
+		try
+		{
+			unsigned chunkPoints = 0;
+			for (size_t c=0; c<cells.size(); ++c)
+			{
+				if (chunks.empty() || chunkPoints >= DUPLICATE_GRID_POINTS_PER_CHUNK)
+				{
+					DuplicateGridChunk chunk;
+					chunk.grid = &grid;
+					chunk.cells = &(cells[c]);
+					chunk.count = 0;
+					chunk.nProgress = (progressCb ? &nProgress : 0);
+					chunk.cancelled = &cancelled;
+					chunks.push_back(chunk);
+					chunkPoints = 0;
+				}
+				chunkPoints += grid.cellStarts[cells[c]+1] - grid.cellStarts[cells[c]];
+				++chunks.back().count;
+			}
+		}
+		catch (const std::bad_alloc&) //out of memory
+		{
+			return -3;
+		}
+
+#ifdef USE_QT
+		if (multiThread && chunks.size() > 1)
+		{
+			QtConcurrent::blockingMap(chunks, FlagDuplicatePointsInCells);
+		}
+		else
+#endif
+		{
+			for (size_t n=0; n<chunks.size(); ++n)
+				FlagDuplicatePointsInCells(chunks[n]);
+		}
+	}
+
+	if (progressCb)
+		progressCb->stop();
+
+	if (cancelled)
+		return -4;
+
+	//output flags
+	if (!theCloud->enableScalarField())
+		return -3;
+	for (unsigned i=0; i<numberOfPoints; ++i)
+		theCloud->setPointScalarValue(grid.points[i].index,static_cast<ScalarType>(grid.flags[i]));
+
+	return 0;
+}
+
 int GeometricalAnalysisTools::computeLocalDensityApprox(GenericIndexedCloudPersist* theCloud,
 														Density densityType,
 														GenericProgressCallback* progressCb/*=0*/,
@@ -399,7 +847,8 @@ int GeometricalAnalysisTools::computeLocalDensity(	GenericIndexedCloudPersist* t
 													Density densityType,
 													PointCoordinateType kernelRadius,
 													GenericProgressCallback* progressCb/*=0*/,
-													DgmOctree* inputOctree/*=0*/)
+													DgmOctree* inputOctree/*=0*/,
+													const NeighbourhoodCache* cache/*=0*/)
 {
 	if (!theCloud)
 		return -1;
@@ -408,6 +857,10 @@ int GeometricalAnalysisTools::computeLocalDensity(	GenericIndexedCloudPersist* t
 	if (numberOfPoints < 3)
 		return -2;
 
+	//the precomputed neighbourhoods must correspond to the input cloud
+	if (cache && !cache->isValidFor(theCloud))
+		cache = 0;
+
 	//compute the right dimensional coef based on the expected output
 	double dimensionalCoef = 1.0;
 	switch (densityType)
@@ -444,7 +897,8 @@ int GeometricalAnalysisTools::computeLocalDensity(	GenericIndexedCloudPersist* t
 
 	//parameters
 	void* additionalParameters[] = {	static_cast<void*>(&kernelRadius),
-										static_cast<void*>(&dimensionalCoef) };
+										static_cast<void*>(&dimensionalCoef),
+										const_cast<void*>(static_cast<const void*>(cache)) };
 
 	int result = 0;
 
@@ -466,9 +920,10 @@ int GeometricalAnalysisTools::computeLocalDensity(	GenericIndexedCloudPersist* t
 }
 
 //"PER-CELL" METHOD: LOCAL DENSITY
-//ADDITIONNAL PARAMETERS (2):
+//ADDITIONNAL PARAMETERS (3):
 // [0] -> (PointCoordinateType*) kernelRadius : spherical neighborhood radius
 // [1] -> (ScalarType*) sphereVolume : spherical neighborhood volume
+// [2] -> (const NeighbourhoodCache*) cache : precomputed neighbourhoods (optional)
 bool GeometricalAnalysisTools::computePointsDensityInACellAtLevel(	const DgmOctree::octreeCell& cell, 
 																	void** additionalParameters,
 																	NormalizedProgress* nProgress/*=0*/)
@@ -476,6 +931,7 @@ bool GeometricalAnalysisTools::computePointsDensityInACellAtLevel(	const DgmOctr
 	//parameter(s)
 	PointCoordinateType radius = *static_cast<PointCoordinateType*>(additionalParameters[0]);
 	double dimensionalCoef = *static_cast<double*>(additionalParameters[1]);
+	const NeighbourhoodCache* cache = static_cast<const NeighbourhoodCache*>(additionalParameters[2]);
 	
 	assert(dimensionalCoef > 0);
 
@@ -493,9 +949,12 @@ bool GeometricalAnalysisTools::computePointsDensityInACellAtLevel(	const DgmOctr
 	{
 		cell.points->getPoint(i,nNSS.queryPoint);
 
-		//look for neighbors inside a sphere
+		//we use the precomputed neighbourhood if possible
+		int cachedCount = (cache ? cache->countNeighboursInSphere(cell.points->getPointGlobalIndex(i),radius) : -1);
+
+		//otherwise we look for neighbors inside a sphere
 		//warning: there may be more points at the end of nNSS.pointsInNeighbourhood than the actual nearest neighbors (neighborCount)!
-		unsigned neighborCount = cell.parentOctree->findNeighborsInASphereStartingFromCell(nNSS,radius,false);
+		unsigned neighborCount = (cachedCount >= 0 ? static_cast<unsigned>(cachedCount) : cell.parentOctree->findNeighborsInASphereStartingFromCell(nNSS,radius,false));
 
 		ScalarType density = static_cast<ScalarType>(neighborCount/dimensionalCoef);
 		cell.points->setPointScalarValue(i,density);
@@ -507,7 +966,7 @@ bool GeometricalAnalysisTools::computePointsDensityInACellAtLevel(	const DgmOctr
 	return true;
 }
 
-int GeometricalAnalysisTools::computeRoughness(GenericIndexedCloudPersist* theCloud, PointCoordinateType kernelRadius, GenericProgressCallback* progressCb/*=0*/, DgmOctree* inputOctree/*=0*/)
+int GeometricalAnalysisTools::computeRoughness(GenericIndexedCloudPersist* theCloud, PointCoordinateType kernelRadius, GenericProgressCallback* progressCb/*=0*/, DgmOctree* inputOctree/*=0*/, const NeighbourhoodCache* cache/*=0*/)
 {
 	if (!theCloud)
 		return -1;
@@ -516,6 +975,10 @@ int GeometricalAnalysisTools::computeRoughness(GenericIndexedCloudPersist* theCl
 	if (numberOfPoints < 3)
 		return -2;
 
+	//the precomputed neighbourhoods must correspond to the input cloud
+	if (cache && !cache->isValidFor(theCloud))
+		cache = 0;
+
 	DgmOctree* theOctree = inputOctree;
 	if (!theOctree)
 	{
@@ -532,7 +995,8 @@ int GeometricalAnalysisTools::computeRoughness(GenericIndexedCloudPersist* theCl
 	unsigned char level = theOctree->findBestLevelForAGivenNeighbourhoodSizeExtraction(kernelRadius);
 
 	//parameters
-	void* additionalParameters[1] = { static_cast<void*>(&kernelRadius) };
+	void* additionalParameters[2] = {	static_cast<void*>(&kernelRadius),
+										const_cast<void*>(static_cast<const void*>(cache)) };
 
 	int result = 0;
 
@@ -554,59 +1018,76 @@ int GeometricalAnalysisTools::computeRoughness(GenericIndexedCloudPersist* theCl
 }
 
 //"PER-CELL" METHOD: ROUGHNESS ESTIMATION (LEAST SQUARES PLANE FIT)
-//ADDITIONNAL PARAMETERS (1):
+//ADDITIONNAL PARAMETERS (2):
 // [0] -> (PointCoordinateType*) kernelRadius : neighbourhood radius
+// [1] -> (const NeighbourhoodCache*) cache : precomputed neighbourhoods (optional)
 bool GeometricalAnalysisTools::computePointsRoughnessInACellAtLevel(const DgmOctree::octreeCell& cell, 
 																	void** additionalParameters,
 																	NormalizedProgress* nProgress/*=0*/)
 {
 	//parameter(s)
 	PointCoordinateType radius = *static_cast<PointCoordinateType*>(additionalParameters[0]);
-
-	//structure for nearest neighbors search
-	DgmOctree::NearestNeighboursSphericalSearchStruct nNSS;
-	nNSS.level = cell.level;
-	nNSS.prepare(radius,cell.parentOctree->getCellSize(nNSS.level));
-	cell.parentOctree->getCellPos(cell.truncatedCode,cell.level,nNSS.cellPos,true);
-	cell.parentOctree->computeCellCenter(nNSS.cellPos,cell.level,nNSS.cellCenter);
+	const NeighbourhoodCache* cache = static_cast<const NeighbourhoodCache*>(additionalParameters[1]);
 
 	unsigned n = cell.points->size(); //number of points in the current cell
-	
+
+	//we extract the neighbourhoods of all the cell points at once
+	//(apart from the ones that can be read from the cache)
+	DgmOctree::NeighboursBatch batch;
+	DgmOctree::NeighboursSet neighbours;
+	std::vector<CCVector3> queryPoints;
+	std::vector<unsigned> batchIndexes; //index of each cell point in the batch
+	try
+	{
+		queryPoints.reserve(n);
+		batchIndexes.resize(n,static_cast<unsigned>(-1));
+		for (unsigned i=0; i<n; ++i)
+		{
+			if (cache && cache->countNeighboursInSphere(cell.points->getPointGlobalIndex(i),radius) >= 0)
+				continue;
+			batchIndexes[i] = static_cast<unsigned>(queryPoints.size());
+			queryPoints.push_back(*cell.points->getPoint(i));
+		}
+
+		if (!queryPoints.empty() && !cell.parentOctree->findNeighborsInASphereBatch(&queryPoints[0],static_cast<unsigned>(queryPoints.size()),radius,cell.level,batch))
+			return false;
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return false;
+	}
+
 	//for each point in the cell
 	for (unsigned i=0; i<n; ++i)
 	{
 		ScalarType d = NAN_VALUE;
-		cell.points->getPoint(i,nNSS.queryPoint);
+		const unsigned globalIndex = cell.points->getPointGlobalIndex(i);
+
+		unsigned neighborCount = 0;
+		if (batchIndexes[i] != static_cast<unsigned>(-1))
+			neighborCount = cell.parentOctree->getBatchNeighbours(batch,batchIndexes[i],neighbours);
+		else if (cache->getNeighboursInSphere(globalIndex,radius,neighbours))
+			neighborCount = static_cast<unsigned>(neighbours.size());
 
-		//look for neighbors inside a sphere
-		//warning: there may be more points at the end of nNSS.pointsInNeighbourhood than the actual nearest neighbors (= neighborCount)!
-		unsigned neighborCount = cell.parentOctree->findNeighborsInASphereStartingFromCell(nNSS,radius,false);
 		if (neighborCount > 3)
 		{
 			//find the query point in the nearest neighbors set and place it at the end
-			const unsigned globalIndex = cell.points->getPointGlobalIndex(i);
 			unsigned localIndex = 0;
-			while (localIndex < neighborCount && nNSS.pointsInNeighbourhood[localIndex].pointIndex != globalIndex)
+			while (localIndex < neighborCount && neighbours[localIndex].pointIndex != globalIndex)
 				++localIndex;
 			//the query point should be in the nearest neighbors set!
 			assert(localIndex < neighborCount);
 			if (localIndex+1 < neighborCount) //no need to swap with another point if it's already at the end!
 			{
-				std::swap(nNSS.pointsInNeighbourhood[localIndex],nNSS.pointsInNeighbourhood[neighborCount-1]);
+				std::swap(neighbours[localIndex],neighbours[neighborCount-1]);
 			}
 
-			DgmOctreeReferenceCloud neighboursCloud(&nNSS.pointsInNeighbourhood,neighborCount-1); //we don't take the query point into account!
+			DgmOctreeReferenceCloud neighboursCloud(&neighbours,neighborCount-1); //we don't take the query point into account!
 			Neighbourhood Z(&neighboursCloud);
 
 			const PointCoordinateType* lsPlane = Z.getLSPlane();
 			if (lsPlane)
-				d = fabs(DistanceComputationTools::computePoint2PlaneDistance(&nNSS.queryPoint,lsPlane));
-
-			//swap the points back to their original position (DGM: not necessary)
-			//if (localIndex+1 < neighborCount)
-			//{
-			//	std::swap(nNSS.pointsInNeighbourhood[localIndex],nNSS.pointsInNeighbourhood[neighborCount-1]);
-			//}
+				d = fabs(DistanceComputationTools::computePoint2PlaneDistance(cell.points->getPoint(i),lsPlane));
 		}
 
 		cell.points->setPointScalarValue(i,d);
@@ -618,6 +1099,353 @@ bool GeometricalAnalysisTools::computePointsRoughnessInACellAtLevel(const DgmOct
 	return true;
 }
 
+//! Multi-scale features computation context
+struct MultiScaleFeaturesContext
+{
+	//! Radii (sorted by increasing value)
+	std::vector<PointCoordinateType> radii;
+	//! Index of each (sorted) scale in the input radii
+	std::vector<unsigned> scaleIndexes;
+	//! Dimensional coefficient of each (sorted) scale (density)
+	std::vector<double> dimensionalCoefs;
+	//! Requested features (MultiScaleFeature flags)
+	std::vector<GeometricalAnalysisTools::MultiScaleFeature> features;
+	//! Output scalar fields
+	const std::vector<ScalarField*>* outputFields;
+
+	//! Returns the output field of a given feature at a given (sorted) scale
+	inline ScalarField* field(size_t featureIndex, size_t scale) const
+	{
+		return outputFields->at(featureIndex * radii.size() + scaleIndexes[scale]);
+	}
+};
+
+//! Returns the eigenvalues (sorted by decreasing value) and the eigen vector associated to the smallest one of the covariance matrix of a set of points
+/** \param sum1 sum of the (recentered) points
+	\param sum2 sum of the products of the (recentered) points coordinates (XX, YY, ZZ, XY, XZ, YZ)
+	\param count number of points
+	\param[out] eigenValues eigenvalues
+	\param[out] minEigenVector eigen vector associated to the smallest eigenvalue (optional)
+	\return false if the eigen decomposition failed
+**/
+static bool ComputeMomentsEigen(const double sum1[3],
+								const double sum2[6],
+								unsigned count,
+								double eigenValues[3],
+								double* minEigenVector = 0)
+{
+	//covariance matrix = E[P.P'] - E[P].E[P]'
+	double G[3] = { sum1[0]/count, sum1[1]/count, sum1[2]/count };
+	SquareMatrixd covMat(3);
+	covMat.m_values[0][0] = sum2[0]/count - G[0]*G[0];
+	covMat.m_values[1][1] = sum2[1]/count - G[1]*G[1];
+	covMat.m_values[2][2] = sum2[2]/count - G[2]*G[2];
+	covMat.m_values[1][0] = covMat.m_values[0][1] = sum2[3]/count - G[0]*G[1];
+	covMat.m_values[2][0] = covMat.m_values[0][2] = sum2[4]/count - G[0]*G[2];
+	covMat.m_values[2][1] = covMat.m_values[1][2] = sum2[5]/count - G[1]*G[2];
+
+	SquareMatrixd eig = covMat.computeJacobianEigenValuesAndVectors();
+	if (!eig.isValid())
+		return false;
+
+	if (minEigenVector)
+		eig.getMinEigenValueAndVector(minEigenVector);
+
+	for (unsigned j=0; j<3; ++j)
+		eigenValues[j] = eig.getEigenValues()[j];
+	std::sort(eigenValues,eigenValues+3);
+	std::swap(eigenValues[0],eigenValues[2]);
+
+	return true;
+}
+
+int GeometricalAnalysisTools::computeMultiScaleFeatures(GenericIndexedCloudPersist* theCloud,
+														const std::vector<PointCoordinateType>& radii,
+														int features,
+														const std::vector<ScalarField*>& outputFields,
+														Density densityType/*=DENSITY_3D*/,
+														GenericProgressCallback* progressCb/*=0*/,
+														DgmOctree* inputOctree/*=0*/)
+{
+	if (!theCloud)
+		return -1;
+
+	unsigned numberOfPoints = theCloud->size();
+	if (numberOfPoints < 5)
+		return -2;
+
+	MultiScaleFeaturesContext context;
+	try
+	{
+		//requested features
+		static const MultiScaleFeature s_features[] = {	MS_DENSITY,
+														MS_ROUGHNESS,
+														MS_MEAN_CURVATURE,
+														MS_GAUSSIAN_CURVATURE,
+														MS_NORMAL_CHANGE_RATE,
+														MS_EIGENVALUE_1,
+														MS_EIGENVALUE_2,
+														MS_EIGENVALUE_3 };
+		for (unsigned i=0; i<sizeof(s_features)/sizeof(MultiScaleFeature); ++i)
+			if (features & s_features[i])
+				context.features.push_back(s_features[i]);
+
+		//we sort the scales by increasing radius
+		std::vector< std::pair<PointCoordinateType,unsigned> > scales;
+		for (size_t i=0; i<radii.size(); ++i)
+			scales.push_back(std::pair<PointCoordinateType,unsigned>(radii[i],static_cast<unsigned>(i)));
+		std::sort(scales.begin(),scales.end());
+
+		for (size_t i=0; i<scales.size(); ++i)
+		{
+			double r = static_cast<double>(scales[i].first);
+
+			double dimensionalCoef = 1.0;
+			switch (densityType)
+			{
+			case DENSITY_KNN:
+				dimensionalCoef = 1.0;
+				break;
+			case DENSITY_2D:
+				dimensionalCoef = M_PI * (r * r);
+				break;
+			case DENSITY_3D:
+				dimensionalCoef = s_UnitSphereVolume * ((r * r) * r);
+				break;
+			default:
+				assert(false);
+				return -5;
+			}
+
+			context.radii.push_back(scales[i].first);
+			context.scaleIndexes.push_back(scales[i].second);
+			context.dimensionalCoefs.push_back(dimensionalCoef);
+		}
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return -4;
+	}
+
+	//check the input parameters
+	if (context.features.empty() || context.radii.empty() || context.radii.front() <= 0)
+		return -5;
+	if (outputFields.size() != context.features.size() * context.radii.size())
+		return -5;
+	for (size_t i=0; i<outputFields.size(); ++i)
+		if (!outputFields[i] || outputFields[i]->currentSize() < numberOfPoints)
+			return -5;
+	context.outputFields = &outputFields;
+
+	DgmOctree* theOctree = inputOctree;
+	if (!theOctree)
+	{
+		theOctree = new DgmOctree(theCloud);
+		if (theOctree->build(progressCb) < 1)
+		{
+			delete theOctree;
+			return -3;
+		}
+	}
+
+	//the neighbourhoods are extracted at the largest scale
+	unsigned char level = theOctree->findBestLevelForAGivenNeighbourhoodSizeExtraction(context.radii.back());
+
+	//parameters
+	void* additionalParameters[1] = { static_cast<void*>(&context) };
+
+	int result = 0;
+
+	if (theOctree->executeFunctionForAllCellsAtLevel(	level,
+														&computeMultiScaleFeaturesInACellAtLevel,
+														additionalParameters,
+														true,
+														progressCb,
+														"Multi-scale Features Computation") == 0)
+	{
+		//something went wrong
+		result = -4;
+	}
+
+	if (!inputOctree)
+		delete theOctree;
+
+	return result;
+}
+
+//"PER-CELL" METHOD: MULTI-SCALE FEATURES
+//ADDITIONAL PARAMETERS (1):
+// [0] -> (MultiScaleFeaturesContext*) context : scales, features and output fields
+bool GeometricalAnalysisTools::computeMultiScaleFeaturesInACellAtLevel(	const DgmOctree::octreeCell& cell,
+																		void** additionalParameters,
+																		NormalizedProgress* nProgress/*=0*/)
+{
+	//parameter(s)
+	const MultiScaleFeaturesContext& context = *static_cast<MultiScaleFeaturesContext*>(additionalParameters[0]);
+
+	unsigned n = cell.points->size(); //number of points in the current cell
+	size_t scaleCount = context.radii.size();
+
+	//we extract the neighbourhoods of all the cell points at once (at the largest scale, sorted by increasing distance)
+	DgmOctree::NeighboursBatch batch;
+	DgmOctree::NeighboursSet neighbours;
+	std::vector<CCVector3> queryPoints;
+	try
+	{
+		queryPoints.resize(n);
+		for (unsigned i=0; i<n; ++i)
+			cell.points->getPoint(i,queryPoints[i]);
+
+		if (n != 0 && !cell.parentOctree->findNeighborsInASphereBatch(&queryPoints[0],n,context.radii.back(),cell.level,batch,true))
+			return false;
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return false;
+	}
+
+	//for each point in the cell
+	for (unsigned i=0; i<n; ++i)
+	{
+		const CCVector3& Q = queryPoints[i];
+		const unsigned globalIndex = cell.points->getPointGlobalIndex(i);
+		unsigned neighborCount = cell.parentOctree->getBatchNeighbours(batch,i,neighbours);
+
+		//moments of the neighbours (recentered on the query point) accumulated from one scale to the next
+		double sum1[3] = { 0, 0, 0 };
+		double sum2[6] = { 0, 0, 0, 0, 0, 0 };
+		unsigned count = 0;
+		//position of the query point in the neighbourhood
+		unsigned localIndex = neighborCount;
+
+		for (size_t s=0; s<scaleCount; ++s)
+		{
+			//we add the neighbours falling inside the current sphere
+			PointCoordinateType squareRadius = context.radii[s] * context.radii[s];
+			while (count < neighborCount && neighbours[count].squareDistd <= static_cast<double>(squareRadius))
+			{
+				if (neighbours[count].pointIndex == globalIndex)
+					localIndex = count;
+
+				CCVector3d P = CCVector3d::fromArray((*neighbours[count].point - Q).u);
+				sum1[0] += P.x;
+				sum1[1] += P.y;
+				sum1[2] += P.z;
+				sum2[0] += P.x*P.x;
+				sum2[1] += P.y*P.y;
+				sum2[2] += P.z*P.z;
+				sum2[3] += P.x*P.y;
+				sum2[4] += P.x*P.z;
+				sum2[5] += P.y*P.z;
+				++count;
+			}
+
+			//eigenvalues of the whole neighbourhood (computed on demand)
+			bool eigenComputed = false;
+			bool eigenValid = false;
+			double eigenValues[3];
+
+			for (size_t f=0; f<context.features.size(); ++f)
+			{
+				ScalarType value = NAN_VALUE;
+
+				switch (context.features[f])
+				{
+				case MS_DENSITY:
+					value = static_cast<ScalarType>(count / context.dimensionalCoefs[s]);
+					break;
+
+				case MS_ROUGHNESS:
+					//we want 3 points or more (other than the point itself!)
+					if (count > 3)
+					{
+						if (count > 4)
+						{
+							//the query point (at the origin) doesn't contribute to the moments
+							double minEigenVector[3];
+							double planeEigenValues[3];
+							if (ComputeMomentsEigen(sum1,sum2,count-1,planeEigenValues,minEigenVector))
+							{
+								//distance from the query point to the LS plane (which goes through the neighbours gravity center)
+								double d = (sum1[0]*minEigenVector[0] + sum1[1]*minEigenVector[1] + sum1[2]*minEigenVector[2]) / (count-1);
+								value = static_cast<ScalarType>(fabs(d));
+							}
+						}
+						else
+						{
+							//the plane goes through the 3 other points (see Neighbourhood::getLSPlane)
+							DgmOctree::NeighboursSet others;
+							for (unsigned j=0; j<count; ++j)
+								if (j != localIndex)
+									others.push_back(neighbours[j]);
+							others.resize(3);
+
+							DgmOctreeReferenceCloud othersCloud(&others);
+							Neighbourhood Z(&othersCloud);
+							const PointCoordinateType* lsPlane = Z.getLSPlane();
+							if (lsPlane)
+								value = static_cast<ScalarType>(fabs(DistanceComputationTools::computePoint2PlaneDistance(&Q,lsPlane)));
+						}
+					}
+					break;
+
+				case MS_MEAN_CURVATURE:
+				case MS_GAUSSIAN_CURVATURE:
+					//same requirement as computeCurvature
+					if (count > 5)
+					{
+						DgmOctreeReferenceCloud neighboursCloud(&neighbours,count);
+						Neighbourhood Z(&neighboursCloud);
+						value = Z.computeCurvature(localIndex < count ? localIndex : 0, context.features[f] == MS_MEAN_CURVATURE ? Neighbourhood::MEAN_CURV : Neighbourhood::GAUSSIAN_CURV);
+					}
+					break;
+
+				case MS_NORMAL_CHANGE_RATE:
+				case MS_EIGENVALUE_1:
+				case MS_EIGENVALUE_2:
+				case MS_EIGENVALUE_3:
+					{
+						//same requirement as computeCurvature
+						if (context.features[f] == MS_NORMAL_CHANGE_RATE ? count <= 5 : count < 3)
+							break;
+
+						if (!eigenComputed)
+						{
+							eigenValid = ComputeMomentsEigen(sum1,sum2,count,eigenValues);
+							eigenComputed = true;
+						}
+						if (!eigenValid)
+							break;
+
+						if (context.features[f] == MS_NORMAL_CHANGE_RATE)
+						{
+							double sum = fabs(eigenValues[0] + eigenValues[1] + eigenValues[2]);
+							if (sum >= ZERO_TOLERANCE)
+								value = static_cast<ScalarType>(fabs(eigenValues[2]) / sum);
+						}
+						else
+						{
+							value = static_cast<ScalarType>(eigenValues[context.features[f] == MS_EIGENVALUE_1 ? 0 : context.features[f] == MS_EIGENVALUE_2 ? 1 : 2]);
+						}
+					}
+					break;
+
+				default:
+					assert(false);
+					break;
+				}
+
+				context.field(f,s)->setValue(globalIndex,value);
+			}
+		}
+
+		if (nProgress && !nProgress->oneStep())
+			return false;
+	}
+
+	return true;
+}
+
 CCVector3 GeometricalAnalysisTools::computeGravityCenter(GenericCloud* theCloud)
 {
 	assert(theCloud);
@@ -0,0 +1,519 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "LocalModelGrid.h"
+
+//local
+#include "DgmOctree.h"
+#include "DgmOctreeReferenceCloud.h"
+#include "DistanceComputationTools.h"
+#include "GenericIndexedMesh.h"
+#include "GenericProgressCallback.h"
+#include "GenericTriangle.h"
+#include "MeshBVH.h"
+#include "Neighbourhood.h"
+#include "ReferenceCloud.h"
+
+//system
+#include <assert.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+using namespace CCLib;
+
+LocalModelGrid::Model::Model()
+	: center(0,0,0)
+	, squareSize(0)
+	, gravityCenter(0,0,0)
+	, firstTriangle(0)
+	, triangleCount(0)
+{
+	memset(eq,0,sizeof(PointCoordinateType)*6);
+	dims[0] = 0;
+	dims[1] = 1;
+	dims[2] = 2;
+}
+
+LocalModelGrid::LocalModelGrid()
+	: m_modelType(NO_MODEL)
+	, m_level(0)
+	, m_origin(0,0,0)
+	, m_cellSize(0)
+	, m_gridSize(0)
+	, m_hashMask(0)
+{
+}
+
+LocalModelGrid::~LocalModelGrid()
+{
+	clear();
+}
+
+void LocalModelGrid::clear()
+{
+	m_modelType = NO_MODEL;
+	m_level = 0;
+	m_origin = CCVector3(0,0,0);
+	m_cellSize = 0;
+	m_gridSize = 0;
+
+	m_models.clear();
+	m_hashKeys.clear();
+	m_hashModelIndexes.clear();
+	m_hashMask = 0;
+	m_triangleVertices.clear();
+}
+
+unsigned LocalModelGrid::modelCount() const
+{
+	unsigned count = 0;
+	for (std::vector<Model>::const_iterator it = m_models.begin(); it != m_models.end(); ++it)
+		if (it->squareSize > 0)
+			++count;
+
+	return count;
+}
+
+//! Internal structure shared by all the threads (see LocalModelGrid::build)
+struct LocalModelGridBuildContext
+{
+	//! Type of models
+	CC_LOCAL_MODEL_TYPES modelType;
+	//! Whether to use a fixed radius or a fixed number of neighbours
+	bool useSphericalSearch;
+	//! Number of neighbours
+	unsigned kNN;
+	//! Neighbourhood radius
+	PointCoordinateType radius;
+	//! Codes of the non empty cells (sorted)
+	const DgmOctree::cellCodesContainer* cellCodes;
+	//! Model of each cell
+	std::vector<LocalModelGrid::Model>* models;
+	//! Triangles vertices of each model (TRI only)
+	std::vector< std::vector<CCVector3> >* triangles;
+};
+
+//! Fits a model on a neighbourhood
+/** \return whether the model is valid or not
+**/
+static bool FitLocalModel(	CC_LOCAL_MODEL_TYPES modelType,
+							Neighbourhood& Z,
+							LocalModelGrid::Model& model,
+							std::vector<CCVector3>* triangleVertices,
+							bool& notEnoughMemory)
+{
+	switch (modelType)
+	{
+	case LS:
+		{
+			const PointCoordinateType* lsPlane = Z.getLSPlane();
+			if (!lsPlane)
+				return false;
+			memcpy(model.eq,lsPlane,sizeof(PointCoordinateType)*4);
+		}
+		break;
+
+	case QUADRIC:
+		{
+			Tuple3ub dims;
+			const PointCoordinateType* eq = Z.getQuadric(&dims);
+			if (!eq)
+				return false;
+			memcpy(model.eq,eq,sizeof(PointCoordinateType)*6);
+			model.dims[0] = dims.x;
+			model.dims[1] = dims.y;
+			model.dims[2] = dims.z;
+			model.gravityCenter = *Z.getGravityCenter();
+		}
+		break;
+
+	case TRI:
+		{
+			//the mesh is released before the neighbourhood, so we don't need to duplicate the vertices
+			GenericIndexedMesh* mesh = Z.triangulateOnPlane(false);
+			if (!mesh)
+				return false;
+
+			assert(triangleVertices);
+			unsigned triCount = mesh->size();
+			try
+			{
+				triangleVertices->resize(3 * static_cast<size_t>(triCount));
+			}
+			catch (const std::bad_alloc&) //out of memory
+			{
+				delete mesh;
+				notEnoughMemory = true;
+				return false;
+			}
+
+			mesh->placeIteratorAtBegining();
+			for (unsigned i=0; i<triCount; ++i)
+			{
+				GenericTriangle* tri = mesh->_getNextTriangle();
+				(*triangleVertices)[3*i  ] = *tri->_getA();
+				(*triangleVertices)[3*i+1] = *tri->_getB();
+				(*triangleVertices)[3*i+2] = *tri->_getC();
+			}
+			model.triangleCount = triCount;
+
+			delete mesh;
+			mesh = 0;
+
+			if (triCount == 0)
+				return false;
+		}
+		break;
+
+	default:
+		assert(false);
+		return false;
+	}
+
+	return true;
+}
+
+//Description of expected 'additionalParameters'
+// [0] -> (LocalModelGridBuildContext*) build context
+static bool ComputeCellLocalModel(	const DgmOctree::octreeCell& cell,
+									void** additionalParameters,
+									NormalizedProgress* nProgress/*=0*/)
+{
+	const LocalModelGridBuildContext* context = reinterpret_cast<LocalModelGridBuildContext*>(additionalParameters[0]);
+	const DgmOctree* octree = cell.parentOctree;
+
+	unsigned pointCount = cell.points->size();
+
+	//the neighbourhood search starts from the current cell
+	DgmOctree::NearestNeighboursSphericalSearchStruct nNSS;
+	nNSS.level = cell.level;
+	octree->getCellPos(cell.truncatedCode,cell.level,nNSS.cellPos,true);
+	octree->computeCellCenter(nNSS.cellPos,cell.level,nNSS.cellCenter);
+
+	//corresponding model (same order as the cells)
+	DgmOctree::cellCodesContainer::const_iterator codeIt = std::lower_bound(	context->cellCodes->begin(),
+																				context->cellCodes->end(),
+																				cell.truncatedCode);
+	assert(codeIt != context->cellCodes->end() && *codeIt == cell.truncatedCode);
+	size_t modelIndex = codeIt - context->cellCodes->begin();
+	LocalModelGrid::Model& model = (*context->models)[modelIndex];
+
+	//the model is centered on the cell point which is the closest to the cell center
+	{
+		PointCoordinateType minSquareDist = 0;
+		for (unsigned i=0; i<pointCount; ++i)
+		{
+			const CCVector3* P = cell.points->getPoint(i);
+			PointCoordinateType squareDist = (*P - nNSS.cellCenter).norm2();
+			if (i == 0 || squareDist < minSquareDist)
+			{
+				minSquareDist = squareDist;
+				nNSS.queryPoint = *P;
+			}
+		}
+	}
+
+	//let's grab its neighbours
+	unsigned kNN = 0;
+	if (context->useSphericalSearch)
+	{
+		nNSS.prepare(context->radius,octree->getCellSize(cell.level));
+		kNN = octree->findNeighborsInASphereStartingFromCell(nNSS,context->radius,false);
+	}
+	else
+	{
+		nNSS.minNumberOfNeighbors = context->kNN;
+		kNN = octree->findNearestNeighborsStartingFromCell(nNSS);
+		kNN = std::min(kNN,context->kNN);
+	}
+
+	//if there's enough neighbours
+	if (kNN >= CC_LOCAL_MODEL_MIN_SIZE[context->modelType])
+	{
+		//the farthest neighbour gives the model 'size'
+		double maxSquareDist = 0;
+		for (unsigned k=0; k<kNN; ++k)
+			maxSquareDist = std::max(maxSquareDist,nNSS.pointsInNeighbourhood[k].squareDistd);
+
+		if (maxSquareDist > 0) //DGM: it happens with duplicate points :(
+		{
+			DgmOctreeReferenceCloud neighboursCloud(&nNSS.pointsInNeighbourhood,kNN);
+			Neighbourhood Z(&neighboursCloud);
+
+			bool notEnoughMemory = false;
+			if (FitLocalModel(context->modelType,Z,model,context->triangles ? &(*context->triangles)[modelIndex] : 0,notEnoughMemory))
+			{
+				model.center = nNSS.queryPoint;
+				model.squareSize = static_cast<PointCoordinateType>(maxSquareDist);
+			}
+			else if (notEnoughMemory)
+			{
+				return false;
+			}
+		}
+	}
+
+	if (nProgress && !nProgress->steps(pointCount))
+		return false;
+
+	return true;
+}
+
+bool LocalModelGrid::build(	DgmOctree* octree,
+							unsigned char level,
+							CC_LOCAL_MODEL_TYPES modelType,
+							bool useSphericalSearch,
+							unsigned kNN,
+							PointCoordinateType radius,
+							bool multiThread/*=true*/,
+							GenericProgressCallback* progressCb/*=0*/)
+{
+	clear();
+
+	if (!octree || octree->getNumberOfProjectedPoints() == 0 || modelType == NO_MODEL)
+		return false;
+	if (useSphericalSearch ? radius <= 0 : kNN == 0)
+		return false;
+
+	//if necessary we guess the best level from the neighbourhood size
+	if (level == 0)
+	{
+		if (useSphericalSearch)
+		{
+			//cells as large as possible but smaller than the neighbourhood
+			level = 1;
+			while (level < DgmOctree::MAX_OCTREE_LEVEL && octree->getCellSize(level) > radius)
+				++level;
+		}
+		else
+		{
+			//a kNN neighbourhood (on a surface) roughly spans the 4 cells around its center
+			level = octree->findBestLevelForAGivenPopulationPerCell(std::max<unsigned>(1,kNN/4));
+		}
+	}
+	assert(level > 0 && level <= DgmOctree::MAX_OCTREE_LEVEL);
+
+	//non empty cells
+	DgmOctree::cellCodesContainer cellCodes;
+	if (!octree->getCellCodes(level,cellCodes,true))
+		return false;
+
+	//hash table size (at most half full)
+	size_t hashSize = 1;
+	while (hashSize < 2 * cellCodes.size())
+		hashSize <<= 1;
+
+	std::vector< std::vector<CCVector3> > triangles;
+	try
+	{
+		m_models.resize(cellCodes.size());
+		m_hashKeys.resize(hashSize,static_cast<unsigned long long>(EMPTY_KEY));
+		m_hashModelIndexes.resize(hashSize,0);
+		if (modelType == TRI)
+			triangles.resize(cellCodes.size());
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		clear();
+		return false;
+	}
+
+	m_hashMask = hashSize - 1;
+	for (size_t i=0; i<cellCodes.size(); ++i)
+	{
+		Tuple3i cellPos;
+		octree->getCellPos(cellCodes[i],level,cellPos,true);
+		unsigned long long key = CellKey(cellPos.x,cellPos.y,cellPos.z);
+
+		//linear probing
+		size_t slot = hashSlot(key);
+		while (m_hashKeys[slot] != EMPTY_KEY)
+			slot = ((slot + 1) & m_hashMask);
+		m_hashKeys[slot] = key;
+		m_hashModelIndexes[slot] = static_cast<unsigned>(i);
+	}
+
+	m_modelType = modelType;
+	m_level = level;
+	m_origin = octree->getOctreeMins();
+	m_cellSize = octree->getCellSize(level);
+	m_gridSize = (1 << level);
+
+	LocalModelGridBuildContext context;
+	context.modelType = modelType;
+	context.useSphericalSearch = useSphericalSearch;
+	context.kNN = kNN;
+	context.radius = radius;
+	context.cellCodes = &cellCodes;
+	context.models = &m_models;
+	context.triangles = (modelType == TRI ? &triangles : 0);
+
+	void* additionalParameters[1] = { reinterpret_cast<void*>(&context) };
+
+	if (octree->executeFunctionForAllCellsAtLevel(	level,
+													ComputeCellLocalModel,
+													additionalParameters,
+													multiThread,
+													progressCb,
+													"Local models") == 0)
+	{
+		//something went wrong (not enough memory or process cancelled by the user)
+		clear();
+		return false;
+	}
+
+	//we gather all the triangles in a single array
+	if (modelType == TRI)
+	{
+		size_t vertCount = 0;
+		for (size_t i=0; i<m_models.size(); ++i)
+		{
+			if (vertCount + triangles[i].size() > 3 * static_cast<size_t>(static_cast<unsigned>(-1)))
+			{
+				//too many triangles
+				clear();
+				return false;
+			}
+			m_models[i].firstTriangle = static_cast<unsigned>(vertCount / 3);
+			vertCount += triangles[i].size();
+		}
+
+		try
+		{
+			m_triangleVertices.reserve(vertCount);
+		}
+		catch (const std::bad_alloc&) //out of memory
+		{
+			clear();
+			return false;
+		}
+
+		for (size_t i=0; i<m_models.size(); ++i)
+		{
+			m_triangleVertices.insert(m_triangleVertices.end(),triangles[i].begin(),triangles[i].end());
+			std::vector<CCVector3>().swap(triangles[i]); //release memory as soon as possible
+		}
+	}
+
+	return true;
+}
+
+const LocalModelGrid::Model* LocalModelGrid::getCellModel(int i, int j, int k) const
+{
+	if (	i < 0 || i >= m_gridSize
+		||	j < 0 || j >= m_gridSize
+		||	k < 0 || k >= m_gridSize)
+		return 0;
+
+	unsigned long long key = CellKey(i,j,k);
+	for (size_t slot = hashSlot(key); m_hashKeys[slot] != EMPTY_KEY; slot = ((slot + 1) & m_hashMask))
+		if (m_hashKeys[slot] == key)
+			return &m_models[m_hashModelIndexes[slot]];
+
+	return 0;
+}
+
+ScalarType LocalModelGrid::distanceToModel(const Model& model, const CCVector3& P) const
+{
+	switch (m_modelType)
+	{
+	case LS:
+		return static_cast<ScalarType>(fabs(DistanceComputationTools::computePoint2PlaneDistance(&P,model.eq)));
+
+	case QUADRIC:
+		{
+			CCVector3 Q = P - model.gravityCenter;
+			const unsigned char dX = model.dims[0];
+			const unsigned char dY = model.dims[1];
+			const unsigned char dZ = model.dims[2];
+
+			//height = h0 + h1.x + h2.y + h3.x^2 + h4.x.y + h5.y^2
+			PointCoordinateType z = model.eq[0] + model.eq[1]*Q.u[dX] + model.eq[2]*Q.u[dY] + model.eq[3]*Q.u[dX]*Q.u[dX] + model.eq[4]*Q.u[dX]*Q.u[dY] + model.eq[5]*Q.u[dY]*Q.u[dY];
+
+			return static_cast<ScalarType>(fabs(Q.u[dZ] - z));
+		}
+
+	case TRI:
+		{
+			assert(model.triangleCount != 0);
+			const CCVector3* vertices = &m_triangleVertices[3 * static_cast<size_t>(model.firstTriangle)];
+
+			//triangles are processed by batches
+			static const unsigned BATCH_SIZE = 32;
+			double squareDists[BATCH_SIZE];
+			double minSquareDist = -1.0;
+			for (unsigned i=0; i<model.triangleCount; i+=BATCH_SIZE)
+			{
+				unsigned count = std::min(BATCH_SIZE,model.triangleCount-i);
+				MeshBVH::ComputeSquareDistancesToTriangles(P,vertices+3*static_cast<size_t>(i),count,squareDists);
+				for (unsigned j=0; j<count; ++j)
+					if (minSquareDist < 0 || squareDists[j] < minSquareDist)
+						minSquareDist = squareDists[j];
+			}
+			return static_cast<ScalarType>(sqrt(minSquareDist));
+		}
+
+	default:
+		assert(false);
+		break;
+	}
+
+	return NAN_VALUE;
+}
+
+bool LocalModelGrid::computeDistance(const CCVector3& cloudPoint, const CCVector3& P, ScalarType& dist) const
+{
+	if (m_models.empty())
+		return false;
+
+	//cell including the cloud point
+	CCVector3 relPos = (cloudPoint - m_origin) / m_cellSize;
+	int ci = std::min(std::max(static_cast<int>(floor(relPos.x)),0),m_gridSize-1);
+	int cj = std::min(std::max(static_cast<int>(floor(relPos.y)),0),m_gridSize-1);
+	int ck = std::min(std::max(static_cast<int>(floor(relPos.z)),0),m_gridSize-1);
+
+	//we look for the model including the cloud point with the closest center
+	//(among the models of the cell and its 26 neighbours)
+	const Model* bestModel = 0;
+	PointCoordinateType minSquareDist = 0;
+	for (int k=ck-1; k<=ck+1; ++k)
+	{
+		for (int j=cj-1; j<=cj+1; ++j)
+		{
+			for (int i=ci-1; i<=ci+1; ++i)
+			{
+				const Model* model = getCellModel(i,j,k);
+				if (model && model->squareSize > 0)
+				{
+					PointCoordinateType squareDist = (model->center - cloudPoint).norm2();
+					if (squareDist <= model->squareSize && (!bestModel || squareDist < minSquareDist))
+					{
+						bestModel = model;
+						minSquareDist = squareDist;
+					}
+				}
+			}
+		}
+	}
+
+	if (!bestModel)
+		return false;
+
+	dist = distanceToModel(*bestModel,P);
+	return true;
+}
@@ -0,0 +1,712 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "MeshBVH.h"
+
+//local
+#include "GenericIndexedMesh.h"
+#include "GenericProgressCallback.h"
+
+//system
+#include <assert.h>
+#include <stdio.h>
+#include <algorithm>
+#include <limits>
+
+using namespace CCLib;
+
+//! Max number of bins used to evaluate the Surface Area Heuristic (small nodes use fewer bins)
+static const unsigned SAH_BIN_COUNT = 16;
+
+//! Cost of a node traversal (relatively to a point/triangle distance computation)
+static const double SAH_TRAVERSAL_COST = 0.5;
+
+//! Depth above which nodes are split at the median (so that the tree depth remains bounded)
+static const unsigned MAX_SAH_DEPTH = 64;
+
+//! Max depth of the traversal stack (the tree depth is at most MAX_SAH_DEPTH + 32)
+static const unsigned MAX_STACK_DEPTH = 128;
+
+MeshBVH::MeshBVH()
+	: m_associatedMesh(0)
+{
+}
+
+MeshBVH::~MeshBVH()
+{
+}
+
+void MeshBVH::clear()
+{
+	m_nodes.clear();
+	m_vertices.clear();
+	m_triIndexes.clear();
+	m_associatedMesh = 0;
+}
+
+//! Triangle bounding-box (used during the tree build)
+struct bvhBuildTriangle
+{
+	CCVector3 bbMin;
+	CCVector3 bbMax;
+	//! Triangle index (in the mesh)
+	unsigned index;
+
+	//! Returns the (doubled) coordinate of the bounding-box center along a given dimension
+	inline PointCoordinateType center2(unsigned char dim) const { return bbMin.u[dim] + bbMax.u[dim]; }
+};
+
+//! Node to be built
+struct bvhBuildTask
+{
+	//! First triangle (in the tree order)
+	unsigned begin;
+	//! Last triangle (excluded)
+	unsigned end;
+	//! Parent node (only for second sons - MeshBVH::INVALID_INDEX otherwise)
+	unsigned parent;
+	//! Depth
+	unsigned depth;
+};
+
+//! SAH bin
+struct bvhBin
+{
+	CCVector3 bbMin;
+	CCVector3 bbMax;
+	unsigned count;
+};
+
+//! Grows a bounding-box so that it contains another one
+static inline void GrowBB(CCVector3& bbMin, CCVector3& bbMax, const CCVector3& otherMin, const CCVector3& otherMax)
+{
+	bbMin.x = std::min(bbMin.x, otherMin.x);
+	bbMin.y = std::min(bbMin.y, otherMin.y);
+	bbMin.z = std::min(bbMin.z, otherMin.z);
+	bbMax.x = std::max(bbMax.x, otherMax.x);
+	bbMax.y = std::max(bbMax.y, otherMax.y);
+	bbMax.z = std::max(bbMax.z, otherMax.z);
+}
+
+//! Returns the half area of a bounding-box
+static inline double HalfArea(const CCVector3& bbMin, const CCVector3& bbMax)
+{
+	double dx = static_cast<double>(bbMax.x) - bbMin.x;
+	double dy = static_cast<double>(bbMax.y) - bbMin.y;
+	double dz = static_cast<double>(bbMax.z) - bbMin.z;
+	return dx*dy + dy*dz + dz*dx;
+}
+
+//! Compares the triangles (bounding-box) centers along a given dimension
+struct bvhCenterComparator
+{
+	explicit bvhCenterComparator(unsigned char dim) : m_dim(dim) {}
+	inline bool operator()(const bvhBuildTriangle& a, const bvhBuildTriangle& b) const { return a.center2(m_dim) < b.center2(m_dim); }
+	unsigned char m_dim;
+};
+
+//! Computes the bin of a triangle
+struct bvhBinner
+{
+	bvhBinner(unsigned char dim, PointCoordinateType centerMin, PointCoordinateType centerMax, unsigned binCount)
+		: m_dim(dim)
+		, m_maxBin(static_cast<int>(binCount) - 1)
+		, m_centerMin(centerMin)
+		, m_scale(0)
+	{
+		if (centerMax > centerMin)
+			m_scale = static_cast<PointCoordinateType>(binCount) / (centerMax - centerMin);
+	}
+
+	inline unsigned binIndex(const bvhBuildTriangle& tri) const
+	{
+		int bin = static_cast<int>((tri.center2(m_dim) - m_centerMin) * m_scale);
+		return static_cast<unsigned>(std::max(0, std::min(bin, m_maxBin)));
+	}
+
+	unsigned char m_dim;
+	int m_maxBin;
+	PointCoordinateType m_centerMin;
+	PointCoordinateType m_scale;
+};
+
+//! Tells whether a triangle lies before a given bin (partition predicate)
+struct bvhBinPredicate
+{
+	bvhBinPredicate(const bvhBinner& binner, unsigned splitBin) : m_binner(binner), m_splitBin(splitBin) {}
+	inline bool operator()(const bvhBuildTriangle& tri) const { return m_binner.binIndex(tri) < m_splitBin; }
+	const bvhBinner& m_binner;
+	unsigned m_splitBin;
+};
+
+bool MeshBVH::buildFromMesh(GenericIndexedMesh* mesh, GenericProgressCallback* progressCb/*=0*/)
+{
+	clear();
+
+	if (!mesh)
+	{
+		assert(false);
+		return false;
+	}
+
+	unsigned triCount = mesh->size();
+	if (triCount == 0)
+		return false;
+
+	//triangles bounding-boxes (sorted in the tree order during the build)
+	std::vector<bvhBuildTriangle> buildTriangles;
+	std::vector<bvhBuildTask> tasks;
+	try
+	{
+		buildTriangles.resize(triCount);
+		m_triIndexes.resize(triCount);
+		//a leaf holds 2 or 3 triangles on average
+		m_nodes.reserve(triCount/2 + 1);
+		tasks.reserve(MAX_STACK_DEPTH);
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		clear();
+		return false;
+	}
+
+	for (unsigned i=0; i<triCount; ++i)
+	{
+		CCVector3 A,B,C;
+		mesh->getTriangleVertices(i,A,B,C);
+		bvhBuildTriangle& tri = buildTriangles[i];
+		tri.bbMin = tri.bbMax = A;
+		GrowBB(tri.bbMin,tri.bbMax,B,B);
+		GrowBB(tri.bbMin,tri.bbMax,C,C);
+		tri.index = i;
+	}
+
+	//progress notification
+	NormalizedProgress nProgress(progressCb,triCount);
+	if (progressCb)
+	{
+		char buffer[256];
+		sprintf(buffer,"Triangles: %u",triCount);
+		progressCb->reset();
+		progressCb->setInfo(buffer);
+		progressCb->setMethodTitle("Build BVH");
+		progressCb->start();
+	}
+
+	bvhBuildTriangle* triangles = &(buildTriangles[0]);
+
+	bvhBuildTask root;
+	root.begin = 0;
+	root.end = triCount;
+	root.parent = INVALID_INDEX;
+	root.depth = 0;
+	tasks.push_back(root);
+
+	bool cancelled = false;
+	while (!tasks.empty() && !cancelled)
+	{
+		bvhBuildTask task = tasks.back();
+		tasks.pop_back();
+
+		unsigned count = task.end - task.begin;
+		assert(count != 0);
+
+		//node and triangles centers bounding-boxes
+		Node node;
+		node.first = 0;
+		node.count = 0;
+		node.bbMin = node.bbMax = triangles[task.begin].bbMin;
+		CCVector3 centerMin, centerMax;
+		for (unsigned char dim=0; dim<3; ++dim)
+			centerMin.u[dim] = centerMax.u[dim] = triangles[task.begin].center2(dim);
+		for (unsigned i=task.begin; i<task.end; ++i)
+		{
+			const bvhBuildTriangle& tri = triangles[i];
+			GrowBB(node.bbMin,node.bbMax,tri.bbMin,tri.bbMax);
+			for (unsigned char dim=0; dim<3; ++dim)
+			{
+				PointCoordinateType c = tri.center2(dim);
+				if (c < centerMin.u[dim])
+					centerMin.u[dim] = c;
+				else if (c > centerMax.u[dim])
+					centerMax.u[dim] = c;
+			}
+		}
+
+		//largest dimension of the centers bounding-box
+		unsigned char largestDim = 0;
+		for (unsigned char dim=1; dim<3; ++dim)
+			if (centerMax.u[dim] - centerMin.u[dim] > centerMax.u[largestDim] - centerMin.u[largestDim])
+				largestDim = dim;
+
+		unsigned splitPos = task.begin; //split position (task.begin = leaf)
+		if (count > 1)
+		{
+			bool medianSplit = false;
+			if (centerMax.u[largestDim] <= centerMin.u[largestDim])
+			{
+				//all the centers are the same: we can only split the set arbitrarily
+				if (count > MAX_LEAF_SIZE)
+					splitPos = task.begin + count/2;
+			}
+			else if (task.depth >= MAX_SAH_DEPTH)
+			{
+				medianSplit = true;
+			}
+			else
+			{
+				//Surface Area Heuristic (binned)
+				double nodeArea = HalfArea(node.bbMin,node.bbMax);
+				double bestCost = std::numeric_limits<double>::max();
+				unsigned char bestDim = 0;
+				unsigned bestSplitBin = 0;
+
+				//the triangles are binned along the 3 dimensions at once
+				unsigned binCount = std::min(count, SAH_BIN_COUNT);
+				bvhBin allBins[3][SAH_BIN_COUNT];
+				{
+					bvhBinner binners[3] = {	bvhBinner(0,centerMin.x,centerMax.x,binCount),
+												bvhBinner(1,centerMin.y,centerMax.y,binCount),
+												bvhBinner(2,centerMin.z,centerMax.z,binCount) };
+					for (unsigned char dim=0; dim<3; ++dim)
+						for (unsigned b=0; b<binCount; ++b)
+							allBins[dim][b].count = 0;
+					for (unsigned i=task.begin; i<task.end; ++i)
+					{
+						const bvhBuildTriangle& tri = triangles[i];
+						for (unsigned char dim=0; dim<3; ++dim)
+						{
+							//flat dimensions are ignored
+							if (centerMax.u[dim] <= centerMin.u[dim])
+								continue;
+							bvhBin& bin = allBins[dim][binners[dim].binIndex(tri)];
+							if (bin.count++ == 0)
+							{
+								bin.bbMin = tri.bbMin;
+								bin.bbMax = tri.bbMax;
+							}
+							else
+							{
+								GrowBB(bin.bbMin,bin.bbMax,tri.bbMin,tri.bbMax);
+							}
+						}
+					}
+				}
+
+				for (unsigned char dim=0; dim<3; ++dim)
+				{
+					if (centerMax.u[dim] <= centerMin.u[dim])
+						continue;
+
+					const bvhBin* bins = allBins[dim];
+
+					//cost of the triangles on the right of each split (from the right)
+					double rightCosts[SAH_BIN_COUNT];
+					{
+						CCVector3 bbMin, bbMax;
+						unsigned rightCount = 0;
+						for (unsigned b=binCount-1; b>0; --b)
+						{
+							if (bins[b].count != 0)
+							{
+								if (rightCount == 0)
+								{
+									bbMin = bins[b].bbMin;
+									bbMax = bins[b].bbMax;
+								}
+								else
+								{
+									GrowBB(bbMin,bbMax,bins[b].bbMin,bins[b].bbMax);
+								}
+								rightCount += bins[b].count;
+							}
+							rightCosts[b] = (rightCount != 0 ? HalfArea(bbMin,bbMax) * rightCount : -1.0);
+						}
+					}
+
+					//then we add the cost of the triangles on the left
+					CCVector3 bbMin, bbMax;
+					unsigned leftCount = 0;
+					for (unsigned b=1; b<binCount; ++b)
+					{
+						const bvhBin& leftBin = bins[b-1];
+						if (leftBin.count != 0)
+						{
+							if (leftCount == 0)
+							{
+								bbMin = leftBin.bbMin;
+								bbMax = leftBin.bbMax;
+							}
+							else
+							{
+								GrowBB(bbMin,bbMax,leftBin.bbMin,leftBin.bbMax);
+							}
+							leftCount += leftBin.count;
+						}
+						//both sides must be non empty
+						if (leftCount == 0 || rightCosts[b] < 0)
+							continue;
+
+						double cost = HalfArea(bbMin,bbMax) * leftCount + rightCosts[b];
+						if (cost < bestCost)
+						{
+							bestCost = cost;
+							bestDim = dim;
+							bestSplitBin = b;
+						}
+					}
+				}
+
+				assert(bestSplitBin != 0);
+				bestCost = (nodeArea > 0 ? SAH_TRAVERSAL_COST + bestCost / nodeArea : static_cast<double>(count));
+
+				//we only make a leaf if it's cheaper than splitting the node
+				if (count > MAX_LEAF_SIZE || bestCost < static_cast<double>(count))
+				{
+					bvhBinner binner(bestDim,centerMin.u[bestDim],centerMax.u[bestDim],binCount);
+					splitPos = static_cast<unsigned>(std::partition(triangles + task.begin, triangles + task.end, bvhBinPredicate(binner,bestSplitBin)) - triangles);
+					//should not happen (both sides of the best split are non empty)
+					if (splitPos == task.begin || splitPos == task.end)
+						medianSplit = true;
+				}
+			}
+
+			if (medianSplit)
+			{
+				splitPos = task.begin + count/2;
+				std::nth_element(triangles + task.begin, triangles + splitPos, triangles + task.end, bvhCenterComparator(largestDim));
+			}
+		}
+
+		unsigned nodeIndex = static_cast<unsigned>(m_nodes.size());
+		try
+		{
+			m_nodes.push_back(node);
+		}
+		catch (const std::bad_alloc&) //out of memory
+		{
+			clear();
+			return false;
+		}
+		if (task.parent != INVALID_INDEX)
+			m_nodes[task.parent].first = nodeIndex;
+
+		if (splitPos == task.begin)
+		{
+			//leaf
+			assert(count <= MAX_LEAF_SIZE);
+			m_nodes.back().first = task.begin;
+			m_nodes.back().count = count;
+
+			if (progressCb && !nProgress.steps(count))
+			{
+				//process cancelled by the user
+				cancelled = true;
+			}
+		}
+		else
+		{
+			m_nodes.back().first = INVALID_INDEX; //updated when the second son is built
+			m_nodes.back().count = 0;
+
+			//the second son is pushed first so that the first son is built right after its parent
+			bvhBuildTask rightTask;
+			rightTask.begin = splitPos;
+			rightTask.end = task.end;
+			rightTask.parent = nodeIndex;
+			rightTask.depth = task.depth+1;
+			bvhBuildTask leftTask;
+			leftTask.begin = task.begin;
+			leftTask.end = splitPos;
+			leftTask.parent = INVALID_INDEX;
+			leftTask.depth = task.depth+1;
+			tasks.push_back(rightTask);
+			tasks.push_back(leftTask);
+		}
+	}
+
+	if (cancelled)
+	{
+		clear();
+		return false;
+	}
+
+	//release the build structures before copying the vertices
+	for (unsigned i=0; i<triCount; ++i)
+		m_triIndexes[i] = buildTriangles[i].index;
+	std::vector<bvhBuildTriangle>().swap(buildTriangles);
+	std::vector<Node>(m_nodes).swap(m_nodes);
+
+	try
+	{
+		m_vertices.resize(3*static_cast<size_t>(triCount));
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		clear();
+		return false;
+	}
+
+	for (unsigned i=0; i<triCount; ++i)
+	{
+		CCVector3* V = &(m_vertices[3*static_cast<size_t>(i)]);
+		mesh->getTriangleVertices(m_triIndexes[i],V[0],V[1],V[2]);
+	}
+
+	m_associatedMesh = mesh;
+
+	return true;
+}
+
+//! Square distance between a point and a segment
+static inline double PointToSegmentSquareDistance(const CCVector3d& P, const CCVector3d& A, const CCVector3d& B)
+{
+	CCVector3d AB = B - A;
+	CCVector3d AP = P - A;
+	double l2 = AB.norm2();
+	double t = (l2 > 0 ? AP.dot(AB) / l2 : 0);
+	if (t <= 0)
+		return AP.norm2();
+	else if (t >= 1.0)
+		return (P - B).norm2();
+	return (AP - AB * t).norm2();
+}
+
+//! Square distance between a point and a triangle
+/** Closest point determination based on the Voronoi regions of the triangle
+	(see C. Ericson, Real-Time Collision Detection, section 5.1.5). Computations
+	are done with double precision (as in DistanceComputationTools::computePoint2TriangleDistance).
+**/
+static inline double PointToTriangleSquareDistance(const CCVector3& _P, const CCVector3& _A, const CCVector3& _B, const CCVector3& _C)
+{
+	CCVector3d A(_A.x, _A.y, _A.z);
+	CCVector3d AB(static_cast<double>(_B.x) - A.x, static_cast<double>(_B.y) - A.y, static_cast<double>(_B.z) - A.z);
+	CCVector3d AC(static_cast<double>(_C.x) - A.x, static_cast<double>(_C.y) - A.y, static_cast<double>(_C.z) - A.z);
+	CCVector3d AP(static_cast<double>(_P.x) - A.x, static_cast<double>(_P.y) - A.y, static_cast<double>(_P.z) - A.z);
+
+	//vertex region A
+	double d1 = AB.dot(AP);
+	double d2 = AC.dot(AP);
+	if (d1 <= 0 && d2 <= 0)
+		return AP.norm2();
+
+	//vertex region B
+	CCVector3d BP = AP - AB;
+	double d3 = AB.dot(BP);
+	double d4 = AC.dot(BP);
+	if (d3 >= 0 && d4 <= d3)
+		return BP.norm2();
+
+	//edge region AB
+	double vc = d1*d4 - d3*d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0)
+	{
+		double v = d1 / (d1 - d3);
+		return (AP - AB * v).norm2();
+	}
+
+	//vertex region C
+	CCVector3d CP = AP - AC;
+	double d5 = AB.dot(CP);
+	double d6 = AC.dot(CP);
+	if (d6 >= 0 && d5 <= d6)
+		return CP.norm2();
+
+	//edge region AC
+	double vb = d5*d2 - d1*d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0)
+	{
+		double w = d2 / (d2 - d6);
+		return (AP - AC * w).norm2();
+	}
+
+	//edge region BC
+	double va = d3*d6 - d5*d4;
+	if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+	{
+		double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		return (BP - (AC - AB) * w).norm2();
+	}
+
+	double denom = va + vb + vc;
+	if (denom <= 0)
+	{
+		//degenerate triangle
+		CCVector3d P(_P.x, _P.y, _P.z);
+		CCVector3d B = A + AB;
+		CCVector3d C = A + AC;
+		return std::min(PointToSegmentSquareDistance(P,A,B), std::min(PointToSegmentSquareDistance(P,B,C), PointToSegmentSquareDistance(P,C,A)));
+	}
+
+	//face region
+	double v = vb / denom;
+	double w = vc / denom;
+	return (AP - AB * v - AC * w).norm2();
+}
+
+void MeshBVH::ComputeSquareDistancesToTriangles(const CCVector3& P,
+												const CCVector3* vertices,
+												unsigned count,
+												double* squareDists)
+{
+	for (unsigned i=0; i<count; ++i, vertices += 3)
+		squareDists[i] = PointToTriangleSquareDistance(P, vertices[0], vertices[1], vertices[2]);
+}
+
+//! Traversal stack element
+struct bvhStackItem
+{
+	//! Node index
+	unsigned node;
+	//! Min. square distance between the query point and the node
+	PointCoordinateType sqrDist;
+};
+
+bool MeshBVH::findNearestTriangle(	const CCVector3& queryPoint,
+									unsigned& triIndex,
+									double& squareDist,
+									double maxSquareDist/*=0*/,
+									CCVector3* triVertices/*=0*/) const
+{
+	if (m_nodes.empty())
+		return false;
+
+	double bestSqrDist = (maxSquareDist > 0 ? maxSquareDist : std::numeric_limits<double>::max());
+	unsigned bestPos = INVALID_INDEX;
+
+	double leafSqrDists[MAX_LEAF_SIZE];
+	bvhStackItem stack[MAX_STACK_DEPTH];
+	unsigned stackSize = 0;
+	stack[stackSize].node = 0;
+	stack[stackSize].sqrDist = PointToNodeSquareDistance(queryPoint,m_nodes[0]);
+	++stackSize;
+
+	while (stackSize != 0)
+	{
+		bvhStackItem item = stack[--stackSize];
+		if (item.sqrDist >= bestSqrDist)
+			continue;
+
+		const Node& node = m_nodes[item.node];
+		if (node.count != 0)
+		{
+			ComputeSquareDistancesToTriangles(queryPoint, &(m_vertices[3*static_cast<size_t>(node.first)]), node.count, leafSqrDists);
+			for (unsigned i=0; i<node.count; ++i)
+			{
+				if (leafSqrDists[i] < bestSqrDist)
+				{
+					bestSqrDist = leafSqrDists[i];
+					bestPos = node.first + i;
+				}
+			}
+		}
+		else
+		{
+			//we push the farthest son first so that the nearest one is processed first
+			unsigned nearSon = item.node+1;
+			unsigned farSon = node.first;
+			PointCoordinateType nearDist = PointToNodeSquareDistance(queryPoint,m_nodes[nearSon]);
+			PointCoordinateType farDist = PointToNodeSquareDistance(queryPoint,m_nodes[farSon]);
+			if (farDist < nearDist)
+			{
+				std::swap(nearSon,farSon);
+				std::swap(nearDist,farDist);
+			}
+			assert(stackSize+2 <= MAX_STACK_DEPTH);
+			if (farDist < bestSqrDist)
+			{
+				stack[stackSize].node = farSon;
+				stack[stackSize].sqrDist = farDist;
+				++stackSize;
+			}
+			if (nearDist < bestSqrDist)
+			{
+				stack[stackSize].node = nearSon;
+				stack[stackSize].sqrDist = nearDist;
+				++stackSize;
+			}
+		}
+	}
+
+	if (bestPos == INVALID_INDEX)
+		return false;
+
+	triIndex = m_triIndexes[bestPos];
+	squareDist = bestSqrDist;
+	if (triVertices)
+	{
+		const CCVector3* V = &(m_vertices[3*static_cast<size_t>(bestPos)]);
+		triVertices[0] = V[0];
+		triVertices[1] = V[1];
+		triVertices[2] = V[2];
+	}
+	return true;
+}
+
+bool MeshBVH::toFile(FILE* fp) const
+{
+	assert(fp);
+
+	unsigned header[2] = {	static_cast<unsigned>(m_nodes.size()),
+							static_cast<unsigned>(m_triIndexes.size()) };
+	if (fwrite(header, sizeof(unsigned), 2, fp) != 2)
+		return false;
+
+	if (	(!m_nodes.empty()		&& fwrite(&(m_nodes[0]), sizeof(Node), m_nodes.size(), fp) != m_nodes.size())
+		||	(!m_triIndexes.empty()	&& fwrite(&(m_triIndexes[0]), sizeof(unsigned), m_triIndexes.size(), fp) != m_triIndexes.size())
+		||	(!m_vertices.empty()	&& fwrite(&(m_vertices[0]), sizeof(CCVector3), m_vertices.size(), fp) != m_vertices.size()) )
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshBVH::fromFile(FILE* fp)
+{
+	assert(fp);
+
+	clear();
+
+	unsigned header[2];
+	if (fread(header, sizeof(unsigned), 2, fp) != 2)
+		return false;
+	if ((header[0] == 0) != (header[1] == 0))
+		return false; //inconsistent header
+
+	try
+	{
+		m_nodes.resize(header[0]);
+		m_triIndexes.resize(header[1]);
+		m_vertices.resize(3*static_cast<size_t>(header[1]));
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		clear();
+		return false;
+	}
+
+	if (	(!m_nodes.empty()		&& fread(&(m_nodes[0]), sizeof(Node), m_nodes.size(), fp) != m_nodes.size())
+		||	(!m_triIndexes.empty()	&& fread(&(m_triIndexes[0]), sizeof(unsigned), m_triIndexes.size(), fp) != m_triIndexes.size())
+		||	(!m_vertices.empty()	&& fread(&(m_vertices[0]), sizeof(CCVector3), m_vertices.size(), fp) != m_vertices.size()) )
+	{
+		clear();
+		return false;
+	}
+
+	return true;
+}
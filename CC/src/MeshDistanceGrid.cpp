@@ -0,0 +1,614 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "MeshDistanceGrid.h"
+
+//local
+#include "DistanceComputationTools.h"
+#include "GenericIndexedMesh.h"
+#include "GenericProgressCallback.h"
+#include "ParallelTools.h"
+#include "SaitoSquaredDistanceTransform.h"
+#include "SimpleTriangle.h"
+
+//system
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <limits>
+
+#ifdef USE_QT
+#include <QtCore>
+#include <QtConcurrentMap>
+#endif
+
+using namespace CCLib;
+
+//! Number of bricks processed by a single thread in a row (nodes computation)
+static const unsigned BRICKS_PER_CHUNK = 16;
+
+//! Max number of bricks (along all dimensions)
+static const double MAX_BRICK_COUNT = static_cast<double>(1 << 30);
+
+//! Grid file signature
+static const char GRID_FILE_SIGNATURE[4] = { 'C', 'C', 'D', 'G' };
+
+//! Grid file version
+static const unsigned GRID_FILE_VERSION = 2;
+
+//! Checksum of the mesh vertices and triangles (Fletcher-like)
+class MeshChecksum
+{
+public:
+	//! Default constructor
+	MeshChecksum() : m_sum1(0), m_sum2(0) {}
+
+	//! Adds a value
+	inline void add(unsigned value) { m_sum1 += value; m_sum2 += m_sum1; }
+
+	//! Adds a point (its coordinates are processed as raw words)
+	inline void add(const CCVector3& P)
+	{
+		unsigned words[sizeof(CCVector3) / sizeof(unsigned)];
+		memcpy(words, P.u, sizeof(words));
+		for (size_t i=0; i<sizeof(words) / sizeof(unsigned); ++i)
+			add(words[i]);
+	}
+
+	//! Returns the checksum value
+	inline unsigned long long value() const { return m_sum2 ^ (m_sum1 << 32) ^ (m_sum1 >> 32); }
+
+protected:
+	unsigned long long m_sum1;
+	unsigned long long m_sum2;
+};
+
+//! Computes the checksum of the vertices and triangles of a mesh
+static unsigned long long ComputeMeshChecksum(GenericIndexedMesh* mesh)
+{
+	MeshChecksum checksum;
+	CCVector3 A, B, C;
+	for (unsigned n=0; n<mesh->size(); ++n)
+	{
+		const VerticesIndexes* tri = mesh->getTriangleVertIndexes(n);
+		checksum.add(tri->i1);
+		checksum.add(tri->i2);
+		checksum.add(tri->i3);
+		mesh->getTriangleVertices(n, A, B, C);
+		checksum.add(A);
+		checksum.add(B);
+		checksum.add(C);
+	}
+	return checksum.value();
+}
+
+MeshDistanceGrid::MeshDistanceGrid()
+	: m_origin(0,0,0)
+	, m_cellSize(0)
+	, m_bandWidth(0)
+	, m_exactBandWidth(0)
+	, m_brickGridSize(0,0,0)
+	, m_meshTriangleCount(0)
+	, m_meshMinBB(0,0,0)
+	, m_meshMaxBB(0,0,0)
+	, m_meshChecksum(0)
+{
+}
+
+MeshDistanceGrid::~MeshDistanceGrid()
+{
+}
+
+void MeshDistanceGrid::clear()
+{
+	m_brickIndexes.clear();
+	m_nodeValues.clear();
+	m_bvh.clear();
+	m_brickGridSize.x = m_brickGridSize.y = m_brickGridSize.z = 0;
+	m_meshTriangleCount = 0;
+	m_meshChecksum = 0;
+}
+
+//! Chunk of bricks processed by a single thread (nodes computation)
+struct gridBricksChunk
+{
+	//! Hierarchy built on the mesh
+	const MeshBVH* bvh;
+	//! Grid origin
+	CCVector3 origin;
+	//! Grid step
+	PointCoordinateType cellSize;
+	//! Bricks to process (position in the grid of bricks)
+	const Tuple3ui* bricks;
+	//! Nodes values of the first brick
+	ScalarType* values;
+	//! Number of bricks
+	unsigned count;
+	//! Progress notification (per chunk)
+	NormalizedProgress* nProgress;
+	//! Whether the process has been cancelled (shared by all chunks)
+	Parallel::AtomicFlag* cancelled;
+};
+
+static void ComputeBrickNodesChunk(gridBricksChunk& chunk)
+{
+	if (chunk.cancelled->isSet())
+		return;
+
+	const unsigned brickSize = MeshDistanceGrid::BRICK_SIZE;
+	const unsigned brickNodes = brickSize + 1;
+	const double cellSize = chunk.cellSize;
+
+	for (unsigned b=0; b<chunk.count; ++b)
+	{
+		const Tuple3ui& brick = chunk.bricks[b];
+		ScalarType* values = chunk.values + static_cast<size_t>(b) * (brickNodes * brickNodes * brickNodes);
+
+		for (unsigned k=0; k<brickNodes; ++k)
+		{
+			for (unsigned j=0; j<brickNodes; ++j)
+			{
+				SimpleTriangle previousTri;
+				for (unsigned i=0; i<brickNodes; ++i)
+				{
+					CCVector3 P = chunk.origin + CCVector3(	static_cast<PointCoordinateType>(brick.x * brickSize + i) * chunk.cellSize,
+															static_cast<PointCoordinateType>(brick.y * brickSize + j) * chunk.cellSize,
+															static_cast<PointCoordinateType>(brick.z * brickSize + k) * chunk.cellSize );
+
+					//the nearest triangle of the previous node (along X) gives a tight upper bound
+					double maxSquareDist = 0;
+					if (i != 0)
+					{
+						double squareBound = DistanceComputationTools::computePoint2TriangleDistance(&P, &previousTri, false);
+						maxSquareDist = squareBound * (1.0 + 1.0e-5) + cellSize * cellSize * 1.0e-10;
+					}
+
+					unsigned triIndex = 0;
+					double squareDist = 0;
+					CCVector3 V[3];
+					if (!chunk.bvh->findNearestTriangle(P, triIndex, squareDist, maxSquareDist, V))
+					{
+						//shouldn't happen (round-off issue?)
+						chunk.bvh->findNearestTriangle(P, triIndex, squareDist, 0, V);
+					}
+
+					previousTri = SimpleTriangle(V[0], V[1], V[2]);
+					values[(k * brickNodes + j) * brickNodes + i] = DistanceComputationTools::computePoint2TriangleDistance(&P, &previousTri, true);
+				}
+			}
+		}
+	}
+
+	if (chunk.nProgress && !chunk.nProgress->oneStep())
+	{
+		//process cancelled by the user
+		chunk.cancelled->set();
+	}
+}
+
+bool MeshDistanceGrid::build(	GenericIndexedMesh* mesh,
+								PointCoordinateType cellSize,
+								PointCoordinateType bandWidth,
+								PointCoordinateType exactBandWidth,
+								GenericProgressCallback* progressCb/*=0*/)
+{
+	clear();
+
+	if (!mesh || mesh->size() == 0 || cellSize <= 0 || bandWidth < 0)
+	{
+		assert(false);
+		return false;
+	}
+
+	m_cellSize = cellSize;
+	m_bandWidth = bandWidth;
+	m_exactBandWidth = exactBandWidth;
+	m_meshTriangleCount = mesh->size();
+	mesh->getBoundingBox(m_meshMinBB, m_meshMaxBB);
+	m_meshChecksum = ComputeMeshChecksum(mesh);
+
+	//the grid covers the mesh bounding-box enlarged by the band width (+ one cell)
+	const PointCoordinateType brickLength = cellSize * BRICK_SIZE;
+	const PointCoordinateType margin = bandWidth + cellSize;
+	m_origin = m_meshMinBB - CCVector3(margin, margin, margin);
+	{
+		CCVector3 diag = m_meshMaxBB - m_meshMinBB;
+		double brickCount = 1.0;
+		for (unsigned char k=0; k<3; ++k)
+		{
+			double n = std::max(1.0, ceil(static_cast<double>(diag.u[k] + 2 * margin) / brickLength));
+			brickCount *= n;
+			if (brickCount > MAX_BRICK_COUNT)
+			{
+				//the grid step is too small
+				return false;
+			}
+			m_brickGridSize.u[k] = static_cast<unsigned>(n);
+		}
+	}
+
+	//we determine the bricks lying in the band with a distance transform computed on the grid of bricks
+	std::vector<Tuple3ui> bricks;
+	{
+		SaitoSquaredDistanceTransform dt;
+		if (	!dt.initGrid(m_brickGridSize)
+			||	!dt.initDT(mesh, brickLength, m_origin, progressCb)
+			||	!dt.propagateDistance(progressCb) )
+		{
+			//not enough memory (or process cancelled by the user)
+			clear();
+			return false;
+		}
+
+		//a point lying at a distance d from the mesh belongs to a brick which center
+		//is at most at (d + brick diagonal) from the center of a brick intersecting the mesh
+		double maxBrickDist = (bandWidth + sqrt(3.0) * brickLength) / brickLength;
+		double maxSquareBrickDist = maxBrickDist * maxBrickDist;
+
+		try
+		{
+			m_brickIndexes.resize(dt.innerCellCount(), static_cast<unsigned>(INVALID_INDEX));
+			for (unsigned k=0; k<m_brickGridSize.z; ++k)
+			{
+				for (unsigned j=0; j<m_brickGridSize.y; ++j)
+				{
+					for (unsigned i=0; i<m_brickGridSize.x; ++i)
+					{
+						if (static_cast<double>(dt.getValue(i,j,k)) <= maxSquareBrickDist)
+						{
+							m_brickIndexes[(static_cast<size_t>(k) * m_brickGridSize.y + j) * m_brickGridSize.x + i] = static_cast<unsigned>(bricks.size());
+							bricks.push_back(Tuple3ui(i,j,k));
+						}
+					}
+				}
+			}
+			m_nodeValues.resize(bricks.size() * static_cast<size_t>(NODES_PER_BRICK));
+		}
+		catch (const std::bad_alloc&) //out of memory
+		{
+			clear();
+			return false;
+		}
+	}
+
+	if (!m_bvh.buildFromMesh(mesh, progressCb))
+	{
+		//not enough memory (or process cancelled by the user)
+		clear();
+		return false;
+	}
+
+	if (bricks.empty())
+	{
+		assert(false);
+		return true;
+	}
+
+	//now we compute the exact distance at each node of the allocated bricks
+	std::vector<gridBricksChunk> chunks;
+	try
+	{
+		chunks.resize((bricks.size() + BRICKS_PER_CHUNK - 1) / BRICKS_PER_CHUNK);
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		clear();
+		return false;
+	}
+
+	NormalizedProgress nProgress(progressCb, static_cast<unsigned>(chunks.size()));
+	if (progressCb)
+	{
+		char buffer[256];
+		sprintf(buffer, "Bricks: %u (%u nodes each)", static_cast<unsigned>(bricks.size()), NODES_PER_BRICK);
+		progressCb->reset();
+		progressCb->setInfo(buffer);
+		progressCb->setMethodTitle("Distance grid");
+		progressCb->start();
+	}
+
+	Parallel::AtomicFlag cancelled;
+	for (size_t n=0; n<chunks.size(); ++n)
+	{
+		gridBricksChunk& chunk = chunks[n];
+		size_t first = n * BRICKS_PER_CHUNK;
+		chunk.bvh = &m_bvh;
+		chunk.origin = m_origin;
+		chunk.cellSize = m_cellSize;
+		chunk.bricks = &(bricks[first]);
+		chunk.values = &(m_nodeValues[first * NODES_PER_BRICK]);
+		chunk.count = static_cast<unsigned>(std::min<size_t>(BRICKS_PER_CHUNK, bricks.size() - first));
+		chunk.nProgress = (progressCb ? &nProgress : 0);
+		chunk.cancelled = &cancelled;
+	}
+
+#ifdef USE_QT
+	if (chunks.size() > 1)
+	{
+		QtConcurrent::blockingMap(chunks, ComputeBrickNodesChunk);
+	}
+	else
+#endif
+	{
+		for (size_t n=0; n<chunks.size(); ++n)
+			ComputeBrickNodesChunk(chunks[n]);
+	}
+
+	if (cancelled.isSet())
+	{
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshDistanceGrid::isCompatibleWith(GenericIndexedMesh* mesh) const
+{
+	if (!mesh || !isValid() || mesh->size() != m_meshTriangleCount)
+		return false;
+
+	CCVector3 bbMin, bbMax;
+	mesh->getBoundingBox(bbMin, bbMax);
+	for (unsigned char k=0; k<3; ++k)
+		if (bbMin.u[k] != m_meshMinBB.u[k] || bbMax.u[k] != m_meshMaxBB.u[k])
+			return false;
+
+	//same size and extents: we must check the vertices and triangles themselves
+	return ComputeMeshChecksum(mesh) == m_meshChecksum;
+}
+
+bool MeshDistanceGrid::interpolateDistance(const CCVector3& P, ScalarType& signedDist, PointCoordinateType* upperBound/*=0*/, bool* signChange/*=0*/) const
+{
+	if (m_brickIndexes.empty())
+		return false;
+
+	//position in the grid (in cells)
+	CCVector3 Q = (P - m_origin) / m_cellSize;
+	Tuple3ui cellPos;
+	CCVector3 t;
+	for (unsigned char k=0; k<3; ++k)
+	{
+		if (!(Q.u[k] >= 0)) //NaN values are rejected as well
+			return false;
+		unsigned cellCount = m_brickGridSize.u[k] * BRICK_SIZE;
+		if (Q.u[k] >= static_cast<PointCoordinateType>(cellCount))
+		{
+			if (Q.u[k] > static_cast<PointCoordinateType>(cellCount))
+				return false;
+			cellPos.u[k] = cellCount - 1;
+		}
+		else
+		{
+			cellPos.u[k] = static_cast<unsigned>(Q.u[k]);
+		}
+		t.u[k] = Q.u[k] - static_cast<PointCoordinateType>(cellPos.u[k]);
+	}
+
+	unsigned brickIndex = m_brickIndexes[	(static_cast<size_t>(cellPos.z / BRICK_SIZE) * m_brickGridSize.y + cellPos.y / BRICK_SIZE) * m_brickGridSize.x
+											+ cellPos.x / BRICK_SIZE ];
+	if (brickIndex == INVALID_INDEX)
+	{
+		//outside of the band
+		return false;
+	}
+
+	//values of the 8 corners of the cell
+	const ScalarType* v =	&(m_nodeValues[static_cast<size_t>(brickIndex) * NODES_PER_BRICK])
+						+	((cellPos.z % BRICK_SIZE) * BRICK_NODES + (cellPos.y % BRICK_SIZE)) * BRICK_NODES + (cellPos.x % BRICK_SIZE);
+	const unsigned offsets[8] = {	0,
+									1,
+									BRICK_NODES,
+									BRICK_NODES + 1,
+									BRICK_NODES * BRICK_NODES,
+									BRICK_NODES * BRICK_NODES + 1,
+									BRICK_NODES * BRICK_NODES + BRICK_NODES,
+									BRICK_NODES * BRICK_NODES + BRICK_NODES + 1 };
+
+	//trilinear interpolation of the unsigned distances (the signed distance is not continuous
+	//across the extension of the mesh borders, while the unsigned distance always is)
+	ScalarType absValues[8];
+	unsigned negativeCount = 0;
+	for (unsigned c=0; c<8; ++c)
+	{
+		ScalarType value = v[offsets[c]];
+		if (value < 0)
+			++negativeCount;
+		absValues[c] = fabs(value);
+	}
+	{
+		ScalarType x00 = absValues[0] + (absValues[1] - absValues[0]) * t.x;
+		ScalarType x10 = absValues[2] + (absValues[3] - absValues[2]) * t.x;
+		ScalarType x01 = absValues[4] + (absValues[5] - absValues[4]) * t.x;
+		ScalarType x11 = absValues[6] + (absValues[7] - absValues[6]) * t.x;
+		ScalarType y0 = x00 + (x10 - x00) * t.y;
+		ScalarType y1 = x01 + (x11 - x01) * t.y;
+		signedDist = y0 + (y1 - y0) * t.z;
+	}
+	//the sign is given by the majority of the corners
+	if (2 * negativeCount > 8)
+		signedDist = -signedDist;
+	if (signChange)
+		*signChange = (negativeCount != 0 && negativeCount != 8);
+
+	if (upperBound)
+	{
+		//the distance to the mesh is 1-Lipschitz: d(P) <= d(corner) + ||P - corner||
+		PointCoordinateType minBound = std::numeric_limits<PointCoordinateType>::max();
+		for (unsigned c=0; c<8; ++c)
+		{
+			CCVector3 d(	(c & 1) ? 1 - t.x : t.x,
+							(c & 2) ? 1 - t.y : t.y,
+							(c & 4) ? 1 - t.z : t.z );
+			PointCoordinateType bound = absValues[c] + d.norm() * m_cellSize;
+			if (bound < minBound)
+				minBound = bound;
+		}
+		*upperBound = minBound;
+	}
+
+	return true;
+}
+
+//! Grid file header (after the signature and the version)
+struct gridFileHeader
+{
+	//! Size of the coordinates type (in bytes)
+	unsigned coordSize;
+	//! Size of the scalar type (in bytes)
+	unsigned scalarSize;
+	//! Number of triangles of the mesh
+	unsigned meshTriangleCount;
+	//! Checksum of the mesh vertices and triangles
+	unsigned long long meshChecksum;
+	//! Number of allocated bricks
+	unsigned brickCount;
+	//! Number of bricks (along each dimension)
+	Tuple3ui brickGridSize;
+	//! Mesh bounding-box (min corner)
+	CCVector3 meshMinBB;
+	//! Mesh bounding-box (max corner)
+	CCVector3 meshMaxBB;
+	//! Grid origin
+	CCVector3 origin;
+	//! Grid step
+	PointCoordinateType cellSize;
+	//! Band width
+	PointCoordinateType bandWidth;
+	//! Exact band width
+	PointCoordinateType exactBandWidth;
+};
+
+bool MeshDistanceGrid::saveToFile(const char* filename) const
+{
+	if (!isValid())
+		return false;
+
+	FILE* fp = fopen(filename, "wb");
+	if (!fp)
+		return false;
+
+	gridFileHeader header;
+	header.coordSize = static_cast<unsigned>(sizeof(PointCoordinateType));
+	header.scalarSize = static_cast<unsigned>(sizeof(ScalarType));
+	header.meshTriangleCount = m_meshTriangleCount;
+	header.meshChecksum = m_meshChecksum;
+	header.brickCount = brickCount();
+	for (unsigned char k=0; k<3; ++k)
+		header.brickGridSize.u[k] = m_brickGridSize.u[k];
+	header.meshMinBB = m_meshMinBB;
+	header.meshMaxBB = m_meshMaxBB;
+	header.origin = m_origin;
+	header.cellSize = m_cellSize;
+	header.bandWidth = m_bandWidth;
+	header.exactBandWidth = m_exactBandWidth;
+
+	bool success =		fwrite(GRID_FILE_SIGNATURE, 1, 4, fp) == 4
+					&&	fwrite(&GRID_FILE_VERSION, sizeof(unsigned), 1, fp) == 1
+					&&	fwrite(&header, sizeof(gridFileHeader), 1, fp) == 1;
+
+	//we only save the position of the allocated bricks (in the storage order)
+	for (size_t i=0; success && i<m_brickIndexes.size(); ++i)
+	{
+		if (m_brickIndexes[i] != INVALID_INDEX)
+		{
+			unsigned pos = static_cast<unsigned>(i);
+			success = (fwrite(&pos, sizeof(unsigned), 1, fp) == 1);
+		}
+	}
+
+	if (success && !m_nodeValues.empty())
+		success = (fwrite(&(m_nodeValues[0]), sizeof(ScalarType), m_nodeValues.size(), fp) == m_nodeValues.size());
+
+	if (success)
+		success = m_bvh.toFile(fp);
+
+	fclose(fp);
+
+	return success;
+}
+
+bool MeshDistanceGrid::loadFromFile(const char* filename)
+{
+	clear();
+
+	FILE* fp = fopen(filename, "rb");
+	if (!fp)
+		return false;
+
+	char signature[4];
+	unsigned version = 0;
+	gridFileHeader header;
+	if (	fread(signature, 1, 4, fp) != 4
+		||	memcmp(signature, GRID_FILE_SIGNATURE, 4) != 0
+		||	fread(&version, sizeof(unsigned), 1, fp) != 1
+		||	version != GRID_FILE_VERSION
+		||	fread(&header, sizeof(gridFileHeader), 1, fp) != 1
+		||	header.coordSize != sizeof(PointCoordinateType)
+		||	header.scalarSize != sizeof(ScalarType)
+		||	static_cast<double>(header.brickGridSize.x) * header.brickGridSize.y * header.brickGridSize.z > MAX_BRICK_COUNT )
+	{
+		//not a (compatible) grid file
+		fclose(fp);
+		return false;
+	}
+
+	m_meshTriangleCount = header.meshTriangleCount;
+	m_meshChecksum = header.meshChecksum;
+	for (unsigned char k=0; k<3; ++k)
+		m_brickGridSize.u[k] = header.brickGridSize.u[k];
+	m_meshMinBB = header.meshMinBB;
+	m_meshMaxBB = header.meshMaxBB;
+	m_origin = header.origin;
+	m_cellSize = header.cellSize;
+	m_bandWidth = header.bandWidth;
+	m_exactBandWidth = header.exactBandWidth;
+
+	bool success = true;
+	try
+	{
+		m_brickIndexes.resize(static_cast<size_t>(m_brickGridSize.x) * m_brickGridSize.y * m_brickGridSize.z, static_cast<unsigned>(INVALID_INDEX));
+		m_nodeValues.resize(static_cast<size_t>(header.brickCount) * NODES_PER_BRICK);
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		success = false;
+	}
+
+	for (unsigned n=0; success && n<header.brickCount; ++n)
+	{
+		unsigned pos = 0;
+		success = (fread(&pos, sizeof(unsigned), 1, fp) == 1 && pos < m_brickIndexes.size());
+		if (success)
+			m_brickIndexes[pos] = n;
+	}
+
+	if (success && !m_nodeValues.empty())
+		success = (fread(&(m_nodeValues[0]), sizeof(ScalarType), m_nodeValues.size(), fp) == m_nodeValues.size());
+
+	if (success)
+		success = (m_bvh.fromFile(fp) && m_bvh.size() == m_meshTriangleCount);
+
+	fclose(fp);
+
+	if (!success)
+		clear();
+
+	return success;
+}
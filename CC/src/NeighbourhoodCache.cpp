@@ -0,0 +1,239 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "NeighbourhoodCache.h"
+
+//local
+#include "GenericProgressCallback.h"
+#include "ReferenceCloud.h"
+
+//system
+#include <assert.h>
+#include <algorithm>
+
+using namespace CCLib;
+
+NeighbourhoodCache::NeighbourhoodCache()
+	: m_cloud(0)
+	, m_pointCount(0)
+	, m_k(0)
+{
+}
+
+NeighbourhoodCache::~NeighbourhoodCache()
+{
+	clear();
+}
+
+void NeighbourhoodCache::clear()
+{
+	m_cloud = 0;
+	m_pointCount = 0;
+	m_k = 0;
+	//release the memory
+	std::vector<PointIndexType>().swap(m_indexes);
+	std::vector<PointCoordinateType>().swap(m_squareDists);
+}
+
+size_t NeighbourhoodCache::RequiredMemory(PointIndexType pointCount, unsigned k)
+{
+	size_t count = static_cast<size_t>(std::min<PointIndexType>(k,pointCount)) * static_cast<size_t>(pointCount);
+	return count * (sizeof(PointIndexType) + sizeof(PointCoordinateType));
+}
+
+//Description of expected 'additionalParameters'
+// [0] -> (unsigned*) number of neighbours per point
+// [1] -> (std::vector<PointIndexType>*) neighbours indexes
+// [2] -> (std::vector<PointCoordinateType>*) neighbours square distances
+static bool ComputeCellNeighbourhoods(	const DgmOctree::octreeCell& cell,
+										void** additionalParameters,
+										NormalizedProgress* nProgress/*=0*/)
+{
+	unsigned k										= *static_cast<unsigned*>(additionalParameters[0]);
+	std::vector<PointIndexType>& indexes			= *static_cast<std::vector<PointIndexType>*>(additionalParameters[1]);
+	std::vector<PointCoordinateType>& squareDists	= *static_cast<std::vector<PointCoordinateType>*>(additionalParameters[2]);
+
+	unsigned n = cell.points->size(); //number of points in the current cell
+	if (n == 0)
+		return true;
+
+	//we look for the k nearest neighbors of all the cell points at once
+	DgmOctree::NeighboursBatch batch;
+	try
+	{
+		std::vector<CCVector3> queryPoints(n);
+		for (unsigned i=0; i<n; ++i)
+			cell.points->getPoint(i,queryPoints[i]);
+
+		if (!cell.parentOctree->findNearestNeighborsBatch(&queryPoints[0],n,k,cell.level,batch))
+			return false;
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return false;
+	}
+
+	//each point has its own (fixed size) slot in the cache
+	for (unsigned i=0; i<n; ++i)
+	{
+		assert(batch.count(i) == k);
+		size_t slot = static_cast<size_t>(cell.points->getPointGlobalIndex(i)) * k;
+		std::copy(batch.indexes.begin() + batch.offsets[i], batch.indexes.begin() + batch.offsets[i+1], indexes.begin() + slot);
+		std::copy(batch.squareDists.begin() + batch.offsets[i], batch.squareDists.begin() + batch.offsets[i+1], squareDists.begin() + slot);
+	}
+
+	if (nProgress && !nProgress->steps(n))
+		return false;
+
+	return true;
+}
+
+bool NeighbourhoodCache::compute(	GenericIndexedCloudPersist* cloud,
+									unsigned k,
+									DgmOctree* inputOctree/*=0*/,
+									size_t maxMemory/*=0*/,
+									bool multiThread/*=true*/,
+									GenericProgressCallback* progressCb/*=0*/)
+{
+	clear();
+
+	if (!cloud || cloud->size() == 0 || k == 0)
+	{
+		//invalid input
+		assert(false);
+		return false;
+	}
+
+	PointIndexType pointCount = cloud->size();
+	if (maxMemory != 0 && RequiredMemory(pointCount,k) > maxMemory)
+	{
+		//the neighbourhoods will have to be computed on the fly
+		return false;
+	}
+	
+	//we can't cache more neighbours than there are points!
+	unsigned cachedCount = static_cast<unsigned>(std::min<PointIndexType>(k,pointCount));
+	try
+	{
+		m_indexes.resize(static_cast<size_t>(pointCount) * cachedCount);
+		m_squareDists.resize(static_cast<size_t>(pointCount) * cachedCount);
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		clear();
+		return false;
+	}
+
+	DgmOctree* octree = inputOctree;
+	if (!octree)
+	{
+		octree = new DgmOctree(cloud);
+		if (octree->build(progressCb) < 1)
+		{
+			delete octree;
+			clear();
+			return false;
+		}
+	}
+
+	void* additionalParameters[] = {	reinterpret_cast<void*>(&cachedCount),
+										reinterpret_cast<void*>(&m_indexes),
+										reinterpret_cast<void*>(&m_squareDists)
+	};
+
+	unsigned char level = octree->findBestLevelForAGivenPopulationPerCell(cachedCount);
+
+	bool success = (octree->executeFunctionForAllCellsAtLevel(	level,
+																ComputeCellNeighbourhoods,
+																additionalParameters,
+																multiThread,
+																progressCb,
+																"Neighbourhoods") != 0);
+
+	if (!inputOctree)
+	{
+		delete octree;
+		octree = 0;
+	}
+
+	if (!success)
+	{
+		//something went wrong (not enough memory or process cancelled by the user)
+		clear();
+		return false;
+	}
+
+	m_cloud = cloud;
+	m_pointCount = pointCount;
+	m_k = cachedCount;
+
+	return true;
+}
+
+void NeighbourhoodCache::getCachedNeighbours(PointIndexType pointIndex, unsigned count, DgmOctree::NeighboursSet& neighbours) const
+{
+	assert(pointIndex < m_pointCount && count <= m_k);
+
+	neighbours.resize(count);
+	size_t slot = static_cast<size_t>(pointIndex) * m_k;
+	for (unsigned i=0; i<count; ++i)
+	{
+		PointIndexType index = m_indexes[slot+i];
+		neighbours[i] = DgmOctree::PointDescriptor(m_cloud->getPointPersistentPtr(index),index,m_squareDists[slot+i]);
+	}
+}
+
+bool NeighbourhoodCache::getNearestNeighbours(PointIndexType pointIndex, unsigned k, DgmOctree::NeighboursSet& neighbours) const
+{
+	if (!hasNearestNeighbours(k))
+		return false;
+
+	getCachedNeighbours(pointIndex,std::min(k,m_k),neighbours);
+
+	return true;
+}
+
+int NeighbourhoodCache::countNeighboursInSphere(PointIndexType pointIndex, PointCoordinateType radius) const
+{
+	if (!m_cloud)
+		return -1;
+	
+	assert(pointIndex < m_pointCount);
+
+	//the neighbours are sorted by increasing distance
+	std::vector<PointCoordinateType>::const_iterator first = m_squareDists.begin() + static_cast<size_t>(pointIndex) * m_k;
+	std::vector<PointCoordinateType>::const_iterator last = first + m_k;
+	unsigned count = static_cast<unsigned>(std::upper_bound(first,last,radius*radius) - first);
+
+	//if all the cached neighbours are inside the sphere, there may be other points inside it
+	//(unless all the points of the cloud are cached)
+	if (count == m_k && m_k < m_pointCount)
+		return -1;
+
+	return static_cast<int>(count);
+}
+
+bool NeighbourhoodCache::getNeighboursInSphere(PointIndexType pointIndex, PointCoordinateType radius, DgmOctree::NeighboursSet& neighbours) const
+{
+	int count = countNeighboursInSphere(pointIndex,radius);
+	if (count < 0)
+		return false;
+
+	getCachedNeighbours(pointIndex,static_cast<unsigned>(count),neighbours);
+
+	return true;
+}
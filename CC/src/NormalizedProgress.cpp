@@ -17,6 +17,9 @@
 
 #include "GenericProgressCallback.h"
 
+//threading layer (Qt or C++11 threads)
+#include "ParallelTools.h"
+
 //system
 #include <assert.h>
 #include <math.h>
@@ -38,6 +41,21 @@ public:
 #endif
 };
 
+#elif defined(CC_PARALLEL_USES_STD_THREADS)
+
+//we use the C++11 atomics (see ParallelTools.h)
+
+//! Atomic counter
+class AtomicCounter
+{
+public:
+	AtomicCounter() : m_value(0) {}
+	inline int load() { return m_value.load(); }
+	inline void store(int value) { m_value.store(value); }
+	inline int fetchAndAddRelaxed(int add) { return m_value.fetch_add(add, std::memory_order_relaxed); }
+	std::atomic<int> m_value;
+};
+
 #else
 
 //we use a fake QAtomicInt
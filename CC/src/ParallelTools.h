@@ -0,0 +1,250 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_PARALLEL_TOOLS_HEADER
+#define CC_PARALLEL_TOOLS_HEADER
+
+//Minimal threading layer used internally by CCLib
+//
+//CCLib relies on Qt (QtConcurrent) for parallel processing. When it is compiled
+//without Qt, the C++11 threads are used instead (if the compiler supports them).
+//CC_PARALLEL_SUPPORT is defined if one of these two backends is available.
+
+#if defined(USE_QT)
+
+#include <QtCore>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QMutex>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#define CC_PARALLEL_SUPPORT
+
+#elif (__cplusplus >= 201103L) || (defined(_MSC_VER) && _MSC_VER >= 1700)
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define CC_PARALLEL_SUPPORT
+#define CC_PARALLEL_USES_STD_THREADS
+
+#endif
+
+#ifdef CC_PARALLEL_SUPPORT
+
+//system
+#include <algorithm>
+
+namespace CCLib
+{
+namespace Parallel
+{
+#ifdef USE_QT
+
+	//! Returns the number of threads that should be used for parallel processing
+	inline unsigned IdealThreadCount() { return static_cast<unsigned>(std::max(QThread::idealThreadCount(), 1)); }
+
+	//! Mutex
+	typedef QMutex Mutex;
+	//! Locks a mutex during its lifetime
+	typedef QMutexLocker MutexLocker;
+
+	//! Atomic pointer (Qt 4/5 compatible)
+	template<class T> class AtomicPointer
+	{
+	public:
+		//! Default constructor
+		AtomicPointer() : m_ptr(0) {}
+		//! Returns the pointer (acquire semantics)
+#if (QT_VERSION < QT_VERSION_CHECK(5, 0, 0))
+		inline T* load() const { return m_ptr; }
+#else
+		inline T* load() const { return m_ptr.loadAcquire(); }
+#endif
+		//! Sets the pointer (release semantics)
+		inline void store(T* ptr) { m_ptr.fetchAndStoreOrdered(ptr); }
+	protected:
+		//! Pointer
+		QAtomicPointer<T> m_ptr;
+	};
+
+	//! Atomic boolean flag (Qt 4/5 compatible)
+	/** Typically used to share a 'process cancelled' state between threads.
+	**/
+	class AtomicFlag
+	{
+	public:
+		//! Default constructor (flag not set)
+		AtomicFlag() : m_value(0) {}
+		//! Returns whether the flag is set (acquire semantics)
+#if (QT_VERSION < QT_VERSION_CHECK(5, 0, 0))
+		inline bool isSet() const { return static_cast<int>(m_value) != 0; }
+#else
+		inline bool isSet() const { return m_value.loadAcquire() != 0; }
+#endif
+		//! Sets the flag (release semantics)
+		inline void set() { m_value.fetchAndStoreOrdered(1); }
+	protected:
+		//! Value
+		QAtomicInt m_value;
+	};
+
+	//! Calls a function on each element of a sequence, in parallel (returns once they are all processed)
+	template<class Sequence, class Function> inline void BlockingMap(Sequence& sequence, Function function)
+	{
+		QtConcurrent::blockingMap(sequence, function);
+	}
+
+#else //CC_PARALLEL_USES_STD_THREADS
+
+	//! Returns the number of threads that should be used for parallel processing
+	inline unsigned IdealThreadCount() { return std::max(std::thread::hardware_concurrency(), 1u); }
+
+	//! Mutex
+	class Mutex
+	{
+	public:
+		inline void lock() { m_mutex.lock(); }
+		inline void unlock() { m_mutex.unlock(); }
+	protected:
+		std::mutex m_mutex;
+	};
+
+	//! Locks a mutex during its lifetime
+	class MutexLocker
+	{
+	public:
+		explicit MutexLocker(Mutex* mutex) : m_mutex(mutex) { m_mutex->lock(); }
+		~MutexLocker() { m_mutex->unlock(); }
+	protected:
+		Mutex* m_mutex;
+	};
+
+	//! Atomic pointer
+	template<class T> class AtomicPointer
+	{
+	public:
+		//! Default constructor
+		AtomicPointer() : m_ptr(0) {}
+		//! Returns the pointer (acquire semantics)
+		inline T* load() const { return m_ptr.load(std::memory_order_acquire); }
+		//! Sets the pointer (release semantics)
+		inline void store(T* ptr) { m_ptr.store(ptr, std::memory_order_release); }
+	protected:
+		//! Pointer
+		std::atomic<T*> m_ptr;
+	};
+
+	//! Atomic boolean flag
+	/** Typically used to share a 'process cancelled' state between threads.
+	**/
+	class AtomicFlag
+	{
+	public:
+		//! Default constructor (flag not set)
+		AtomicFlag() : m_value(false) {}
+		//! Returns whether the flag is set (acquire semantics)
+		inline bool isSet() const { return m_value.load(std::memory_order_acquire); }
+		//! Sets the flag (release semantics)
+		inline void set() { m_value.store(true, std::memory_order_release); }
+	protected:
+		//! Value
+		std::atomic<bool> m_value;
+	};
+
+	//! Thread of BlockingMap: processes the next unprocessed element until there's none left
+	template<class Sequence, class Function> class MapWorker
+	{
+	public:
+		MapWorker(Sequence& sequence, Function function, std::atomic<size_t>& next)
+			: m_sequence(sequence)
+			, m_function(function)
+			, m_next(next)
+		{}
+
+		void operator()()
+		{
+			const size_t count = m_sequence.size();
+			for (size_t i = m_next++; i < count; i = m_next++)
+				m_function(m_sequence[i]);
+		}
+
+	protected:
+		Sequence& m_sequence;
+		Function m_function;
+		std::atomic<size_t>& m_next;
+	};
+
+	//! Calls a function on each element of a sequence, in parallel (returns once they are all processed)
+	/** \warning the sequence must provide random access (operator[])
+	**/
+	template<class Sequence, class Function> void BlockingMap(Sequence& sequence, Function function)
+	{
+		const size_t count = sequence.size();
+		if (count == 0)
+			return;
+
+		std::atomic<size_t> next(0);
+		MapWorker<Sequence, Function> worker(sequence, function, next);
+
+		//the calling thread is one of the workers
+		size_t threadCount = std::min<size_t>(IdealThreadCount(), count);
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount - 1);
+		for (size_t i=1; i<threadCount; ++i)
+			threads.push_back(std::thread(worker));
+		worker();
+
+		for (size_t i=0; i<threads.size(); ++i)
+			threads[i].join();
+	}
+
+#endif
+
+} //namespace Parallel
+} //namespace CCLib
+
+#else //no parallel support
+
+namespace CCLib
+{
+namespace Parallel
+{
+	//! Boolean flag (same interface as the atomic version, for serial processing only)
+	class AtomicFlag
+	{
+	public:
+		//! Default constructor (flag not set)
+		AtomicFlag() : m_value(false) {}
+		//! Returns whether the flag is set
+		inline bool isSet() const { return m_value; }
+		//! Sets the flag
+		inline void set() { m_value = true; }
+	protected:
+		//! Value
+		bool m_value;
+	};
+
+} //namespace Parallel
+} //namespace CCLib
+
+#endif //CC_PARALLEL_SUPPORT
+
+#endif //CC_PARALLEL_TOOLS_HEADER
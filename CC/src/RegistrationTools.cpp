@@ -31,7 +31,7 @@
 #include "NormalDistribution.h"
 #include "ManualSegmentationTools.h"
 #include "GeometricalAnalysisTools.h"
-#include "KdTree.h"
+#include "FlatKdTree.h"
 #include "SimpleCloud.h"
 #include "ChunkedPointCloud.h"
 #include "Garbage.h"
@@ -1124,7 +1124,7 @@ bool FPCSRegistrationTools::RegisterClouds(	GenericIndexedCloud* modelCloud,
 											GenericProgressCallback* progressCb,
 											unsigned nbMaxCandidates)
 {
-	/*DGM: KDTree::buildFromCloud will call reset right away!
+	/*DGM: FlatKDTree::buildFromCloud will call reset right away!
 	if (progressCb)
 	{
 		progressCb->reset();
@@ -1137,7 +1137,7 @@ bool FPCSRegistrationTools::RegisterClouds(	GenericIndexedCloud* modelCloud,
 	//Initialize random seed with current time
 	srand(static_cast<unsigned>(time(0)));
 
-	unsigned bestScore = 0, score = 0;
+	unsigned bestScore = 0;
 	transform.R.invalidate();
 	transform.T = CCVector3(0,0,0);
 
@@ -1150,13 +1150,13 @@ bool FPCSRegistrationTools::RegisterClouds(	GenericIndexedCloud* modelCloud,
 	}
 
 	//Build the associated KDtrees
-	KDTree* dataTree = new KDTree();
+	FlatKDTree* dataTree = new FlatKDTree();
 	if (!dataTree->buildFromCloud(dataCloud, progressCb))
 	{
 		delete dataTree;
 		return false;
 	}
-	KDTree* modelTree = new KDTree();
+	FlatKDTree* modelTree = new FlatKDTree();
 	if (!modelTree->buildFromCloud(modelCloud, progressCb))
 	{
 		delete dataTree;
@@ -1219,14 +1219,21 @@ bool FPCSRegistrationTools::RegisterClouds(	GenericIndexedCloud* modelCloud,
 				//Apply the rigid transform to the data cloud and compute the registration score
 				if (RT.R.isValid())
 				{
-					score = ComputeRegistrationScore(modelTree, dataCloud, delta, RT);
+					int score = ComputeRegistrationScore(modelTree, dataCloud, delta, RT);
+					if (score < 0) //not enough memory
+					{
+						delete dataTree;
+						delete modelTree;
+						transform.R = SquareMatrix();
+						return false;
+					}
 
 					//Keep parameters that lead to the best result
-					if (score > bestScore)
+					if (static_cast<unsigned>(score) > bestScore)
 					{
 						transform.R = RT.R;
 						transform.T = RT.T;
-						bestScore = score;
+						bestScore = static_cast<unsigned>(score);
 					}
 				}
 			}
@@ -1259,27 +1266,42 @@ bool FPCSRegistrationTools::RegisterClouds(	GenericIndexedCloud* modelCloud,
 }
 
 
- unsigned FPCSRegistrationTools::ComputeRegistrationScore(	KDTree *modelTree,
-															GenericIndexedCloud *dataCloud,
-															ScalarType delta,
-															const ScaledTransformation& dataToModel)
+//! Number of data points transformed (then queried as a batch) in a row during the registration score computation
+static const unsigned SCORE_QUERIES_BLOCK_SIZE = 65536;
+
+ int FPCSRegistrationTools::ComputeRegistrationScore(	FlatKDTree *modelTree,
+														GenericIndexedCloud *dataCloud,
+														ScalarType delta,
+														const ScaledTransformation& dataToModel)
 {
-	CCVector3 Q;
+	unsigned count = dataCloud->size();
+
+	std::vector<CCVector3> transformedPoints;
+	try
+	{
+		transformedPoints.resize(std::min(count, SCORE_QUERIES_BLOCK_SIZE));
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return -1;
+	}
 
 	unsigned score = 0;
 
-	unsigned count = dataCloud->size();
-	for (unsigned i=0; i<count; ++i)
+	for (unsigned start=0; start<count; start+=SCORE_QUERIES_BLOCK_SIZE)
 	{
-		dataCloud->getPoint(i,Q);
-		//Apply rigid transform to each point
-		Q = dataToModel.R * Q + dataToModel.T;
-		//Check if there is a point in the model cloud that is close enough to q
-		if (modelTree->findPointBelowDistance(Q.u, delta))
-			score++;
+		unsigned blockSize = std::min(SCORE_QUERIES_BLOCK_SIZE, count-start);
+		for (unsigned i=0; i<blockSize; ++i)
+		{
+			dataCloud->getPoint(start+i,transformedPoints[i]);
+			//Apply rigid transform to each point
+			transformedPoints[i] = dataToModel.R * transformedPoints[i] + dataToModel.T;
+		}
+		//Count the points for which there is a point in the model cloud that is close enough
+		score += modelTree->countPointsBelowDistance(&(transformedPoints[0]), blockSize, delta);
 	}
 
-	return score;
+	return static_cast<int>(score);
  }
 
 bool FPCSRegistrationTools::FindBase(	GenericIndexedCloud* cloud,
@@ -1410,7 +1432,7 @@ bool FPCSRegistrationTools::FindBase(	GenericIndexedCloud* cloud,
 //pair of indexes
 typedef std::pair<unsigned,unsigned> IndexPair;
 
-int FPCSRegistrationTools::FindCongruentBases(KDTree* tree,
+int FPCSRegistrationTools::FindCongruentBases(FlatKDTree* tree,
 												ScalarType delta,
 												const CCVector3* base[4],
 												std::vector<Base>& results)
@@ -1486,7 +1508,7 @@ int FPCSRegistrationTools::FindCongruentBases(KDTree* tree,
 	//Select among the pairs the ones that can be congruent to the base "base"
 	std::vector<IndexPair> match;
 	{
-		SimpleCloud tmpCloud1,tmpCloud2;
+		SimpleCloud tmpCloud1;
 		{
 			unsigned count = (unsigned)pairs1.size();
 			if (!tmpCloud1.reserve(count*2)) //not enough memory
@@ -1502,44 +1524,58 @@ int FPCSRegistrationTools::FindCongruentBases(KDTree* tree,
 				tmpCloud1.addPoint(P2);
 			}
 		}
-	
+
+		//the second set of intermediate points is only used as query points
+		std::vector<CCVector3> tmpPoints2;
 		{
 			unsigned count = (unsigned)pairs2.size();
-			if (!tmpCloud2.reserve(count*2)) //not enough memory
+			try
+			{
+				tmpPoints2.resize(count*2);
+			}
+			catch (const std::bad_alloc&) //not enough memory
+			{
 				return -3;
+			}
 			for(unsigned i=0; i<count; i++)
 			{
 				//generate the two intermediate points from r2 in pairs2[i]
 				const CCVector3 *q0 = cloud->getPoint(pairs2[i].first);
 				const CCVector3 *q1 = cloud->getPoint(pairs2[i].second);
-				CCVector3 P1 = *q0 + r2*(*q1-*q0);
-				tmpCloud2.addPoint(P1);
-				CCVector3 P2 = *q1 + r2*(*q0-*q1);
-				tmpCloud2.addPoint(P2);
+				tmpPoints2[2*i] = *q0 + r2*(*q1-*q0);
+				tmpPoints2[2*i+1] = *q1 + r2*(*q0-*q1);
 			}
 		}
 
 		//build kdtree for nearest neighbour fast research
-		KDTree intermediateTree;
+		FlatKDTree intermediateTree;
 		if (!intermediateTree.buildFromCloud(&tmpCloud1))
 			return -4;
 
-		//Find matching (up to delta) intermediate points in tmpCloud1 and tmpCloud2
+		//Find matching (up to delta) intermediate points in tmpCloud1 and tmpPoints2
+		if (!tmpPoints2.empty())
 		{
-			unsigned count = (unsigned)tmpCloud2.size();
-			match.reserve(count);
-			if (match.capacity() < count)	//not enough memory
+			unsigned count = (unsigned)tmpPoints2.size();
+			std::vector<unsigned> nearestIndexes;
+			if (!intermediateTree.findNearestNeighbours(&(tmpPoints2[0]), count, delta, nearestIndexes))
 				return -5;
+
+			try
+			{
+				match.reserve(count);
+			}
+			catch (const std::bad_alloc&) //not enough memory
+			{
+				return -5;
+			}
 		
 			for(unsigned i=0; i<count; i++)
 			{
-				const CCVector3 *q0 = tmpCloud2.getPoint(i);
-				unsigned a;
-				if (intermediateTree.findNearestNeighbour(q0->u, a, delta))
+				if (nearestIndexes[i] != FlatKDTree::INVALID_INDEX)
 				{
 					IndexPair idxPair;
 					idxPair.first = i;
-					idxPair.second = a;
+					idxPair.second = nearestIndexes[i];
 					match.push_back(idxPair);
 				}
 			}
@@ -12,9 +12,21 @@
 #include <stdint.h>
 #include <stdio.h> //for sprintf
 
+#ifdef USE_QT
+#include <QtCore>
+#include <QtConcurrentMap>
+#endif
+
 using namespace CCLib;
 
-bool SaitoSquaredDistanceTransform::EDT_1D(GridElement* slice, size_t r, size_t c)
+typedef SaitoSquaredDistanceTransform::GridElement GridElement;
+
+//! Number of adjacent columns processed together (so as to read and write the grid by contiguous blocks)
+static const size_t COLUMNS_PER_BLOCK = 16;
+
+
+//! 1D Euclidean Distance Transform (along each row of a slice)
+static void EDT_1D(GridElement* slice, size_t r, size_t c)
 {
 	GridElement *row = slice;
 	
@@ -51,136 +63,234 @@ bool SaitoSquaredDistanceTransform::EDT_1D(GridElement* slice, size_t r, size_t
 			}
 		}
 	}
-
-	return true;
 }
 
-//:
-// Assumes given a Lookup table of integer squares.
-// Also assumes the image \a im already has infinity in all non-zero points.
-bool SaitoSquaredDistanceTransform::SDT_2D(Grid3D<GridElement>& grid, size_t sliceIndex, const std::vector<GridElement>& sq)
+//! Squared distance transform along a single (contiguous) column
+/** \param colData input values
+	\param out output values (must be initialized with the input values)
+	\param n column length
+	\param sq lookup table of integer squares
+**/
+static void SDT_Column(const GridElement* colData, GridElement* out, size_t n, const GridElement* sq)
 {
-	const Tuple3ui& gridSize = grid.size();
-	size_t r = gridSize.y;
-	size_t c = gridSize.x;
-	size_t voxelCount = r*c;
+	if (n < 2)
+		return;
 
-	GridElement* sliceData = grid.data() + sliceIndex * voxelCount;
-
-	// 1st step: vertical row-wise EDT
-	{
-		if (!EDT_1D(sliceData, r, c))
-		{
-			return false;
-		}
-	}
-	
-	// 2nd step: horizontal scan
+	//forward scan
 	{
-		std::vector<GridElement> colData;
-		try
-		{
-			colData.resize(r);
-		}
-		catch (const std::bad_alloc&)
-		{
-			//not enough memory
-			return false;
-		}
+		GridElement a = 0;
+		GridElement buffer = colData[0];
 
-		//for each column
-		for (size_t i = 0; i < c; ++i)
+		for (size_t k = 1; k < n; ++k)
 		{
-			//fill buffer with column values
+			if (a != 0)
+				--a;
+			if (colData[k] > buffer + 1)
 			{
-				GridElement* pt = sliceData + i;
-				for (size_t j = 0; j < r; ++j, pt += c)
-					colData[j] = *pt;
-			}
-
-			//forward scan
-			GridElement* pt = sliceData + i + c;
-			{
-				GridElement a = 0;
-				GridElement buffer = colData[0];
+				GridElement b = (colData[k] - buffer - 1) / 2;
+				if (k + b + 1 > n)
+					b = static_cast<GridElement>(n - 1 - k);
 
-				for (size_t j = 1; j < r; ++j, pt += c)
+				for (GridElement l = a; l <= b; ++l)
 				{
-					size_t rowIndex = j;
-					if (a != 0)
-						--a;
-					if (colData[rowIndex] > buffer + 1)
-					{
-						GridElement b = (colData[rowIndex] - buffer - 1) / 2;
-						if (rowIndex + b + 1 > r)
-							b = static_cast<GridElement>(r - 1 - rowIndex);
-
-						GridElement* npt = pt + a*c;
-						for (GridElement l = a; l <= b; ++l)
-						{
-							GridElement m = buffer + sq[l + 1];
-							if (colData[rowIndex + l] <= m)
-							{
-								//proceed to next column
-								break;
-							}
-							if (m < *npt)
-								*npt = m;
-							npt += c;
-						}
-						a = b;
-					}
-					else
-					{
-						a = 0;
-					}
-					buffer = colData[rowIndex];
+					GridElement m = buffer + sq[l + 1];
+					if (colData[k + l] <= m)
+						break;   // go to next position k
+					if (m < out[k + l])
+						out[k + l] = m;
 				}
+				a = b;
+			}
+			else
+			{
+				a = 0;
 			}
+			buffer = colData[k];
+		}
+	}
 
-			//backward scan
-			pt -= 2 * c;
+	//backward scan
+	{
+		GridElement a = 0;
+		GridElement buffer = colData[n - 1];
+
+		for (size_t k = n - 2; k != static_cast<size_t>(-1); --k)
+		{
+			if (a != 0)
+				--a;
+			if (colData[k] > buffer + 1)
 			{
-				GridElement a = 0;
-				GridElement buffer = colData[r - 1];
+				GridElement b = (colData[k] - buffer - 1) / 2;
+				if (k < b)
+					b = static_cast<GridElement>(k);
 
-				for (size_t j = 1; j < r; ++j, pt -= c)
+				for (GridElement l = a; l <= b; ++l)
 				{
-					size_t rowIndex = r - j - 1;
-					if (a != 0)
-						--a;
-					if (colData[rowIndex] > buffer + 1)
-					{
-						GridElement b = (colData[rowIndex] - buffer - 1) / 2;
-						if (rowIndex < b)
-							b = static_cast<GridElement>(rowIndex);
-
-						GridElement* npt = pt - a*c;
-						for (GridElement l = a; l <= b; ++l)
-						{
-							GridElement m = buffer + sq[l + 1];
-							if (colData[rowIndex - l] <= m)
-							{
-								//proceed to next column
-								break;
-							}
-							if (m < *npt)
-								*npt = m;
-							npt -= c;
-						}
-						a = b;
-					}
-					else
-					{
-						a = 0;
-					}
-					buffer = colData[rowIndex];
+					GridElement m = buffer + sq[l + 1];
+					if (colData[k - l] <= m)
+						break;   // go to next position k
+					if (m < out[k - l])
+						out[k - l] = m;
 				}
+				a = b;
+			}
+			else
+			{
+				a = 0;
 			}
+			buffer = colData[k];
 		}
 	}
+}
+
+//! Squared distance transform along a set of adjacent columns
+/** The columns are processed by blocks of COLUMNS_PER_BLOCK: their values are
+	gathered in a contiguous buffer, so that the grid is only read and written
+	by rows (instead of jumping from one row/slice to the next for each value).
+	\param data first value of the first column
+	\param columnCount number of (adjacent) columns
+	\param n column length
+	\param stride offset between two consecutive values of a column
+	\param sq lookup table of integer squares
+	\param buffer temporary buffer (at least 2 * COLUMNS_PER_BLOCK * n values)
+**/
+static void SDT_Columns(GridElement* data, size_t columnCount, size_t n, size_t stride, const GridElement* sq, GridElement* buffer)
+{
+	GridElement* colData = buffer;
+	GridElement* out = buffer + COLUMNS_PER_BLOCK * n;
+
+	for (size_t i0 = 0; i0 < columnCount; i0 += COLUMNS_PER_BLOCK)
+	{
+		size_t blockSize = std::min(COLUMNS_PER_BLOCK, columnCount - i0);
+
+		//gather
+		{
+			const GridElement* row = data + i0;
+			for (size_t k = 0; k < n; ++k, row += stride)
+				for (size_t b = 0; b < blockSize; ++b)
+					colData[b * n + k] = row[b];
+		}
+		memcpy(out, colData, sizeof(GridElement) * blockSize * n);
+
+		for (size_t b = 0; b < blockSize; ++b)
+			SDT_Column(colData + b * n, out + b * n, n, sq);
+
+		//scatter
+		{
+			GridElement* row = data + i0;
+			for (size_t k = 0; k < n; ++k, row += stride)
+				for (size_t b = 0; b < blockSize; ++b)
+					row[b] = out[b * n + k];
+		}
+	}
+}
+
+//! Set of slices (or rows) processed by a single thread
+struct SDTJob
+{
+	//! Grid data
+	GridElement* data;
+	//! Grid size
+	Tuple3ui gridSize;
+	//! Index of the slice (2D pass) or of the row (3rd pass)
+	size_t index;
+	//! Lookup table of integer squares
+	const GridElement* sq;
+	//! Initial value of the empty cells (2D pass only)
+	GridElement maxDistance;
+	//! Progress notification
+	NormalizedProgress* nProgress;
+	//! Whether the process has failed or has been cancelled (shared by all jobs)
+	bool* cancelled;
+};
+
+//! 2D Exact Squared Distance Transform (on a single slice)
+/** Assumes given a Lookup table of integer squares.
+	The input values of the slice are inverted first (the 'zero' cells are the non-empty ones).
+**/
+static void SDT_2D(SDTJob& job)
+{
+	if (*job.cancelled)
+		return;
+
+	size_t r = job.gridSize.y;
+	size_t c = job.gridSize.x;
+	size_t voxelCount = r*c;
+
+	GridElement* sliceData = job.data + job.index * voxelCount;
+
+	//DGM: warning we must invert the input image here!
+	for (size_t i = 0; i < voxelCount; ++i)
+		sliceData[i] = (sliceData[i] == 0 ? job.maxDistance : 0);
+
+	// 1st step: vertical row-wise EDT
+	EDT_1D(sliceData, r, c);
+
+	// 2nd step: horizontal scan
+	std::vector<GridElement> buffer;
+	try
+	{
+		buffer.resize(2 * COLUMNS_PER_BLOCK * r);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		*job.cancelled = true;
+		return;
+	}
+	SDT_Columns(sliceData, c, r, c, job.sq, &(buffer[0]));
 
-	return true;
+	if (job.nProgress && !job.nProgress->oneStep())
+	{
+		//process cancelled by user
+		*job.cancelled = true;
+	}
+}
+
+//! Final pass along the Z direction (on a single row of all slices)
+static void SDT_Z(SDTJob& job)
+{
+	if (*job.cancelled)
+		return;
+
+	size_t r = job.gridSize.y;
+	size_t c = job.gridSize.x;
+	size_t p = job.gridSize.z;
+
+	std::vector<GridElement> buffer;
+	try
+	{
+		buffer.resize(2 * COLUMNS_PER_BLOCK * p);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		*job.cancelled = true;
+		return;
+	}
+	SDT_Columns(job.data + job.index * c, c, p, r*c, job.sq, &(buffer[0]));
+
+	if (job.nProgress && !job.nProgress->oneStep())
+	{
+		//process cancelled by user
+		*job.cancelled = true;
+	}
+}
+
+//! Processes a set of jobs (in parallel if possible)
+static void RunSDTJobs(std::vector<SDTJob>& jobs, void (*jobFunction)(SDTJob&))
+{
+#ifdef USE_QT
+	if (jobs.size() > 1)
+	{
+		QtConcurrent::blockingMap(jobs, jobFunction);
+	}
+	else
+#endif
+	{
+		for (size_t n = 0; n < jobs.size(); ++n)
+			jobFunction(jobs[n]);
+	}
 }
 
 bool SaitoSquaredDistanceTransform::SDT_3D(Grid3D<GridElement>& grid, GenericProgressCallback* progressCb/*=0*/)
@@ -189,15 +299,17 @@ bool SaitoSquaredDistanceTransform::SDT_3D(Grid3D<GridElement>& grid, GenericPro
 	size_t r = gridSize.y;
 	size_t c = gridSize.x;
 	size_t p = gridSize.z;
-	size_t voxelCount = r*c*p;
 
 	size_t diag = static_cast<size_t>(ceil(sqrt(static_cast<double>(r*r + c*c + p*p))) - 1);
 	size_t nsqr = 2 * (diag + 1);
 
 	std::vector<GridElement> sq;
+	std::vector<SDTJob> sliceJobs, rowJobs;
 	try
 	{
 		sq.resize(nsqr);
+		sliceJobs.resize(p);
+		rowJobs.resize(r);
 	}
 	catch (const std::bad_alloc&)
 	{
@@ -223,128 +335,34 @@ bool SaitoSquaredDistanceTransform::SDT_3D(Grid3D<GridElement>& grid, GenericPro
 		progressCb->start();
 	}
 
-	GridElement* data = grid.data();
-	{
-		for (size_t i = 0; i < voxelCount; ++i)
-		{
-			//DGM: warning we must invert the input image here!
-			if (data[i] == 0)
-				data[i] = maxDistance;
-			else
-				data[i] = 0;
-		}
-	}
-
-	// 2D EDT for each slice
+	bool cancelled = false;
+	SDTJob job;
+	job.data = grid.data();
+	job.gridSize = gridSize;
+	job.index = 0;
+	job.sq = &(sq[0]);
+	job.maxDistance = maxDistance;
+	job.nProgress = (progressCb ? &normProgress : 0);
+	job.cancelled = &cancelled;
+
+	//the slices are independent during the first 2 passes (2D EDT for each slice)
 	for (size_t k = 0; k < p; ++k)
 	{
-		if (!SDT_2D(grid, k, sq))
-		{
-			return false;
-		}
-
-		if (progressCb && !normProgress.oneStep())
-		{
-			//process cancelled by user
-			return false;
-		}
-	}
-
-	// Now, for each pixel, compute final distance by searching along Z direction
-	size_t rc = r*c;
-	std::vector<GridElement> colData;
-	try
-	{
-		colData.resize(p);
+		sliceJobs[k] = job;
+		sliceJobs[k].index = k;
 	}
-	catch (const std::bad_alloc&)
-	{
-		//not enough memory
+	RunSDTJobs(sliceJobs, SDT_2D);
+	if (cancelled)
 		return false;
-	}
 
-	for (size_t j = 0; j < r; ++j, data += c)
+	//now, for each pixel, compute final distance by searching along Z direction
+	//(the rows are independent)
+	for (size_t j = 0; j < r; ++j)
 	{
-		for (size_t i = 0; i < c; ++i)
-		{
-			GridElement* pt = data + i;
-
-			for (size_t k = 0; k < p; ++k, pt += rc)
-				colData[k] = *pt;
-
-			pt = data + i + rc;
-			GridElement a = 0;
-			GridElement buffer = colData[0];
-
-			for (size_t k = 1; k < p; ++k, pt += rc)
-			{
-				if (a != 0)
-					--a;
-				if (colData[k] > buffer + 1)
-				{
-					GridElement b = (colData[k] - buffer - 1) / 2;
-					if (k + b + 1 > p)
-						b = static_cast<GridElement>(p - 1 - k);
-
-					GridElement* npt = pt + a*rc;
-					for (GridElement l = a; l <= b; ++l)
-					{
-						GridElement m = buffer + sq[l + 1];
-						if (colData[k + l] <= m)
-							break;   // go to next plane k
-						if (m < *npt)
-							*npt = m;
-						npt += rc;
-					}
-					a = b;
-				}
-				else
-				{
-					a = 0;
-				}
-				buffer = colData[k];
-			}
-
-			a = 0;
-			pt -= 2 * rc;
-			buffer = colData[p - 1];
-
-			for (size_t k = p - 2; k != static_cast<size_t>(-1); --k, pt -= rc)
-			{
-				if (a != 0)
-					--a;
-				if (colData[k] > buffer + 1)
-				{
-					GridElement b = (colData[k] - buffer - 1) / 2;
-					if (k < b)
-						b = static_cast<GridElement>(k);
-
-					GridElement* npt = pt - a*rc;
-					for (GridElement l = a; l <= b; ++l)
-					{
-						GridElement m = buffer + sq[l + 1];
-						if (colData[k - l] <= m)
-							break;   // go to next column k
-						if (m < *npt)
-							*npt = m;
-						npt -= rc;
-					}
-					a = b;
-				}
-				else
-				{
-					a = 0;
-				}
-				buffer = colData[k];
-			}
-		}
-
-		if (progressCb && !normProgress.oneStep())
-		{
-			//process cancelled by user
-			return false;
-		}
+		rowJobs[j] = job;
+		rowJobs[j].index = j;
 	}
+	RunSDTJobs(rowJobs, SDT_Z);
 
-	return true;
+	return !cancelled;
 }
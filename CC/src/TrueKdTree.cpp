@@ -25,16 +25,101 @@
 //system
 #include <algorithm>
 #include <assert.h>
+#include <new>
 
 //Qt
 #ifdef USE_QT
 #include <QCoreApplication>
+#include <QtCore>
+#include <QtConcurrentRun>
 #endif
 
 using namespace CCLib;
 
+//! Min number of points in a subset to process its two halves in parallel
+static const unsigned MIN_POINTS_FOR_PARALLEL_SPLIT = 65536;
+
+//! Number of nodes allocated in a row by the build pool
+static const size_t BUILD_POOL_CHUNK_SIZE = 4096;
+
+//! Simple memory pool for the tree nodes and leaves
+/** Memory is only released when the pool is destroyed (nodes
+	and leaves destructors must be called beforehand). Thread safe.
+**/
+class TrueKdTree::NodePool
+{
+public:
+
+	//! Size of a single slot (enough for a node or a leaf)
+	static const size_t SLOT_SIZE = (sizeof(Node) > sizeof(Leaf) ? sizeof(Node) : sizeof(Leaf));
+
+	//! Default constructor
+	explicit NodePool(size_t slotsPerChunk)
+		: m_slotsPerChunk(std::max<size_t>(slotsPerChunk,1))
+		, m_usedSlots(0)
+	{}
+
+	//! Destructor
+	~NodePool()
+	{
+		for (size_t i=0; i<m_chunks.size(); ++i)
+			delete[] m_chunks[i];
+	}
+
+	//! Allocates the first chunk of memory
+	bool reserve()
+	{
+#ifdef USE_QT
+		QMutexLocker locker(&m_mutex);
+#endif
+		return !m_chunks.empty() || addChunk();
+	}
+
+	//! Returns a new slot (or 0 if not enough memory)
+	void* allocate()
+	{
+#ifdef USE_QT
+		QMutexLocker locker(&m_mutex);
+#endif
+		if ((m_chunks.empty() || m_usedSlots == m_slotsPerChunk) && !addChunk())
+			return 0;
+		return m_chunks.back() + (m_usedSlots++) * SLOT_SIZE;
+	}
+
+protected:
+
+	//! Adds a new chunk of memory
+	bool addChunk()
+	{
+		try
+		{
+			char* chunk = new char[SLOT_SIZE * m_slotsPerChunk];
+			m_chunks.push_back(chunk);
+		}
+		catch (const std::bad_alloc&)
+		{
+			return false;
+		}
+		m_usedSlots = 0;
+		return true;
+	}
+
+	//! Memory chunks
+	std::vector<char*> m_chunks;
+	//! Number of slots per chunk
+	size_t m_slotsPerChunk;
+	//! Number of used slots in the last chunk
+	size_t m_usedSlots;
+#ifdef USE_QT
+	//! Mutex
+	QMutex m_mutex;
+#endif
+};
+
 TrueKdTree::TrueKdTree(GenericIndexedCloudPersist* cloud)
 	: m_root(0)
+	, m_nodePool(0)
+	, m_buildPool(0)
 	, m_associatedCloud(cloud)
 	, m_maxError(0.0)
 	, m_errorMeasure(DistanceComputationTools::RMS)
@@ -52,14 +137,101 @@ TrueKdTree::~TrueKdTree()
 void TrueKdTree::clear()
 {
 	if (m_root)
-		delete m_root;
+		releaseSubTree(m_root);
 	m_root = 0;
+
+	if (m_nodePool)
+		delete m_nodePool;
+	m_nodePool = 0;
+}
+
+TrueKdTree::Node* TrueKdTree::newNode() const
+{
+	assert(m_buildPool);
+	void* slot = m_buildPool->allocate();
+	return slot ? new (slot) Node : 0;
+}
+
+TrueKdTree::Leaf* TrueKdTree::newLeaf(ReferenceCloud* set, const PointCoordinateType planeEquation[], ScalarType error) const
+{
+	assert(m_buildPool);
+	void* slot = m_buildPool->allocate();
+	if (!slot)
+	{
+		//not enough memory
+		if (set)
+			delete set;
+		return 0;
+	}
+	return new (slot) Leaf(set, planeEquation, error);
+}
+
+void TrueKdTree::releaseSubTree(BaseNode* node)
+{
+	assert(node);
+	if (node->isNode())
+	{
+		Node* trueNode = static_cast<Node*>(node);
+		if (trueNode->leftChild)
+			releaseSubTree(trueNode->leftChild);
+		if (trueNode->rightChild)
+			releaseSubTree(trueNode->rightChild);
+	}
+	//the memory itself belongs to the pool
+	node->~BaseNode();
+}
+
+//! Returns the number of nodes and leaves in a (sub)tree
+static unsigned CountNodes(const TrueKdTree::BaseNode* node)
+{
+	if (node->isNode())
+	{
+		const TrueKdTree::Node* trueNode = static_cast<const TrueKdTree::Node*>(node);
+		return 1 + CountNodes(trueNode->leftChild) + CountNodes(trueNode->rightChild);
+	}
+	return 1;
+}
+
+TrueKdTree::BaseNode* TrueKdTree::moveSubTree(BaseNode* node, NodePool* pool)
+{
+	assert(node && pool);
+	void* slot = pool->allocate();
+	assert(slot); //the pool should be large enough!
+
+	BaseNode* newNode = 0;
+	if (node->isNode())
+	{
+		Node* trueNode = static_cast<Node*>(node);
+		Node* movedNode = new (slot) Node;
+		movedNode->splitDim = trueNode->splitDim;
+		movedNode->splitValue = trueNode->splitValue;
+		//the children are allocated after their parent (depth-first order)
+		movedNode->leftChild = moveSubTree(trueNode->leftChild, pool);
+		movedNode->leftChild->parent = movedNode;
+		movedNode->rightChild = moveSubTree(trueNode->rightChild, pool);
+		movedNode->rightChild->parent = movedNode;
+		trueNode->leftChild = trueNode->rightChild = 0;
+		newNode = movedNode;
+	}
+	else //if (node->isLeaf())
+	{
+		Leaf* leaf = static_cast<Leaf*>(node);
+		Leaf* movedLeaf = new (slot) Leaf(leaf->points, leaf->planeEq, leaf->error);
+		movedLeaf->userData = leaf->userData;
+		leaf->points = 0; //the new leaf takes ownership of the subset
+		newNode = movedLeaf;
+	}
+	node->~BaseNode();
+
+	return newNode;
 }
 
-//shared structure used to sort the points along a single dimension (see TrueKdTree::split)
-static std::vector<PointCoordinateType> s_sortedCoordsForSplit;
 static GenericProgressCallback* s_progressCb = 0;
+#ifdef USE_QT
+static QAtomicInt s_lastProgressCount(0);
+#else
 static unsigned s_lastProgressCount = 0;
+#endif
 static unsigned s_totalProgressCount = 0;
 static unsigned s_lastProgress = 0;
 
@@ -83,13 +255,24 @@ static void InitProgress(GenericProgressCallback* progressCb, unsigned totalCoun
 	}
 }
 
-static inline void UpdateProgress(unsigned increment)
+//! Updates the progress count
+/** The progress callback is only updated from the caller thread (see 'reportProgress')
+**/
+static inline void UpdateProgress(unsigned increment, bool reportProgress)
 {
 	if (s_progressCb)
 	{
 		assert(s_totalProgressCount != 0);
+#ifdef USE_QT
+		unsigned progressCount = static_cast<unsigned>(s_lastProgressCount.fetchAndAddRelaxed(static_cast<int>(increment))) + increment;
+#else
 		s_lastProgressCount += increment;
-		float fPercent = static_cast<float>(s_lastProgressCount) / static_cast<float>(s_totalProgressCount) * 100.0f;
+		unsigned progressCount = s_lastProgressCount;
+#endif
+		if (!reportProgress)
+			return;
+
+		float fPercent = static_cast<float>(progressCount) / static_cast<float>(s_totalProgressCount) * 100.0f;
 		unsigned uiPercent = static_cast<unsigned>(fPercent);
 		if (uiPercent > s_lastProgress)
 		{
@@ -102,7 +285,7 @@ static inline void UpdateProgress(unsigned increment)
 	}
 }
 
-TrueKdTree::BaseNode* TrueKdTree::split(ReferenceCloud* subset)
+TrueKdTree::BaseNode* TrueKdTree::split(ReferenceCloud* subset, PointCoordinateType* sortBuffer, bool reportProgress)
 {
 	assert(subset); //subset will always be taken care of by this method
 	
@@ -115,7 +298,7 @@ TrueKdTree::BaseNode* TrueKdTree::split(ReferenceCloud* subset)
 		//we return an invalid Leaf (so as the above level understands that it's not a memory issue)
 		delete subset;
 		PointCoordinateType fakePlaneEquation[4] = {0,0,0,0};
-		return new Leaf(0, fakePlaneEquation, static_cast<ScalarType>(-1));
+		return newLeaf(0, fakePlaneEquation, static_cast<ScalarType>(-1));
 	}
 
 	//we always split sets larger than a given size
@@ -129,9 +312,9 @@ TrueKdTree::BaseNode* TrueKdTree::split(ReferenceCloud* subset)
 		bool isLeaf = (error <= m_maxError || count < 2 * m_minPointCountPerCell);
 		if (isLeaf)
 		{
-			UpdateProgress(count);
+			UpdateProgress(count, reportProgress);
 			//the Leaf class takes ownership of the subset!
-			return new Leaf(subset,planeEquation,error);
+			return newLeaf(subset,planeEquation,error);
 		}
 	}
 
@@ -153,48 +336,48 @@ TrueKdTree::BaseNode* TrueKdTree::split(ReferenceCloud* subset)
 		splitDim = Z_DIM;
 
 	//find the median by sorting the points coordinates
-	assert(s_sortedCoordsForSplit.size() >= static_cast<size_t>(count));
+	assert(sortBuffer);
 	for (unsigned i=0; i<count; ++i)
 	{
 		const CCVector3* P = subset->getPoint(i);
-		s_sortedCoordsForSplit[i] = P->u[splitDim];
+		sortBuffer[i] = P->u[splitDim];
 	}
-	std::sort(s_sortedCoordsForSplit.begin(),s_sortedCoordsForSplit.begin()+count);
+	std::sort(sortBuffer,sortBuffer+count);
 
 	unsigned splitCount = count/2;
 	assert(splitCount >= 3); //count >= 6 (see above)
 	
 	//we must check that the split value is the 'first one'
-	if (s_sortedCoordsForSplit[splitCount-1] == s_sortedCoordsForSplit[splitCount])
+	if (sortBuffer[splitCount-1] == sortBuffer[splitCount])
 	{
-		if (s_sortedCoordsForSplit[2] != s_sortedCoordsForSplit[splitCount]) //can we go backward?
+		if (sortBuffer[2] != sortBuffer[splitCount]) //can we go backward?
 		{
-			while (/*splitCount>0 &&*/ s_sortedCoordsForSplit[splitCount-1] == s_sortedCoordsForSplit[splitCount])
+			while (/*splitCount>0 &&*/ sortBuffer[splitCount-1] == sortBuffer[splitCount])
 			{
 				assert(splitCount > 3);
 				--splitCount;
 			}
 		}
-		else if (s_sortedCoordsForSplit[count-3] != s_sortedCoordsForSplit[splitCount]) //can we go forward?
+		else if (sortBuffer[count-3] != sortBuffer[splitCount]) //can we go forward?
 		{
 			do
 			{
 				++splitCount;
 				assert(splitCount < count-3);
 			}
-			while (/*splitCount+1<count &&*/ s_sortedCoordsForSplit[splitCount] == s_sortedCoordsForSplit[splitCount-1]);
+			while (/*splitCount+1<count &&*/ sortBuffer[splitCount] == sortBuffer[splitCount-1]);
 		}
 		else //in fact we can't split this cell!
 		{
-			UpdateProgress(count);
+			UpdateProgress(count, reportProgress);
 			if (error < 0)
 				error = (count != 3 ? DistanceComputationTools::ComputeCloud2PlaneDistance(subset, planeEquation, m_errorMeasure) : 0);
 			//the Leaf class takes ownership of the subset!
-			return new Leaf(subset, planeEquation, error);
+			return newLeaf(subset, planeEquation, error);
 		}
 	}
 
-	PointCoordinateType splitCoord = s_sortedCoordsForSplit[splitCount]; //count > 3 --> splitCount >= 2
+	PointCoordinateType splitCoord = sortBuffer[splitCount]; //count > 3 --> splitCount >= 2
 
 	ReferenceCloud* leftSubset = new ReferenceCloud(subset->getAssociatedCloud());
 	ReferenceCloud* rightSubset = new ReferenceCloud(subset->getAssociatedCloud());
@@ -220,21 +403,34 @@ TrueKdTree::BaseNode* TrueKdTree::split(ReferenceCloud* subset)
 			rightSubset->addPointIndex(subset->getPointGlobalIndex(i));
 		}
 	}
+	assert(leftSubset->size() == splitCount);
 
 	//process subsets (if any)
-	BaseNode* leftChild = split(leftSubset);
-	if (!leftChild)
+	//each half uses its own part of the sort buffer, so that they can be processed concurrently
+	BaseNode* leftChild = 0;
+	BaseNode* rightChild = 0;
+#ifdef USE_QT
+	if (count >= MIN_POINTS_FOR_PARALLEL_SPLIT)
 	{
-		delete subset;
-		delete rightSubset;
-		return 0;
+		QFuture<BaseNode*> leftFuture = QtConcurrent::run(this, &TrueKdTree::split, leftSubset, sortBuffer, false);
+		rightChild = split(rightSubset, sortBuffer + splitCount, reportProgress);
+		leftChild = leftFuture.result();
+	}
+	else
+#endif
+	{
+		leftChild = split(leftSubset, sortBuffer, reportProgress);
+		rightChild = split(rightSubset, sortBuffer + splitCount, reportProgress);
 	}
 
-	BaseNode* rightChild = split(rightSubset);
-	if (!rightChild)
+	if (!leftChild || !rightChild)
 	{
+		//not enough memory!
+		if (leftChild)
+			releaseSubTree(leftChild);
+		if (rightChild)
+			releaseSubTree(rightChild);
 		delete subset;
-		delete leftChild;
 		return 0;
 	}
 
@@ -242,20 +438,27 @@ TrueKdTree::BaseNode* TrueKdTree::split(ReferenceCloud* subset)
 		||	(rightChild->isLeaf() && static_cast<Leaf*>(rightChild)->points == 0) )
 	{
 		//at least one of the subsets couldn't be fitted with a plane!
-		delete leftChild;
-		delete rightChild;
+		releaseSubTree(leftChild);
+		releaseSubTree(rightChild);
 
 		//this node will become a leaf!
-		UpdateProgress(count);
+		UpdateProgress(count, reportProgress);
 		//the Leaf class takes ownership of the subset!
-		return new Leaf(subset, planeEquation, error);
+		return newLeaf(subset, planeEquation, error);
 	}
 
 	//we can now delete the subset
 	delete subset;
 	subset = 0;
 
-	Node* node = new Node;
+	Node* node = newNode();
+	if (!node)
+	{
+		//not enough memory!
+		releaseSubTree(leftChild);
+		releaseSubTree(rightChild);
+		return 0;
+	}
 	{
 		node->leftChild = leftChild;
 		leftChild->parent = node;
@@ -286,10 +489,11 @@ bool TrueKdTree::build(	double maxError,
 		return false;
 	}
 
-	//structures used to sort the points along the 3 dimensions
+	//buffer used to sort the points along a single dimension
+	std::vector<PointCoordinateType> sortBuffer;
 	try
 	{
-		s_sortedCoordsForSplit.resize(count);
+		sortBuffer.resize(count);
 	}
 	catch (const std::bad_alloc&)
 	{
@@ -313,10 +517,38 @@ bool TrueKdTree::build(	double maxError,
 	m_minPointCountPerCell = std::max<unsigned>(3,minPointCountPerCell);
 	m_maxPointCountPerCell = std::max<unsigned>(2*minPointCountPerCell,maxPointCountPerCell); //the max number of point per cell can't be < 2*min
 	m_errorMeasure = errorMeasure;
-	m_root = split(subset);
+	
+	if (m_nodePool)
+		delete m_nodePool;
+	m_nodePool = 0;
+	m_buildPool = new NodePool(BUILD_POOL_CHUNK_SIZE);
+	
+	m_root = split(subset, &(sortBuffer[0]), true);
 
-	//clear static structure
-	s_sortedCoordsForSplit.clear();
+	if (m_root)
+	{
+		//we move the whole tree in a single memory block, in depth-first order, so that
+		//the nodes and leaves order (in memory) doesn't depend on the threads scheduling
+		NodePool* finalPool = new NodePool(CountNodes(m_root));
+		if (finalPool->reserve())
+		{
+			m_root = moveSubTree(m_root, finalPool);
+			m_root->parent = 0;
+			delete m_buildPool;
+			m_nodePool = finalPool;
+		}
+		else
+		{
+			//not enough memory: we keep the build pool
+			delete finalPool;
+			m_nodePool = m_buildPool;
+		}
+	}
+	else
+	{
+		delete m_buildPool;
+	}
+	m_buildPool = 0;
 
 	return (m_root != 0);
 }
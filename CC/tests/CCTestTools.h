@@ -0,0 +1,141 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_TEST_TOOLS_HEADER
+#define CC_TEST_TOOLS_HEADER
+
+//Shared helpers for the CC_CORE_LIB tests and benchmarks (see tests/CMakeLists.txt)
+
+//Local
+#include <CCTypes.h>
+#include <SimpleCloud.h>
+
+//system
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+//! Checks a condition and makes the test fail (with a message) if it's not met
+#define CC_TEST_CHECK(cond) \
+	if (!(cond)) \
+	{ \
+		fprintf(stderr,"[%s:%i] Check failed: %s\n",__FILE__,__LINE__,#cond); \
+		return EXIT_FAILURE; \
+	}
+
+namespace CCTestTools
+{
+	//! Wall-clock timer
+	class Timer
+	{
+	public:
+
+		//! Default constructor (starts the timer)
+		Timer() { start(); }
+
+		//! (Re)starts the timer
+		void start() { m_start = now(); }
+
+		//! Returns the elapsed time since the last start (in milliseconds)
+		double elapsedMs() const { return now() - m_start; }
+
+	protected:
+
+		//! Returns the current time (in milliseconds)
+		static double now()
+		{
+#ifdef _WIN32
+			LARGE_INTEGER freq, t;
+			QueryPerformanceFrequency(&freq);
+			QueryPerformanceCounter(&t);
+			return (1000.0 * t.QuadPart) / freq.QuadPart;
+#else
+			timeval t;
+			gettimeofday(&t,0);
+			return 1000.0 * t.tv_sec + t.tv_usec / 1000.0;
+#endif
+		}
+
+		//! Start time
+		double m_start;
+	};
+
+	//! Deterministic pseudo-random generator (same sequence on all platforms)
+	class Random
+	{
+	public:
+
+		//! Default constructor
+		explicit Random(unsigned seed = 1) : m_state(seed) {}
+
+		//! Returns a value in [0,1[
+		double next()
+		{
+			//64 bits LCG (Knuth's MMIX constants)
+			m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+			return static_cast<double>(m_state >> 11) / 9007199254740992.0;
+		}
+
+	protected:
+
+		//! Current state
+		unsigned long long m_state;
+	};
+
+	//! Fills a cloud with points uniformly distributed in a box
+	/** \param cloud output cloud (points are appended)
+		\param count number of points
+		\param seed random generator seed
+		\param size box size (the box is centered on the origin)
+		\return false if there's not enough memory
+	**/
+	inline bool FillRandomCloud(CCLib::SimpleCloud& cloud, PointIndexType count, unsigned seed = 1, PointCoordinateType size = 100)
+	{
+		if (!cloud.reserve(cloud.size() + count))
+			return false;
+
+		Random rand(seed);
+		for (PointIndexType i=0; i<count; ++i)
+		{
+			CCVector3 P(static_cast<PointCoordinateType>((rand.next() - 0.5) * size),
+						static_cast<PointCoordinateType>((rand.next() - 0.5) * size),
+						static_cast<PointCoordinateType>((rand.next() - 0.5) * size));
+			cloud.addPoint(P);
+		}
+
+		return true;
+	}
+
+	//! Reads an optional count from the command line (or returns the default value)
+	inline PointIndexType GetCountArg(int argc, char** argv, int index, PointIndexType defaultValue)
+	{
+		if (argc > index)
+		{
+			long long value = atoll(argv[index]);
+			if (value > 0)
+				return static_cast<PointIndexType>(value);
+		}
+		return defaultValue;
+	}
+}
+
+#endif //CC_TEST_TOOLS_HEADER
@@ -0,0 +1,187 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+//Capped distances (maxSearchDist > 0): below the cap, cloud-to-cloud and
+//cloud-to-mesh distances must be exactly the same as the uncapped ones, and
+//all the other points must get the cap value. Single thread and multi-thread
+//results must be identical. The cloud-to-mesh Closest Point Set must flag the
+//points beyond the cap as 'no match' (NaN coordinates).
+//
+//Usage: CappedDistancesTest [point count]
+
+#include "CCTestTools.h"
+
+//CCLib
+#include <ChunkedPointCloud.h>
+#include <DistanceComputationTools.h>
+#include <SimpleCloud.h>
+#include <SimpleMesh.h>
+
+//system
+#include <math.h>
+#include <vector>
+
+using namespace CCLib;
+
+//! Distances computation mode
+enum DistanceMode { C2C, C2M_UNSIGNED, C2M_SIGNED };
+
+//! Computes the distances of all the compared points (stored in 'distances')
+static bool ComputeDistances(	DistanceMode mode,
+								SimpleCloud& compared,
+								SimpleCloud& reference,
+								SimpleMesh& mesh,
+								ScalarType maxSearchDist,
+								bool multiThread,
+								std::vector<ScalarType>& distances)
+{
+	if (!compared.enableScalarField())
+		return false;
+
+	int result = 0;
+	if (mode == C2C)
+	{
+		DistanceComputationTools::Cloud2CloudDistanceComputationParams params;
+		params.octreeLevel = 5;
+		params.maxSearchDist = maxSearchDist;
+		params.multiThread = multiThread;
+		result = DistanceComputationTools::computeCloud2CloudDistance(&compared,&reference,params);
+	}
+	else
+	{
+		DistanceComputationTools::Cloud2MeshDistanceComputationParams params;
+		params.octreeLevel = 4;
+		params.maxSearchDist = maxSearchDist;
+		params.multiThread = multiThread;
+		params.signedDistances = (mode == C2M_SIGNED);
+		result = DistanceComputationTools::computeCloud2MeshDistance(&compared,&mesh,params);
+	}
+	if (result < 0)
+		return false;
+
+	distances.resize(compared.size());
+	for (unsigned i=0; i<compared.size(); ++i)
+		distances[i] = compared.getPointScalarValue(i);
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned count = static_cast<unsigned>(CCTestTools::GetCountArg(argc,argv,1,20000));
+
+	//the compared points are spread in a larger box than the reference points/triangles
+	SimpleCloud compared;
+	CC_TEST_CHECK(CCTestTools::FillRandomCloud(compared,count,1,100));
+	SimpleCloud reference;
+	CC_TEST_CHECK(CCTestTools::FillRandomCloud(reference,count/4,2,40));
+
+	//wavy mesh (grid)
+	const unsigned gridSize = 60;
+	SimpleCloud vertices;
+	CC_TEST_CHECK(vertices.reserve(gridSize*gridSize));
+	for (unsigned j=0; j<gridSize; ++j)
+	{
+		for (unsigned i=0; i<gridSize; ++i)
+		{
+			PointCoordinateType x = static_cast<PointCoordinateType>(i) - gridSize/2;
+			PointCoordinateType y = static_cast<PointCoordinateType>(j) - gridSize/2;
+			vertices.addPoint(CCVector3(x,y,static_cast<PointCoordinateType>(5 * sin(x/7) * cos(y/5))));
+		}
+	}
+	SimpleMesh mesh(&vertices);
+	CC_TEST_CHECK(mesh.reserve(2*(gridSize-1)*(gridSize-1)));
+	for (unsigned j=0; j+1<gridSize; ++j)
+	{
+		for (unsigned i=0; i+1<gridSize; ++i)
+		{
+			unsigned v = j*gridSize + i;
+			mesh.addTriangle(v, v+1, v+gridSize);
+			mesh.addTriangle(v+1, v+gridSize+1, v+gridSize);
+		}
+	}
+
+	const ScalarType maxSearchDist = 15;
+	//relative margin around the cap (where float rounding may make the results differ)
+	const ScalarType margin = maxSearchDist * static_cast<ScalarType>(1.0e-4);
+
+	for (int mode=C2C; mode<=C2M_SIGNED; ++mode)
+	{
+		std::vector<ScalarType> reference_ST, reference_MT;
+		CC_TEST_CHECK(ComputeDistances(static_cast<DistanceMode>(mode),compared,reference,mesh,0,false,reference_ST));
+		CC_TEST_CHECK(ComputeDistances(static_cast<DistanceMode>(mode),compared,reference,mesh,0,true,reference_MT));
+		CC_TEST_CHECK(reference_ST == reference_MT);
+
+		std::vector<ScalarType> capped_ST, capped_MT;
+		CC_TEST_CHECK(ComputeDistances(static_cast<DistanceMode>(mode),compared,reference,mesh,maxSearchDist,false,capped_ST));
+		CC_TEST_CHECK(ComputeDistances(static_cast<DistanceMode>(mode),compared,reference,mesh,maxSearchDist,true,capped_MT));
+		CC_TEST_CHECK(capped_ST == capped_MT);
+
+		unsigned belowCount = 0, aboveCount = 0;
+		for (unsigned i=0; i<count; ++i)
+		{
+			ScalarType d = fabs(reference_ST[i]);
+			if (d < maxSearchDist - margin)
+			{
+				CC_TEST_CHECK(capped_ST[i] == reference_ST[i]);
+				++belowCount;
+			}
+			else if (d > maxSearchDist + margin)
+			{
+				CC_TEST_CHECK(capped_ST[i] == maxSearchDist);
+				++aboveCount;
+			}
+		}
+
+		//both cases must be tested
+		printf("Mode %i: %u points below the cap, %u above\n",mode,belowCount,aboveCount);
+		CC_TEST_CHECK(belowCount != 0 && aboveCount != 0);
+	}
+
+	//cloud-to-mesh Closest Point Set (octree and BVH based methods)
+	for (int useBVH=0; useBVH<2; ++useBVH)
+	{
+		ChunkedPointCloud CPSet;
+		DistanceComputationTools::Cloud2MeshDistanceComputationParams params;
+		params.octreeLevel = 4;
+		params.maxSearchDist = maxSearchDist;
+		params.multiThread = true;
+		params.useBVH = (useBVH != 0);
+		params.CPSet = &CPSet;
+		CC_TEST_CHECK(compared.enableScalarField());
+		CC_TEST_CHECK(DistanceComputationTools::computeCloud2MeshDistance(&compared,&mesh,params) >= 0);
+		CC_TEST_CHECK(CPSet.size() == count);
+
+		for (unsigned i=0; i<count; ++i)
+		{
+			ScalarType d = compared.getPointScalarValue(i);
+			const CCVector3* Q = CPSet.getPoint(i);
+			if (d < maxSearchDist)
+			{
+				CC_TEST_CHECK(Q->x == Q->x);
+				CC_TEST_CHECK(fabs((*Q - *compared.getPoint(i)).norm() - d) <= margin);
+			}
+			else
+			{
+				//'no match'
+				CC_TEST_CHECK(Q->x != Q->x);
+			}
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+//FlatKDTree benchmark: build time and queries throughput of the flat kd-tree
+//(used by the FPCS registration) vs. the former KDTree. The flat tree results
+//are checked against a brute force search on a subset of the queries.
+//
+//Usage: FlatKdTreeBenchmark [point count] [query count]
+
+#include "CCTestTools.h"
+
+//CCLib
+#include <FlatKdTree.h>
+#include <KdTree.h>
+#include <SimpleCloud.h>
+
+//system
+#include <algorithm>
+#include <math.h>
+#include <vector>
+
+using namespace CCLib;
+
+//! Returns the index of the nearest point closer than maxDist (brute force), or FlatKDTree::INVALID_INDEX
+static unsigned BruteForceNearestNeighbour(SimpleCloud& cloud, const CCVector3& Q, ScalarType maxDist)
+{
+	unsigned nearest = FlatKDTree::INVALID_INDEX;
+	double minDist2 = static_cast<double>(maxDist) * maxDist;
+	for (unsigned i=0; i<cloud.size(); ++i)
+	{
+		double d2 = (*cloud.getPoint(i) - Q).norm2d();
+		if (d2 < minDist2)
+		{
+			minDist2 = d2;
+			nearest = i;
+		}
+	}
+	return nearest;
+}
+
+//! Prints a throughput in million queries per second
+static void PrintThroughput(const char* name, unsigned queryCount, double ms)
+{
+	printf("  %-34s %10.1f ms (%.2f Mq/s)\n",name,ms,queryCount / (1000.0 * ms));
+}
+
+int main(int argc, char** argv)
+{
+	unsigned count = static_cast<unsigned>(CCTestTools::GetCountArg(argc,argv,1,1000000));
+	unsigned queryCount = static_cast<unsigned>(CCTestTools::GetCountArg(argc,argv,2,1000000));
+	//number of queries checked against the brute force search
+	const unsigned checkedCount = std::min<unsigned>(queryCount,200);
+
+	const PointCoordinateType size = 100;
+	SimpleCloud cloud;
+	CC_TEST_CHECK(CCTestTools::FillRandomCloud(cloud,count,1,size));
+
+	std::vector<CCVector3> queries;
+	{
+		SimpleCloud queryCloud;
+		CC_TEST_CHECK(CCTestTools::FillRandomCloud(queryCloud,queryCount,2,size));
+		queries.resize(queryCount);
+		for (unsigned i=0; i<queryCount; ++i)
+			queries[i] = *queryCloud.getPoint(i);
+	}
+
+	//mean distance between points
+	const ScalarType spacing = static_cast<ScalarType>(size / pow(static_cast<double>(count),1.0/3.0));
+	const ScalarType nnMaxDist = 2 * spacing;
+	const ScalarType belowMaxDist = spacing / 2;
+
+	printf("Kd-trees: %u points, %u queries\n",count,queryCount);
+
+	//build
+	FlatKDTree flatTree;
+	KDTree tree;
+	{
+		CCTestTools::Timer timer;
+		CC_TEST_CHECK(flatTree.buildFromCloud(&cloud));
+		double flatTime = timer.elapsedMs();
+
+		timer.start();
+		CC_TEST_CHECK(tree.buildFromCloud(&cloud));
+		double time = timer.elapsedMs();
+
+		printf("  build: flat %.1f ms, former %.1f ms\n",flatTime,time);
+	}
+
+	//nearest neighbour
+	std::vector<unsigned> nearest(queryCount);
+	{
+		CCTestTools::Timer timer;
+		for (unsigned i=0; i<queryCount; ++i)
+		{
+			if (!flatTree.findNearestNeighbour(queries[i].u,nearest[i],nnMaxDist))
+				nearest[i] = FlatKDTree::INVALID_INDEX;
+		}
+		PrintThroughput("nearest neighbour (flat)",queryCount,timer.elapsedMs());
+
+		timer.start();
+		for (unsigned i=0; i<queryCount; ++i)
+		{
+			unsigned index = 0;
+			tree.findNearestNeighbour(queries[i].u,index,nnMaxDist);
+		}
+		PrintThroughput("nearest neighbour (former)",queryCount,timer.elapsedMs());
+
+		std::vector<unsigned> batchNearest;
+		timer.start();
+		CC_TEST_CHECK(flatTree.findNearestNeighbours(&(queries[0]),queryCount,nnMaxDist,batchNearest));
+		PrintThroughput("nearest neighbours (flat, batch)",queryCount,timer.elapsedMs());
+
+		CC_TEST_CHECK(batchNearest == nearest);
+		for (unsigned i=0; i<checkedCount; ++i)
+		{
+			unsigned expected = BruteForceNearestNeighbour(cloud,queries[i],nnMaxDist);
+			CC_TEST_CHECK(nearest[i] == expected);
+		}
+	}
+
+	//point below distance
+	{
+		std::vector<unsigned char> found(queryCount);
+		unsigned foundCount = 0;
+		CCTestTools::Timer timer;
+		for (unsigned i=0; i<queryCount; ++i)
+		{
+			found[i] = flatTree.findPointBelowDistance(queries[i].u,belowMaxDist) ? 1 : 0;
+			foundCount += found[i];
+		}
+		PrintThroughput("point below distance (flat)",queryCount,timer.elapsedMs());
+
+		timer.start();
+		for (unsigned i=0; i<queryCount; ++i)
+		{
+			tree.findPointBelowDistance(queries[i].u,belowMaxDist);
+		}
+		PrintThroughput("point below distance (former)",queryCount,timer.elapsedMs());
+
+		timer.start();
+		unsigned batchCount = flatTree.countPointsBelowDistance(&(queries[0]),queryCount,belowMaxDist);
+		PrintThroughput("points below distance (flat, batch)",queryCount,timer.elapsedMs());
+
+		CC_TEST_CHECK(batchCount == foundCount);
+		for (unsigned i=0; i<checkedCount; ++i)
+		{
+			bool expected = (BruteForceNearestNeighbour(cloud,queries[i],belowMaxDist) != FlatKDTree::INVALID_INDEX);
+			CC_TEST_CHECK((found[i] != 0) == expected);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+//64 bits point indexes (CC_CORE_LIB_USES_64_BITS_INDEXES): a cloud with more
+//than 2^32 points is simulated (only its last points are actually stored), and
+//an octree structure referencing these last points is restored on top of it.
+//Its cells and neighbourhoods must match the ones of the same points stored
+//in a regular cloud (indexes shifted by 2^32 or more).
+//
+//Usage: Index64Test [stored point count]
+
+#include "CCTestTools.h"
+
+//CCLib
+#include <DgmOctree.h>
+#include <ReferenceCloud.h>
+#include <SimpleCloud.h>
+
+//system
+#include <vector>
+
+using namespace CCLib;
+
+#ifdef CC_CORE_LIB_USES_64_BITS_INDEXES
+
+//! Cloud with more than 2^32 points, of which only the last ones are stored
+/** Point #i (with i >= offset) is the point #(i-offset) of the 'stored' cloud.
+	The first (virtual) points must never be accessed.
+**/
+class VirtualLargeCloud : public GenericIndexedCloudPersist
+{
+public:
+
+	VirtualLargeCloud(SimpleCloud* stored, PointIndexType offset)
+		: m_stored(stored)
+		, m_offset(offset)
+		, m_invalidAccess(false)
+	{}
+
+	//! Returns whether one of the first (virtual) points has been accessed
+	bool invalidAccess() const { return m_invalidAccess; }
+
+	//inherited from GenericIndexedCloudPersist
+	virtual PointIndexType size() const { return m_offset + m_stored->size(); }
+	virtual void forEach(genericPointAction&) { m_invalidAccess = true; }
+	virtual void getBoundingBox(CCVector3& bbMin, CCVector3& bbMax) { m_stored->getBoundingBox(bbMin,bbMax); }
+	virtual void placeIteratorAtBegining() {}
+	virtual const CCVector3* getNextPoint() { m_invalidAccess = true; return 0; }
+	virtual bool enableScalarField() { return false; }
+	virtual bool isScalarFieldEnabled() const { return false; }
+	virtual void setPointScalarValue(PointIndexType, ScalarType) {}
+	virtual ScalarType getPointScalarValue(PointIndexType) const { return 0; }
+	virtual const CCVector3* getPoint(PointIndexType index) { return getPointPersistentPtr(index); }
+	virtual void getPoint(PointIndexType index, CCVector3& P) const { P = *const_cast<VirtualLargeCloud*>(this)->getPointPersistentPtr(index); }
+	virtual const CCVector3* getPointPersistentPtr(PointIndexType index)
+	{
+		if (index < m_offset)
+		{
+			m_invalidAccess = true;
+			index = m_offset;
+		}
+		return m_stored->getPointPersistentPtr(index - m_offset);
+	}
+
+protected:
+
+	SimpleCloud* m_stored;
+	PointIndexType m_offset;
+	bool m_invalidAccess;
+};
+
+//! Checks that the points of a cell are the expected ones
+/** Additional parameters:
+	- (PointIndexType*) first (real) point index
+	- (SimpleCloud*) stored points
+	- (std::vector<unsigned>*) number of visits per stored point
+**/
+static bool CheckCellPoints(const DgmOctree::octreeCell& cell, void** additionalParameters, NormalizedProgress*)
+{
+	PointIndexType offset = *static_cast<PointIndexType*>(additionalParameters[0]);
+	SimpleCloud* stored = static_cast<SimpleCloud*>(additionalParameters[1]);
+	std::vector<unsigned>& visits = *static_cast<std::vector<unsigned>*>(additionalParameters[2]);
+
+	for (PointIndexType i=0; i<cell.points->size(); ++i)
+	{
+		PointIndexType globalIndex = cell.points->getPointGlobalIndex(i);
+		if (globalIndex < offset || globalIndex - offset >= stored->size())
+			return false;
+		if ((*cell.points->getPoint(i) - *stored->getPoint(globalIndex - offset)).norm2() != 0)
+			return false;
+		++visits[globalIndex - offset];
+	}
+
+	return true;
+}
+
+#endif //CC_CORE_LIB_USES_64_BITS_INDEXES
+
+int main(int argc, char** argv)
+{
+#ifndef CC_CORE_LIB_USES_64_BITS_INDEXES
+	(void)argc; (void)argv;
+	printf("32 bits indexes: skipped\n");
+	return EXIT_SUCCESS;
+#else
+	PointIndexType count = CCTestTools::GetCountArg(argc,argv,1,100000);
+	const PointIndexType offset = (static_cast<PointIndexType>(1) << 32) + 17;
+
+	//the stored points
+	SimpleCloud stored;
+	CC_TEST_CHECK(CCTestTools::FillRandomCloud(stored,count));
+
+	//reference octree (regular indexes)
+	DgmOctree refOctree(&stored);
+	CC_TEST_CHECK(refOctree.build() > 0);
+
+	//ReferenceCloud with indexes above 2^32
+	VirtualLargeCloud largeCloud(&stored,offset);
+	CC_TEST_CHECK(largeCloud.size() > (static_cast<PointIndexType>(1) << 32));
+	{
+		ReferenceCloud ref(&largeCloud);
+		CC_TEST_CHECK(ref.addPointIndex(offset + 5));
+		CC_TEST_CHECK(ref.addPointIndex(offset, offset + 3));
+		CC_TEST_CHECK(ref.size() == 4);
+		CC_TEST_CHECK(ref.getPointGlobalIndex(0) == offset + 5);
+		CC_TEST_CHECK(ref.getPointGlobalIndex(3) == offset + 2);
+		CC_TEST_CHECK((*ref.getPoint(0) - *stored.getPoint(5)).norm2() == 0);
+	}
+
+	//same structure, with the indexes of the large cloud
+	DgmOctree octree(&largeCloud);
+	{
+		DgmOctree::cellsContainer cells = refOctree.pointsAndTheirCellCodes();
+		for (size_t i=0; i<cells.size(); ++i)
+			cells[i].theIndex += offset;
+
+		CCVector3 pointsMin, pointsMax;
+		refOctree.getPointsBoundingBox(pointsMin,pointsMax);
+		int fillIndexes[6];
+		for (int dim=0; dim<3; ++dim)
+		{
+			fillIndexes[dim] = refOctree.getMinFillIndexes(DgmOctree::MAX_OCTREE_LEVEL)[dim];
+			fillIndexes[dim+3] = refOctree.getMaxFillIndexes(DgmOctree::MAX_OCTREE_LEVEL)[dim];
+		}
+
+		CC_TEST_CHECK(octree.restoreStructure(cells,refOctree.getOctreeMins(),refOctree.getOctreeMaxs(),pointsMin,pointsMax,fillIndexes));
+		CC_TEST_CHECK(octree.getNumberOfProjectedPoints() == count);
+		for (unsigned char level=1; level<=DgmOctree::MAX_OCTREE_LEVEL; ++level)
+		{
+			CC_TEST_CHECK(octree.getCellNumber(level) == refOctree.getCellNumber(level));
+		}
+	}
+
+	//cells (serial and parallel)
+	for (int multiThread=0; multiThread<2; ++multiThread)
+	{
+		std::vector<unsigned> visits(count,0);
+		PointIndexType _offset = offset;
+		void* additionalParameters[3] = { &_offset, &stored, &visits };
+		CC_TEST_CHECK(octree.executeFunctionForAllCellsAtLevel(6,CheckCellPoints,additionalParameters,multiThread != 0) != 0);
+		for (PointIndexType i=0; i<count; ++i)
+		{
+			CC_TEST_CHECK(visits[i] == 1);
+		}
+	}
+
+	//neighbourhoods
+	{
+		PointCoordinateType radius = 2;
+		unsigned char level = octree.findBestLevelForAGivenNeighbourhoodSizeExtraction(radius);
+		DgmOctree::NeighboursSet refNeighbours, neighbours;
+		for (PointIndexType i=0; i<count; i+=97)
+		{
+			const CCVector3* P = stored.getPoint(i);
+			int refCount = refOctree.getPointsInSphericalNeighbourhood(*P,radius,refNeighbours,level);
+			int neighbourCount = octree.getPointsInSphericalNeighbourhood(*P,radius,neighbours,level);
+			CC_TEST_CHECK(refCount == neighbourCount);
+			for (int j=0; j<neighbourCount; ++j)
+			{
+				CC_TEST_CHECK(neighbours[j].pointIndex == refNeighbours[j].pointIndex + offset);
+			}
+		}
+	}
+
+	CC_TEST_CHECK(!largeCloud.invalidAccess());
+
+	return EXIT_SUCCESS;
+#endif
+}
@@ -0,0 +1,143 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+//Mesh distance grid: a grid saved and loaded again must give the same
+//distances, and it must be rejected for a mesh with the same size and
+//bounding-box but different vertices or triangles.
+//
+//Usage: MeshDistanceGridTest [point count]
+
+#include "CCTestTools.h"
+
+//CCLib
+#include <DistanceComputationTools.h>
+#include <MeshDistanceGrid.h>
+#include <SimpleCloud.h>
+#include <SimpleMesh.h>
+
+//system
+#include <math.h>
+#include <vector>
+
+using namespace CCLib;
+
+//! Size of the (square) grid mesh
+static const unsigned GRID_SIZE = 40;
+
+//! Creates a wavy grid mesh
+/** \param vertices mesh vertices (output)
+	\param mesh mesh (output)
+	\param bump elevation added to the vertex at the center of the grid
+	\param flipFirstTriangle whether the vertices order of the first triangle should be flipped
+	\return false if there's not enough memory
+**/
+static bool CreateMesh(SimpleCloud& vertices, SimpleMesh& mesh, PointCoordinateType bump, bool flipFirstTriangle)
+{
+	if (!vertices.reserve(GRID_SIZE*GRID_SIZE) || !mesh.reserve(2*(GRID_SIZE-1)*(GRID_SIZE-1)))
+		return false;
+
+	for (unsigned j=0; j<GRID_SIZE; ++j)
+	{
+		for (unsigned i=0; i<GRID_SIZE; ++i)
+		{
+			PointCoordinateType x = static_cast<PointCoordinateType>(i) - GRID_SIZE/2;
+			PointCoordinateType y = static_cast<PointCoordinateType>(j) - GRID_SIZE/2;
+			PointCoordinateType z = static_cast<PointCoordinateType>(3 * sin(x/5) * cos(y/4));
+			if (i == GRID_SIZE/2 && j == GRID_SIZE/2)
+				z += bump;
+			vertices.addPoint(CCVector3(x,y,z));
+		}
+	}
+
+	for (unsigned j=0; j+1<GRID_SIZE; ++j)
+	{
+		for (unsigned i=0; i+1<GRID_SIZE; ++i)
+		{
+			unsigned v = j*GRID_SIZE + i;
+			if (flipFirstTriangle && v == 0)
+				mesh.addTriangle(v, v+GRID_SIZE, v+1);
+			else
+				mesh.addTriangle(v, v+1, v+GRID_SIZE);
+			mesh.addTriangle(v+1, v+GRID_SIZE+1, v+GRID_SIZE);
+		}
+	}
+
+	return true;
+}
+
+//! Computes the signed distances with a distance grid
+static int ComputeDistances(SimpleCloud& cloud, SimpleMesh& mesh, const MeshDistanceGrid& grid, std::vector<ScalarType>& distances)
+{
+	if (!cloud.enableScalarField())
+		return -1;
+
+	DistanceComputationTools::Cloud2MeshDistanceComputationParams params;
+	params.signedDistances = true;
+	params.distanceGrid = &grid;
+	int result = DistanceComputationTools::computeCloud2MeshDistance(&cloud,&mesh,params);
+	if (result < 0)
+		return result;
+
+	distances.resize(cloud.size());
+	for (unsigned i=0; i<cloud.size(); ++i)
+		distances[i] = cloud.getPointScalarValue(i);
+
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned count = static_cast<unsigned>(CCTestTools::GetCountArg(argc,argv,1,20000));
+
+	SimpleCloud vertices, bumpVertices, flipVertices;
+	SimpleMesh mesh(&vertices), bumpMesh(&bumpVertices), flipMesh(&flipVertices);
+	CC_TEST_CHECK(CreateMesh(vertices,mesh,0,false));
+	//same size and bounding-box as 'mesh'
+	CC_TEST_CHECK(CreateMesh(bumpVertices,bumpMesh,static_cast<PointCoordinateType>(0.5),false));
+	CC_TEST_CHECK(CreateMesh(flipVertices,flipMesh,0,true));
+
+	MeshDistanceGrid grid;
+	CC_TEST_CHECK(grid.build(&mesh,static_cast<PointCoordinateType>(0.5),5,1));
+	CC_TEST_CHECK(grid.isCompatibleWith(&mesh));
+	CC_TEST_CHECK(!grid.isCompatibleWith(&bumpMesh));
+	CC_TEST_CHECK(!grid.isCompatibleWith(&flipMesh));
+
+	//save and load the grid again
+	const char filename[] = "MeshDistanceGridTest.grid";
+	CC_TEST_CHECK(grid.saveToFile(filename));
+	MeshDistanceGrid loadedGrid;
+	bool loaded = loadedGrid.loadFromFile(filename);
+	remove(filename);
+	CC_TEST_CHECK(loaded);
+	CC_TEST_CHECK(loadedGrid.brickCount() == grid.brickCount());
+	CC_TEST_CHECK(loadedGrid.isCompatibleWith(&mesh));
+	CC_TEST_CHECK(!loadedGrid.isCompatibleWith(&bumpMesh));
+	CC_TEST_CHECK(!loadedGrid.isCompatibleWith(&flipMesh));
+
+	//the distances must be the same with both grids
+	SimpleCloud cloud;
+	CC_TEST_CHECK(CCTestTools::FillRandomCloud(cloud,count,1,50));
+	std::vector<ScalarType> distances, loadedDistances;
+	CC_TEST_CHECK(ComputeDistances(cloud,mesh,grid,distances) >= 0);
+	CC_TEST_CHECK(ComputeDistances(cloud,mesh,loadedGrid,loadedDistances) >= 0);
+	CC_TEST_CHECK(distances == loadedDistances);
+
+	//an incompatible grid must be rejected
+	CC_TEST_CHECK(ComputeDistances(cloud,bumpMesh,loadedGrid,loadedDistances) == -2);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,87 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+//DgmOctree build benchmark: parallel build (cell codes computed by all threads +
+//radix sort) vs. the former serial path (see DgmOctree::setParallelBuild)
+//
+//Usage: OctreeBuildBenchmark [point count] [repetitions]
+
+#include "CCTestTools.h"
+
+//CCLib
+#include <DgmOctree.h>
+#include <SimpleCloud.h>
+
+using namespace CCLib;
+
+//! Builds the octree several times and returns the best time (in ms, or -1 on error)
+static double BestBuildTime(DgmOctree& octree, unsigned repetitions)
+{
+	double best = -1.0;
+	for (unsigned r=0; r<repetitions; ++r)
+	{
+		octree.clear();
+		CCTestTools::Timer timer;
+		if (octree.build() <= 0)
+			return -1.0;
+		double t = timer.elapsedMs();
+		if (best < 0 || t < best)
+			best = t;
+	}
+	return best;
+}
+
+int main(int argc, char** argv)
+{
+	PointIndexType count = CCTestTools::GetCountArg(argc,argv,1,10000000);
+	unsigned repetitions = static_cast<unsigned>(CCTestTools::GetCountArg(argc,argv,2,3));
+
+	SimpleCloud cloud;
+	CC_TEST_CHECK(CCTestTools::FillRandomCloud(cloud,count));
+
+	printf("DgmOctree build: %llu points, multi-threading %s, best of %u run(s)\n",static_cast<unsigned long long>(count),DgmOctree::MultiThreadSupport() ? "on" : "off",repetitions);
+
+	//serial build + std::sort
+	DgmOctree serialOctree(&cloud);
+	serialOctree.setParallelBuild(false);
+	double serialTime = BestBuildTime(serialOctree,repetitions);
+	CC_TEST_CHECK(serialTime >= 0);
+
+	//parallel build + radix sort
+	DgmOctree octree(&cloud);
+	double parallelTime = BestBuildTime(octree,repetitions);
+	CC_TEST_CHECK(parallelTime >= 0);
+
+	//both paths must give the same structure (std::sort is not stable: only the codes are compared)
+	const DgmOctree::cellsContainer& serialCells = serialOctree.pointsAndTheirCellCodes();
+	const DgmOctree::cellsContainer& cells = octree.pointsAndTheirCellCodes();
+	CC_TEST_CHECK(serialCells.size() == cells.size());
+	for (size_t i=0; i<cells.size(); ++i)
+	{
+		CC_TEST_CHECK(serialCells[i].theCode == cells[i].theCode);
+	}
+	for (unsigned char level=1; level<=DgmOctree::MAX_OCTREE_LEVEL; ++level)
+	{
+		CC_TEST_CHECK(serialOctree.getCellNumber(level) == octree.getCellNumber(level));
+	}
+
+	printf("  serial + std::sort:   %10.1f ms (%.2f Mpoints/s)\n",serialTime,count / (1000.0 * serialTime));
+	printf("  parallel + radix:     %10.1f ms (%.2f Mpoints/s)\n",parallelTime,count / (1000.0 * parallelTime));
+	printf("  speed-up: %.2f\n",serialTime / parallelTime);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+//Octree cell functions: the parallel execution (work stealing scheduler)
+//must visit each point once and give the same results as the serial one
+//
+//Usage: OctreeCellFunctionsTest [point count]
+
+#include "CCTestTools.h"
+
+//CCLib
+#include <DgmOctree.h>
+#include <ReferenceCloud.h>
+#include <SimpleCloud.h>
+
+//system
+#include <vector>
+
+using namespace CCLib;
+
+//! Counts the neighbours of each point of a cell
+/** Additional parameters:
+	- (std::vector<unsigned>*) number of neighbours per point
+	- (std::vector<unsigned>*) number of visits per point
+	- (PointCoordinateType*) neighbourhood radius
+**/
+static bool CountNeighboursInCell(const DgmOctree::octreeCell& cell, void** additionalParameters, NormalizedProgress*)
+{
+	std::vector<unsigned>& neighbourCounts = *static_cast<std::vector<unsigned>*>(additionalParameters[0]);
+	std::vector<unsigned>& visits = *static_cast<std::vector<unsigned>*>(additionalParameters[1]);
+	PointCoordinateType radius = *static_cast<PointCoordinateType*>(additionalParameters[2]);
+
+	DgmOctree::NeighboursSet neighbours;
+	unsigned char level = cell.parentOctree->findBestLevelForAGivenNeighbourhoodSizeExtraction(radius);
+	for (unsigned i=0; i<cell.points->size(); ++i)
+	{
+		PointIndexType globalIndex = cell.points->getPointGlobalIndex(i);
+		const CCVector3* P = cell.points->getPoint(i);
+		neighbourCounts[globalIndex] = static_cast<unsigned>(cell.parentOctree->getPointsInSphericalNeighbourhood(*P,radius,neighbours,level));
+		++visits[globalIndex];
+	}
+
+	return true;
+}
+
+//! Applies CountNeighboursInCell to all the cells and checks that each point is visited once
+static bool CountNeighbours(DgmOctree& octree, bool multiThread, bool startingAtLevel, std::vector<unsigned>& neighbourCounts)
+{
+	PointIndexType count = octree.associatedCloud()->size();
+	neighbourCounts.assign(count,0);
+	std::vector<unsigned> visits(count,0);
+	PointCoordinateType radius = 2;
+	void* additionalParameters[3] = { &neighbourCounts, &visits, &radius };
+
+	unsigned cellCount = 0;
+	if (startingAtLevel)
+		cellCount = octree.executeFunctionForAllCellsStartingAtLevel(4,CountNeighboursInCell,additionalParameters,50,500,multiThread);
+	else
+		cellCount = octree.executeFunctionForAllCellsAtLevel(7,CountNeighboursInCell,additionalParameters,multiThread);
+	if (cellCount == 0)
+		return false;
+
+	for (PointIndexType i=0; i<count; ++i)
+		if (visits[i] != 1)
+			return false;
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	PointIndexType count = CCTestTools::GetCountArg(argc,argv,1,200000);
+
+	//uneven density (so that the workers have to steal cells from each other)
+	SimpleCloud cloud;
+	CC_TEST_CHECK(CCTestTools::FillRandomCloud(cloud,count/2,1,100));
+	CC_TEST_CHECK(CCTestTools::FillRandomCloud(cloud,count/2,2,10));
+
+	DgmOctree octree(&cloud);
+	CC_TEST_CHECK(octree.build() > 0);
+
+	printf("Multi-thread support: %s\n",DgmOctree::MultiThreadSupport() ? "yes" : "no");
+
+	for (int startingAtLevel=0; startingAtLevel<2; ++startingAtLevel)
+	{
+		std::vector<unsigned> serialCounts, parallelCounts;
+		CC_TEST_CHECK(CountNeighbours(octree,false,startingAtLevel != 0,serialCounts));
+		CC_TEST_CHECK(CountNeighbours(octree,true,startingAtLevel != 0,parallelCounts));
+		CC_TEST_CHECK(serialCounts == parallelCounts);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+//Tiled (bounded memory) and out-of-core cloud-to-cloud distances: whatever
+//the memory budget (i.e. the number of tiles), the distances must be exactly
+//the same as the ones computed on the whole clouds.
+//
+//Usage: TiledDistancesTest [point count]
+
+#include "CCTestTools.h"
+
+//CCLib
+#include <DistanceComputationTools.h>
+#include <GenericPointStream.h>
+#include <ScalarFieldTools.h>
+#include <SimpleCloud.h>
+
+//system
+#include <vector>
+
+using namespace CCLib;
+
+//! Point stream reading a cloud stored in memory
+class CloudPointStream : public GenericPointStream
+{
+public:
+
+	explicit CloudPointStream(SimpleCloud* cloud) : m_cloud(cloud), m_next(0), m_rewindCount(0) {}
+
+	//! Returns how many times the stream has been read
+	unsigned rewindCount() const { return m_rewindCount; }
+
+	//inherited from GenericPointStream
+	virtual bool rewind() { m_next = 0; ++m_rewindCount; return true; }
+	virtual bool readNext(CCVector3& P)
+	{
+		if (m_next >= m_cloud->size())
+			return false;
+		P = *m_cloud->getPoint(m_next++);
+		return true;
+	}
+
+protected:
+
+	SimpleCloud* m_cloud;
+	unsigned m_next;
+	unsigned m_rewindCount;
+};
+
+//! Distances output stored in memory
+class VectorDistanceOutput : public GenericDistanceOutput
+{
+public:
+
+	std::vector<ScalarType> distances;
+
+	//inherited from GenericDistanceOutput
+	virtual bool writeNext(ScalarType d) { distances.push_back(d); return true; }
+};
+
+int main(int argc, char** argv)
+{
+	unsigned count = static_cast<unsigned>(CCTestTools::GetCountArg(argc,argv,1,50000));
+
+	//the reference cloud only partly overlaps the compared one
+	SimpleCloud compared;
+	CC_TEST_CHECK(CCTestTools::FillRandomCloud(compared,count,1,100));
+	SimpleCloud reference;
+	CC_TEST_CHECK(CCTestTools::FillRandomCloud(reference,count,2,60));
+
+	DistanceComputationTools::Cloud2CloudDistanceComputationParams params;
+	params.maxSearchDist = 5;
+
+	//reference: whole clouds
+	std::vector<ScalarType> expected(count);
+	{
+		CC_TEST_CHECK(compared.enableScalarField());
+		CC_TEST_CHECK(DistanceComputationTools::computeCloud2CloudDistance(&compared,&reference,params) >= 0);
+		for (unsigned i=0; i<count; ++i)
+			expected[i] = compared.getPointScalarValue(i);
+	}
+
+	//from a single tile to many tiles
+	const size_t budgets[3] = { 1 << 30, 1 << 20, 1 << 16 };
+	for (unsigned b=0; b<3; ++b)
+	{
+		//tiled
+		{
+			CC_TEST_CHECK(compared.enableScalarField());
+			compared.forEach(ScalarFieldTools::SetScalarValueToNaN);
+			CC_TEST_CHECK(DistanceComputationTools::computeCloud2CloudDistanceTiled(&compared,&reference,params,budgets[b]) == 0);
+			for (unsigned i=0; i<count; ++i)
+			{
+				CC_TEST_CHECK(compared.getPointScalarValue(i) == expected[i]);
+			}
+		}
+
+		//out-of-core
+		{
+			CloudPointStream comparedStream(&compared), referenceStream(&reference);
+			VectorDistanceOutput output;
+			CC_TEST_CHECK(DistanceComputationTools::computeCloud2CloudDistanceOutOfCore(&comparedStream,&referenceStream,&output,params,budgets[b],"TiledDistancesTest") == 0);
+			CC_TEST_CHECK(output.distances == expected);
+			printf("Budget %u bytes: compared stream read %u times\n",static_cast<unsigned>(budgets[b]),comparedStream.rewindCount());
+			//the number of passes doesn't depend on the number of tiles
+			CC_TEST_CHECK(comparedStream.rewindCount() <= 4 && referenceStream.rewindCount() <= 4);
+
+			//the temporary files must have been deleted
+			FILE* fp = fopen("TiledDistancesTest_0_comp.tmp","rb");
+			CC_TEST_CHECK(!fp);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -127,28 +127,28 @@ public:
 		It may even be 0 if the value shouldn't be displayed.
 		WARNING: scalar field must be enabled! (see ccDrawableObject::hasDisplayedScalarField)
 	**/
-	virtual const ColorCompType* getPointScalarValueColor(unsigned pointIndex) const = 0;
+	virtual const ColorCompType* getPointScalarValueColor(PointIndexType pointIndex) const = 0;
 
 	//! Returns scalar value associated to a given point
 	/** The returned value is taken from the current displayed scalar field
 		WARNING: scalar field must be enabled! (see ccDrawableObject::hasDisplayedScalarField)
 	**/
-	virtual ScalarType getPointDisplayedDistance(unsigned pointIndex) const = 0;
+	virtual ScalarType getPointDisplayedDistance(PointIndexType pointIndex) const = 0;
 
 	//! Returns color corresponding to a given point
 	/** WARNING: color array must be enabled! (see ccDrawableObject::hasDisplayedScalarField)
 	**/
-	virtual const ColorCompType* getPointColor(unsigned pointIndex) const = 0;
+	virtual const ColorCompType* getPointColor(PointIndexType pointIndex) const = 0;
 
 	//! Returns compressed normal corresponding to a given point
 	/** WARNING: normals array must be enabled! (see ccDrawableObject::hasDisplayedScalarField)
 	**/
-	virtual const CompressedNormType& getPointNormalIndex(unsigned pointIndex) const = 0;
+	virtual const CompressedNormType& getPointNormalIndex(PointIndexType pointIndex) const = 0;
 
 	//! Returns normal corresponding to a given point
 	/** WARNING: normals array must be enabled! (see ccDrawableObject::hasDisplayedScalarField)
 	**/
-	virtual const CCVector3& getPointNormal(unsigned pointIndex) const = 0;
+	virtual const CCVector3& getPointNormal(PointIndexType pointIndex) const = 0;
 
 
 	/***************************************************
@@ -665,6 +665,25 @@ bool ccNormalVectors::ComputeNormalWithTri(CCLib::GenericIndexedCloudPersist* po
 	return true;
 }
 
+//! Returns the coordinates of the points of an octree cell (as query points for batched neighbourhood extraction)
+static bool GetCellQueryPoints(const CCLib::DgmOctree::octreeCell& cell, std::vector<CCVector3>& queryPoints)
+{
+	unsigned pointCount = cell.points->size();
+	try
+	{
+		queryPoints.resize(pointCount);
+	}
+	catch (const std::bad_alloc&) //out of memory
+	{
+		return false;
+	}
+
+	for (unsigned i=0; i<pointCount; ++i)
+		cell.points->getPoint(i,queryPoints[i]);
+
+	return true;
+}
+
 bool ccNormalVectors::ComputeNormsAtLevelWithQuadric(	const CCLib::DgmOctree::octreeCell& cell,
 														void** additionalParameters,
 														CCLib::NormalizedProgress* nProgress/*=0*/)
@@ -673,35 +692,25 @@ bool ccNormalVectors::ComputeNormsAtLevelWithQuadric(	const CCLib::DgmOctree::oc
 	NormsTableType* theNorms	= static_cast<NormsTableType*>(additionalParameters[0]);
 	PointCoordinateType radius	= *static_cast<PointCoordinateType*>(additionalParameters[1]);
 
-	CCLib::DgmOctree::NearestNeighboursSphericalSearchStruct nNSS;
-	nNSS.level												= cell.level;
-	nNSS.prepare(radius,cell.parentOctree->getCellSize(nNSS.level));
-	cell.parentOctree->getCellPos(cell.truncatedCode,cell.level,nNSS.cellPos,true);
-	cell.parentOctree->computeCellCenter(nNSS.cellPos,cell.level,nNSS.cellCenter);
-
-	//we already know which points are lying in the current cell
+	//we extract the neighbourhoods of all the cell points at once
 	unsigned pointCount = cell.points->size();
-	nNSS.pointsInNeighbourhood.resize(pointCount);
-	CCLib::DgmOctree::NeighboursSet::iterator it = nNSS.pointsInNeighbourhood.begin();
-	for (unsigned j=0; j<pointCount; ++j,++it)
-	{
-		it->point = cell.points->getPointPersistentPtr(j);
-		it->pointIndex = cell.points->getPointGlobalIndex(j);
-	}
-	nNSS.alreadyVisitedNeighbourhoodSize = 1;
+	std::vector<CCVector3> queryPoints;
+	CCLib::DgmOctree::NeighboursBatch batch;
+	if (	!GetCellQueryPoints(cell,queryPoints)
+		||	(pointCount != 0 && !cell.parentOctree->findNeighborsInASphereBatch(&queryPoints[0],pointCount,radius,cell.level,batch)))
+		return false;
 
+	CCLib::DgmOctree::NeighboursSet neighboursSet;
 	for (unsigned i=0; i<pointCount; ++i)
 	{
-		cell.points->getPoint(i,nNSS.queryPoint);
-
-		//warning: there may be more points at the end of nNSS.pointsInNeighbourhood than the actual nearest neighbors (k)!
-		unsigned k = cell.parentOctree->findNeighborsInASphereStartingFromCell(nNSS,radius,false);
+		unsigned k = batch.count(i);
 		if (k >= NUMBER_OF_POINTS_FOR_NORM_WITH_LS)
 		{
-			CCLib::DgmOctreeReferenceCloud neighbours(&nNSS.pointsInNeighbourhood,k);
+			cell.parentOctree->getBatchNeighbours(batch,i,neighboursSet);
+			CCLib::DgmOctreeReferenceCloud neighbours(&neighboursSet,k);
 
 			CCVector3 N;
-			if (ComputeNormalWithQuadric(&neighbours, nNSS.queryPoint, N))
+			if (ComputeNormalWithQuadric(&neighbours, queryPoints[i], N))
 			{
 				theNorms->setValue(cell.points->getPointGlobalIndex(i), N.u);
 			}
@@ -722,34 +731,22 @@ bool ccNormalVectors::ComputeNormsAtLevelWithLS(const CCLib::DgmOctree::octreeCe
 	NormsTableType* theNorms	= static_cast<NormsTableType*>(additionalParameters[0]);
 	PointCoordinateType radius	= *static_cast<PointCoordinateType*>(additionalParameters[1]);
 
-	CCLib::DgmOctree::NearestNeighboursSphericalSearchStruct nNSS;
-	nNSS.level												= cell.level;
-	nNSS.prepare(radius,cell.parentOctree->getCellSize(nNSS.level));
-	cell.parentOctree->getCellPos(cell.truncatedCode,cell.level,nNSS.cellPos,true);
-	cell.parentOctree->computeCellCenter(nNSS.cellPos,cell.level,nNSS.cellCenter);
-
-	//we already know which points are lying in the current cell
+	//we extract the neighbourhoods of all the cell points at once
 	unsigned pointCount = cell.points->size();
-	nNSS.pointsInNeighbourhood.resize(pointCount);
-	{
-		CCLib::DgmOctree::NeighboursSet::iterator it = nNSS.pointsInNeighbourhood.begin();
-		for (unsigned j=0; j<pointCount; ++j,++it)
-		{
-			it->point = cell.points->getPointPersistentPtr(j);
-			it->pointIndex = cell.points->getPointGlobalIndex(j);
-		}
-	}
-	nNSS.alreadyVisitedNeighbourhoodSize = 1;
+	std::vector<CCVector3> queryPoints;
+	CCLib::DgmOctree::NeighboursBatch batch;
+	if (	!GetCellQueryPoints(cell,queryPoints)
+		||	(pointCount != 0 && !cell.parentOctree->findNeighborsInASphereBatch(&queryPoints[0],pointCount,radius,cell.level,batch)))
+		return false;
 
+	CCLib::DgmOctree::NeighboursSet neighboursSet;
 	for (unsigned i=0; i<pointCount; ++i)
 	{
-		cell.points->getPoint(i,nNSS.queryPoint);
-
-		//warning: there may be more points at the end of nNSS.pointsInNeighbourhood than the actual nearest neighbors (k)!
-		unsigned k = cell.parentOctree->findNeighborsInASphereStartingFromCell(nNSS,radius,false);
+		unsigned k = batch.count(i);
 		if (k >= NUMBER_OF_POINTS_FOR_NORM_WITH_QUADRIC)
 		{
-			CCLib::DgmOctreeReferenceCloud neighbours(&nNSS.pointsInNeighbourhood,k);
+			cell.parentOctree->getBatchNeighbours(batch,i,neighboursSet);
+			CCLib::DgmOctreeReferenceCloud neighbours(&neighboursSet,k);
 
 			CCVector3 N;
 			if (ComputeNormalWithLS(&neighbours, N))
@@ -772,35 +769,22 @@ bool ccNormalVectors::ComputeNormsAtLevelWithTri(	const CCLib::DgmOctree::octree
 	//additional parameters
 	NormsTableType* theNorms = static_cast<NormsTableType*>(additionalParameters[0]);
 
-	CCLib::DgmOctree::NearestNeighboursSearchStruct nNSS;
-	nNSS.level												= cell.level;
-	nNSS.minNumberOfNeighbors								= NUMBER_OF_POINTS_FOR_NORM_WITH_TRI;
-	cell.parentOctree->getCellPos(cell.truncatedCode,cell.level,nNSS.cellPos,true);
-	cell.parentOctree->computeCellCenter(nNSS.cellPos,cell.level,nNSS.cellCenter);
-
-	//we already know which points are lying in the current cell
+	//we extract the (at most) NUMBER_OF_POINTS_FOR_NORM_WITH_TRI*3 nearest neighbours of all the cell points at once
 	unsigned pointCount = cell.points->size();
-	nNSS.pointsInNeighbourhood.resize(pointCount);
-	CCLib::DgmOctree::NeighboursSet::iterator it = nNSS.pointsInNeighbourhood.begin();
-	{
-		for (unsigned j=0; j<pointCount; ++j,++it)
-		{
-			it->point = cell.points->getPointPersistentPtr(j);
-			it->pointIndex = cell.points->getPointGlobalIndex(j);
-		}
-	}
-	nNSS.alreadyVisitedNeighbourhoodSize = 1;
+	std::vector<CCVector3> queryPoints;
+	CCLib::DgmOctree::NeighboursBatch batch;
+	if (	!GetCellQueryPoints(cell,queryPoints)
+		||	(pointCount != 0 && !cell.parentOctree->findNearestNeighborsBatch(&queryPoints[0],pointCount,NUMBER_OF_POINTS_FOR_NORM_WITH_TRI*3,cell.level,batch)))
+		return false;
 
+	CCLib::DgmOctree::NeighboursSet neighboursSet;
 	for (unsigned i=0; i<pointCount; ++i)
 	{
-		cell.points->getPoint(i,nNSS.queryPoint);
-
-		unsigned k = cell.parentOctree->findNearestNeighborsStartingFromCell(nNSS);
+		unsigned k = batch.count(i);
 		if (k > NUMBER_OF_POINTS_FOR_NORM_WITH_TRI)
 		{
-			if (k > NUMBER_OF_POINTS_FOR_NORM_WITH_TRI*3)
-				k = NUMBER_OF_POINTS_FOR_NORM_WITH_TRI*3;
-			CCLib::DgmOctreeReferenceCloud neighbours(&nNSS.pointsInNeighbourhood,k);
+			cell.parentOctree->getBatchNeighbours(batch,i,neighboursSet);
+			CCLib::DgmOctreeReferenceCloud neighbours(&neighboursSet,k);
 
 			CCVector3 N;
 			if (ComputeNormalWithTri(&neighbours, N))
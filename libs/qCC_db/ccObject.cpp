@@ -55,8 +55,10 @@
 	v4.0 - 08/06/2015 - Custom labels added to color scales
 	v4.1 - 09/01/2015 - Scan grids added to point clouds
 	v4.2 - 10/07/2015 - Global shift added to the ccScalarField structure
+	v4.3 - 10/17/2026 - Octree and L.O.D. structures can be saved along with point clouds
+	v4.4 - 10/17/2026 - Octree structure saved with 64 bits indexes and counts
 **/
-const unsigned c_currentDBVersion = 42; //4.2
+const unsigned c_currentDBVersion = 44; //4.4
 
 //! Default unique ID generator (using the system persistent settings as we did previously proved to be not reliable)
 static ccUniqueIDGenerator::Shared s_uniqueIDGenerator(new ccUniqueIDGenerator);
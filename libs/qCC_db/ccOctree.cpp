@@ -142,6 +142,47 @@ void ccOctree::clear()
 	DgmOctree::clear();
 }
 
+void ccOctree::onStructureUpdated()
+{
+	m_shouldBeRefreshed = true;
+
+	//the frustum intersector will be rebuilt on demand
+	if (m_frustrumIntersector)
+	{
+		delete m_frustrumIntersector;
+		m_frustrumIntersector = 0;
+	}
+}
+
+bool ccOctree::removePoints(const std::vector<PointIndexType>& newIndexes)
+{
+	onStructureUpdated();
+	return DgmOctree::removePoints(newIndexes);
+}
+
+bool ccOctree::insertPoints(PointIndexType firstIndex)
+{
+	onStructureUpdated();
+	return DgmOctree::insertPoints(firstIndex);
+}
+
+int ccOctree::buildFromSubset(const CCLib::DgmOctree& source, const std::vector<PointIndexType>& newIndexes)
+{
+	onStructureUpdated();
+	return DgmOctree::buildFromSubset(source, newIndexes);
+}
+
+bool ccOctree::restoreStructure(cellsContainer& cells,
+								const CCVector3& octreeMin,
+								const CCVector3& octreeMax,
+								const CCVector3& pointsMin,
+								const CCVector3& pointsMax,
+								const int fillIndexes[6])
+{
+	onStructureUpdated();
+	return DgmOctree::restoreStructure(cells, octreeMin, octreeMax, pointsMin, pointsMax, fillIndexes);
+}
+
 ccBBox ccOctree::getOwnBB(bool withGLFeatures/*=false*/)
 {
 	if (withGLFeatures)
@@ -163,6 +204,9 @@ void ccOctree::multiplyBoundingBox(const PointCoordinateType multFactor)
 
 	for (int i=0; i<=MAX_OCTREE_LEVEL; ++i)
 		m_cellSize[i] *= multFactor;
+
+	//the ordered copy of the points coordinates is obsolete
+	releaseOrderedPoints();
 }
 
 void ccOctree::translateBoundingBox(const CCVector3& T)
@@ -171,6 +215,9 @@ void ccOctree::translateBoundingBox(const CCVector3& T)
 	m_dimMax += T;
 	m_pointsMin += T;
 	m_pointsMax += T;
+
+	//the ordered copy of the points coordinates is obsolete
+	releaseOrderedPoints();
 }
 
 void ccOctree::drawMeOnly(CC_DRAW_CONTEXT& context)
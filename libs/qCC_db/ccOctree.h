@@ -119,6 +119,15 @@ public: //GENERAL METHODS
 
 	//inherited from DgmOctree
 	virtual void clear();
+	virtual bool removePoints(const std::vector<PointIndexType>& newIndexes);
+	virtual bool insertPoints(PointIndexType firstIndex);
+	virtual int buildFromSubset(const CCLib::DgmOctree& source, const std::vector<PointIndexType>& newIndexes);
+	virtual bool restoreStructure(	cellsContainer& cells,
+									const CCVector3& octreeMin,
+									const CCVector3& octreeMax,
+									const CCVector3& pointsMin,
+									const CCVector3& pointsMax,
+									const int fillIndexes[6]);
 
 	//Inherited from ccHObject
 	virtual ccBBox getOwnBB(bool withGLFeatures = false);
@@ -162,6 +171,9 @@ protected:
 										void** additionalParameters,
 										CCLib::NormalizedProgress* nProgress = 0);
 
+	//! Deprecates the structures depending on the octree cells (display, frustum intersector, etc.)
+	void onStructureUpdated();
+
 	ccGenericPointCloud* m_theAssociatedCloudAsGPC;
 	CC_OCTREE_DISPLAY_TYPE m_displayType;
 	int m_displayedLevel;
@@ -49,9 +49,12 @@
 //Qt
 #include <QThread>
 #include <QElapsedTimer>
+#include <QtConcurrentMap>
 
 //system
 #include <assert.h>
+#include <math.h>
+#include <algorithm>
 
 //! Thread for background computation
 class LodStructThread : public QThread
@@ -353,6 +356,399 @@ void ccPointCloud::LodStruct::clearExtended(bool autoStopThread, State newState)
 	m_mutex.unlock();
 }
 
+//! Checksum of the acceleration structures saved in BIN files (Fletcher-like)
+class StructureChecksum
+{
+public:
+	//! Default constructor
+	StructureChecksum() : m_sum1(0), m_sum2(0) {}
+
+	//! Adds a value
+	inline void add(uint32_t value) { m_sum1 += value; m_sum2 += m_sum1; }
+
+	//! Returns the checksum value
+	inline uint64_t value() const { return m_sum2 ^ (m_sum1 << 32) ^ (m_sum1 >> 32); }
+
+protected:
+	uint64_t m_sum1;
+	uint64_t m_sum2;
+};
+
+//! Number of elements written (or read) at once when saving (or loading) the acceleration structures
+static const unsigned STRUCTURE_IO_CHUNK_SIZE = 65536;
+
+bool ccPointCloud::LodStruct::toFile(QFile& out) const
+{
+	lock();
+	assert(m_state == INITIALIZED && m_indexes);
+
+	StructureChecksum checksum;
+	bool success = true;
+
+	//level descriptors
+	uint8_t levelCount = static_cast<uint8_t>(std::min<size_t>(m_levels.size(),255));
+	if (out.write((const char*)&levelCount,1) < 0)
+		success = ccSerializableObject::WriteError();
+	for (uint8_t i=0; i<levelCount && success; ++i)
+	{
+		uint32_t desc[2] = {	static_cast<uint32_t>(m_levels[i].startIndex),
+								static_cast<uint32_t>(m_levels[i].count) };
+		if (out.write((const char*)desc,8) < 0)
+			success = ccSerializableObject::WriteError();
+		checksum.add(desc[0]);
+		checksum.add(desc[1]);
+	}
+
+	//indexes
+	if (success)
+	{
+		success = ccSerializationHelper::GenericArrayToFile(*m_indexes,out);
+	}
+
+	//checksum
+	if (success)
+	{
+		for (unsigned i=0; i<m_indexes->currentSize(); ++i)
+			checksum.add(static_cast<uint32_t>(m_indexes->getValue(i)));
+		uint64_t value = checksum.value();
+		if (out.write((const char*)&value,8) < 0)
+			success = ccSerializableObject::WriteError();
+	}
+
+	unlock();
+
+	return success;
+}
+
+bool ccPointCloud::LodStruct::fromFile(QFile& in, short dataVersion, unsigned pointCount)
+{
+	clear();
+
+	StructureChecksum checksum;
+	bool valid = true;
+
+	//level descriptors
+	uint8_t levelCount = 0;
+	if (in.read((char*)&levelCount,1) < 0)
+		return ccSerializableObject::ReadError();
+	std::vector<LevelDesc> levels;
+	try
+	{
+		levels.resize(levelCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return ccSerializableObject::MemoryError();
+	}
+	unsigned expectedStartIndex = 0;
+	for (uint8_t i=0; i<levelCount; ++i)
+	{
+		uint32_t desc[2] = { 0, 0 };
+		if (in.read((char*)desc,8) < 0)
+			return ccSerializableObject::ReadError();
+		checksum.add(desc[0]);
+		checksum.add(desc[1]);
+
+		levels[i] = LevelDesc(desc[0], desc[1]);
+		valid &= (levels[i].startIndex == expectedStartIndex);
+		expectedStartIndex += levels[i].count;
+	}
+	valid &= (levelCount != 0 && expectedStartIndex == pointCount);
+
+	//indexes
+	IndexSet* indexes = new IndexSet;
+	if (!ccSerializationHelper::GenericArrayFromFile(*indexes,in,dataVersion))
+	{
+		indexes->release();
+		return false;
+	}
+	valid &= (indexes->currentSize() == pointCount);
+	for (unsigned i=0; i<indexes->currentSize(); ++i)
+	{
+		unsigned index = indexes->getValue(i);
+		valid &= (index < pointCount);
+		checksum.add(static_cast<uint32_t>(index));
+	}
+
+	//checksum
+	uint64_t value = 0;
+	if (in.read((char*)&value,8) < 0)
+	{
+		indexes->release();
+		return ccSerializableObject::ReadError();
+	}
+	valid &= (value == checksum.value());
+
+	if (!valid)
+	{
+		ccLog::Warning("[BIN] Invalid L.O.D. structure (it will be computed again)");
+		indexes->release();
+		return true;
+	}
+
+	lock();
+	m_levels.swap(levels);
+	m_indexes = indexes;
+	m_state = INITIALIZED;
+	unlock();
+
+	return true;
+}
+
+//! Saves the octree structure of a cloud (see ccPointCloud::toFile_MeOnly)
+/** Point indexes and counts are saved on 64 bits (dataVersion>=44).
+**/
+static bool OctreeToFile(const ccOctree& octree, QFile& out)
+{
+	const CCLib::DgmOctree::cellsContainer& cells = octree.pointsAndTheirCellCodes();
+	StructureChecksum checksum;
+
+	//number of cells
+	uint64_t cellCount = static_cast<uint64_t>(cells.size());
+	if (out.write((const char*)&cellCount,8) < 0)
+		return ccSerializableObject::WriteError();
+	checksum.add(static_cast<uint32_t>(cellCount & 0xFFFFFFFF));
+	checksum.add(static_cast<uint32_t>(cellCount >> 32));
+
+	//maximum level of subdivision
+	uint8_t maxLevel = static_cast<uint8_t>(CCLib::DgmOctree::MAX_OCTREE_LEVEL);
+	if (out.write((const char*)&maxLevel,1) < 0)
+		return ccSerializableObject::WriteError();
+
+	//bounding-boxes
+	{
+		CCVector3 pointsMin, pointsMax;
+		octree.getPointsBoundingBox(pointsMin,pointsMax);
+		const CCVector3* boxes[4] = { &octree.getOctreeMins(), &octree.getOctreeMaxs(), &pointsMin, &pointsMax };
+		double values[12];
+		for (unsigned i=0; i<4; ++i)
+			for (unsigned j=0; j<3; ++j)
+				values[i*3+j] = static_cast<double>(boxes[i]->u[j]);
+		if (out.write((const char*)values,sizeof(double)*12) < 0)
+			return ccSerializableObject::WriteError();
+	}
+
+	//fill indexes (deepest level)
+	{
+		const int* minFillIndexes = octree.getMinFillIndexes(maxLevel);
+		const int* maxFillIndexes = octree.getMaxFillIndexes(maxLevel);
+		int32_t fillIndexes[6];
+		for (unsigned j=0; j<3; ++j)
+		{
+			fillIndexes[j] = static_cast<int32_t>(minFillIndexes[j]);
+			fillIndexes[j+3] = static_cast<int32_t>(maxFillIndexes[j]);
+		}
+		if (out.write((const char*)fillIndexes,4*6) < 0)
+			return ccSerializableObject::WriteError();
+		for (unsigned j=0; j<6; ++j)
+			checksum.add(static_cast<uint32_t>(fillIndexes[j]));
+	}
+
+	//number of cells per level (to double check the restored structure)
+	for (unsigned char level=0; level<=maxLevel; ++level)
+	{
+		uint64_t count = static_cast<uint64_t>(octree.getCellNumber(level));
+		if (out.write((const char*)&count,8) < 0)
+			return ccSerializableObject::WriteError();
+		checksum.add(static_cast<uint32_t>(count & 0xFFFFFFFF));
+		checksum.add(static_cast<uint32_t>(count >> 32));
+	}
+
+	//cells (64 bits index + 64 bits code)
+	{
+		std::vector<uint32_t> buffer;
+		try
+		{
+			buffer.resize(4*std::min<size_t>(cells.size(),STRUCTURE_IO_CHUNK_SIZE));
+		}
+		catch (const std::bad_alloc&)
+		{
+			return ccSerializableObject::MemoryError();
+		}
+
+		for (size_t start=0; start<cells.size(); start+=STRUCTURE_IO_CHUNK_SIZE)
+		{
+			size_t count = std::min<size_t>(cells.size()-start,STRUCTURE_IO_CHUNK_SIZE);
+			uint32_t* _buffer = &(buffer[0]);
+			for (size_t i=0; i<count; ++i)
+			{
+				const CCLib::DgmOctree::IndexAndCode& cell = cells[start+i];
+				uint64_t index = static_cast<uint64_t>(cell.theIndex);
+				uint64_t code = static_cast<uint64_t>(cell.theCode);
+				*_buffer++ = static_cast<uint32_t>(index & 0xFFFFFFFF);
+				*_buffer++ = static_cast<uint32_t>(index >> 32);
+				*_buffer++ = static_cast<uint32_t>(code & 0xFFFFFFFF);
+				*_buffer++ = static_cast<uint32_t>(code >> 32);
+			}
+			for (size_t i=0; i<4*count; ++i)
+				checksum.add(buffer[i]);
+
+			if (out.write((const char*)&(buffer[0]),sizeof(uint32_t)*4*count) < 0)
+				return ccSerializableObject::WriteError();
+		}
+	}
+
+	//checksum
+	uint64_t value = checksum.value();
+	if (out.write((const char*)&value,8) < 0)
+		return ccSerializableObject::WriteError();
+
+	return true;
+}
+
+//! Reads a count (or an index) saved on 1 or 2 words of 32 bits (see OctreeFromFile)
+static bool ReadStructureCount(QFile& in, unsigned words, StructureChecksum& checksum, uint64_t& count)
+{
+	uint32_t values[2] = { 0, 0 };
+	if (in.read((char*)values,4*words) < 0)
+		return false;
+	for (unsigned i=0; i<words; ++i)
+		checksum.add(values[i]);
+	count = (static_cast<uint64_t>(values[1]) << 32) | static_cast<uint64_t>(values[0]);
+	return true;
+}
+
+//! Loads the octree structure of a cloud (see ccPointCloud::fromFile_MeOnly)
+/** Point indexes and counts are saved on 32 bits in version 43, and on 64 bits since then.
+	\param cloud associated cloud (with all its points already loaded)
+	\param in input file
+	\param dataVersion file version
+	\param octree restored octree (or 0 if the saved structure is invalid)
+	\return false in case of a reading error
+**/
+static bool OctreeFromFile(ccPointCloud* cloud, QFile& in, short dataVersion, ccOctree*& octree)
+{
+	octree = 0;
+	StructureChecksum checksum;
+
+	//size of the indexes and counts (in 32 bits words)
+	const unsigned indexWords = (dataVersion >= 44 ? 2 : 1);
+	//size of a cell: index + 64 bits code (in 32 bits words)
+	const unsigned cellWords = indexWords + 2;
+
+	//number of cells
+	uint64_t cellCount = 0;
+	if (!ReadStructureCount(in,indexWords,checksum,cellCount))
+		return ccSerializableObject::ReadError();
+
+	//maximum level of subdivision
+	uint8_t maxLevel = 0;
+	if (in.read((char*)&maxLevel,1) < 0)
+		return ccSerializableObject::ReadError();
+
+	//bounding-boxes
+	CCVector3 boxes[4];
+	{
+		double values[12];
+		if (in.read((char*)values,sizeof(double)*12) < 0)
+			return ccSerializableObject::ReadError();
+		for (unsigned i=0; i<4; ++i)
+			for (unsigned j=0; j<3; ++j)
+				boxes[i].u[j] = static_cast<PointCoordinateType>(values[i*3+j]);
+	}
+
+	//fill indexes (deepest level)
+	int fillIndexes[6];
+	{
+		int32_t values[6];
+		if (in.read((char*)values,4*6) < 0)
+			return ccSerializableObject::ReadError();
+		for (unsigned j=0; j<6; ++j)
+		{
+			fillIndexes[j] = static_cast<int>(values[j]);
+			checksum.add(static_cast<uint32_t>(values[j]));
+		}
+	}
+
+	//octree built with a different maximum level of subdivision or with more points than the cloud? We skip it
+	if (	maxLevel != static_cast<uint8_t>(CCLib::DgmOctree::MAX_OCTREE_LEVEL)
+		||	cellCount > static_cast<uint64_t>(cloud->size()) )
+	{
+		qint64 byteCount = 4 * indexWords * (static_cast<qint64>(maxLevel)+1) + 4 * cellWords * static_cast<qint64>(cellCount) + 8;
+		if (!in.seek(in.pos() + byteCount))
+			return ccSerializableObject::ReadError();
+		if (maxLevel != static_cast<uint8_t>(CCLib::DgmOctree::MAX_OCTREE_LEVEL))
+			ccLog::Warning(QString("[BIN] Octree of cloud '%1' has been saved with a different maximum level of subdivision (it will be computed again)").arg(cloud->getName()));
+		else
+			ccLog::Warning(QString("[BIN] Invalid octree structure for cloud '%1' (it will be computed again)").arg(cloud->getName()));
+		return true;
+	}
+
+	//number of cells per level
+	uint64_t cellNumbers[CCLib::DgmOctree::MAX_OCTREE_LEVEL+1];
+	for (int level=0; level<=CCLib::DgmOctree::MAX_OCTREE_LEVEL; ++level)
+	{
+		if (!ReadStructureCount(in,indexWords,checksum,cellNumbers[level]))
+			return ccSerializableObject::ReadError();
+	}
+
+	//cells (index + 64 bits code)
+	CCLib::DgmOctree::cellsContainer cells;
+	bool valid = true;
+	{
+		std::vector<uint32_t> buffer;
+		try
+		{
+			cells.resize(static_cast<size_t>(cellCount));
+			buffer.resize(cellWords*std::min<size_t>(static_cast<size_t>(cellCount),STRUCTURE_IO_CHUNK_SIZE));
+		}
+		catch (const std::bad_alloc&)
+		{
+			return ccSerializableObject::MemoryError();
+		}
+
+		for (size_t start=0; start<cells.size(); start+=STRUCTURE_IO_CHUNK_SIZE)
+		{
+			size_t count = std::min<size_t>(cells.size()-start,STRUCTURE_IO_CHUNK_SIZE);
+			if (in.read((char*)&(buffer[0]),sizeof(uint32_t)*cellWords*count) < 0)
+				return ccSerializableObject::ReadError();
+			for (size_t i=0; i<cellWords*count; ++i)
+				checksum.add(buffer[i]);
+
+			const uint32_t* _buffer = &(buffer[0]);
+			for (size_t i=0; i<count; ++i, _buffer+=cellWords)
+			{
+				uint64_t index = static_cast<uint64_t>(_buffer[0]);
+				if (indexWords == 2)
+					index |= (static_cast<uint64_t>(_buffer[1]) << 32);
+				uint64_t code = (static_cast<uint64_t>(_buffer[indexWords+1]) << 32) | static_cast<uint64_t>(_buffer[indexWords]);
+				CCLib::DgmOctree::IndexAndCode& cell = cells[start+i];
+				cell.theIndex = static_cast<PointIndexType>(index);
+				cell.theCode = static_cast<CCLib::DgmOctree::OctreeCellCodeType>(code);
+				//the index or the code may not fit (e.g. 32 bits indexes or codes)
+				valid &= (static_cast<uint64_t>(cell.theIndex) == index);
+				valid &= (static_cast<uint64_t>(cell.theCode) == code);
+			}
+		}
+	}
+
+	//checksum
+	uint64_t value = 0;
+	if (in.read((char*)&value,8) < 0)
+		return ccSerializableObject::ReadError();
+	valid &= (value == checksum.value());
+
+	if (valid)
+	{
+		octree = new ccOctree(cloud);
+		valid = octree->restoreStructure(cells,boxes[0],boxes[1],boxes[2],boxes[3],fillIndexes);
+		for (int level=0; level<=CCLib::DgmOctree::MAX_OCTREE_LEVEL && valid; ++level)
+			valid = (static_cast<uint64_t>(octree->getCellNumber(static_cast<unsigned char>(level))) == cellNumbers[level]);
+		if (!valid)
+		{
+			delete octree;
+			octree = 0;
+		}
+	}
+
+	if (!valid)
+	{
+		ccLog::Warning(QString("[BIN] Invalid octree structure for cloud '%1' (it will be computed again)").arg(cloud->getName()));
+	}
+
+	return true;
+}
+
 ccPointCloud::ccPointCloud(QString name) throw()
 	: ChunkedPointCloud()
 	, ccGenericPointCloud(name)
@@ -468,6 +864,60 @@ void UpdateGridIndexes(const std::vector<int>& newIndexMap, std::vector<ccPointC
 	}
 }
 
+//! Gives to a cloud extracted from another one an octree extracted from the original cloud's octree
+/** The points don't need to be projected and sorted again (see DgmOctree::buildFromSubset).
+	\param octree original cloud's octree
+	\param selection selected points (in the original cloud)
+	\param result extracted cloud (its points must be in the same order as the selection)
+	\return success
+**/
+static bool ExtractOctree(ccOctree* octree, const CCLib::ReferenceCloud* selection, ccPointCloud* result)
+{
+	assert(octree && selection && result);
+
+	PointIndexType originalCount = selection->getAssociatedCloud()->size();
+	PointIndexType count = selection->size();
+	if (octree->getNumberOfProjectedPoints() != originalCount || result->size() != count)
+	{
+		//the octree is not up to date (or some points couldn't be copied)
+		return false;
+	}
+
+	ccOctree* resultOctree = new ccOctree(result);
+	try
+	{
+		std::vector<PointIndexType> newIndexes(originalCount, static_cast<PointIndexType>(CCLib::DgmOctree::INVALID_POINT_INDEX));
+		for (PointIndexType i=0; i<count; ++i)
+		{
+			PointIndexType& newIndex = newIndexes[selection->getPointGlobalIndex(i)];
+			if (newIndex != CCLib::DgmOctree::INVALID_POINT_INDEX)
+			{
+				//the same point is selected several times: it can't be extracted
+				delete resultOctree;
+				return false;
+			}
+			newIndex = i;
+		}
+
+		if (	resultOctree->buildFromSubset(*octree, newIndexes) > 0
+			&&	resultOctree->getNumberOfProjectedPoints() == count )
+		{
+			resultOctree->setDisplay(result->getDisplay());
+			resultOctree->setVisible(octree->isVisible());
+			resultOctree->setEnabled(false);
+			result->addChild(resultOctree);
+			return true;
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory: the octree will be computed again if necessary
+	}
+
+	delete resultOctree;
+	return false;
+}
+
 ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection, int* warnings/*=0*/) const
 {
 	if (warnings)
@@ -675,6 +1125,570 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 	//other parameters
 	result->importParametersFrom(this);
 
+	//octree (extracted from this cloud's octree: no need to sort the points again)
+	ccOctree* octree = const_cast<ccPointCloud*>(this)->getOctree();
+	if (octree)
+	{
+		ExtractOctree(octree, selection, result);
+	}
+
+	return result;
+}
+
+//! Number of bits per dimension of the voxel keys (see VoxelGrid::VoxelKey)
+static const unsigned VOXEL_GRID_KEY_BITS = 21;
+
+//! Max voxel position (along each dimension)
+static const int VOXEL_GRID_MAX_POS = (1 << VOXEL_GRID_KEY_BITS) - 1;
+
+//! Binary shift applied to the first dimension to define the sorting slabs
+static const unsigned VOXEL_GRID_SLAB_SHIFT = 4;
+
+//! Min number of points per sorting slab
+static const unsigned VOXEL_GRID_POINTS_PER_SLAB = 65536;
+
+//! Max number of chunks of points (key computation)
+static const unsigned VOXEL_GRID_MAX_CHUNK_COUNT = 64;
+
+//! Point of the voxel grid
+struct VoxelGridPoint
+{
+	//! Voxel key
+	unsigned long long key;
+	//! Point index
+	unsigned index;
+
+	//! Comparison operator (by voxel, then by index)
+	inline bool operator < (const VoxelGridPoint& other) const
+	{
+		return key < other.key || (key == other.key && index < other.index);
+	}
+};
+
+//! Voxel grid (see ccPointCloud::voxelGridSubsample)
+/** The dimensions are sorted by decreasing extent, so that the points can be sorted by slabs
+	along the largest one.
+**/
+struct VoxelGrid
+{
+	//! Source cloud
+	const ccPointCloud* cloud;
+	//! Grid origin
+	CCVector3d origin;
+	//! Voxel size
+	double voxelSize;
+	//! Dimensions (sorted by decreasing extent)
+	unsigned char dims[3];
+	//! Max voxel position along each (sorted) dimension
+	int maxPos[3];
+	//! Slab of each bin (the bins are the voxel positions along the first dimension, shifted by VOXEL_GRID_SLAB_SHIFT)
+	std::vector<unsigned> binSlabs;
+
+	//! Returns the voxel position of a point along a given (sorted) dimension
+	inline int voxelPos(const CCVector3& P, unsigned char d) const
+	{
+		double relPos = (static_cast<double>(P.u[dims[d]]) - origin.u[dims[d]]) / voxelSize;
+		return std::min(std::max(static_cast<int>(floor(relPos)), 0), maxPos[d]);
+	}
+
+	//! Returns the key of the voxel including a point
+	inline unsigned long long voxelKey(const CCVector3& P) const
+	{
+		return		(static_cast<unsigned long long>(voxelPos(P,0)) << (2*VOXEL_GRID_KEY_BITS))
+				|	(static_cast<unsigned long long>(voxelPos(P,1)) << VOXEL_GRID_KEY_BITS)
+				|	static_cast<unsigned long long>(voxelPos(P,2));
+	}
+};
+
+//! Chunk of points processed by a single thread (voxel keys computation)
+struct VoxelGridPointChunk
+{
+	//! Grid
+	const VoxelGrid* grid;
+	//! First point
+	unsigned first;
+	//! Number of points
+	unsigned count;
+	//! Number of points per bin (first pass)
+	std::vector<unsigned> binCounts;
+	//! Next position in each slab (second pass)
+	std::vector<unsigned> slabPos;
+	//! Output points (second pass)
+	VoxelGridPoint* points;
+};
+
+static void CountVoxelGridBins(VoxelGridPointChunk& chunk)
+{
+	for (unsigned i=chunk.first; i<chunk.first+chunk.count; ++i)
+		++chunk.binCounts[chunk.grid->voxelPos(*chunk.grid->cloud->getPoint(i),0) >> VOXEL_GRID_SLAB_SHIFT];
+}
+
+static void DispatchVoxelGridPoints(VoxelGridPointChunk& chunk)
+{
+	const VoxelGrid& grid = *chunk.grid;
+	for (unsigned i=chunk.first; i<chunk.first+chunk.count; ++i)
+	{
+		unsigned long long key = grid.voxelKey(*grid.cloud->getPoint(i));
+		unsigned slab = grid.binSlabs[static_cast<unsigned>(key >> (2*VOXEL_GRID_KEY_BITS)) >> VOXEL_GRID_SLAB_SHIFT];
+		VoxelGridPoint& vp = chunk.points[chunk.slabPos[slab]++];
+		vp.key = key;
+		vp.index = i;
+	}
+}
+
+//! Voxel aggregation context (shared by all the slabs)
+struct VoxelGridAggregation
+{
+	//! Source cloud
+	const ccPointCloud* cloud;
+	//! Aggregation mode
+	ccPointCloud::VOXEL_AGGREGATION mode;
+	//! Output points
+	std::vector<CCVector3> points;
+	//! Output colors (if any)
+	ColorsTableType* colors;
+	//! Output normals (if any)
+	NormsIndexesTableType* normals;
+	//! Source scalar fields
+	std::vector<const CCLib::ScalarField*> inSFs;
+	//! Output scalar fields
+	std::vector<CCLib::ScalarField*> outSFs;
+	//! Progress notification (per slab)
+	CCLib::NormalizedProgress* nProgress;
+	//! Whether the process has been cancelled
+	bool cancelled;
+	//! Whether we ran out of memory
+	bool notEnoughMemory;
+};
+
+//! Slab of points sorted and aggregated by a single thread
+/** A voxel always lies in a single slab.
+**/
+struct VoxelGridSlab
+{
+	//! First point
+	VoxelGridPoint* begin;
+	//! Last point (excluded)
+	VoxelGridPoint* end;
+	//! Index of the first voxel of the slab
+	unsigned firstVoxel;
+	//! Number of voxels in the slab
+	unsigned voxelCount;
+	//! Aggregation context
+	VoxelGridAggregation* aggregation;
+};
+
+static void SortVoxelGridSlab(VoxelGridSlab& slab)
+{
+	std::sort(slab.begin, slab.end);
+
+	slab.voxelCount = 0;
+	for (const VoxelGridPoint* it = slab.begin; it != slab.end; ++it)
+		if (it == slab.begin || it->key != (it-1)->key)
+			++slab.voxelCount;
+
+	VoxelGridAggregation& aggregation = *slab.aggregation;
+	if (aggregation.nProgress && !aggregation.nProgress->oneStep())
+		aggregation.cancelled = true;
+}
+
+//! Aggregates a set of values (not empty, reordered in the median case)
+static ScalarType AggregateVoxelValues(std::vector<ScalarType>& values, ccPointCloud::VOXEL_AGGREGATION mode)
+{
+	assert(!values.empty());
+	switch (mode)
+	{
+	case ccPointCloud::VOXEL_MEDIAN:
+		{
+			size_t mid = values.size() / 2;
+			std::nth_element(values.begin(), values.begin()+mid, values.end());
+			ScalarType median = values[mid];
+			if ((values.size() & 1) == 0)
+			{
+				//even number of values: mean of the two middle values
+				median = (median + *std::max_element(values.begin(), values.begin()+mid)) / 2;
+			}
+			return median;
+		}
+	case ccPointCloud::VOXEL_MIN:
+		return *std::min_element(values.begin(), values.end());
+	case ccPointCloud::VOXEL_MAX:
+		return *std::max_element(values.begin(), values.end());
+	default:
+		break;
+	}
+
+	double sum = 0;
+	for (size_t i=0; i<values.size(); ++i)
+		sum += values[i];
+	return static_cast<ScalarType>(sum / values.size());
+}
+
+static void AggregateVoxelGridSlab(VoxelGridSlab& slab)
+{
+	VoxelGridAggregation& aggregation = *slab.aggregation;
+	if (aggregation.cancelled || aggregation.notEnoughMemory)
+		return;
+
+	const ccPointCloud* cloud = aggregation.cloud;
+
+	try
+	{
+		std::vector<ScalarType> values;
+		unsigned voxelIndex = slab.firstVoxel;
+		for (const VoxelGridPoint* first = slab.begin; first != slab.end; ++voxelIndex)
+		{
+			const VoxelGridPoint* last = first + 1;
+			while (last != slab.end && last->key == first->key)
+				++last;
+
+			//gravity center
+			{
+				CCVector3d sumP(0,0,0);
+				for (const VoxelGridPoint* it = first; it != last; ++it)
+				{
+					const CCVector3* P = cloud->getPoint(it->index);
+					sumP += CCVector3d(P->x, P->y, P->z);
+				}
+				aggregation.points[voxelIndex] = CCVector3::fromArray((sumP / static_cast<double>(last - first)).u);
+			}
+
+			//mean normal
+			if (aggregation.normals)
+			{
+				CCVector3 sumN(0,0,0);
+				for (const VoxelGridPoint* it = first; it != last; ++it)
+					sumN += cloud->getPointNormal(it->index);
+				sumN.normalize();
+				aggregation.normals->setValue(voxelIndex, ccNormalVectors::GetNormIndex(sumN));
+			}
+
+			//colors
+			if (aggregation.colors)
+			{
+				ColorCompType C[3];
+				for (unsigned char c=0; c<3; ++c)
+				{
+					values.clear();
+					for (const VoxelGridPoint* it = first; it != last; ++it)
+						values.push_back(static_cast<ScalarType>(cloud->getPointColor(it->index)[c]));
+					double value = floor(AggregateVoxelValues(values, aggregation.mode) + 0.5);
+					C[c] = static_cast<ColorCompType>(std::min(std::max(value, 0.0), static_cast<double>(ccColor::MAX)));
+				}
+				aggregation.colors->setValue(voxelIndex, C);
+			}
+
+			//scalar fields
+			for (size_t k=0; k<aggregation.inSFs.size(); ++k)
+			{
+				const CCLib::ScalarField* sf = aggregation.inSFs[k];
+				values.clear();
+				for (const VoxelGridPoint* it = first; it != last; ++it)
+				{
+					ScalarType value = sf->getValue(it->index);
+					if (CCLib::ScalarField::ValidValue(value))
+						values.push_back(value);
+				}
+				aggregation.outSFs[k]->setValue(voxelIndex, values.empty() ? CCLib::ScalarField::NaN() : AggregateVoxelValues(values, aggregation.mode));
+			}
+
+			first = last;
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		aggregation.notEnoughMemory = true;
+		return;
+	}
+
+	if (aggregation.nProgress && !aggregation.nProgress->oneStep())
+		aggregation.cancelled = true;
+}
+
+ccPointCloud* ccPointCloud::voxelGridSubsample(	PointCoordinateType voxelSize,
+												VOXEL_AGGREGATION aggregationMode/*=VOXEL_MEAN*/,
+												bool multiThread/*=true*/,
+												CCLib::GenericProgressCallback* progressCb/*=0*/)
+{
+	unsigned pointCount = size();
+	if (pointCount == 0 || !(voxelSize > 0))
+	{
+		ccLog::Warning("[ccPointCloud::voxelGridSubsample] Invalid input");
+		return 0;
+	}
+
+	VoxelGrid grid;
+	grid.cloud = this;
+	grid.voxelSize = voxelSize;
+
+	//grid dimensions
+	{
+		CCVector3 bbMin, bbMax;
+		getBoundingBox(bbMin,bbMax);
+		CCVector3d extents(	static_cast<double>(bbMax.x) - bbMin.x,
+							static_cast<double>(bbMax.y) - bbMin.y,
+							static_cast<double>(bbMax.z) - bbMin.z );
+
+		//dimensions sorted by decreasing extent
+		grid.dims[0] = 0; grid.dims[1] = 1; grid.dims[2] = 2;
+		for (unsigned char i=0; i<2; ++i)
+			for (unsigned char j=i+1; j<3; ++j)
+				if (extents.u[grid.dims[j]] > extents.u[grid.dims[i]])
+					std::swap(grid.dims[i],grid.dims[j]);
+
+		if (extents.u[grid.dims[0]] / grid.voxelSize >= VOXEL_GRID_MAX_POS)
+		{
+			ccLog::Warning(QString("[ccPointCloud::voxelGridSubsample] Voxel size is too small (at most %1 voxels per dimension)").arg(VOXEL_GRID_MAX_POS));
+			return 0;
+		}
+
+		grid.origin = CCVector3d(bbMin.x, bbMin.y, bbMin.z);
+		for (unsigned char d=0; d<3; ++d)
+			grid.maxPos[d] = static_cast<int>(floor(extents.u[grid.dims[d]] / grid.voxelSize));
+	}
+
+	CCLib::NormalizedProgress* nProgress = 0;
+	if (progressCb)
+	{
+		progressCb->reset();
+		progressCb->setMethodTitle("Voxel grid subsampling");
+		progressCb->setInfo(qPrintable(QString("Points: %1\nVoxel size: %2").arg(pointCount).arg(voxelSize)));
+		progressCb->start();
+	}
+
+	VoxelGridAggregation aggregation;
+	aggregation.cloud = this;
+	aggregation.mode = aggregationMode;
+	aggregation.colors = 0;
+	aggregation.normals = 0;
+	aggregation.nProgress = 0;
+	aggregation.cancelled = false;
+	aggregation.notEnoughMemory = false;
+
+	std::vector<VoxelGridPoint> points;
+	std::vector<VoxelGridPointChunk> chunks;
+	std::vector<VoxelGridSlab> slabs;
+	try
+	{
+		points.resize(pointCount);
+
+		//chunks of points
+		const unsigned binCount = (static_cast<unsigned>(grid.maxPos[0]) >> VOXEL_GRID_SLAB_SHIFT) + 1;
+		const unsigned pointsPerChunk = std::max(VOXEL_GRID_POINTS_PER_SLAB, (pointCount - 1) / VOXEL_GRID_MAX_CHUNK_COUNT + 1);
+		for (unsigned first=0; first<pointCount; first+=pointsPerChunk)
+		{
+			VoxelGridPointChunk chunk;
+			chunk.grid = &grid;
+			chunk.first = first;
+			chunk.count = std::min(pointsPerChunk, pointCount - first);
+			chunk.points = &(points[0]);
+			chunks.push_back(chunk);
+			chunks.back().binCounts.resize(binCount, 0);
+		}
+
+		//number of points per bin
+		if (multiThread && chunks.size() > 1)
+		{
+			QtConcurrent::blockingMap(chunks, CountVoxelGridBins);
+		}
+		else
+		{
+			for (size_t c=0; c<chunks.size(); ++c)
+				CountVoxelGridBins(chunks[c]);
+		}
+
+		//consecutive bins are gathered in slabs
+		const unsigned pointsPerSlab = std::max(VOXEL_GRID_POINTS_PER_SLAB, pointCount / 256);
+		grid.binSlabs.resize(binCount);
+		std::vector<unsigned> slabOffsets(1,0);
+		unsigned slabPoints = 0;
+		for (unsigned b=0; b<binCount; ++b)
+		{
+			if (slabPoints >= pointsPerSlab)
+			{
+				slabOffsets.push_back(slabOffsets.back() + slabPoints);
+				slabPoints = 0;
+			}
+			grid.binSlabs[b] = static_cast<unsigned>(slabOffsets.size()) - 1;
+			for (size_t c=0; c<chunks.size(); ++c)
+				slabPoints += chunks[c].binCounts[b];
+		}
+		slabOffsets.push_back(pointCount);
+
+		//starting position of each chunk in each slab (so that the points keep their original order)
+		std::vector<unsigned> slabPos(slabOffsets.begin(), slabOffsets.end()-1);
+		for (size_t c=0; c<chunks.size(); ++c)
+		{
+			VoxelGridPointChunk& chunk = chunks[c];
+			chunk.slabPos = slabPos;
+			for (unsigned b=0; b<binCount; ++b)
+				slabPos[grid.binSlabs[b]] += chunk.binCounts[b];
+			//we don't need the bins anymore
+			std::vector<unsigned>().swap(chunk.binCounts);
+		}
+
+		for (size_t s=0; s+1<slabOffsets.size(); ++s)
+		{
+			VoxelGridSlab slab;
+			slab.begin = &(points[0]) + slabOffsets[s];
+			slab.end = &(points[0]) + slabOffsets[s+1];
+			slab.firstVoxel = 0;
+			slab.voxelCount = 0;
+			slab.aggregation = &aggregation;
+			slabs.push_back(slab);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccPointCloud::voxelGridSubsample] Not enough memory");
+		if (progressCb)
+			progressCb->stop();
+		return 0;
+	}
+
+	if (progressCb)
+	{
+		nProgress = new CCLib::NormalizedProgress(progressCb, 2 * static_cast<unsigned>(slabs.size()));
+		aggregation.nProgress = nProgress;
+	}
+
+	//the points are dispatched in their slab...
+	if (multiThread && chunks.size() > 1)
+	{
+		QtConcurrent::blockingMap(chunks, DispatchVoxelGridPoints);
+	}
+	else
+	{
+		for (size_t c=0; c<chunks.size(); ++c)
+			DispatchVoxelGridPoints(chunks[c]);
+	}
+	chunks.clear();
+
+	//...then sorted by voxel
+	if (multiThread && slabs.size() > 1)
+	{
+		QtConcurrent::blockingMap(slabs, SortVoxelGridSlab);
+	}
+	else
+	{
+		for (size_t s=0; s<slabs.size(); ++s)
+			SortVoxelGridSlab(slabs[s]);
+	}
+
+	unsigned voxelCount = 0;
+	for (size_t s=0; s<slabs.size(); ++s)
+	{
+		slabs[s].firstVoxel = voxelCount;
+		voxelCount += slabs[s].voxelCount;
+	}
+
+	//output cloud
+	ccPointCloud* result = 0;
+	if (!aggregation.cancelled)
+	{
+		result = new ccPointCloud(getName() + QString(".subsampled"));
+		bool success = result->reserveThePointsTable(voxelCount);
+		if (success && hasColors())
+			success = result->reserveTheRGBTable();
+		if (success && hasNormals())
+		{
+			//the normals must be decompressed in parallel
+			ccNormalVectors::GetUniqueInstance();
+			success = result->reserveTheNormsTable();
+		}
+		for (unsigned k=0; k<getNumberOfScalarFields() && success; ++k)
+		{
+			const ccScalarField* sf = static_cast<ccScalarField*>(getScalarField(k));
+			int sfIdx = result->addScalarField(sf->getName());
+			if (sfIdx >= 0)
+			{
+				aggregation.inSFs.push_back(sf);
+				aggregation.outSFs.push_back(result->getScalarField(sfIdx));
+			}
+			else
+			{
+				success = false;
+			}
+		}
+		if (success)
+		{
+			try
+			{
+				aggregation.points.resize(voxelCount);
+			}
+			catch (const std::bad_alloc&)
+			{
+				success = false;
+			}
+		}
+		if (success)
+			success = result->resize(voxelCount);
+
+		if (success)
+		{
+			aggregation.colors = (hasColors() ? result->rgbColors() : 0);
+			aggregation.normals = (hasNormals() ? result->normals() : 0);
+
+			//the features of each voxel are aggregated
+			if (multiThread && slabs.size() > 1)
+			{
+				QtConcurrent::blockingMap(slabs, AggregateVoxelGridSlab);
+			}
+			else
+			{
+				for (size_t s=0; s<slabs.size(); ++s)
+					AggregateVoxelGridSlab(slabs[s]);
+			}
+		}
+		else
+		{
+			aggregation.notEnoughMemory = true;
+		}
+	}
+
+	if (nProgress)
+	{
+		delete nProgress;
+		nProgress = 0;
+	}
+	if (progressCb)
+		progressCb->stop();
+
+	if (aggregation.cancelled || aggregation.notEnoughMemory)
+	{
+		if (aggregation.notEnoughMemory)
+			ccLog::Warning("[ccPointCloud::voxelGridSubsample] Not enough memory");
+		delete result;
+		return 0;
+	}
+
+	for (unsigned i=0; i<voxelCount; ++i)
+		*result->point(i) = aggregation.points[i];
+
+	//display parameters
+	result->setVisible(isVisible());
+	result->setDisplay(getDisplay());
+	result->setEnabled(isEnabled());
+	result->showColors(colorsShown());
+	result->showNormals(normalsShown());
+
+	for (size_t k=0; k<aggregation.outSFs.size(); ++k)
+	{
+		ccScalarField* sf = static_cast<ccScalarField*>(aggregation.outSFs[k]);
+		const ccScalarField* sourceSF = static_cast<const ccScalarField*>(aggregation.inSFs[k]);
+		sf->setGlobalShift(sourceSF->getGlobalShift());
+		sf->computeMinAndMax();
+		sf->importParametersFrom(sourceSF);
+	}
+	if (!aggregation.outSFs.empty())
+	{
+		result->setCurrentDisplayedScalarField(std::max(0, getCurrentDisplayedScalarFieldIndex()));
+		result->showSF(sfShown());
+	}
+
+	//other parameters
+	result->importParametersFrom(this);
+
 	return result;
 }
 
@@ -707,6 +1721,11 @@ void ccPointCloud::notifyGeometryUpdate()
 
 	releaseVBOs();
 	m_lod.clear();
+
+	//the octree copy of the points coordinates (if any) is now obsolete
+	ccOctree* oct = getOctree();
+	if (oct)
+		oct->releaseOrderedPoints();
 }
 
 ccGenericPointCloud* ccPointCloud::clone(ccGenericPointCloud* destCloud/*=0*/, bool ignoreChildren/*=false*/)
@@ -771,19 +1790,29 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 	setVisible(isVisible() || addedCloud->isVisible());
 
 	//3D points (already reserved)
+	bool pointsAdded = false;
 	if (size() == pointCountBefore) //in some cases points have already been copied! (ok it's tricky)
 	{
 		//we remove structures that are not compatible with fusion process
-		deleteOctree();
 		unallocateVisibilityArray();
 
 		for (unsigned i=0; i<addedPoints; i++)
 			addPoint(*addedCloud->getPoint(i));
+
+		pointsAdded = true;
 	}
 
 	//deprecate internal structures
 	notifyGeometryUpdate(); //calls releaseVBOs()
 
+	//the new points are inserted in the octree (if they fit in its bounding-box)
+	if (pointsAdded)
+	{
+		ccOctree* octree = getOctree();
+		if (octree && !octree->insertPoints(pointCountBefore))
+			deleteOctree();
+	}
+
 	//Colors (already reserved)
 	if (hasColors() || addedCloud->hasColors())
 	{
@@ -1130,7 +2159,7 @@ void ccPointCloud::unallocateColors()
 	enableTempColor(false);
 }
 
-bool ccPointCloud::reserveThePointsTable(unsigned newNumberOfPoints)
+bool ccPointCloud::reserveThePointsTable(PointIndexType newNumberOfPoints)
 {
 	return m_points->reserve(newNumberOfPoints);
 }
@@ -1255,7 +2284,7 @@ bool ccPointCloud::resizeTheNormsTable()
 	return m_normals && m_normals->currentSize() == m_points->currentSize();
 }
 
-bool ccPointCloud::reserve(unsigned newNumberOfPoints)
+bool ccPointCloud::reserve(PointIndexType newNumberOfPoints)
 {
 	//reserve works only to enlarge the cloud
 	if (newNumberOfPoints < size())
@@ -1278,7 +2307,7 @@ bool ccPointCloud::reserve(unsigned newNumberOfPoints)
 		&&	( !hasNormals() || m_normals->capacity()   >= newNumberOfPoints );
 }
 
-bool ccPointCloud::resize(unsigned newNumberOfPoints)
+bool ccPointCloud::resize(PointIndexType newNumberOfPoints)
 {
 	//can't reduce the size if the cloud if it is locked!
 	if (newNumberOfPoints < size() && isLocked())
@@ -1321,7 +2350,7 @@ bool ccPointCloud::sfColorScaleShown() const
 	return m_sfColorScaleDisplayed;
 }
 
-const ColorCompType* ccPointCloud::getPointScalarValueColor(unsigned pointIndex) const
+const ColorCompType* ccPointCloud::getPointScalarValueColor(PointIndexType pointIndex) const
 {
 	assert(m_currentDisplayedScalarField && m_currentDisplayedScalarField->getColorScale());
 
@@ -1335,7 +2364,7 @@ const ColorCompType* ccPointCloud::geScalarValueColor(ScalarType d) const
 	return m_currentDisplayedScalarField->getColor(d);
 }
 
-ScalarType ccPointCloud::getPointDisplayedDistance(unsigned pointIndex) const
+ScalarType ccPointCloud::getPointDisplayedDistance(PointIndexType pointIndex) const
 {
 	assert(m_currentDisplayedScalarField);
 	assert(pointIndex<m_currentDisplayedScalarField->currentSize());
@@ -1343,7 +2372,7 @@ ScalarType ccPointCloud::getPointDisplayedDistance(unsigned pointIndex) const
 	return m_currentDisplayedScalarField->getValue(pointIndex);
 }
 
-const ColorCompType* ccPointCloud::getPointColor(unsigned pointIndex) const
+const ColorCompType* ccPointCloud::getPointColor(PointIndexType pointIndex) const
 {
 	assert(hasColors());
 	assert(m_rgbColors && pointIndex < m_rgbColors->currentSize());
@@ -1351,14 +2380,14 @@ const ColorCompType* ccPointCloud::getPointColor(unsigned pointIndex) const
 	return m_rgbColors->getValue(pointIndex);
 }
 
-const CompressedNormType& ccPointCloud::getPointNormalIndex(unsigned pointIndex) const
+const CompressedNormType& ccPointCloud::getPointNormalIndex(PointIndexType pointIndex) const
 {
 	assert(m_normals && pointIndex < m_normals->currentSize());
 
 	return m_normals->getValue(pointIndex);
 }
 
-const CCVector3& ccPointCloud::getPointNormal(unsigned pointIndex) const
+const CCVector3& ccPointCloud::getPointNormal(PointIndexType pointIndex) const
 {
 	assert(m_normals && pointIndex < m_normals->currentSize());
 
@@ -1902,7 +2931,7 @@ void ccPointCloud::invertNormals()
 	releaseVBOs();
 }
 
-void ccPointCloud::swapPoints(unsigned firstIndex, unsigned secondIndex)
+void ccPointCloud::swapPoints(PointIndexType firstIndex, PointIndexType secondIndex)
 {
 	assert(!isLocked());
 	assert(firstIndex < size() && secondIndex < size());
@@ -3041,7 +4070,7 @@ ccGenericPointCloud* ccPointCloud::createNewCloudFromVisibilitySelection(bool re
 		}
 		assert(rc->size() != 0);
 
-		//convert selection to cloud
+		//convert selection to cloud (its octree is extracted from this cloud's octree)
 		result = partialClone(rc);
 
 		//don't need this one anymore
@@ -3060,11 +4089,31 @@ ccGenericPointCloud* ccPointCloud::createNewCloudFromVisibilitySelection(bool re
 	//shall the visible points be erased from this cloud?
 	if (removeSelectedPoints && !isLocked())
 	{
-		//we drop the octree before modifying this cloud's contents
-		deleteOctree();
+		//we keep the octree (it will be updated incrementally)
 		clearLOD();
 
-		unsigned count = size();
+		PointIndexType count = size();
+
+		//map between old and new indexes (for the octree update)
+		std::vector<PointIndexType> octreeNewIndexes;
+		if (getOctree())
+		{
+			try
+			{
+				octreeNewIndexes.resize(count, static_cast<PointIndexType>(CCLib::DgmOctree::INVALID_POINT_INDEX));
+				PointIndexType newIndex = 0;
+				for (PointIndexType i=0; i<count; ++i)
+				{
+					if (m_pointsVisibility->getValue(i) != POINT_VISIBLE)
+						octreeNewIndexes[i] = newIndex++;
+				}
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not enough memory: we drop the octree before modifying this cloud's contents
+				deleteOctree();
+			}
+		}
 
 		//we have to take care of scan grids first
 		{
@@ -3111,6 +4160,11 @@ ccGenericPointCloud* ccPointCloud::createNewCloudFromVisibilitySelection(bool re
 		resize(lastPoint);
 		
 		refreshBB(); //calls notifyGeometryUpdate + releaseVBOs
+
+		//the remaining points have kept their order: we can update the octree without rebuilding it
+		ccOctree* octree = getOctree();
+		if (octree && !octree->removePoints(octreeNewIndexes))
+			deleteOctree();
 	}
 
 	return result;
@@ -3500,6 +4554,19 @@ int ccPointCloud::addScalarField(ccScalarField* sf)
 	return static_cast<int>(m_scalarFields.size())-1;
 }
 
+//! Whether the acceleration structures (octree and L.O.D.) should be serialized along with the clouds
+static bool s_saveAccelerationStructures = false;
+
+void ccPointCloud::SetSaveAccelerationStructures(bool state)
+{
+	s_saveAccelerationStructures = state;
+}
+
+bool ccPointCloud::SaveAccelerationStructures()
+{
+	return s_saveAccelerationStructures;
+}
+
 bool ccPointCloud::toFile_MeOnly(QFile& out) const
 {
 	if (!ccGenericPointCloud::toFile_MeOnly(out))
@@ -3605,6 +4672,26 @@ bool ccPointCloud::toFile_MeOnly(QFile& out) const
 		}
 	}
 
+	//acceleration structures (dataVersion>=43)
+	{
+		ccOctree* octree = const_cast<ccPointCloud*>(this)->getOctree();
+		bool saveOctree = (s_saveAccelerationStructures && octree && octree->getNumberOfProjectedPoints() != 0);
+		bool saveLOD = (s_saveAccelerationStructures && m_lod.getState() == LodStruct::INITIALIZED);
+
+		uint8_t structures = 0;
+		if (saveOctree)
+			structures |= 1;
+		if (saveLOD)
+			structures |= 2;
+		if (out.write((const char*)&structures,1) < 0)
+			return WriteError();
+
+		if (saveOctree && !OctreeToFile(*octree,out))
+			return false;
+		if (saveLOD && !m_lod.toFile(out))
+			return false;
+	}
+
 	return true;
 }
 
@@ -3818,6 +4905,36 @@ bool ccPointCloud::fromFile_MeOnly(QFile& in, short dataVersion, int flags)
 		}
 
 	}
+
+	//acceleration structures (dataVersion>=43)
+	if (dataVersion >= 43)
+	{
+		uint8_t structures = 0;
+		if (in.read((char*)&structures,1) < 0)
+			return ReadError();
+
+		//octree
+		if (structures & 1)
+		{
+			ccOctree* octree = 0;
+			if (!OctreeFromFile(this,in,dataVersion,octree))
+				return false;
+			if (octree)
+			{
+				octree->setVisible(true);
+				octree->setEnabled(false);
+				addChild(octree);
+			}
+		}
+
+		//L.O.D.
+		if (structures & 2)
+		{
+			if (!m_lod.fromFile(in,dataVersion,size()))
+				return false;
+		}
+	}
+
 	//notifyGeometryUpdate(); //FIXME: we can't call it now as the dependent 'pointers' are not valid yet!
 
 	//We should update the VBOs (just in case)
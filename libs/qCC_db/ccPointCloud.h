@@ -135,6 +135,32 @@ public:
 	**/
 	ccPointCloud* partialClone(const CCLib::ReferenceCloud* selection, int* warnings = 0) const;
 
+	//! Aggregation of the point features inside each voxel (see voxelGridSubsample)
+	enum VOXEL_AGGREGATION {	VOXEL_MEAN,		/**< mean value **/
+								VOXEL_MEDIAN,	/**< median value **/
+								VOXEL_MIN,		/**< min value **/
+								VOXEL_MAX		/**< max value **/
+	};
+
+	//! Creates a new point cloud by subsampling this one on a regular voxel grid
+	/** One point is created for each non empty voxel. Contrarily to the octree based
+		methods, the voxel size can be anything. The point is placed at the gravity
+		center of the voxel points and gets their mean normal. The colors and the scalar
+		fields are aggregated as requested (invalid scalar values are ignored).
+		The points are sorted by voxel in parallel (by slabs of the grid) and all the
+		features are aggregated in a single parallel pass. The output doesn't depend on
+		the number of threads.
+		\param voxelSize voxel size
+		\param aggregation how colors and scalar values are aggregated
+		\param multiThread whether to use multiple threads or not
+		\param progressCb the client method can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return the subsampled cloud (or 0 if an error occurred)
+	**/
+	ccPointCloud* voxelGridSubsample(	PointCoordinateType voxelSize,
+										VOXEL_AGGREGATION aggregation = VOXEL_MEAN,
+										bool multiThread = true,
+										CCLib::GenericProgressCallback* progressCb = 0);
+
 	//! Clones this entity
 	/** All the main features of the entity are cloned, except from the octree and
 		the points visibility information.
@@ -186,7 +212,7 @@ public:
 		\param _numberOfPoints number of points to reserve the memory for
 		\return true if ok, false if there's not enough memory
 	**/
-	bool reserveThePointsTable(unsigned _numberOfPoints);
+	bool reserveThePointsTable(PointIndexType _numberOfPoints);
 
 	//! Reserves memory to store the RGB colors
 	/** Before adding colors to the cloud (with addRGBColor())
@@ -235,7 +261,7 @@ public:
 		population. Only the already allocated features will be re-reserved.
 		\return true if ok, false if there's not enough memory
 	**/
-	virtual bool reserve(unsigned numberOfPoints);
+	virtual bool reserve(PointIndexType numberOfPoints);
 
 	//! Resizes all the active features arrays
 	/** This method is meant to be called after having increased the cloud
@@ -243,7 +269,7 @@ public:
 		reserved size). Otherwise, it fills all new elements with blank values.
 		\return true if ok, false if there's not enough memory
 	**/
-	virtual bool resize(unsigned numberOfPoints);
+	virtual bool resize(PointIndexType numberOfPoints);
 
 	//! Removes unused capacity
 	inline void shrinkToFit() { if (size() < capacity()) resize(size()); }
@@ -384,12 +410,12 @@ public:
 	virtual unsigned char testVisibility(const CCVector3& P) const;
 
 	//inherited from ccGenericPointCloud
-	virtual const ColorCompType* getPointScalarValueColor(unsigned pointIndex) const;
+	virtual const ColorCompType* getPointScalarValueColor(PointIndexType pointIndex) const;
 	virtual const ColorCompType* geScalarValueColor(ScalarType d) const;
-	virtual ScalarType getPointDisplayedDistance(unsigned pointIndex) const;
-	virtual const ColorCompType* getPointColor(unsigned pointIndex) const;
-	virtual const CompressedNormType& getPointNormalIndex(unsigned pointIndex) const;
-	virtual const CCVector3& getPointNormal(unsigned pointIndex) const;
+	virtual ScalarType getPointDisplayedDistance(PointIndexType pointIndex) const;
+	virtual const ColorCompType* getPointColor(PointIndexType pointIndex) const;
+	virtual const CompressedNormType& getPointNormalIndex(PointIndexType pointIndex) const;
+	virtual const CCVector3& getPointNormal(PointIndexType pointIndex) const;
 	CCLib::ReferenceCloud* crop(const ccBBox& box, bool inside = true);
 	virtual void scale(PointCoordinateType fx, PointCoordinateType fy, PointCoordinateType fz, CCVector3 center = CCVector3(0,0,0));
 	/** \warning if removeSelectedPoints is true, any attached octree will be deleted. **/
@@ -613,6 +639,15 @@ public:
 	**/
 	const ccPointCloud& append(ccPointCloud* cloud, unsigned pointCountBefore, bool ignoreChildren = false);
 
+	//! Sets whether the acceleration structures (octree and L.O.D.) should be serialized along with the clouds
+	/** Saving them makes bigger files, but they won't have to be recomputed at loading time.
+		Disabled by default.
+	**/
+	static void SetSaveAccelerationStructures(bool state);
+
+	//! Returns whether the acceleration structures (octree and L.O.D.) are serialized along with the clouds
+	static bool SaveAccelerationStructures();
+
 protected:
 
 	//inherited from ccHObject
@@ -625,7 +660,7 @@ protected:
 	//inherited from ChunkedPointCloud
 	/** \warning Doesn't handle scan grids!
 	**/
-	virtual void swapPoints(unsigned firstIndex, unsigned secondIndex);
+	virtual void swapPoints(PointIndexType firstIndex, PointIndexType secondIndex);
 
 	//! Colors
 	ColorsTableType* m_rgbColors;
@@ -728,12 +763,12 @@ public: //Level of Detail (LOD)
 		bool init(ccPointCloud& cloud);
 
 		//! Locks the structure
-		inline void lock() { m_mutex.lock(); }
+		inline void lock() const { m_mutex.lock(); }
 		//! Unlocks the structure
-		inline void unlock() { m_mutex.unlock(); }
+		inline void unlock() const { m_mutex.unlock(); }
 
 		//! Returns the current state
-		inline State getState() { lock(); State state = m_state; unlock(); return state; }
+		inline State getState() const { lock(); State state = m_state; unlock(); return state; }
 
 		//! Sets the current state
 		inline void setState(State state) { lock(); m_state = state; unlock(); }
@@ -789,6 +824,19 @@ public: //Level of Detail (LOD)
 		//! Returns a given level descriptor
 		inline LevelDesc level(unsigned char index) { lock(); LevelDesc desc = m_levels[index]; unlock(); return desc; }
 
+		//! Saves the (initialized) structure to a file
+		bool toFile(QFile& out) const;
+
+		//! Loads the structure from a file
+		/** The structure is only considered as initialized if it matches the cloud
+			and its checksum is valid (otherwise it is simply cleared).
+			\param in input file (must be already opened)
+			\param dataVersion version current data version
+			\param pointCount number of points of the associated cloud
+			\return false in case of a reading error
+		**/
+		bool fromFile(QFile& in, short dataVersion, unsigned pointCount);
+
 	protected:
 
 		//! L.O.D. indexes
@@ -803,7 +851,7 @@ public: //Level of Detail (LOD)
 		LodStructThread* m_thread;
 
 		//! For concurrent access
-		QMutex m_mutex;
+		mutable QMutex m_mutex;
 
 		//! State
 		State m_state;
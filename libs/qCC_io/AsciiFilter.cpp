@@ -16,6 +16,7 @@
 //##########################################################################
 
 #include "AsciiFilter.h"
+#include "ccStreamSubsampler.h"
 
 //Qt
 #include <QFile>
@@ -656,6 +657,27 @@ cloudAttributesDescriptor prepareCloud(	const AsciiOpenDlg::Sequence &openSequen
 	return cloudDesc;
 }
 
+//! Counts the number of data lines of an ASCII file (i.e. without comments and empty lines)
+static unsigned CountDataLines(const QString& filename, unsigned skipLines)
+{
+	QFile file(filename);
+	if (!file.open(QFile::ReadOnly))
+		return 0;
+
+	unsigned lineCount = 0;
+	unsigned linesRead = 0;
+	while (!file.atEnd())
+	{
+		QByteArray line = file.readLine().trimmed();
+		if (++linesRead <= skipLines)
+			continue;
+		if (!line.isEmpty() && !line.startsWith("//"))
+			++lineCount;
+	}
+
+	return lineCount;
+}
+
 CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filename,
 															ccHObject& container,
 															const AsciiOpenDlg::Sequence& openSequence,
@@ -666,9 +688,17 @@ CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filena
 															unsigned skipLines,
 															LoadParameters& parameters)
 {
+	//subsampling on load
+	if (parameters.subsamplingMode == RANDOM_SUBSAMPLING)
+	{
+		//random subsampling requires the exact number of points
+		approximateNumberOfLines = CountDataLines(filename,skipLines);
+	}
+	ccStreamSubsampler subsampler(parameters,approximateNumberOfLines);
+
 	//we may have to "slice" clouds when opening them if they are too big!
 	maxCloudSize = std::min(maxCloudSize,CC_MAX_NUMBER_OF_POINTS_PER_CLOUD);
-	unsigned cloudChunkSize = std::min(maxCloudSize,approximateNumberOfLines);
+	unsigned cloudChunkSize = std::min(maxCloudSize,subsampler.initialCapacity());
 	unsigned cloudChunkPos = 0;
 	unsigned chunkRank = 1;
 
@@ -739,11 +769,12 @@ CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filena
 		}
 
 		//if we have reached the max. number of points per cloud
-		if (pointsRead == nextLimit)
+		if (pointsRead == nextLimit && subsampler.canKeepMore())
 		{
 			ccLog::PrintDebug("[ASCII] Point %i -> end of chunk (%i points)",pointsRead,cloudChunkSize);
 
 			//we re-evaluate the average line size
+			if (!subsampler.enabled())
 			{
 				double averageLineSize = static_cast<double>(file.pos())/(pointsRead+skipLines);
 				double newNbOfLinesApproximation = std::max(1.0, static_cast<double>(fileSize)/averageLineSize - static_cast<double>(skipLines));
@@ -758,11 +789,15 @@ CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filena
 			}
 
 			//we try to resize actual clouds
-			if (cloudChunkSize < maxCloudSize || approximateNumberOfLines-cloudChunkPos <= maxCloudSize)
+			//(the output size is unknown when subsampling: we simply enlarge the clouds while we can)
+			if (cloudChunkSize < maxCloudSize || (!subsampler.enabled() && approximateNumberOfLines-cloudChunkPos <= maxCloudSize))
 			{
 				ccLog::PrintDebug("[ASCII] We choose to enlarge existing clouds");
 
-				cloudChunkSize = std::min(maxCloudSize,approximateNumberOfLines-cloudChunkPos);
+				if (subsampler.enabled())
+					cloudChunkSize = ccStreamSubsampler::NextCapacity(cloudChunkSize,maxCloudSize);
+				else
+					cloudChunkSize = std::min(maxCloudSize,approximateNumberOfLines-cloudChunkPos);
 				if (!cloudDesc.cloud->reserve(cloudChunkSize))
 				{
 					ccLog::Error("Not enough memory! Process stopped ...");
@@ -790,7 +825,10 @@ CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filena
 
 				//and create new one
 				cloudChunkPos = pointsRead;
-				cloudChunkSize = std::min(maxCloudSize,approximateNumberOfLines-cloudChunkPos);
+				if (subsampler.enabled())
+					cloudChunkSize = std::min(maxCloudSize,subsampler.initialCapacity());
+				else
+					cloudChunkSize = std::min(maxCloudSize,approximateNumberOfLines-cloudChunkPos);
 				cloudDesc = prepareCloud(openSequence, cloudChunkSize, maxPartIndex, separator, ++chunkRank);
 				if (!cloudDesc.cloud)
 				{
@@ -821,6 +859,19 @@ CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filena
 			if (cloudDesc.zCoordIndex >= 0)
 				P.z = parts[cloudDesc.zCoordIndex].toDouble();
 
+			//subsampling on load
+			if (subsampler.enabled() && !subsampler.keep(P))
+			{
+				if (!nprogress.oneStep())
+				{
+					//cancel requested
+					result = CC_FERR_CANCELED_BY_USER;
+					break;
+				}
+				currentLine = stream.readLine();
+				continue;
+			}
+
 			//first point: check for 'big' coordinates
 			if (pointsRead == 0)
 			{
@@ -921,6 +972,15 @@ CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filena
 
 	file.close();
 
+	if (subsampler.enabled())
+	{
+		ccLog::Print(QString("[ASCII] Subsampling on load: %1 points kept out of %2").arg(subsampler.keptCount()).arg(subsampler.readCount()));
+
+		//the last cloud may be empty (if no point was kept after the previous one was full)
+		if (cloudDesc.cloud && cloudDesc.cloud->size() == 0 && container.getChildrenNumber() != 0)
+			clearStructure(cloudDesc);
+	}
+
 	if (cloudDesc.cloud)
 	{
 		if (cloudDesc.cloud->size() < cloudDesc.cloud->capacity())
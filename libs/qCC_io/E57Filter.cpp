@@ -21,6 +21,7 @@
 
 //Local
 #include "E57Header.h"
+#include "ccStreamSubsampler.h"
 
 //libE57
 #include <e57/E57Foundation.h>
@@ -1403,7 +1404,10 @@ ccHObject* LoadScan(e57::Node& node, QString& guidStr, bool showProgressBar/*=tr
 	TempArrays arrays;
 	std::vector<e57::SourceDestBuffer> dbufs;
 
-	if (!cloud->reserve(static_cast<unsigned>(pointCount)))
+	//subsampling on load
+	ccStreamSubsampler subsampler(s_loadParameters,static_cast<unsigned>(pointCount));
+
+	if (!cloud->reserve(subsampler.initialCapacity()))
 	{
 		ccLog::Error("[E57] Not enough memory!");
 		delete cloud;
@@ -1502,7 +1506,7 @@ ccHObject* LoadScan(e57::Node& node, QString& guidStr, bool showProgressBar/*=tr
 	if (header.pointFields.intensityField)
 	{
 		intensitySF = new ccScalarField(CC_E57_INTENSITY_FIELD_NAME);
-		if (!intensitySF->resize(static_cast<unsigned>(pointCount)))
+		if (!intensitySF->resize(subsampler.initialCapacity()))
 		{
 			ccLog::Error("[E57] Not enough memory!");
 			intensitySF->release();
@@ -1577,7 +1581,7 @@ ccHObject* LoadScan(e57::Node& node, QString& guidStr, bool showProgressBar/*=tr
 	{
 		//we store the point return index as a scalar field
 		returnIndexSF = new ccScalarField(CC_E57_RETURN_INDEX_FIELD_NAME);
-		if (!returnIndexSF->resize(static_cast<unsigned>(pointCount)))
+		if (!returnIndexSF->resize(subsampler.initialCapacity()))
 		{
 			ccLog::Error("[E57] Not enough memory!");
 			delete cloud;
@@ -1650,7 +1654,7 @@ ccHObject* LoadScan(e57::Node& node, QString& guidStr, bool showProgressBar/*=tr
 			}
 
 			//first point: check for 'big' coordinates
-			if (realCount == 0)
+			if (subsampler.readCount() == 0)
 			{
 				if (FileIOFilter::HandleGlobalShift(Pd,Pshift,s_loadParameters))
 				{
@@ -1659,6 +1663,19 @@ ccHObject* LoadScan(e57::Node& node, QString& guidStr, bool showProgressBar/*=tr
 				}
 			}
 
+			//subsampling on load
+			if (!subsampler.keep(Pd))
+				continue;
+			if (!ccStreamSubsampler::ReserveForNewPoint(cloud))
+			{
+				ccLog::Error("[E57] Not enough memory!");
+				dataReader.close();
+				if (nprogress)
+					delete nprogress;
+				delete cloud;
+				return 0;
+			}
+
 			CCVector3 P = CCVector3::fromArray((Pd + Pshift).u);
 			cloud->addPoint(P);
 
@@ -1749,6 +1766,11 @@ ccHObject* LoadScan(e57::Node& node, QString& guidStr, bool showProgressBar/*=tr
 		delete cloud;
 		return 0;
 	}
+	else if (subsampler.enabled())
+	{
+		ccLog::Print(QString("[E57] Subsampling on load: %1 points kept out of %2 for scan '%3'").arg(realCount).arg(subsampler.readCount()).arg(scanNode.elementName().c_str()));
+		cloud->resize(static_cast<unsigned>(realCount));
+	}
 	else if (realCount < pointCount)
 	{
 		ccLog::Warning(QString("[E57] We read less points than expected for scan '%1'! (%2/%3)").arg(scanNode.elementName().c_str()).arg(realCount).arg(pointCount));
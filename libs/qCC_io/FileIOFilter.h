@@ -63,6 +63,14 @@ public: //initialization
 	//! Destructor
 	virtual ~FileIOFilter() {}
 
+	//! Subsampling on load modes
+	/** See LoadParameters::subsamplingMode.
+	**/
+	enum SubsamplingMode {	NO_SUBSAMPLING,			/**< all points are loaded **/
+							RANDOM_SUBSAMPLING,		/**< at most LoadParameters::subsamplingPointCount points (randomly picked) per cloud **/
+							SPATIAL_SUBSAMPLING,	/**< only the first point of each cell of a regular grid (LoadParameters::subsamplingStep) **/
+	};
+
 	//! Generic loading parameters
 	struct LoadParameters
 	{
@@ -73,6 +81,9 @@ public: //initialization
 			, coordinatesShiftEnabled(0)
 			, coordinatesShift(0)
 			, autoComputeNormals(false)
+			, subsamplingMode(NO_SUBSAMPLING)
+			, subsamplingPointCount(0)
+			, subsamplingStep(0)
 		{}
 
 		//! How to handle big coordinates
@@ -85,6 +96,14 @@ public: //initialization
 		CCVector3d* coordinatesShift;
 		//! Whether normals should be computed at loading time (if possible - e.g. for gridded clouds) or not
 		bool autoComputeNormals;
+		//! Whether clouds should be subsampled while being read (so that the full clouds never sit in memory)
+		/** Only supported by some filters (ASCII, LAS, PLY and E57 clouds - see ccStreamSubsampler).
+		**/
+		SubsamplingMode subsamplingMode;
+		//! Max number of points per cloud (RANDOM_SUBSAMPLING)
+		unsigned subsamplingPointCount;
+		//! Grid step (SPATIAL_SUBSAMPLING)
+		double subsamplingStep;
 	};
 
 	//! Generic saving parameters
@@ -21,6 +21,7 @@
 
 //Local
 #include "LASOpenDlg.h"
+#include "ccStreamSubsampler.h"
 
 //qCC_db
 #include <ccLog.h>
@@ -694,6 +695,9 @@ CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadPa
 		unsigned int fileChunkPos = 0;
 		unsigned int fileChunkSize = 0;
 
+		//subsampling on load
+		ccStreamSubsampler subsampler(parameters,nbOfPoints);
+
 		while (true)
 		{
 			//if we reach the end of the file, or the max. cloud size limit (in which case we cerate a new chunk)
@@ -708,7 +712,15 @@ CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadPa
 				break;
 			}
 
-			if (!newPointAvailable || pointsRead == fileChunkPos+fileChunkSize)
+			//do we need a new cloud?
+			//(when subsampling, we only know the number of kept points)
+			bool newChunk = false;
+			if (subsampler.enabled())
+				newChunk = (!loadedCloud || (loadedCloud->size() == CC_MAX_NUMBER_OF_POINTS_PER_CLOUD && subsampler.canKeepMore()));
+			else
+				newChunk = (pointsRead == fileChunkPos+fileChunkSize);
+
+			if (!newPointAvailable || newChunk)
 			{
 				if (loadedCloud)
 				{
@@ -795,7 +807,10 @@ CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadPa
 
 				//otherwise, we must create a new cloud
 				fileChunkPos = pointsRead;
-				fileChunkSize = std::min(nbOfPoints-pointsRead,CC_MAX_NUMBER_OF_POINTS_PER_CLOUD);
+				if (subsampler.enabled())
+					fileChunkSize = std::min(subsampler.initialCapacity(),CC_MAX_NUMBER_OF_POINTS_PER_CLOUD);
+				else
+					fileChunkSize = std::min(nbOfPoints-pointsRead,CC_MAX_NUMBER_OF_POINTS_PER_CLOUD);
 				loadedCloud = new ccPointCloud();
 				if (!loadedCloud->reserveThePointsTable(fileChunkSize))
 				{
@@ -956,6 +971,32 @@ CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadPa
 				parameters.shiftHandlingMode = csModeBackup;
 			}
 
+			//subsampling on load
+			if (subsampler.enabled())
+			{
+				if (!subsampler.keep(CCVector3d(p.GetX(),p.GetY(),p.GetZ())))
+				{
+					++pointsRead;
+					continue;
+				}
+
+				//the cloud (and the scalar fields not yet attached to it) must be able to receive a new point
+				if (loadedCloud->size() == loadedCloud->capacity())
+				{
+					bool success = ccStreamSubsampler::ReserveForNewPoint(loadedCloud);
+					for (std::vector<LasField::Shared>::iterator it = fieldsToLoad.begin(); it != fieldsToLoad.end() && success; ++it)
+						if ((*it)->sf)
+							success = (*it)->sf->reserve(loadedCloud->capacity());
+					if (!success)
+					{
+						ccLog::Warning("[LAS] Not enough memory!");
+						delete loadedCloud;
+						ifs.close();
+						return CC_FERR_NOT_ENOUGH_MEMORY;
+					}
+				}
+			}
+
 			CCVector3 P(static_cast<PointCoordinateType>(p.GetX()+Pshift.x),
 						static_cast<PointCoordinateType>(p.GetY()+Pshift.y),
 						static_cast<PointCoordinateType>(p.GetZ()+Pshift.z));
@@ -1157,7 +1198,7 @@ CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadPa
 					if (!ignoreDefaultFields || value != field->firstValue || (field->firstValue != field->defaultValue && field->firstValue >= field->minValue))
 					{
 						field->sf = new ccScalarField(qPrintable(field->getName()));
-						if (field->sf->reserve(fileChunkSize))
+						if (field->sf->reserve(loadedCloud->capacity()))
 						{
 							field->sf->link();
 
@@ -1192,6 +1233,9 @@ CC_FILE_ERROR LASFilter::loadFile(QString filename, ccHObject& container, LoadPa
 
 			++pointsRead;
 		}
+
+		if (subsampler.enabled())
+			ccLog::Print(QString("[LAS] Subsampling on load: %1 points kept out of %2").arg(subsampler.keptCount()).arg(subsampler.readCount()));
 	}
 	catch (const std::out_of_range& oor)
 	{
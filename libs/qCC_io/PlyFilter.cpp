@@ -19,6 +19,7 @@
 
 //Local
 #include "PlyOpenDlg.h"
+#include "ccStreamSubsampler.h"
 
 //Qt
 #include <QImage>
@@ -38,6 +39,7 @@
 //System
 #include <string.h>
 #include <assert.h>
+#include <algorithm>
 #if defined(CC_WINDOWS)
 #include <Windows.h>
 #else
@@ -461,6 +463,10 @@ static int s_PointCount = 0;
 static bool s_PointDataCorrupted = false;
 static FileIOFilter::LoadParameters s_loadParameters;
 static CCVector3d s_Pshift(0,0,0);
+//! Subsampling on load (the point properties must be read after the point coordinates)
+static ccStreamSubsampler* s_subsampler = 0;
+//! Whether the current point is kept or not (subsampling on load)
+static bool s_keepVertex = true;
 
 static int vertex_cb(p_ply_argument argument)
 {
@@ -486,8 +492,10 @@ static int vertex_cb(p_ply_argument argument)
 
 	if (flags & ELEM_EOL)
 	{
+		unsigned pointsRead = (s_subsampler ? s_subsampler->readCount() : static_cast<unsigned>(s_PointCount));
+
 		//first point: check for 'big' coordinates
-		if (s_PointCount == 0)
+		if (pointsRead == 0)
 		{
 			if (FileIOFilter::HandleGlobalShift(s_Point,s_Pshift,s_loadParameters))
 			{
@@ -496,11 +504,25 @@ static int vertex_cb(p_ply_argument argument)
 			}
 		}
 
-		cloud->addPoint(CCVector3::fromArray((s_Point + s_Pshift).u));
-		++s_PointCount;
+		//subsampling on load
+		if (s_subsampler)
+		{
+			s_keepVertex = s_subsampler->keep(s_Point);
+			if (s_keepVertex && !ccStreamSubsampler::ReserveForNewPoint(cloud))
+			{
+				ccLog::Warning("[PLY] Not enough memory!");
+				return 0;
+			}
+		}
+
+		if (s_keepVertex)
+		{
+			cloud->addPoint(CCVector3::fromArray((s_Point + s_Pshift).u));
+			++s_PointCount;
+		}
 
 		s_PointDataCorrupted = false;
-		if ((s_PointCount % PROCESS_EVENTS_FREQ) == 0)
+		if ((++pointsRead % PROCESS_EVENTS_FREQ) == 0)
 			QCoreApplication::processEvents();
 	}
 
@@ -518,7 +540,7 @@ static int normal_cb(p_ply_argument argument)
 
 	s_Normal.u[flags & POS_MASK] = static_cast<PointCoordinateType>( ply_get_argument_value(argument) );
 
-	if (flags & ELEM_EOL)
+	if ((flags & ELEM_EOL) && s_keepVertex)
 	{
 		cloud->addNorm(s_Normal);
 		++s_NormalCount;
@@ -563,7 +585,7 @@ static int rgb_cb(p_ply_argument argument)
 		break;
 	}
 
-	if (flags & ELEM_EOL)
+	if ((flags & ELEM_EOL) && s_keepVertex)
 	{
 		cloud->addRGBColor(s_color);
 		++s_ColorCount;
@@ -578,6 +600,9 @@ static int rgb_cb(p_ply_argument argument)
 static int s_IntensityCount = 0;
 static int grey_cb(p_ply_argument argument)
 {
+	if (!s_keepVertex)
+		return 1;
+
 	ccPointCloud* cloud;
 	ply_get_argument_user_data(argument, (void**)(&cloud), NULL);
 
@@ -619,12 +644,20 @@ static int grey_cb(p_ply_argument argument)
 static unsigned s_totalScalarCount = 0;
 static int scalar_cb(p_ply_argument argument)
 {
+	if (!s_keepVertex)
+		return 1;
+
 	CCLib::ScalarField* sf = 0;
 	ply_get_argument_user_data(argument, (void**)(&sf), NULL);
 
 	p_ply_element element;
 	long instance_index;
 	ply_get_argument_element(argument, &element, &instance_index);
+	if (s_subsampler)
+	{
+		//the point has already been added
+		instance_index = s_PointCount-1;
+	}
 
 	ScalarType scal = static_cast<ScalarType>(ply_get_argument_value(argument));
 	sf->setValue(instance_index,scal);
@@ -749,6 +782,8 @@ CC_FILE_ERROR PlyFilter::loadFile(QString filename, ccHObject& container, LoadPa
 	s_PointDataCorrupted = false;
 	s_loadParameters = parameters;
 	s_Pshift = CCVector3d(0,0,0);
+	s_subsampler = 0;
+	s_keepVertex = true;
 
 	/****************/
 	/***  Header  ***/
@@ -1235,7 +1270,34 @@ CC_FILE_ERROR PlyFilter::loadFile(QString filename, ccHObject& container, LoadPa
 		else numberOfPoints = pointElements[pp.elemIndex].elementInstances;
 	}
 
-	if (numberOfPoints == 0 || !cloud->reserveThePointsTable(numberOfPoints))
+	//subsampling on load
+	FileIOFilter::LoadParameters subsamplingParameters = s_loadParameters;
+	if (subsamplingParameters.subsamplingMode != NO_SUBSAMPLING)
+	{
+		//only for clouds, and only if the point coordinates are read before their other properties
+		bool canSubsample = (facesIndex == 0);
+		int lastCoordIndex = std::max(xIndex,std::max(yIndex,zIndex));
+		std::vector<int> otherIndexes(sfPropIndexes);
+		for (unsigned i=3; i<10; ++i) //normals, colors and intensity
+			otherIndexes.push_back(stdPropIndexes[i]);
+		for (size_t i=0; i<otherIndexes.size() && canSubsample; ++i)
+		{
+			int index = otherIndexes[i];
+			if (index > 0 && (index < lastCoordIndex || stdProperties[index-1].elemIndex != stdProperties[lastCoordIndex-1].elemIndex))
+				canSubsample = false;
+		}
+
+		if (!canSubsample)
+		{
+			ccLog::Warning("[PLY] Subsampling on load is not supported for this file (mesh, or point coordinates not stored first)");
+			subsamplingParameters.subsamplingMode = NO_SUBSAMPLING;
+		}
+	}
+	ccStreamSubsampler subsampler(subsamplingParameters,numberOfPoints);
+	if (subsampler.enabled())
+		s_subsampler = &subsampler;
+
+	if (numberOfPoints == 0 || !cloud->reserveThePointsTable(subsampler.initialCapacity()))
 	{
 		delete cloud;
 		ply_close(ply);
@@ -1420,7 +1482,7 @@ CC_FILE_ERROR PlyFilter::loadFile(QString filename, ccHObject& container, LoadPa
 				{
 					CCLib::ScalarField* sf = cloud->getScalarField(sfIdx);
 					assert(sf);
-					if (sf->reserve(numberOfScalars))
+					if (sf->reserve(subsampler.initialCapacity()))
 					{
 						ply_set_read_cb(ply, pointElements[pp.elemIndex].elementName, pp.propName, scalar_cb, sf, 1);
 					}
@@ -1539,6 +1601,15 @@ CC_FILE_ERROR PlyFilter::loadFile(QString filename, ccHObject& container, LoadPa
 
 	ply_close(ply);
 
+	if (s_subsampler)
+	{
+		ccLog::Print(QString("[PLY] Subsampling on load: %1 points kept out of %2").arg(s_subsampler->keptCount()).arg(s_subsampler->readCount()));
+		s_subsampler = 0;
+		//we release the unused memory
+		if (success >= 1)
+			cloud->resize(cloud->size());
+	}
+
 	if (success < 1)
 	{
 		if (mesh)
@@ -0,0 +1,225 @@
+//##########################################################################
+//#                                                                        #
+//#                            CLOUDCOMPARE                                #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+//Local
+#include "ccStreamSubsampler.h"
+
+//qCC_db
+#include <ccPointCloud.h>
+#include <ccLog.h>
+
+//System
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <algorithm>
+
+//! Empty slot of the hash table
+static const int EMPTY_CELL = INT_MIN;
+
+//! Initial size of the hash table (must be a power of 2)
+static const size_t INITIAL_TABLE_SIZE = (1 << 16);
+
+//! Min capacity of the output clouds
+static const unsigned MIN_OUTPUT_CAPACITY = (1 << 16);
+
+ccStreamSubsampler::ccStreamSubsampler(const FileIOFilter::LoadParameters& parameters, unsigned inputCount)
+	: m_mode(parameters.subsamplingMode)
+	, m_count(parameters.subsamplingPointCount)
+	, m_inputCount(inputCount)
+	, m_readCount(0)
+	, m_keptCount(0)
+	, m_randomState(0)
+	, m_step(parameters.subsamplingStep)
+	, m_origin(0,0,0)
+	, m_cellCount(0)
+{
+	if (m_mode == FileIOFilter::SPATIAL_SUBSAMPLING && !(m_step > 0))
+	{
+		ccLog::Warning("[Subsampling on load] Invalid grid step: subsampling is disabled");
+		m_mode = FileIOFilter::NO_SUBSAMPLING;
+	}
+}
+
+double ccStreamSubsampler::randomValue()
+{
+	//SplitMix64 (fast and deterministic)
+	m_randomState += 0x9E3779B97F4A7C15ull;
+	unsigned long long z = m_randomState;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	z ^= (z >> 31);
+
+	return static_cast<double>(z >> 11) / static_cast<double>(1ull << 53);
+}
+
+static inline size_t CellHash(int i, int j, int k)
+{
+	unsigned long long h =	static_cast<unsigned long long>(static_cast<unsigned>(i)) * 73856093ull
+						^	static_cast<unsigned long long>(static_cast<unsigned>(j)) * 19349663ull
+						^	static_cast<unsigned long long>(static_cast<unsigned>(k)) * 83492791ull;
+	//Fibonacci hashing
+	return static_cast<size_t>((h * 11400714819323198485ull) >> 32);
+}
+
+bool ccStreamSubsampler::growTable()
+{
+	std::vector<Cell> oldCells;
+	try
+	{
+		Cell emptyCell;
+		emptyCell.i = emptyCell.j = emptyCell.k = EMPTY_CELL;
+		oldCells.resize(m_cells.empty() ? INITIAL_TABLE_SIZE : 2*m_cells.size(), emptyCell);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+	m_cells.swap(oldCells);
+
+	//re-insert the previous cells
+	size_t mask = m_cells.size() - 1;
+	for (size_t n=0; n<oldCells.size(); ++n)
+	{
+		const Cell& cell = oldCells[n];
+		if (cell.i == EMPTY_CELL)
+			continue;
+		size_t slot = CellHash(cell.i,cell.j,cell.k) & mask;
+		while (m_cells[slot].i != EMPTY_CELL)
+			slot = ((slot + 1) & mask);
+		m_cells[slot] = cell;
+	}
+
+	return true;
+}
+
+bool ccStreamSubsampler::insertCell(int i, int j, int k)
+{
+	//the table is kept at most half full
+	if (2*(m_cellCount+1) > m_cells.size() && !growTable())
+	{
+		//not enough memory: we can't track the cells anymore, so we keep all the points
+		ccLog::Warning("[Subsampling on load] Not enough memory: subsampling is disabled");
+		m_mode = FileIOFilter::NO_SUBSAMPLING;
+		return true;
+	}
+
+	size_t mask = m_cells.size() - 1;
+	size_t slot = CellHash(i,j,k) & mask;
+	while (m_cells[slot].i != EMPTY_CELL)
+	{
+		const Cell& cell = m_cells[slot];
+		if (cell.i == i && cell.j == j && cell.k == k)
+			return false; //already there
+		slot = ((slot + 1) & mask);
+	}
+
+	Cell& cell = m_cells[slot];
+	cell.i = i;
+	cell.j = j;
+	cell.k = k;
+	++m_cellCount;
+
+	return true;
+}
+
+static inline int CellPos(double relativePos)
+{
+	//we keep the positions in ]INT_MIN,INT_MAX] (INT_MIN is reserved for empty cells)
+	double pos = floor(relativePos);
+	if (pos <= static_cast<double>(INT_MIN))
+		return INT_MIN + 1;
+	if (pos >= static_cast<double>(INT_MAX))
+		return INT_MAX;
+	return static_cast<int>(pos);
+}
+
+bool ccStreamSubsampler::keep(const CCVector3d& P)
+{
+	bool keepPoint = true;
+
+	switch (m_mode)
+	{
+	case FileIOFilter::RANDOM_SUBSAMPLING:
+		{
+			if (m_keptCount >= m_count)
+			{
+				keepPoint = false;
+			}
+			else if (m_readCount < m_inputCount)
+			{
+				//we keep the point with probability (number of points still to pick) / (number of points left)
+				double remaining = static_cast<double>(m_inputCount - m_readCount);
+				double needed = static_cast<double>(m_count - m_keptCount);
+				keepPoint = (remaining * randomValue() < needed);
+			}
+			//else: the file has more points than expected! We keep them while we can.
+		}
+		break;
+
+	case FileIOFilter::SPATIAL_SUBSAMPLING:
+		{
+			//the grid is centered on the first point (so as to avoid overflows)
+			if (m_readCount == 0)
+				m_origin = P;
+
+			CCVector3d Q = (P - m_origin) / m_step;
+			keepPoint = insertCell(CellPos(Q.x),CellPos(Q.y),CellPos(Q.z));
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	++m_readCount;
+	if (keepPoint)
+		++m_keptCount;
+
+	return keepPoint;
+}
+
+unsigned ccStreamSubsampler::initialCapacity() const
+{
+	switch (m_mode)
+	{
+	case FileIOFilter::RANDOM_SUBSAMPLING:
+		return m_inputCount != 0 ? std::min(m_count,m_inputCount) : m_count;
+	case FileIOFilter::SPATIAL_SUBSAMPLING:
+		return m_inputCount != 0 ? std::min(MIN_OUTPUT_CAPACITY,m_inputCount) : MIN_OUTPUT_CAPACITY;
+	default:
+		break;
+	}
+
+	return m_inputCount;
+}
+
+unsigned ccStreamSubsampler::NextCapacity(unsigned currentCapacity, unsigned maxCapacity)
+{
+	unsigned long long newCapacity = std::max<unsigned long long>(2ull * currentCapacity, MIN_OUTPUT_CAPACITY);
+	return static_cast<unsigned>(std::min<unsigned long long>(newCapacity, maxCapacity));
+}
+
+bool ccStreamSubsampler::ReserveForNewPoint(ccPointCloud* cloud)
+{
+	assert(cloud);
+	if (cloud->size() < cloud->capacity())
+		return true;
+
+	unsigned newCapacity = NextCapacity(cloud->capacity(),CC_MAX_NUMBER_OF_POINTS_PER_CLOUD);
+	return newCapacity > cloud->size() && cloud->reserve(newCapacity);
+}
@@ -0,0 +1,128 @@
+//##########################################################################
+//#                                                                        #
+//#                            CLOUDCOMPARE                                #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_STREAM_SUBSAMPLER_HEADER
+#define CC_STREAM_SUBSAMPLER_HEADER
+
+//Local
+#include "qCC_io.h"
+#include "FileIOFilter.h"
+
+//CCLib
+#include <CCGeom.h>
+
+//system
+#include <vector>
+
+class ccPointCloud;
+
+//! Streaming subsampler (to subsample clouds while they are being read)
+/** The points are submitted one after the other (in the file order) and the
+	subsampler decides on the fly whether each one should be kept or not.
+	Therefore the memory consumption only depends on the output size:
+	- RANDOM_SUBSAMPLING: selection sampling (Knuth's 'algorithm S'). Exactly
+	min(count,inputCount) points are kept, uniformly picked among the input ones.
+	The input count must be known beforehand.
+	- SPATIAL_SUBSAMPLING: only the first point read in each cell of a regular
+	grid (with 'step' as cell size) is kept. The non empty cells are stored in a
+	hash table.
+**/
+class QCC_IO_LIB_API ccStreamSubsampler
+{
+public:
+
+	//! Default constructor
+	/** \param parameters loading parameters (subsampling mode and parameter)
+		\param inputCount number of points in the file (mandatory for RANDOM_SUBSAMPLING)
+	**/
+	ccStreamSubsampler(const FileIOFilter::LoadParameters& parameters, unsigned inputCount);
+
+	//! Returns whether subsampling is enabled or not
+	inline bool enabled() const { return m_mode != FileIOFilter::NO_SUBSAMPLING; }
+
+	//! Returns whether the next input point should be kept or not
+	/** \param P point coordinates (before any shift)
+	**/
+	bool keep(const CCVector3d& P);
+
+	//! Returns whether more points may still be kept or not
+	inline bool canKeepMore() const { return m_mode != FileIOFilter::RANDOM_SUBSAMPLING || m_keptCount < m_count; }
+
+	//! Returns the number of submitted points
+	inline unsigned readCount() const { return m_readCount; }
+	//! Returns the number of kept points
+	inline unsigned keptCount() const { return m_keptCount; }
+
+	//! Returns the capacity that should be initially reserved for the output cloud
+	unsigned initialCapacity() const;
+
+	//! Returns the next capacity of an output cloud that is full
+	/** \param currentCapacity current capacity
+		\param maxCapacity max capacity
+	**/
+	static unsigned NextCapacity(unsigned currentCapacity, unsigned maxCapacity);
+
+	//! Makes sure an output cloud can receive a new point
+	/** The cloud (and all its features) capacity is enlarged if necessary.
+		\return false if not enough memory
+	**/
+	static bool ReserveForNewPoint(ccPointCloud* cloud);
+
+protected:
+
+	//! Random number in [0,1[
+	double randomValue();
+
+	//! Inserts a cell in the hash table
+	/** \return false if the cell was already there
+	**/
+	bool insertCell(int i, int j, int k);
+
+	//! Doubles the size of the hash table
+	bool growTable();
+
+	//! Subsampling mode
+	FileIOFilter::SubsamplingMode m_mode;
+	//! Number of points to keep (RANDOM_SUBSAMPLING)
+	unsigned m_count;
+	//! Number of input points (RANDOM_SUBSAMPLING)
+	unsigned m_inputCount;
+	//! Number of submitted points
+	unsigned m_readCount;
+	//! Number of kept points
+	unsigned m_keptCount;
+	//! Random generator state (RANDOM_SUBSAMPLING)
+	unsigned long long m_randomState;
+
+	//! Grid step (SPATIAL_SUBSAMPLING)
+	double m_step;
+	//! Grid origin (first point)
+	CCVector3d m_origin;
+
+	//! Cell of the hash table
+	struct Cell
+	{
+		int i, j, k;
+	};
+
+	//! Hash table (SPATIAL_SUBSAMPLING)
+	std::vector<Cell> m_cells;
+	//! Number of non empty cells
+	size_t m_cellCount;
+};
+
+#endif //CC_STREAM_SUBSAMPLER_HEADER
@@ -6,6 +6,12 @@
 #include <NormalDistribution.h>
 #include <StatisticalTestingTools.h>
 #include <Neighbourhood.h>
+#include <DistanceComputationTools.h>
+#include <GenericPointStream.h>
+#include <GeometricalAnalysisTools.h>
+#include <MeshDistanceGrid.h>
+#include <CCMiscTools.h>
+#include <DgmOctree.h>
 
 //qCC_db
 #include <ccProgressDialog.h>
@@ -41,22 +47,28 @@
 #include <QElapsedTimer>
 #include <QStringList>
 #include <QTextStream>
+#include <QThread>
+#include <QtConcurrentRun>
 
 //system
 #include <set>
+#include <algorithm>
+#include <stdlib.h>
 
 static const char COMMAND_SILENT_MODE[]						= "SILENT";
 static const char COMMAND_OPEN[]							= "O";				//+file name
 static const char COMMAND_OPEN_SKIP_LINES[]					= "SKIP";			//+number of lines to skip
 static const char COMMAND_OPEN_SHIFT_ON_LOAD[]				= "GLOBAL_SHIFT";	//+global shift
+static const char COMMAND_OPEN_SUBSAMPLE[]					= "SS_ON_LOAD";		//+ method (RANDOM/SPATIAL) + parameter (resp. point count / spatial step)
 static const char COMMAND_KEYWORD_AUTO[]					= "AUTO";			//"AUTO" keyword
-static const char COMMAND_SUBSAMPLE[]						= "SS";				//+ method (RANDOM/SPATIAL/OCTREE) + parameter (resp. point count / spatial step / octree level)
+static const char COMMAND_SUBSAMPLE[]						= "SS";				//+ method (RANDOM/SPATIAL/OCTREE/VOXEL) + parameter (resp. point count / spatial step / octree level / voxel size [+ MEAN/MEDIAN/MIN/MAX])
 static const char COMMAND_CURVATURE[]						= "CURV";			//+ curvature type (MEAN/GAUSS) +
 static const char COMMAND_DENSITY[]							= "DENSITY";		//+ sphere radius
 static const char COMMAND_DENSITY_TYPE[]					= "TYPE";			//+ density type
 static const char COMMAND_APPROX_DENSITY[]					= "APPROX_DENSITY";
 static const char COMMAND_SF_GRADIENT[]						= "SF_GRAD";
 static const char COMMAND_ROUGHNESS[]						= "ROUGH";
+static const char COMMAND_MULTI_SCALE_FEATURES[]				= "MS_FEATURES";	//+ radii (comma separated) + features (comma separated: DENSITY/ROUGH/MEAN_CURV/GAUSS_CURV/NORMAL_CHANGE_RATE/EIGEN1/EIGEN2/EIGEN3 or ALL)
 static const char COMMAND_BUNDLER[]							= "BUNDLER_IMPORT"; //Import Bundler file + orthorectification
 static const char COMMAND_BUNDLER_ALT_KEYPOINTS[]			= "ALT_KEYPOINTS";
 static const char COMMAND_BUNDLER_SCALE_FACTOR[]			= "SCALE_FACTOR";
@@ -64,9 +76,16 @@ static const char COMMAND_BUNDLER_UNDISTORT[]				= "UNDISTORT";
 static const char COMMAND_BUNDLER_COLOR_DTM[]				= "COLOR_DTM";
 static const char COMMAND_C2M_DIST[]						= "C2M_DIST";
 static const char COMMAND_C2M_DIST_FLIP_NORMALS[]			= "FLIP_NORMS";
+static const char COMMAND_C2M_DIST_GRID[]					= "DIST_GRID";		//+ cache file + cell size + band width + exact band width
 static const char COMMAND_C2C_DIST[]						= "C2C_DIST";
 static const char COMMAND_C2C_SPLIT_XYZ[]					= "SPLIT_XYZ";
 static const char COMMAND_C2C_LOCAL_MODEL[]					= "MODEL";
+static const char COMMAND_C2C_LOCAL_MODEL_GRID[]			= "MODEL_GRID";		//local models precomputed on a grid
+static const char COMMAND_C2C_TILE_MEMORY[]					= "TILE_MEMORY";	//+ max memory per tile (in MB)
+static const char COMMAND_C2C_OUT_OF_CORE[]					= "OUT_OF_CORE";	//+ compared, reference and output ASCII files (never loaded in memory)
+static const char COMMAND_C2C_BATCH[]						= "C2C_BATCH";		//+ epoch files (compared to the first loaded cloud)
+static const char COMMAND_C2C_BATCH_STATS_FILE[]			= "STATS_FILE";		//+ output (CSV) file
+static const char COMMAND_C2C_BATCH_WORKERS[]				= "WORKERS";		//+ max number of epochs processed concurrently
 static const char COMMAND_MAX_DISTANCE[]					= "MAX_DIST";
 static const char COMMAND_OCTREE_LEVEL[]					= "OCTREE_LEVEL";
 static const char COMMAND_SAMPLE_MESH[]						= "SAMPLE_MESH";
@@ -102,6 +121,7 @@ static const char COMMAND_FBX_EXPORT_FORMAT[]				= "FBX_EXPORT_FMT";
 static const char COMMAND_MESH_EXPORT_FORMAT[]				= "M_EXPORT_FMT";
 static const char COMMAND_EXPORT_EXTENSION[]				= "EXT";
 static const char COMMAND_NO_TIMESTAMP[]					= "NO_TIMESTAMP";
+static const char COMMAND_BIN_SAVE_STRUCTURES[]			= "BIN_SAVE_STRUCTS";
 static const char COMMAND_CROP[]							= "CROP";
 static const char COMMAND_CROP_2D[]							= "CROP2D";
 static const char COMMAND_COLOR_BANDING[]					= "CBANDING";
@@ -121,6 +141,7 @@ static const char COMMAND_CROSS_SECTION[]					= "CROSS_SECTION";
 static const char COMMAND_LOG_FILE[]						= "LOG_FILE";
 static const char COMMAND_SF_ARITHMETIC[]					= "SF_ARITHMETIC";
 static const char COMMAND_SOR_FILTER[]						= "SOR";
+static const char COMMAND_REMOVE_DUPLICATES[]				= "REMOVE_DUPLICATES";
 
 static const char OPTION_ALL_AT_ONCE[]						= "ALL_AT_ONCE";
 static const char OPTION_ON[]								= "ON";
@@ -143,6 +164,8 @@ static bool s_addTimestamp = true;
 static bool s_silentMode = false;
 //Whether files should be automatically saved (after each process) or not
 static bool s_autoSaveMode = true;
+//Whether the clouds octree and L.O.D. structures should be saved in BIN files or not
+static bool s_saveAccelerationStructures = false;
 
 //Loading parameters
 struct CmdLineLoadParameters : public FileIOFilter::LoadParameters
@@ -184,6 +207,7 @@ int ccCommandLineParser::Parse(int nargs, char** args)
 	s_addTimestamp = true;
 	s_silentMode = false;
 	s_autoSaveMode = true;
+	s_saveAccelerationStructures = false;
 
 	//load arguments
 	QStringList arguments;
@@ -472,6 +496,16 @@ QString ccCommandLineParser::Export(EntityDesc& entDesc, QString suffix/*=QStrin
 		}
 	}
 
+	//acceleration structures (BIN format only)
+	QString exportFormat = isCloud ? s_CloudExportFormat : s_MeshExportFormat;
+	bool saveAccelerationStructures = (s_saveAccelerationStructures && exportFormat == BinFilter::GetFileFilter());
+	if (saveAccelerationStructures && entity->isA(CC_TYPES::POINT_CLOUD))
+	{
+		ccPointCloud* cloud = static_cast<ccPointCloud*>(entity);
+		if (!cloud->getOctree() && !cloud->computeOctree())
+			Warning(QString("Failed to compute the octree of cloud '%1' (not enough memory?)").arg(entName));
+	}
+
 	//save file
 	FileIOFilter::SaveParameters parameters;
 	{
@@ -479,10 +513,12 @@ QString ccCommandLineParser::Export(EntityDesc& entDesc, QString suffix/*=QStrin
 		parameters.alwaysDisplaySaveDialog = false;
 	}
 
+	ccPointCloud::SetSaveAccelerationStructures(saveAccelerationStructures);
 	CC_FILE_ERROR result = FileIOFilter::SaveToFile(entity,
 													qPrintable(outputFilename),
 													parameters,
-													isCloud ? s_CloudExportFormat : s_MeshExportFormat);
+													exportFormat);
+	ccPointCloud::SetSaveAccelerationStructures(false);
 
 	//restore input state!
 	if (tempDependencyCreated)
@@ -568,6 +604,39 @@ bool ccCommandLineParser::commandLoad(QStringList& arguments)
 				s_loadParameters.m_coordinatesShift = shiftOnLoadVec;
 			}
 		}
+		else if (IsCommand(argument,COMMAND_OPEN_SUBSAMPLE))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.size() < 2)
+				return Error(QString("Missing parameter: subsampling method and parameter after '%1'").arg(COMMAND_OPEN_SUBSAMPLE));
+
+			QString method = arguments.takeFirst().toUpper();
+			bool ok = true;
+			if (method == "RANDOM")
+			{
+				unsigned count = arguments.takeFirst().toUInt(&ok);
+				if (!ok || count == 0)
+					return Error(QString("Invalid parameter: number of points after '%1 RANDOM'").arg(COMMAND_OPEN_SUBSAMPLE));
+				s_loadParameters.subsamplingMode = FileIOFilter::RANDOM_SUBSAMPLING;
+				s_loadParameters.subsamplingPointCount = count;
+				Print(QString("Will randomly subsample the cloud(s) to %1 points while loading").arg(count));
+			}
+			else if (method == "SPATIAL")
+			{
+				double step = arguments.takeFirst().toDouble(&ok);
+				if (!ok || step <= 0)
+					return Error(QString("Invalid parameter: spatial step after '%1 SPATIAL'").arg(COMMAND_OPEN_SUBSAMPLE));
+				s_loadParameters.subsamplingMode = FileIOFilter::SPATIAL_SUBSAMPLING;
+				s_loadParameters.subsamplingStep = step;
+				Print(QString("Will spatially subsample the cloud(s) with a step of %1 while loading").arg(step));
+			}
+			else
+			{
+				return Error(QString("Unknown subsampling method '%1' after '%2' (RANDOM or SPATIAL expected)").arg(method).arg(COMMAND_OPEN_SUBSAMPLE));
+			}
+		}
 		else
 		{
 			break;
@@ -586,6 +655,8 @@ bool ccCommandLineParser::commandLoad(QStringList& arguments)
 	Print(QString("Opening file: '%1'").arg(filename));
 
 	ccHObject* db = FileIOFilter::LoadFromFile(filename,s_loadParameters,QString());
+	//subsampling on load only applies to the current file
+	s_loadParameters.subsamplingMode = FileIOFilter::NO_SUBSAMPLING;
 	if (!db)
 		return false/*Error(QString("Failed to open file '%1'").arg(filename))*/;
 
@@ -757,7 +828,7 @@ bool ccCommandLineParser::commandSubsample(QStringList& arguments, ccProgressDia
 			Print(QString("\tProcessing cloud #%1 (%2)").arg(i+1).arg(!cloud->getName().isEmpty() ? cloud->getName() : "no name"));
 
 			CCLib::CloudSamplingTools::SFModulationParams modParams(false);
-			CCLib::ReferenceCloud* refCloud = CCLib::CloudSamplingTools::resampleCloudSpatially(cloud,static_cast<PointCoordinateType>(step),modParams,0,pDlg);
+			CCLib::ReferenceCloud* refCloud = CCLib::CloudSamplingTools::resampleCloudSpatially(cloud,static_cast<PointCoordinateType>(step),modParams,0,pDlg,true);
 			if (!refCloud)
 				return Error("Subsampling process failed!");
 			Print(QString("\tResult: %1 points").arg(refCloud->size()));
@@ -845,6 +916,68 @@ bool ccCommandLineParser::commandSubsample(QStringList& arguments, ccProgressDia
 			}
 		}
 	}
+	else if (method == "VOXEL")
+	{
+		if (arguments.empty())
+			return Error(QString("Missing parameter: voxel size after \"-%1 VOXEL\"").arg(COMMAND_SUBSAMPLE));
+
+		bool ok = false;
+		double voxelSize = arguments.takeFirst().toDouble(&ok);
+		if (!ok || voxelSize <= 0)
+			return Error("Invalid voxel size!");
+		Print(QString("\tVoxel size: %1").arg(voxelSize));
+
+		//optional aggregation mode
+		ccPointCloud::VOXEL_AGGREGATION aggregation = ccPointCloud::VOXEL_MEAN;
+		if (!arguments.empty())
+		{
+			QString aggregationStr = arguments.front().toUpper();
+			bool validMode = true;
+			if (aggregationStr == "MEAN")
+				aggregation = ccPointCloud::VOXEL_MEAN;
+			else if (aggregationStr == "MEDIAN")
+				aggregation = ccPointCloud::VOXEL_MEDIAN;
+			else if (aggregationStr == "MIN")
+				aggregation = ccPointCloud::VOXEL_MIN;
+			else if (aggregationStr == "MAX")
+				aggregation = ccPointCloud::VOXEL_MAX;
+			else
+				validMode = false;
+
+			if (validMode)
+			{
+				arguments.pop_front();
+				Print(QString("\tAggregation: ")+aggregationStr);
+			}
+		}
+
+		for (unsigned i=0; i<m_clouds.size(); ++i)
+		{
+			ccPointCloud* cloud = m_clouds[i].pc;
+			Print(QString("\tProcessing cloud #%1 (%2)").arg(i+1).arg(!cloud->getName().isEmpty() ? cloud->getName() : "no name"));
+
+			ccPointCloud* result = cloud->voxelGridSubsample(static_cast<PointCoordinateType>(voxelSize),aggregation,true,pDlg);
+			if (!result)
+				return Error("Subsampling process failed!");
+			Print(QString("\tResult: %1 points").arg(result->size()));
+
+			result->setName(m_clouds[i].pc->getName() + QString(".subsampled"));
+			if (s_autoSaveMode)
+			{
+				CloudDesc cloudDesc(result,m_clouds[i].basename,m_clouds[i].path,m_clouds[i].indexInFile);
+				QString errorStr = Export(cloudDesc,"VOXEL_SUBSAMPLED");
+				if (!errorStr.isEmpty())
+				{
+					delete result;
+					return Error(errorStr);
+				}
+			}
+			//replace current cloud by this one
+			delete m_clouds[i].pc;
+			m_clouds[i].pc = result;
+			m_clouds[i].basename += QString("_SUBSAMPLED");
+		}
+	}
 	else
 	{
 		return Error("Unknown method!");
@@ -1107,6 +1240,152 @@ bool ccCommandLineParser::commandRoughness(QStringList& arguments, QDialog* pare
 	return true;
 }
 
+bool ccCommandLineParser::commandMultiScaleFeatures(QStringList& arguments, ccProgressDialog* pDlg/*=0*/)
+{
+	Print("[MULTI-SCALE FEATURES]");
+
+	typedef CCLib::GeometricalAnalysisTools GAT;
+
+	//radii
+	if (arguments.empty())
+		return Error(QString("Missing parameter: radii (comma separated) after \"-%1\"").arg(COMMAND_MULTI_SCALE_FEATURES));
+	QString radiiStr = arguments.takeFirst();
+	std::vector<PointCoordinateType> radii;
+	{
+		QStringList tokens = radiiStr.split(',',QString::SkipEmptyParts);
+		for (int i=0; i<tokens.size(); ++i)
+		{
+			bool ok = false;
+			double radius = tokens[i].toDouble(&ok);
+			if (!ok || radius <= 0)
+				return Error(QString("Invalid parameter: radius (%1) after \"-%2\"").arg(tokens[i]).arg(COMMAND_MULTI_SCALE_FEATURES));
+			radii.push_back(static_cast<PointCoordinateType>(radius));
+		}
+		if (radii.empty())
+			return Error(QString("Invalid parameter: no radius after \"-%1\"").arg(COMMAND_MULTI_SCALE_FEATURES));
+	}
+
+	//features
+	if (arguments.empty())
+		return Error(QString("Missing parameter: features (comma separated) after the radii"));
+	QString featuresStr = arguments.takeFirst().toUpper();
+	int features = 0;
+	{
+		QStringList tokens = featuresStr.split(',',QString::SkipEmptyParts);
+		for (int i=0; i<tokens.size(); ++i)
+		{
+			const QString& token = tokens[i];
+			if (token == "DENSITY")
+				features |= GAT::MS_DENSITY;
+			else if (token == "ROUGH")
+				features |= GAT::MS_ROUGHNESS;
+			else if (token == "MEAN_CURV")
+				features |= GAT::MS_MEAN_CURVATURE;
+			else if (token == "GAUSS_CURV")
+				features |= GAT::MS_GAUSSIAN_CURVATURE;
+			else if (token == "NORMAL_CHANGE_RATE")
+				features |= GAT::MS_NORMAL_CHANGE_RATE;
+			else if (token == "EIGEN1")
+				features |= GAT::MS_EIGENVALUE_1;
+			else if (token == "EIGEN2")
+				features |= GAT::MS_EIGENVALUE_2;
+			else if (token == "EIGEN3")
+				features |= GAT::MS_EIGENVALUE_3;
+			else if (token == "ALL")
+				features |= (GAT::MS_DENSITY | GAT::MS_ROUGHNESS | GAT::MS_MEAN_CURVATURE | GAT::MS_GAUSSIAN_CURVATURE | GAT::MS_NORMAL_CHANGE_RATE | GAT::MS_EIGENVALUE_1 | GAT::MS_EIGENVALUE_2 | GAT::MS_EIGENVALUE_3);
+			else
+				return Error(QString("Invalid parameter: unknown feature '%1' (DENSITY/ROUGH/MEAN_CURV/GAUSS_CURV/NORMAL_CHANGE_RATE/EIGEN1/EIGEN2/EIGEN3 or ALL)").arg(token));
+		}
+		if (features == 0)
+			return Error(QString("Invalid parameter: no feature after the radii"));
+	}
+
+	//optional parameter: density type
+	GAT::Density densityType = GAT::DENSITY_3D;
+	if (!arguments.empty())
+	{
+		QString argument = arguments.front();
+		if (IsCommand(argument,COMMAND_DENSITY_TYPE))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+			if (!ReadDensityType(arguments,densityType))
+				return false;
+		}
+	}
+
+	if (m_clouds.empty())
+		return Error(QString("No point cloud on which to compute features! (be sure to open one with \"-%1 [cloud filename]\" before \"-%2\")").arg(COMMAND_OPEN).arg(COMMAND_MULTI_SCALE_FEATURES));
+
+	//output scalar fields names (same order as the output of GeometricalAnalysisTools::computeMultiScaleFeatures)
+	QStringList sfNames;
+	{
+		QString densityName = CC_LOCAL_VOL_DENSITY_FIELD_NAME;
+		if (densityType == GAT::DENSITY_KNN)
+			densityName = CC_LOCAL_KNN_DENSITY_FIELD_NAME;
+		else if (densityType == GAT::DENSITY_2D)
+			densityName = CC_LOCAL_SURF_DENSITY_FIELD_NAME;
+
+		QStringList featureNames;
+		if (features & GAT::MS_DENSITY)
+			featureNames << densityName;
+		if (features & GAT::MS_ROUGHNESS)
+			featureNames << CC_ROUGHNESS_FIELD_NAME;
+		if (features & GAT::MS_MEAN_CURVATURE)
+			featureNames << CC_CURVATURE_MEAN_FIELD_NAME;
+		if (features & GAT::MS_GAUSSIAN_CURVATURE)
+			featureNames << CC_CURVATURE_GAUSSIAN_FIELD_NAME;
+		if (features & GAT::MS_NORMAL_CHANGE_RATE)
+			featureNames << CC_CURVATURE_NORM_CHANGE_RATE_FIELD_NAME;
+		if (features & GAT::MS_EIGENVALUE_1)
+			featureNames << "Eigenvalue 1";
+		if (features & GAT::MS_EIGENVALUE_2)
+			featureNames << "Eigenvalue 2";
+		if (features & GAT::MS_EIGENVALUE_3)
+			featureNames << "Eigenvalue 3";
+
+		for (int f=0; f<featureNames.size(); ++f)
+			for (size_t r=0; r<radii.size(); ++r)
+				sfNames << featureNames[f] + QString("(%1)").arg(radii[r]);
+	}
+	Print(QString("\t%1 scalar field(s) per cloud").arg(sfNames.size()));
+
+	for (size_t i=0; i<m_clouds.size(); ++i)
+	{
+		ccPointCloud* cloud = m_clouds[i].pc;
+		assert(cloud);
+
+		//create the output scalar fields
+		std::vector<CCLib::ScalarField*> outputFields;
+		int sfIdx = -1;
+		for (int j=0; j<sfNames.size(); ++j)
+		{
+			QByteArray sfName = sfNames[j].toLocal8Bit();
+			sfIdx = cloud->getScalarFieldIndexByName(sfName.constData());
+			if (sfIdx < 0)
+				sfIdx = cloud->addScalarField(sfName.constData());
+			if (sfIdx < 0)
+				return Error(QString("Couldn't create scalar field '%1' on cloud '%2'! Not enough memory?").arg(sfNames[j]).arg(cloud->getName()));
+			outputFields.push_back(cloud->getScalarField(sfIdx));
+		}
+
+		//computation
+		int result = GAT::computeMultiScaleFeatures(cloud,radii,features,outputFields,densityType,pDlg);
+		if (result < 0)
+			return Error(QString("Failed to compute the multi-scale features of cloud '%1'! (error code: %2)").arg(cloud->getName()).arg(result));
+
+		for (size_t j=0; j<outputFields.size(); ++j)
+			outputFields[j]->computeMinAndMax();
+		cloud->setCurrentDisplayedScalarField(sfIdx);
+	}
+
+	//save output
+	if (s_autoSaveMode && !saveClouds("MS_FEATURES"))
+		return false;
+
+	return true;
+}
+
 bool ccCommandLineParser::commandApplyTransformation(QStringList& arguments)
 {
 	Print("[APPLY TRANSFORMATION]");
@@ -1644,6 +1923,75 @@ bool ccCommandLineParser::commandSORFilter(QStringList& arguments, ccProgressDia
 	return true;
 }
 
+bool ccCommandLineParser::commandRemoveDuplicates(QStringList& arguments, ccProgressDialog* pDlg/*=0*/)
+{
+	Print("[REMOVE DUPLICATE POINTS]");
+
+	if (arguments.empty())
+		return Error(QString("Missing parameter: min distance between points after \"-%1\"").arg(COMMAND_REMOVE_DUPLICATES));
+
+	QString minDistStr = arguments.takeFirst();
+	bool ok;
+	double minDistanceBetweenPoints = minDistStr.toDouble(&ok);
+	if (!ok || minDistanceBetweenPoints < 0)
+		return Error(QString("Invalid parameter: min distance between points (%1)").arg(minDistStr));
+
+	if (m_clouds.empty())
+		return Error(QString("No cloud available. Be sure to open one first!"));
+
+	static const char DEFAULT_DUPLICATE_TEMP_SF_NAME[] = "DuplicateFlags";
+
+	for (size_t i=0; i<m_clouds.size(); ++i)
+	{
+		ccPointCloud* cloud = m_clouds[i].pc;
+		assert(cloud);
+
+		//create temporary SF for 'duplicate flags'
+		int sfIdx = cloud->getScalarFieldIndexByName(DEFAULT_DUPLICATE_TEMP_SF_NAME);
+		if (sfIdx < 0)
+			sfIdx = cloud->addScalarField(DEFAULT_DUPLICATE_TEMP_SF_NAME);
+		if (sfIdx < 0)
+			return Error(QString("Couldn't create temporary scalar field on cloud '%1'! Not enough memory?").arg(cloud->getName()));
+		cloud->setCurrentScalarField(sfIdx);
+
+		//computation
+		int result = CCLib::GeometricalAnalysisTools::flagDuplicatePointsWithGrid(cloud,minDistanceBetweenPoints,pDlg);
+		if (result < 0)
+		{
+			cloud->deleteScalarField(sfIdx);
+			return Error(QString("Failed to flag the duplicate points of cloud '%1'! (not enough memory?)").arg(cloud->getName()));
+		}
+
+		ccPointCloud* cleanCloud = cloud->filterPointsByScalarValue(0,0);
+		cloud->deleteScalarField(sfIdx);
+		if (!cleanCloud)
+			return Error(QString("Not enough memory to create a clean version of cloud '%1'!").arg(cloud->getName()));
+
+		int sfIdx2 = cleanCloud->getScalarFieldIndexByName(DEFAULT_DUPLICATE_TEMP_SF_NAME);
+		if (sfIdx2 >= 0)
+			cleanCloud->deleteScalarField(sfIdx2);
+		Print(QString("Cloud '%1': %2 duplicate point(s) removed").arg(cloud->getName()).arg(cloud->size() - cleanCloud->size()));
+
+		cleanCloud->setName(cloud->getName()+QString(".clean"));
+		if (s_autoSaveMode)
+		{
+			CloudDesc cloudDesc(cleanCloud,m_clouds[i].basename,m_clouds[i].path,m_clouds[i].indexInFile);
+			QString errorStr = Export(cloudDesc,"REMOVED_DUPLICATES");
+			if (!errorStr.isEmpty())
+			{
+				delete cleanCloud;
+				return Error(errorStr);
+			}
+		}
+		//replace current cloud by this one
+		delete m_clouds[i].pc;
+		m_clouds[i].pc = cleanCloud;
+		m_clouds[i].basename += QString("_REMOVED_DUPLICATES");
+	}
+
+	return true;
+}
+
 bool ccCommandLineParser::commandSampleMesh(QStringList& arguments, ccProgressDialog* pDlg/*=0*/)
 {
 	Print("[SAMPLE POINTS ON MESH]");
@@ -2464,36 +2812,131 @@ bool ccCommandLineParser::commandBundler(QStringList& arguments)
 	return true;
 }
 
-bool ccCommandLineParser::commandDist(QStringList& arguments, bool cloud2meshDist, QDialog* parent/*=0*/)
+//! Point stream reading an ASCII file line by line (out-of-core C2C distances)
+/** The first 3 numerical values of each line are the point coordinates (the other
+	lines - e.g. headers - are ignored). The coordinates are shifted so as to keep
+	as much precision as possible once converted to PointCoordinateType.
+**/
+class AsciiPointStream : public CCLib::GenericPointStream
 {
-	Print("[DISTANCE COMPUTATION]");
+public:
 
-	//compared cloud
-	if (m_clouds.empty())
-		return Error(QString("No point cloud available. Be sure to open or generate one first!"));
-	else if (cloud2meshDist && m_clouds.size() != 1)
-		ccConsole::Warning("Multiple point clouds loaded! We take the first one by default");
-	CloudDesc& compCloud = m_clouds.front();
+	//! Default constructor
+	AsciiPointStream(const QString& filename, const CCVector3d& shift)
+		: m_file(filename)
+		, m_shift(shift)
+		, m_separator(' ')
+	{}
 
-	//reference entity
-	ccHObject* refEntity = 0;
-	if (cloud2meshDist)
+	//! Opens the file
+	bool open() { return m_file.open(QFile::ReadOnly); }
+
+	//! Last line read
+	const QByteArray& currentLine() const { return m_line; }
+	//! Separator of the last line read
+	char separator() const { return m_separator; }
+
+	//! Reads the first point of the file (unshifted)
+	bool readFirstPoint(CCVector3d& P)
 	{
-		if (m_meshes.empty())
-			return Error(QString("No mesh available. Be sure to open one first!"));
-		else if (m_meshes.size() != 1)
-			ccConsole::Warning("Multiple meshes loaded! We take the first one by default");
-		refEntity = m_meshes.front().mesh;
+		return rewind() && readNextLine(P);
 	}
-	else
+
+	//inherited from GenericPointStream
+	virtual bool rewind() { return m_file.seek(0); }
+	virtual bool readNext(CCVector3& P)
 	{
-		if (m_clouds.size() < 2)
-			return Error(QString("Only one point cloud available. Be sure to open or generate a second one before performing C2C distance!"));
-		else if (m_clouds.size() > 2)
-			ccConsole::Warning("More than 3 point clouds loaded! We take the second one as reference by default");
-		refEntity = m_clouds[1].pc;
+		CCVector3d Pd;
+		if (!readNextLine(Pd))
+			return false;
+		P = CCVector3::fromArray((Pd + m_shift).u);
+		return true;
+	}
+
+protected:
+
+	//! Reads the next valid line
+	bool readNextLine(CCVector3d& P)
+	{
+		while (!m_file.atEnd())
+		{
+			m_line = m_file.readLine();
+			while (m_line.endsWith('\n') || m_line.endsWith('\r'))
+				m_line.chop(1);
+
+			const char* start = m_line.constData();
+			char* end = 0;
+			unsigned char k = 0;
+			for (; k<3; ++k)
+			{
+				P.u[k] = strtod(start,&end);
+				if (end == start)
+					break;
+				if (k == 0)
+				{
+					//the separator is the first non-blank character after the first value (if any)
+					const char* c = end;
+					while (*c == ' ' || *c == '\t')
+						++c;
+					m_separator = (*c == ',' || *c == ';' ? *c : (*end == '\t' ? '\t' : ' '));
+				}
+				//skip the separator
+				start = end;
+				while (*start == ' ' || *start == '\t' || *start == ',' || *start == ';')
+					++start;
+			}
+			if (k == 3)
+				return true;
+		}
+		return false;
+	}
+
+	//! File
+	QFile m_file;
+	//! Coordinates shift
+	CCVector3d m_shift;
+	//! Last line read
+	QByteArray m_line;
+	//! Separator of the last line read
+	char m_separator;
+};
+
+//! Writes each line of an ASCII point stream with the corresponding distance as an additional column
+class AsciiDistanceOutput : public CCLib::GenericDistanceOutput
+{
+public:
+
+	//! Default constructor
+	AsciiDistanceOutput(const QString& filename, const AsciiPointStream& stream)
+		: m_file(filename)
+		, m_stream(stream)
+	{}
+
+	//! Opens the file
+	bool open() { return m_file.open(QFile::WriteOnly | QFile::Text); }
+
+	//inherited from GenericDistanceOutput
+	virtual bool writeNext(ScalarType d)
+	{
+		QByteArray line = m_stream.currentLine();
+		line += m_stream.separator();
+		line += QByteArray::number(d,'g',s_precision);
+		line += '\n';
+		return m_file.write(line) == line.size();
 	}
 
+protected:
+
+	//! File
+	QFile m_file;
+	//! Associated stream
+	const AsciiPointStream& m_stream;
+};
+
+bool ccCommandLineParser::commandDist(QStringList& arguments, bool cloud2meshDist, QDialog* parent/*=0*/)
+{
+	Print("[DISTANCE COMPUTATION]");
+
 	//inner loop for Distance computation options
 	bool flipNormals = false;
 	double maxDist = 0.0;
@@ -2503,6 +2946,14 @@ bool ccCommandLineParser::commandDist(QStringList& arguments, bool cloud2meshDis
 	int modelIndex = 0;
 	bool useKNN = true;
 	double nSize = 0;
+	bool modelGrid = false;
+	unsigned tileMemory = 0;
+	QString outOfCoreCompFilename, outOfCoreRefFilename, outOfCoreOutputFilename;
+
+	QString gridFilename;
+	double gridCellSize = 0;
+	double gridBandWidth = 0;
+	double gridExactBandWidth = 0;
 
 	while (!arguments.empty())
 	{
@@ -2515,7 +2966,7 @@ bool ccCommandLineParser::commandDist(QStringList& arguments, bool cloud2meshDis
 			flipNormals = true;
 
 			if (!cloud2meshDist)
-				ccConsole::Warning("Parameter \"-%1\" ignored: only for C2M distance!");
+				ccConsole::Warning(QString("Parameter \"-%1\" ignored: only for C2M distance!").arg(COMMAND_C2M_DIST_FLIP_NORMALS));
 		}
 		else if (IsCommand(argument,COMMAND_MAX_DISTANCE))
 		{
@@ -2528,9 +2979,6 @@ bool ccCommandLineParser::commandDist(QStringList& arguments, bool cloud2meshDis
 			maxDist = arguments.takeFirst().toDouble(&conversionOk);
 			if (!conversionOk)
 				return Error(QString("Invalid parameter: value after \"-%1\"").arg(COMMAND_MAX_DISTANCE));
-
-			if (!cloud2meshDist)
-				ccConsole::Warning("Parameter \"-%1\" ignored: only for C2M distance!");
 		}
 		else if (IsCommand(argument,COMMAND_OCTREE_LEVEL))
 		{
@@ -2552,7 +3000,7 @@ bool ccCommandLineParser::commandDist(QStringList& arguments, bool cloud2meshDis
 			splitXYZ = true;
 
 			if (cloud2meshDist)
-				ccConsole::Warning("Parameter \"-%1\" ignored: only for C2C distance!");
+				ccConsole::Warning(QString("Parameter \"-%1\" ignored: only for C2C distance!").arg(COMMAND_C2C_SPLIT_XYZ));
 		}
 		else if (IsCommand(argument,COMMAND_C2C_LOCAL_MODEL))
 		{
@@ -2604,68 +3052,346 @@ bool ccCommandLineParser::commandDist(QStringList& arguments, bool cloud2meshDis
 				return Error(QString("Missing parameter: expected neighborhood size after neighborhood type (neighbor count/sphere radius)"));
 			}
 		}
+		else if (IsCommand(argument,COMMAND_C2C_LOCAL_MODEL_GRID))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			modelGrid = true;
+
+			if (cloud2meshDist)
+				ccConsole::Warning(QString("Parameter \"-%1\" ignored: only for C2C distance!").arg(COMMAND_C2C_LOCAL_MODEL_GRID));
+		}
+		else if (IsCommand(argument,COMMAND_C2C_TILE_MEMORY))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: memory size (in MB) after \"-%1\"").arg(COMMAND_C2C_TILE_MEMORY));
+			bool conversionOk = false;
+			tileMemory = arguments.takeFirst().toUInt(&conversionOk);
+			if (!conversionOk || tileMemory == 0)
+				return Error(QString("Invalid parameter: memory size (in MB) after \"-%1\"").arg(COMMAND_C2C_TILE_MEMORY));
+
+			if (cloud2meshDist)
+				ccConsole::Warning(QString("Parameter \"-%1\" ignored: only for C2C distance!").arg(COMMAND_C2C_TILE_MEMORY));
+		}
+		else if (IsCommand(argument,COMMAND_C2C_OUT_OF_CORE))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.size() < 3)
+				return Error(QString("Missing parameter(s) after \"-%1\" (expected: compared, reference and output ASCII files)").arg(COMMAND_C2C_OUT_OF_CORE));
+			outOfCoreCompFilename = arguments.takeFirst();
+			outOfCoreRefFilename = arguments.takeFirst();
+			outOfCoreOutputFilename = arguments.takeFirst();
+
+			if (cloud2meshDist)
+				return Error(QString("Parameter \"-%1\" is only supported for C2C distance").arg(COMMAND_C2C_OUT_OF_CORE));
+		}
+		else if (IsCommand(argument,COMMAND_C2M_DIST_GRID))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.size() < 4)
+				return Error(QString("Missing parameter(s) after \"-%1\" (expected: file, cell size, band width and exact band width)").arg(COMMAND_C2M_DIST_GRID));
+			gridFilename = arguments.takeFirst();
+			bool conversionOk = false;
+			gridCellSize = arguments.takeFirst().toDouble(&conversionOk);
+			if (!conversionOk || gridCellSize <= 0)
+				return Error(QString("Invalid parameter: cell size after \"-%1\" {file}").arg(COMMAND_C2M_DIST_GRID));
+			gridBandWidth = arguments.takeFirst().toDouble(&conversionOk);
+			if (!conversionOk || gridBandWidth <= 0)
+				return Error(QString("Invalid parameter: band width after \"-%1\" {file} {cell size}").arg(COMMAND_C2M_DIST_GRID));
+			gridExactBandWidth = arguments.takeFirst().toDouble(&conversionOk);
+			if (!conversionOk || gridExactBandWidth < 0)
+				return Error(QString("Invalid parameter: exact band width after \"-%1\" {file} {cell size} {band width}").arg(COMMAND_C2M_DIST_GRID));
+
+			if (!cloud2meshDist)
+				ccConsole::Warning(QString("Parameter \"-%1\" ignored: only for C2M distance!").arg(COMMAND_C2M_DIST_GRID));
+		}
 		else
 		{
 			break; //as soon as we encounter an unrecognized argument, we break the local loop to go back on the main one!
 		}
 	}
 
-	//spawn dialog (virtually) so as to prepare the comparison process
-	ccComparisonDlg compDlg(compCloud.pc,
-							refEntity,
-							cloud2meshDist ? ccComparisonDlg::CLOUDMESH_DIST : ccComparisonDlg::CLOUDCLOUD_DIST,
-							parent,
-							true);
+	//out-of-core C2C distances (the clouds are never loaded)
+	if (!outOfCoreCompFilename.isEmpty())
+	{
+		if (maxDist <= 0 || tileMemory == 0)
+			return Error(QString("Out-of-core distances computation (\"-%1\") requires a max distance (\"-%2\") and a max memory per tile (\"-%3\")").arg(COMMAND_C2C_OUT_OF_CORE).arg(COMMAND_MAX_DISTANCE).arg(COMMAND_C2C_TILE_MEMORY));
+		if (splitXYZ || modelIndex != 0)
+			return Error(QString("Parameters \"-%1\" and \"-%2\" are not supported in out-of-core mode (\"-%3\")").arg(COMMAND_C2C_SPLIT_XYZ).arg(COMMAND_C2C_LOCAL_MODEL).arg(COMMAND_C2C_OUT_OF_CORE));
 
-	//update parameters
-	if (maxDist > 0)
+		//the same shift is applied to both clouds
+		CCVector3d shift(0,0,0);
+		if (s_loadParameters.m_coordinatesShiftEnabled)
+		{
+			shift = s_loadParameters.m_coordinatesShift;
+		}
+		else
+		{
+			AsciiPointStream firstPointStream(outOfCoreCompFilename,shift);
+			CCVector3d P;
+			if (!firstPointStream.open() || !firstPointStream.readFirstPoint(P))
+				return Error(QString("Failed to read file '%1'").arg(outOfCoreCompFilename));
+			shift = CCVector3d(-floor(P.x),-floor(P.y),-floor(P.z));
+		}
+
+		AsciiPointStream comparedStream(outOfCoreCompFilename,shift);
+		if (!comparedStream.open())
+			return Error(QString("Failed to open file '%1'").arg(outOfCoreCompFilename));
+		AsciiPointStream referenceStream(outOfCoreRefFilename,shift);
+		if (!referenceStream.open())
+			return Error(QString("Failed to open file '%1'").arg(outOfCoreRefFilename));
+		AsciiDistanceOutput output(outOfCoreOutputFilename,comparedStream);
+		if (!output.open())
+			return Error(QString("Failed to create file '%1'").arg(outOfCoreOutputFilename));
+
+		CCLib::DistanceComputationTools::Cloud2CloudDistanceComputationParams params;
+		params.maxSearchDist = static_cast<ScalarType>(maxDist);
+		params.octreeLevel = static_cast<unsigned char>(octreeLevel);
+
+		Print(QString("[Out-of-core distances] Max memory per tile: %1 MB").arg(tileMemory));
+
+		//the temporary files are created next to the output file
+		QString tempFilesPrefix = outOfCoreOutputFilename + QString(".c2c");
+
+		QElapsedTimer eTimer;
+		eTimer.start();
+		int result = CCLib::DistanceComputationTools::computeCloud2CloudDistanceOutOfCore(	&comparedStream,
+																							&referenceStream,
+																							&output,
+																							params,
+																							static_cast<size_t>(tileMemory) << 20,
+																							qPrintable(tempFilesPrefix));
+		if (result < 0)
+			return Error(QString("An error occured during distances computation! (error code: %1)").arg(result));
+
+		Print(QString("[Out-of-core distances] Done in %1 s. - distances saved in '%2'").arg(eTimer.elapsed()/1.0e3).arg(outOfCoreOutputFilename));
+		return true;
+	}
+
+	//compared cloud
+	if (m_clouds.empty())
+		return Error(QString("No point cloud available. Be sure to open or generate one first!"));
+	else if (cloud2meshDist && m_clouds.size() != 1)
+		ccConsole::Warning("Multiple point clouds loaded! We take the first one by default");
+	CloudDesc& compCloud = m_clouds.front();
+
+	//reference entity
+	ccHObject* refEntity = 0;
+	if (cloud2meshDist)
 	{
-		compDlg.maxDistCheckBox->setChecked(true);
-		compDlg.maxSearchDistSpinBox->setValue(maxDist);
+		if (m_meshes.empty())
+			return Error(QString("No mesh available. Be sure to open one first!"));
+		else if (m_meshes.size() != 1)
+			ccConsole::Warning("Multiple meshes loaded! We take the first one by default");
+		refEntity = m_meshes.front().mesh;
 	}
-	if (octreeLevel > 0)
+	else
 	{
-		compDlg.octreeLevelComboBox->setCurrentIndex(octreeLevel);
+		if (m_clouds.size() < 2)
+			return Error(QString("Only one point cloud available. Be sure to open or generate a second one before performing C2C distance!"));
+		else if (m_clouds.size() > 2)
+			ccConsole::Warning("More than 3 point clouds loaded! We take the second one as reference by default");
+		refEntity = m_clouds[1].pc;
 	}
 
-	//C2M-only parameters
-	if (cloud2meshDist)
+	//tiled C2C distances (bounded memory)
+	if (!cloud2meshDist && tileMemory != 0)
+	{
+		if (maxDist <= 0)
+			return Error(QString("Tiled distances computation (\"-%1\") requires a max distance (\"-%2\")").arg(COMMAND_C2C_TILE_MEMORY).arg(COMMAND_MAX_DISTANCE));
+		if (splitXYZ || modelIndex != 0)
+			return Error(QString("Parameters \"-%1\" and \"-%2\" are not supported in tiled mode (\"-%3\")").arg(COMMAND_C2C_SPLIT_XYZ).arg(COMMAND_C2C_LOCAL_MODEL).arg(COMMAND_C2C_TILE_MEMORY));
+
+		ccPointCloud* compPC = compCloud.pc;
+		ccPointCloud* refPC = m_clouds[1].pc;
+
+		//output scalar field (same name as the one created by the comparison dialog)
+		QString sfName = QString(CC_CLOUD2CLOUD_DISTANCES_DEFAULT_SF_NAME) + QString("[<%1]").arg(maxDist);
+		int sfIdx = compPC->getScalarFieldIndexByName(qPrintable(sfName));
+		if (sfIdx < 0)
+			sfIdx = compPC->addScalarField(qPrintable(sfName));
+		if (sfIdx < 0)
+			return Error("Couldn't allocate a new scalar field for computing distances! Try to free some memory ...");
+		compPC->setCurrentScalarField(sfIdx);
+
+		CCLib::DistanceComputationTools::Cloud2CloudDistanceComputationParams params;
+		params.maxSearchDist = static_cast<ScalarType>(maxDist);
+		params.octreeLevel = static_cast<unsigned char>(octreeLevel);
+
+		Print(QString("[Tiled distances] Max memory per tile: %1 MB").arg(tileMemory));
+
+		QElapsedTimer eTimer;
+		eTimer.start();
+		int result = CCLib::DistanceComputationTools::computeCloud2CloudDistanceTiled(	compPC,
+																						refPC,
+																						params,
+																						static_cast<size_t>(tileMemory) << 20);
+		if (result < 0)
+		{
+			compPC->deleteScalarField(sfIdx);
+			return Error(QString("An error occured during distances computation! (error code: %1)").arg(result));
+		}
+
+		ccScalarField* sf = static_cast<ccScalarField*>(compPC->getScalarField(sfIdx));
+		sf->computeMinAndMax();
+		ScalarType mean = 0, variance = 0;
+		sf->computeMeanAndVariance(mean,&variance);
+		Print(QString("[Tiled distances] Done in %1 s. - mean distance = %2 / std deviation = %3").arg(eTimer.elapsed()/1.0e3).arg(mean).arg(sqrt(variance)));
+
+		compPC->setCurrentDisplayedScalarField(sfIdx);
+		compPC->showSF(true);
+	}
+	//C2M distances with a (cached) distance grid
+	else if (cloud2meshDist && !gridFilename.isEmpty())
 	{
+		ccPointCloud* compPC = compCloud.pc;
+		ccGenericMesh* mesh = m_meshes.front().mesh;
+
+		CCLib::MeshDistanceGrid grid;
+		QElapsedTimer eTimer;
+		eTimer.start();
+
+		//try to reuse the cache file first
+		bool gridLoaded = false;
+		if (QFile(gridFilename).exists())
+		{
+			if (!grid.loadFromFile(qPrintable(gridFilename)))
+				ccConsole::Warning(QString("[Distance grid] Failed to load file '%1'").arg(gridFilename));
+			else if (!grid.isCompatibleWith(mesh))
+				ccConsole::Warning(QString("[Distance grid] File '%1' has been generated with another mesh").arg(gridFilename));
+			else if (grid.getCellSize() != static_cast<PointCoordinateType>(gridCellSize) || grid.getBandWidth() != static_cast<PointCoordinateType>(gridBandWidth))
+				ccConsole::Warning(QString("[Distance grid] File '%1' has been generated with other parameters").arg(gridFilename));
+			else
+				gridLoaded = true;
+		}
+
+		if (gridLoaded)
+		{
+			grid.setExactBandWidth(static_cast<PointCoordinateType>(gridExactBandWidth));
+			Print(QString("[Distance grid] Loaded from file '%1' in %2 s. (%3 bricks)").arg(gridFilename).arg(eTimer.elapsed()/1.0e3).arg(grid.brickCount()));
+		}
+		else
+		{
+			if (!grid.build(mesh,
+							static_cast<PointCoordinateType>(gridCellSize),
+							static_cast<PointCoordinateType>(gridBandWidth),
+							static_cast<PointCoordinateType>(gridExactBandWidth)))
+				return Error("Failed to build the distance grid! (not enough memory?)");
+			Print(QString("[Distance grid] Built in %1 s. (%2 bricks)").arg(eTimer.elapsed()/1.0e3).arg(grid.brickCount()));
+
+			if (!grid.saveToFile(qPrintable(gridFilename)))
+				ccConsole::Warning(QString("[Distance grid] Failed to save file '%1'").arg(gridFilename));
+		}
+
+		//output scalar field (same name as the one created by the comparison dialog)
+		QString sfName(CC_CLOUD2MESH_SIGNED_DISTANCES_DEFAULT_SF_NAME);
 		if (flipNormals)
-			compDlg.flipNormalsCheckBox->setChecked(true);
+			sfName += QString("[-]");
+		if (maxDist > 0)
+			sfName += QString("[<%1]").arg(maxDist);
+		int sfIdx = compPC->getScalarFieldIndexByName(qPrintable(sfName));
+		if (sfIdx < 0)
+			sfIdx = compPC->addScalarField(qPrintable(sfName));
+		if (sfIdx < 0)
+			return Error("Couldn't allocate a new scalar field for computing distances! Try to free some memory ...");
+		compPC->setCurrentScalarField(sfIdx);
+
+		CCLib::DistanceComputationTools::Cloud2MeshDistanceComputationParams params;
+		params.signedDistances = true;
+		params.flipNormals = flipNormals;
+		params.maxSearchDist = static_cast<ScalarType>(maxDist);
+		params.distanceGrid = &grid;
+
+		eTimer.start();
+		int result = CCLib::DistanceComputationTools::computeCloud2MeshDistance(compPC, mesh, params);
+		if (result < 0)
+		{
+			compPC->deleteScalarField(sfIdx);
+			return Error(QString("An error occured during distances computation! (error code: %1)").arg(result));
+		}
+
+		ccScalarField* sf = static_cast<ccScalarField*>(compPC->getScalarField(sfIdx));
+		sf->computeMinAndMax();
+		ScalarType mean = 0, variance = 0;
+		sf->computeMeanAndVariance(mean,&variance);
+		Print(QString("[Distance grid] Distances computed in %1 s. - mean distance = %2 / std deviation = %3").arg(eTimer.elapsed()/1.0e3).arg(mean).arg(sqrt(variance)));
+
+		compPC->setCurrentDisplayedScalarField(sfIdx);
+		compPC->showSF(true);
 	}
-	//C2C-only parameters
 	else
 	{
-		if (splitXYZ)
+		//spawn dialog (virtually) so as to prepare the comparison process
+		ccComparisonDlg compDlg(compCloud.pc,
+								refEntity,
+								cloud2meshDist ? ccComparisonDlg::CLOUDMESH_DIST : ccComparisonDlg::CLOUDCLOUD_DIST,
+								parent,
+								true);
+
+		//update parameters
+		if (maxDist > 0)
 		{
-			if (maxDist > 0)
-				ccConsole::Warning("'Split XYZ' option is ignored if max distance is defined!");
-			compDlg.split3DCheckBox->setChecked(true);
+			compDlg.maxDistCheckBox->setChecked(true);
+			compDlg.maxSearchDistSpinBox->setValue(maxDist);
 		}
-		if (modelIndex != 0)
+		if (octreeLevel > 0)
 		{
-			compDlg.localModelComboBox->setCurrentIndex(modelIndex);
-			if (useKNN)
+			compDlg.octreeLevelComboBox->setCurrentIndex(octreeLevel);
+		}
+
+		//C2M-only parameters
+		if (cloud2meshDist)
+		{
+			if (flipNormals)
+				compDlg.flipNormalsCheckBox->setChecked(true);
+		}
+		//C2C-only parameters
+		else
+		{
+			if (splitXYZ)
 			{
-				compDlg.lmKNNRadioButton->setChecked(true);
-				compDlg.lmKNNSpinBox->setValue(static_cast<int>(nSize));
+				//points without any neighbour below the max distance (if any) get NaN values
+				compDlg.split3DCheckBox->setChecked(true);
+				if (!compDlg.split3DCheckBox->isEnabled())
+					ccConsole::Warning(QString("Parameter \"-%1\" ignored: not supported with this reference entity").arg(COMMAND_C2C_SPLIT_XYZ));
 			}
-			else
+			if (modelIndex != 0)
 			{
-				compDlg.lmRadiusRadioButton->setChecked(true);
-				compDlg.lmRadiusDoubleSpinBox->setValue(nSize);
+				compDlg.localModelComboBox->setCurrentIndex(modelIndex);
+				if (useKNN)
+				{
+					compDlg.lmKNNRadioButton->setChecked(true);
+					compDlg.lmKNNSpinBox->setValue(static_cast<int>(nSize));
+				}
+				else
+				{
+					compDlg.lmRadiusRadioButton->setChecked(true);
+					compDlg.lmRadiusDoubleSpinBox->setValue(nSize);
+				}
+				compDlg.lmGridCheckBox->setChecked(modelGrid);
+			}
+			else if (modelGrid)
+			{
+				ccConsole::Warning(QString("Parameter \"-%1\" ignored: no local model (\"-%2\")").arg(COMMAND_C2C_LOCAL_MODEL_GRID).arg(COMMAND_C2C_LOCAL_MODEL));
 			}
 		}
-	}
 
-	if (!compDlg.computeDistances())
-	{
-		compDlg.cancelAndExit();
-		return Error("An error occured during distances computation!");
-	}
+		if (!compDlg.computeDistances())
+		{
+			compDlg.cancelAndExit();
+			return Error("An error occured during distances computation!");
+		}
 
-	compDlg.applyAndExit();
+		compDlg.applyAndExit();
+	}
 
 	QString suffix(cloud2meshDist ? "_C2M_DIST" : "_C2C_DIST");
 	if (maxDist > 0)
@@ -2684,6 +3410,495 @@ bool ccCommandLineParser::commandDist(QStringList& arguments, bool cloud2meshDis
 	return true;
 }
 
+//! One-pass quantile estimator (P-square algorithm)
+/** R. Jain and I. Chlamtac, "The P2 algorithm for dynamic calculation of quantiles
+	and histograms without storing observations", Communications of the ACM, 28(10), 1985
+**/
+class P2QuantileEstimator
+{
+public:
+
+	//! Default constructor
+	/** \param p quantile to estimate (in [0,1])
+	**/
+	P2QuantileEstimator(double p = 0.5)
+		: m_p(p)
+		, m_count(0)
+	{
+		m_dn[0] = 0; m_dn[1] = p/2; m_dn[2] = p; m_dn[3] = (1+p)/2; m_dn[4] = 1;
+	}
+
+	//! Adds a value
+	void add(double x)
+	{
+		if (m_count < 5)
+		{
+			m_q[m_count++] = x;
+			if (m_count == 5)
+			{
+				std::sort(m_q, m_q+5);
+				for (int i=0; i<5; ++i)
+					m_n[i] = i+1;
+				m_np[0] = 1; m_np[1] = 1 + 2*m_p; m_np[2] = 1 + 4*m_p; m_np[3] = 3 + 2*m_p; m_np[4] = 5;
+			}
+			return;
+		}
+		++m_count;
+
+		//cell of the new value
+		int k = 0;
+		if (x < m_q[0])
+		{
+			m_q[0] = x;
+		}
+		else if (x >= m_q[4])
+		{
+			m_q[4] = x;
+			k = 3;
+		}
+		else
+		{
+			while (x >= m_q[k+1])
+				++k;
+		}
+
+		//update the markers positions
+		for (int i=k+1; i<5; ++i)
+			m_n[i] += 1;
+		for (int i=0; i<5; ++i)
+			m_np[i] += m_dn[i];
+
+		//adjust the markers heights if necessary
+		for (int i=1; i<4; ++i)
+		{
+			double d = m_np[i] - m_n[i];
+			if ((d >= 1 && m_n[i+1] - m_n[i] > 1) || (d <= -1 && m_n[i-1] - m_n[i] < -1))
+			{
+				int s = (d >= 0 ? 1 : -1);
+				//piecewise-parabolic prediction
+				double q = m_q[i] + s / (m_n[i+1] - m_n[i-1]) * (	(m_n[i] - m_n[i-1] + s) * (m_q[i+1] - m_q[i]) / (m_n[i+1] - m_n[i])
+																+	(m_n[i+1] - m_n[i] - s) * (m_q[i] - m_q[i-1]) / (m_n[i] - m_n[i-1]) );
+				if (m_q[i-1] < q && q < m_q[i+1])
+					m_q[i] = q;
+				else //linear prediction
+					m_q[i] += s * (m_q[i+s] - m_q[i]) / (m_n[i+s] - m_n[i]);
+				m_n[i] += s;
+			}
+		}
+	}
+
+	//! Returns the estimated quantile
+	double value() const
+	{
+		if (m_count >= 5)
+			return m_q[2];
+		if (m_count == 0)
+			return 0;
+		//not enough values: exact quantile
+		double q[5];
+		std::copy(m_q, m_q+m_count, q);
+		std::sort(q, q+m_count);
+		return q[std::min(m_count-1, static_cast<unsigned>(m_p * m_count))];
+	}
+
+protected:
+
+	//! Quantile
+	double m_p;
+	//! Number of values
+	unsigned m_count;
+	//! Markers heights
+	double m_q[5];
+	//! Markers positions
+	double m_n[5];
+	//! Markers desired positions
+	double m_np[5];
+	//! Markers desired positions increments
+	double m_dn[5];
+};
+
+//! Percentiles reported by the C2C batch command
+static const double s_c2cBatchPercentiles[] = { 0.50, 0.90, 0.95, 0.99 };
+//! Number of percentiles reported by the C2C batch command
+static const unsigned C2C_BATCH_PERCENTILE_COUNT = sizeof(s_c2cBatchPercentiles) / sizeof(double);
+
+//! Epoch compared to the reference cloud (C2C batch command)
+struct C2CBatchJob
+{
+	//! Epoch filename
+	QString filename;
+	//! Epoch cloud
+	ccPointCloud* cloud;
+	//! Reference cloud
+	ccPointCloud* reference;
+	//! Reference octree (shared by all jobs)
+	CCLib::DgmOctree* referenceOctree;
+	//! Distances computation parameters
+	CCLib::DistanceComputationTools::Cloud2CloudDistanceComputationParams params;
+	//! Computation result (error code if negative)
+	int result;
+	//! Number of valid distances
+	unsigned validCount;
+	//! Mean distance
+	double mean;
+	//! Distances std. deviation
+	double stdDev;
+	//! Min distance
+	double minDist;
+	//! Max distance
+	double maxDist;
+	//! Percentiles (see s_c2cBatchPercentiles)
+	double percentiles[C2C_BATCH_PERCENTILE_COUNT];
+	//! Computation time (in seconds)
+	double time;
+	//! Computation state
+	QFuture<void> future;
+
+	C2CBatchJob()
+		: cloud(0)
+		, reference(0)
+		, referenceOctree(0)
+		, result(0)
+		, validCount(0)
+		, mean(0)
+		, stdDev(0)
+		, minDist(0)
+		, maxDist(0)
+		, time(0)
+	{}
+};
+
+//! Computes the distances of an epoch and their statistics (called in a worker thread)
+static void ComputeC2CBatchJob(C2CBatchJob* job)
+{
+	QElapsedTimer eTimer;
+	eTimer.start();
+
+	job->result = CCLib::DistanceComputationTools::computeCloud2CloudDistance(	job->cloud,
+																				job->reference,
+																				job->params,
+																				0,
+																				0,
+																				job->referenceOctree);
+	if (job->result >= 0)
+	{
+		//statistics (single pass)
+		CCLib::ScalarField* sf = job->cloud->getCurrentInScalarField();
+		assert(sf);
+		P2QuantileEstimator estimators[C2C_BATCH_PERCENTILE_COUNT];
+		for (unsigned j=0; j<C2C_BATCH_PERCENTILE_COUNT; ++j)
+			estimators[j] = P2QuantileEstimator(s_c2cBatchPercentiles[j]);
+
+		double mean = 0, m2 = 0;
+		unsigned count = 0;
+		for (unsigned i=0; i<sf->currentSize(); ++i)
+		{
+			ScalarType val = sf->getValue(i);
+			if (!CCLib::ScalarField::ValidValue(val))
+				continue;
+
+			double d = static_cast<double>(val);
+			if (count == 0)
+			{
+				job->minDist = job->maxDist = d;
+			}
+			else
+			{
+				job->minDist = std::min(job->minDist, d);
+				job->maxDist = std::max(job->maxDist, d);
+			}
+			++count;
+
+			//Welford's online algorithm
+			double delta = d - mean;
+			mean += delta / count;
+			m2 += delta * (d - mean);
+
+			for (unsigned j=0; j<C2C_BATCH_PERCENTILE_COUNT; ++j)
+				estimators[j].add(d);
+		}
+
+		job->validCount = count;
+		job->mean = mean;
+		job->stdDev = (count != 0 ? sqrt(m2 / count) : 0);
+		for (unsigned j=0; j<C2C_BATCH_PERCENTILE_COUNT; ++j)
+			job->percentiles[j] = estimators[j].value();
+	}
+
+	job->time = eTimer.elapsed() / 1.0e3;
+}
+
+bool ccCommandLineParser::commandC2CBatch(QStringList& arguments)
+{
+	Print("[C2C BATCH]");
+
+	//reference cloud
+	if (m_clouds.empty())
+		return Error(QString("No point cloud available. Be sure to open the reference cloud first!"));
+	else if (m_clouds.size() != 1)
+		ccConsole::Warning("Multiple point clouds loaded! We take the first one as reference by default");
+	ccPointCloud* refPC = m_clouds.front().pc;
+
+	double maxDist = 0.0;
+	unsigned octreeLevel = 0;
+	QString statsFilename;
+	int maxWorkers = std::max(1, QThread::idealThreadCount());
+
+	//local options
+	while (!arguments.empty())
+	{
+		QString argument = arguments.front();
+		if (IsCommand(argument,COMMAND_MAX_DISTANCE))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: value after \"-%1\"").arg(COMMAND_MAX_DISTANCE));
+			bool conversionOk = false;
+			maxDist = arguments.takeFirst().toDouble(&conversionOk);
+			if (!conversionOk)
+				return Error(QString("Invalid parameter: value after \"-%1\"").arg(COMMAND_MAX_DISTANCE));
+		}
+		else if (IsCommand(argument,COMMAND_OCTREE_LEVEL))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: value after \"-%1\"").arg(COMMAND_OCTREE_LEVEL));
+			bool conversionOk = false;
+			octreeLevel = arguments.takeFirst().toUInt(&conversionOk);
+			if (!conversionOk || octreeLevel > CCLib::DgmOctree::MAX_OCTREE_LEVEL)
+				return Error(QString("Invalid parameter: value after \"-%1\"").arg(COMMAND_OCTREE_LEVEL));
+		}
+		else if (IsCommand(argument,COMMAND_C2C_BATCH_STATS_FILE))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: filename after \"-%1\"").arg(COMMAND_C2C_BATCH_STATS_FILE));
+			statsFilename = arguments.takeFirst();
+		}
+		else if (IsCommand(argument,COMMAND_C2C_BATCH_WORKERS))
+		{
+			//local option confirmed, we can move on
+			arguments.pop_front();
+
+			if (arguments.empty())
+				return Error(QString("Missing parameter: number of workers after \"-%1\"").arg(COMMAND_C2C_BATCH_WORKERS));
+			bool conversionOk = false;
+			maxWorkers = arguments.takeFirst().toInt(&conversionOk);
+			if (!conversionOk || maxWorkers < 1)
+				return Error(QString("Invalid parameter: number of workers after \"-%1\"").arg(COMMAND_C2C_BATCH_WORKERS));
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	//epochs (all the following arguments that are not commands)
+	QStringList epochFilenames;
+	while (!arguments.empty() && !arguments.front().startsWith("-"))
+		epochFilenames << arguments.takeFirst();
+	if (epochFilenames.empty())
+		return Error(QString("Missing parameter: epoch filename(s) after \"-%1\"").arg(COMMAND_C2C_BATCH));
+
+	if (!s_autoSaveMode)
+		ccConsole::Warning(QString("[C2C batch] Auto-save is disabled: only the statistics will be output (the epochs are released once processed)"));
+
+	//summary file
+	QFile statsFile;
+	QTextStream statsStream(&statsFile);
+	if (!statsFilename.isEmpty())
+	{
+		statsFile.setFileName(statsFilename);
+		if (!statsFile.open(QFile::WriteOnly | QFile::Text))
+			return Error(QString("Failed to create file '%1'").arg(statsFilename));
+		statsStream << "Epoch,Points,Valid,Mean,StdDev,Min,Max";
+		for (unsigned j=0; j<C2C_BATCH_PERCENTILE_COUNT; ++j)
+			statsStream << QString(",P%1").arg(static_cast<int>(s_c2cBatchPercentiles[j] * 100));
+		statsStream << endl;
+	}
+
+	//the reference octree is computed once: its bounding-box must contain the compared points
+	//(or at least the ones below the max distance). Otherwise a temporary octree is computed
+	//for the corresponding epoch.
+	CCLib::DgmOctree refOctree(refPC);
+	{
+		CCVector3 bbMin, bbMax;
+		refPC->getBoundingBox(bbMin,bbMax);
+		PointCoordinateType margin = static_cast<PointCoordinateType>(maxDist);
+		if (maxDist <= 0)
+		{
+			//no max distance: we keep some room for the epochs that are slightly larger than the reference
+			CCVector3 diag = bbMax - bbMin;
+			margin = std::max(diag.x,std::max(diag.y,diag.z)) / 10;
+		}
+		bbMin -= CCVector3(margin,margin,margin);
+		bbMax += CCVector3(margin,margin,margin);
+		CCLib::CCMiscTools::MakeMinAndMaxCubical(bbMin,bbMax,0.01);
+
+		QElapsedTimer eTimer;
+		eTimer.start();
+		if (refOctree.build(bbMin,bbMax) < 1)
+			return Error("Failed to compute the reference octree! (not enough memory?)");
+		Print(QString("[C2C batch] Reference octree computed in %1 s.").arg(eTimer.elapsed()/1.0e3));
+	}
+
+	QString sfName(CC_CLOUD2CLOUD_DISTANCES_DEFAULT_SF_NAME);
+	QString suffix("C2C_DIST");
+	if (maxDist > 0)
+	{
+		sfName += QString("[<%1]").arg(maxDist);
+		suffix += QString("_MAX_DIST_%1").arg(maxDist);
+	}
+
+	Print(QString("[C2C batch] %1 epoch(s) - up to %2 processed concurrently").arg(epochFilenames.size()).arg(maxWorkers));
+
+	QElapsedTimer batchTimer;
+	batchTimer.start();
+
+	//the epochs are loaded and saved by this thread, while their distances are computed in parallel
+	QList<C2CBatchJob*> pendingJobs;
+	QString errorStr;
+	int epochIndex = 0;
+	while ((epochIndex < epochFilenames.size() || !pendingJobs.empty()) && errorStr.isEmpty())
+	{
+		if (epochIndex < epochFilenames.size() && pendingJobs.size() < maxWorkers)
+		{
+			//load the next epoch
+			QString filename = epochFilenames[epochIndex++];
+			Print(QString("[C2C batch] Opening epoch '%1'").arg(filename));
+			ccHObject* db = FileIOFilter::LoadFromFile(filename,s_loadParameters,QString());
+			if (!db)
+			{
+				errorStr = QString("Failed to open file '%1'").arg(filename);
+				break;
+			}
+
+			ccHObject::Container clouds;
+			db->filterChildren(clouds,true,CC_TYPES::POINT_CLOUD,true);
+			ccPointCloud* cloud = (clouds.empty() ? 0 : static_cast<ccPointCloud*>(clouds.front()));
+			if (cloud)
+			{
+				if (clouds.size() > 1)
+					ccConsole::Warning(QString("[C2C batch] Multiple clouds in file '%1': we take the first one").arg(filename));
+				if (cloud->getParent())
+					cloud->getParent()->detachChild(cloud);
+			}
+			delete db;
+			db = 0;
+
+			if (!cloud || cloud->size() == 0)
+			{
+				ccConsole::Warning(QString("[C2C batch] No point in file '%1' (ignored)").arg(filename));
+				delete cloud;
+				continue;
+			}
+
+			int sfIdx = cloud->getScalarFieldIndexByName(qPrintable(sfName));
+			if (sfIdx < 0)
+				sfIdx = cloud->addScalarField(qPrintable(sfName));
+			if (sfIdx < 0)
+			{
+				delete cloud;
+				errorStr = "Couldn't allocate a new scalar field for computing distances! Try to free some memory ...";
+				break;
+			}
+			cloud->setCurrentScalarField(sfIdx);
+
+			//warn the user if the reference octree can't be used as is for this epoch
+			if (maxDist <= 0)
+			{
+				CCVector3 bbMin, bbMax;
+				cloud->getBoundingBox(bbMin,bbMax);
+				const CCVector3& octreeMin = refOctree.getOctreeMins();
+				const CCVector3& octreeMax = refOctree.getOctreeMaxs();
+				for (unsigned char k=0; k<3; ++k)
+				{
+					if (bbMin.u[k] < octreeMin.u[k] || bbMax.u[k] > octreeMax.u[k])
+					{
+						ccConsole::Warning(QString("[C2C batch] Epoch '%1' extends beyond the reference octree: a temporary octree will be computed (set a max distance to avoid this)").arg(filename));
+						break;
+					}
+				}
+			}
+
+			C2CBatchJob* job = new C2CBatchJob;
+			job->filename = filename;
+			job->cloud = cloud;
+			job->reference = refPC;
+			job->referenceOctree = &refOctree;
+			job->params.maxSearchDist = static_cast<ScalarType>(maxDist);
+			job->params.octreeLevel = static_cast<unsigned char>(octreeLevel);
+			job->params.reuseReferenceOctree = true;
+			job->params.multiThread = false; //the epochs are processed in parallel instead
+			job->future = QtConcurrent::run(ComputeC2CBatchJob, job);
+			pendingJobs.push_back(job);
+			continue;
+		}
+
+		//all the workers are busy (or all the epochs are loaded): we wait for the oldest epoch
+		C2CBatchJob* job = pendingJobs.takeFirst();
+		job->future.waitForFinished();
+
+		if (job->result < 0)
+		{
+			errorStr = QString("An error occured during distances computation for epoch '%1'! (error code: %2)").arg(job->filename).arg(job->result);
+		}
+		else
+		{
+			ccScalarField* sf = static_cast<ccScalarField*>(job->cloud->getCurrentInScalarField());
+			sf->computeMinAndMax();
+			job->cloud->setCurrentDisplayedScalarField(job->cloud->getCurrentInScalarFieldIndex());
+			job->cloud->showSF(true);
+
+			QString percentilesStr;
+			for (unsigned j=0; j<C2C_BATCH_PERCENTILE_COUNT; ++j)
+				percentilesStr += QString(" / P%1 = %2").arg(static_cast<int>(s_c2cBatchPercentiles[j] * 100)).arg(job->percentiles[j]);
+			Print(QString("[C2C batch] Epoch '%1' done in %2 s. - mean distance = %3 / std deviation = %4%5").arg(job->filename).arg(job->time).arg(job->mean).arg(job->stdDev).arg(percentilesStr));
+
+			if (statsFile.isOpen())
+			{
+				statsStream << QString("%1,%2,%3").arg(job->filename).arg(job->cloud->size()).arg(job->validCount);
+				statsStream << QString(",%1,%2,%3,%4").arg(job->mean,0,'g',s_precision).arg(job->stdDev,0,'g',s_precision).arg(job->minDist,0,'g',s_precision).arg(job->maxDist,0,'g',s_precision);
+				for (unsigned j=0; j<C2C_BATCH_PERCENTILE_COUNT; ++j)
+					statsStream << QString(",%1").arg(job->percentiles[j],0,'g',s_precision);
+				statsStream << endl;
+			}
+
+			if (s_autoSaveMode)
+			{
+				CloudDesc desc(job->cloud,job->filename);
+				errorStr = Export(desc,suffix);
+			}
+		}
+
+		delete job->cloud;
+		delete job;
+	}
+
+	//in case of error, we must wait for the running jobs
+	while (!pendingJobs.empty())
+	{
+		C2CBatchJob* job = pendingJobs.takeFirst();
+		job->future.waitForFinished();
+		delete job->cloud;
+		delete job;
+	}
+
+	if (!errorStr.isEmpty())
+		return Error(errorStr);
+
+	double totalTime = batchTimer.elapsed() / 1.0e3;
+	Print(QString("[C2C batch] %1 epoch(s) processed in %2 s. (%3 epochs/hour)").arg(epochIndex).arg(totalTime).arg(totalTime > 0 ? epochIndex * 3600.0 / totalTime : 0));
+
+	return true;
+}
+
 bool ccCommandLineParser::commandStatTest(QStringList& arguments, ccProgressDialog* pDlg/*=0*/)
 {
 	Print("[STATISTICAL TEST]");
@@ -3645,6 +4860,11 @@ int ccCommandLineParser::parse(QStringList& arguments, QDialog* parent/*=0*/)
 		{
 			success = commandRoughness(arguments,parent);
 		}
+		// "MS_FEATURES" MULTI-SCALE FEATURES
+		else if (IsCommand(argument,COMMAND_MULTI_SCALE_FEATURES))
+		{
+			success = commandMultiScaleFeatures(arguments,&progressDlg);
+		}
 		// "APPLY_TRANSFO" (APPLY 4x4 TRANSFORMATION)
 		else if (IsCommand(argument,COMMAND_APPLY_TRANSFORMATION))
 		{
@@ -3665,6 +4885,11 @@ int ccCommandLineParser::parse(QStringList& arguments, QDialog* parent/*=0*/)
 		{
 			success = commandDist(arguments,false,parent);
 		}
+		//Cloud-Cloud distances (batch)
+		else if (IsCommand(argument,COMMAND_C2C_BATCH))
+		{
+			success = commandC2CBatch(arguments);
+		}
 		//Mesh sampling
 		else if (IsCommand(argument,COMMAND_SAMPLE_MESH))
 		{
@@ -3735,6 +4960,11 @@ int ccCommandLineParser::parse(QStringList& arguments, QDialog* parent/*=0*/)
 		{
 			success = commandSORFilter(arguments,&progressDlg);
 		}
+		//Remove duplicate points
+		else if (IsCommand(argument,COMMAND_REMOVE_DUPLICATES))
+		{
+			success = commandRemoveDuplicates(arguments,&progressDlg);
+		}
 		//Change default cloud output format
 		else if (IsCommand(argument,COMMAND_CLOUD_EXPORT_FORMAT))
 		{
@@ -3815,6 +5045,11 @@ int ccCommandLineParser::parse(QStringList& arguments, QDialog* parent/*=0*/)
 		{
 			s_addTimestamp = false;
 		}
+		//save the clouds octree and L.O.D. structures in BIN files
+		else if (IsCommand(argument,COMMAND_BIN_SAVE_STRUCTURES))
+		{
+			s_saveAccelerationStructures = true;
+		}
 		//log file
 		else if (IsCommand(argument,COMMAND_LOG_FILE))
 		{
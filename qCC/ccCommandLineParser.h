@@ -34,9 +34,11 @@ protected:
 	bool commandApproxDensity				(QStringList& arguments, QDialog* parent = 0);
 	bool commandSFGradient					(QStringList& arguments, QDialog* parent = 0);
 	bool commandRoughness					(QStringList& arguments, QDialog* parent = 0);
+	bool commandMultiScaleFeatures			(QStringList& arguments, ccProgressDialog* pDlg = 0);
 	bool commandSampleMesh					(QStringList& arguments, ccProgressDialog* pDlg = 0);
 	bool commandBundler						(QStringList& arguments);
 	bool commandDist						(QStringList& arguments, bool cloud2meshDist, QDialog* parent = 0);
+	bool commandC2CBatch					(QStringList& arguments);
 	bool commandFilterSFByValue				(QStringList& arguments);
 	bool commandMergeClouds					(QStringList& arguments);
 	bool commandStatTest					(QStringList& arguments, ccProgressDialog* pDlg = 0);
@@ -62,6 +64,7 @@ protected:
 	bool commandApplyTransformation			(QStringList& arguments);
 	bool commandLogFile						(QStringList& arguments);
 	bool commandSORFilter					(QStringList& arguments, ccProgressDialog* pDlg = 0);
+	bool commandRemoveDuplicates			(QStringList& arguments, ccProgressDialog* pDlg = 0);
 
 protected:
 
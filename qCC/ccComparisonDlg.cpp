@@ -760,6 +760,7 @@ bool ccComparisonDlg::computeDistances()
 					c2cParams.kNNForLocalModel = static_cast<unsigned>(std::max(0,lmKNNSpinBox->value()));
 					c2cParams.radiusForLocalModel = static_cast<ScalarType>(lmRadiusDoubleSpinBox->value());
 					c2cParams.reuseExistingLocalModels = lmOptimizeCheckBox->isChecked();
+					c2cParams.useLocalModelGrid = lmGridCheckBox->isChecked();
 				}
 			}
 			c2cParams.maxSearchDist = maxSearchDist;
@@ -777,11 +778,6 @@ bool ccComparisonDlg::computeDistances()
 
 	case CLOUDMESH_DIST: //cloud-mesh
 
-		if (multiThread && maxDistCheckBox->isChecked())
-		{
-			ccLog::Warning("[Cloud/Mesh comparison] Max search distance is not supported in multi-thread mode! Switching to single thread mode...");
-		}
-
 		//setup parameters
 		{
 			c2mParams.octreeLevel = static_cast<unsigned char>(octreeLevel);
@@ -837,7 +833,9 @@ bool ccComparisonDlg::computeDistances()
 				m_sfName += QString("[r=%1]").arg(c2cParams.radiusForLocalModel);
 			else
 				m_sfName += QString("[k=%1]").arg(c2cParams.kNNForLocalModel);
-			if (c2cParams.reuseExistingLocalModels)
+			if (c2cParams.useLocalModelGrid)
+				m_sfName += QString("[grid]");
+			else if (c2cParams.reuseExistingLocalModels)
 				m_sfName += QString("[fast]");
 		}
 
@@ -872,6 +870,14 @@ bool ccComparisonDlg::computeDistances()
 			{
 				for (unsigned i=0; i<count; ++i)
 				{
+					if (CPSet->getPointGlobalIndex(i) == CCLib::DgmOctree::INVALID_POINT_INDEX)
+					{
+						//no match (i.e. no point below the max search distance)
+						sfDims[0]->setValue(i,NAN_VALUE);
+						sfDims[1]->setValue(i,NAN_VALUE);
+						sfDims[2]->setValue(i,NAN_VALUE);
+						continue;
+					}
 					const CCVector3* P = CPSet->getPoint(i);
 					const CCVector3* Q = m_compCloud->getPoint(i);
 					CCVector3 D = *Q-*P;
@@ -38,6 +38,7 @@ public:
 	static inline const QString SelectedOutputFilterPoly    () { return "selectedOutputFilterPoly"; }
 	static inline const QString DuplicatePointsGroup        () { return "duplicatePoints"; }
 	static inline const QString DuplicatePointsMinDist      () { return "minDist"; }
+	static inline const QString DuplicatePointsUseGrid      () { return "useGrid"; }
 	static inline const QString HeightGridGeneration        () { return "HeightGridGeneration"; }
 	static inline const QString VolumeCalculation			() { return "VolumeCalculation"; }
 };
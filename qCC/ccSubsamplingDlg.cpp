@@ -107,7 +107,8 @@ CCLib::ReferenceCloud* ccSubsamplingDlg::getSampledCloud(ccGenericPointCloud* cl
 																			minDist,
 																			modParams,
 																			octree,
-																			progressCb);
+																			progressCb,
+																			true); //multi-thread
 			}
 			else
 			{
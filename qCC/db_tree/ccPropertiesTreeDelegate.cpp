@@ -658,6 +658,10 @@ void ccPropertiesTreeDelegate::fillWithPointOctree(ccOctree* _obj)
 	//level
 	appendRow( ITEM("Display level"), PERSISTENT_EDITOR(OBJECT_OCTREE_LEVEL), true );
 
+	//ordered copy of the points (faster neighbourhood extraction)
+	appendRow( ITEM("Ordered points copy"), CHECKABLE_ITEM(_obj->keepOrderedPoints(),OBJECT_OCTREE_ORDERED_POINTS) );
+	appendRow( ITEM("Ordered points memory"), ITEM(QString("%1 Mb").arg((double)_obj->getOrderedPointsMemory()/1048576.0,0,'f',2),Qt::NoItemFlags,OBJECT_OCTREE_ORDERED_POINTS_MEMORY) );
+
 	addSeparator("Current level");
 
 	//current display level
@@ -1720,6 +1724,40 @@ void ccPropertiesTreeDelegate::updateItem(QStandardItem * item)
 		m_currentObject->showNameIn3D(item->checkState() == Qt::Checked);
 		redraw = true;
 		break;
+	case OBJECT_OCTREE_ORDERED_POINTS:
+		{
+			ccOctree* octree = ccHObjectCaster::ToOctree(m_currentObject);
+			assert(octree);
+			if (!octree)
+				break;
+
+			bool state = (item->checkState() == Qt::Checked);
+			if (state == octree->keepOrderedPoints())
+				break;
+			if (!octree->setKeepOrderedPoints(state))
+			{
+				ccLog::Warning("[Octree] Not enough memory to keep an ordered copy of the points!");
+				item->setCheckState(Qt::Unchecked);
+			}
+
+			QString memory = QString("%1 Mb").arg((double)octree->getOrderedPointsMemory()/1048576.0,0,'f',2);
+			if (octree->keepOrderedPoints())
+				ccLog::Print(QString("[Octree] Ordered copy of the points enabled (%1)").arg(memory));
+			else
+				ccLog::Print("[Octree] Ordered copy of the points released");
+
+			//update the 'memory' row
+			for (int i=0; i<m_model->rowCount(); ++i)
+			{
+				QStandardItem* memoryItem = m_model->item(i,1);
+				if (memoryItem && memoryItem->data().isValid() && memoryItem->data().toInt() == OBJECT_OCTREE_ORDERED_POINTS_MEMORY)
+				{
+					memoryItem->setText(memory);
+					break;
+				}
+			}
+		}
+		break;
 	case OBJECT_SHOW_TRANS_BUFFER_PATH:
 		{
 			ccIndexedTransformationBuffer* buffer = ccHObjectCaster::ToTransBuffer(m_currentObject);
@@ -67,6 +67,8 @@ public:
 							OBJECT_SF_SHOW_SCALE					,
 							OBJECT_OCTREE_LEVEL						,
 							OBJECT_OCTREE_TYPE						,
+							OBJECT_OCTREE_ORDERED_POINTS			,
+							OBJECT_OCTREE_ORDERED_POINTS_MEMORY		,
 							OBJECT_MESH_WIRE						,
 							OBJECT_MESH_STIPPLING					,
 							OBJECT_CURRENT_SCALAR_FIELD				,
@@ -3494,14 +3494,26 @@ void MainWindow::doRemoveDuplicatePoints()
 	QSettings settings;
 	settings.beginGroup(ccPS::DuplicatePointsGroup());
 	double minDistanceBetweenPoints = settings.value(ccPS::DuplicatePointsMinDist(),1.0e-12).toDouble();
+	bool useGrid = settings.value(ccPS::DuplicatePointsUseGrid(),true).toBool();
 
 	bool ok;
 	minDistanceBetweenPoints = QInputDialog::getDouble(this, "Remove duplicate points", "Min distance between points:", minDistanceBetweenPoints, 0, 1.0e8, 12, &ok);
 	if (!ok)
 		return;
 
-	//save parameter
+	//detection method
+	{
+		QStringList methods;
+		methods << "Hashed grid (parallel)" << "Octree";
+		QString method = QInputDialog::getItem(this, "Remove duplicate points", "Method:", methods, useGrid ? 0 : 1, false, &ok);
+		if (!ok)
+			return;
+		useGrid = (method == methods[0]);
+	}
+
+	//save parameters
 	settings.setValue(ccPS::DuplicatePointsMinDist(),minDistanceBetweenPoints);
+	settings.setValue(ccPS::DuplicatePointsUseGrid(),useGrid);
 
 	static const char DEFAULT_DUPLICATE_TEMP_SF_NAME[] = "DuplicateFlags";
 
@@ -3524,10 +3536,18 @@ void MainWindow::doRemoveDuplicatePoints()
 				break;
 			}
 
-			ccOctree* octree = cloud->getOctree();
 			ccProgressDialog pDlg(true,this);
 
-			int result = CCLib::GeometricalAnalysisTools::flagDuplicatePoints(cloud,minDistanceBetweenPoints,&pDlg,octree);
+			int result = 0;
+			if (useGrid)
+			{
+				result = CCLib::GeometricalAnalysisTools::flagDuplicatePointsWithGrid(cloud,minDistanceBetweenPoints,&pDlg);
+			}
+			else
+			{
+				ccOctree* octree = cloud->getOctree();
+				result = CCLib::GeometricalAnalysisTools::flagDuplicatePoints(cloud,minDistanceBetweenPoints,&pDlg,octree);
+			}
 
 			if (result >= 0)
 			{